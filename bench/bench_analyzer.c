@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "analyzer.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_analyzer.h"
+
+/*
+ * Streams noise through an analyzer with 2048 sample windows and a hop of
+ * 512 samples with every supported instruction set, and reports the number
+ * of input frames per second the worker thread analyzes on its core. The
+ * writer only waits when the ring is full, so the worker never idles.
+ */
+
+static const int fftSize = 2048;
+static const int hopSize = 512;
+static const int numHops = 20000;
+static const float sampleRate = 48000;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static volatile float sink;
+
+void benchAnalyzer()
+{
+    float* input = malloc(hopSize * sizeof(float));
+    for (int i = 0; i < hopSize; i++)
+    {
+        input[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    
+    printf("Analyzer - %d sample FFT, hop of %d samples\n", fftSize, hopSize);
+    for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON; level++)
+    {
+        mnSIMD_setLevel((mnSIMDLevel)level);
+        if ((int)mnSIMD_getLevel() != level)
+        {
+            continue;
+        }
+        
+        mnAnalyzerOptions options;
+        mnAnalyzerOptions_setDefaults(&options);
+        options.sampleRate = sampleRate;
+        options.fftSize = fftSize;
+        options.hopSize = hopSize;
+        options.bufferSizeInFrames = 16 * hopSize;
+        mnAnalyzer analyzer;
+        mnAnalyzer_start(&analyzer, &options);
+        
+        const double t0 = mnClock_getSeconds();
+        for (int i = 0; i < numHops; i++)
+        {
+            while (mnFIFO_getNumElements(&analyzer.ring) > options.bufferSizeInFrames - hopSize)
+            {
+                sched_yield();
+            }
+            mnAnalyzer_writeInterleaved(&analyzer, input, hopSize);
+        }
+        while (mnAnalyzer_getNumSnapshots(&analyzer) < numHops)
+        {
+            sched_yield();
+        }
+        const double t1 = mnClock_getSeconds();
+        
+        sink = mnAnalyzer_getSnapshot(&analyzer, NULL)->pitch;
+        mnAnalyzer_stop(&analyzer);
+        
+        char name[64];
+        snprintf(name, sizeof(name), "%s (per frame)", levelNames[level]);
+        mnBenchReport(name, (double)numHops * hopSize, t1 - t0);
+        
+        const double duration = numHops * hopSize / sampleRate;
+        printf("  %-48s %10.1f x\n", "faster than real time at 48 kHz", duration / (t1 - t0));
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    free(input);
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_ANALYZER_H
+#define MN_BENCH_ANALYZER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchAnalyzer();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_ANALYZER_H
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdatomic.h>
+#include "tinycthread.h"
+#include "atomic.h"
+#include "bench_timer.h"
+#include "bench_atomic.h"
+
+/*
+ * Compares the full barrier operations used by the original OSAtomic based
+ * backend with the acquire/release and relaxed operations. The original backend
+ * is emulated with C11 atomics so that this benchmark runs on any platform:
+ * loads are an add of zero and stores are a compare-and-swap retry loop.
+ */
+
+static const int loopCount = 10000000;
+static const int handoffCount = 100000;
+
+static int legacyLoad(int* value)
+{
+    return atomic_fetch_add_explicit((_Atomic int*)value, 0, memory_order_seq_cst);
+}
+
+static void legacyStore(int newValue, int* destination)
+{
+    while (1)
+    {
+        int oldValue = *destination;
+        if (atomic_compare_exchange_strong_explicit((_Atomic int*)destination,
+                                                    &oldValue,
+                                                    newValue,
+                                                    memory_order_seq_cst,
+                                                    memory_order_seq_cst))
+        {
+            return;
+        }
+    }
+}
+
+typedef enum
+{
+    ORDERING_LEGACY = 0,
+    ORDERING_SEQ_CST,
+    ORDERING_ACQUIRE_RELEASE,
+    ORDERING_RELAXED
+} Ordering;
+
+static const char* orderingNames[] =
+{
+    "legacy full barrier (add 0 / CAS loop)",
+    "mnAtomicLoad/mnAtomicStore",
+    "mnAtomicLoadAcquire/mnAtomicStoreRelease",
+    "mnAtomicLoadRelaxed/mnAtomicStoreRelaxed"
+};
+
+static inline int load(Ordering ordering, int* value)
+{
+    switch (ordering)
+    {
+        case ORDERING_LEGACY: return legacyLoad(value);
+        case ORDERING_SEQ_CST: return mnAtomicLoad(value);
+        case ORDERING_ACQUIRE_RELEASE: return mnAtomicLoadAcquire(value);
+        default: return mnAtomicLoadRelaxed(value);
+    }
+}
+
+static inline void store(Ordering ordering, int newValue, int* destination)
+{
+    switch (ordering)
+    {
+        case ORDERING_LEGACY: legacyStore(newValue, destination); break;
+        case ORDERING_SEQ_CST: mnAtomicStore(newValue, destination); break;
+        case ORDERING_ACQUIRE_RELEASE: mnAtomicStoreRelease(newValue, destination); break;
+        default: mnAtomicStoreRelaxed(newValue, destination); break;
+    }
+}
+
+static void benchLoadStore(Ordering ordering)
+{
+    int value = 0;
+    const double t0 = mnClock_getSeconds();
+    for (int i = 0; i < loopCount; i++)
+    {
+        store(ordering, load(ordering, &value) + 1, &value);
+    }
+    const double t1 = mnClock_getSeconds();
+    
+    if (value != loopCount)
+    {
+        printf("  unexpected counter value %d\n", value);
+    }
+    mnBenchReport(orderingNames[ordering], loopCount, t1 - t0);
+}
+
+typedef struct
+{
+    Ordering ordering;
+    int payload;
+    int flag;
+} Handoff;
+
+static int entryPointPing(void* data)
+{
+    Handoff* h = (Handoff*)data;
+    for (int i = 0; i < handoffCount; i++)
+    {
+        while (load(h->ordering, &h->flag) != 0)
+        {
+            thrd_yield();
+        }
+        h->payload = i;
+        store(h->ordering, 1, &h->flag);
+    }
+    return 0;
+}
+
+static int entryPointPong(void* data)
+{
+    Handoff* h = (Handoff*)data;
+    for (int i = 0; i < handoffCount; i++)
+    {
+        while (load(h->ordering, &h->flag) != 1)
+        {
+            thrd_yield();
+        }
+        store(h->ordering, 0, &h->flag);
+    }
+    return 0;
+}
+
+static void benchHandoff(Ordering ordering)
+{
+    Handoff h;
+    h.ordering = ordering;
+    h.payload = 0;
+    h.flag = 0;
+    
+    const double t0 = mnClock_getSeconds();
+    thrd_t t1, t2;
+    thrd_create(&t1, entryPointPong, &h);
+    thrd_create(&t2, entryPointPing, &h);
+    int joinRes1, joinRes2;
+    thrd_join(t1, &joinRes1);
+    thrd_join(t2, &joinRes2);
+    const double t1s = mnClock_getSeconds();
+    
+    mnBenchReport(orderingNames[ordering], handoffCount, t1s - t0);
+}
+
+void benchAtomic()
+{
+    printf("Atomics - uncontended load + store, single thread\n");
+    for (int o = ORDERING_LEGACY; o <= ORDERING_RELAXED; o++)
+    {
+        benchLoadStore((Ordering)o);
+    }
+    
+    printf("Atomics - flag handoff between two threads\n");
+    for (int o = ORDERING_LEGACY; o <= ORDERING_ACQUIRE_RELEASE; o++)
+    {
+        benchHandoff((Ordering)o);
+    }
+}
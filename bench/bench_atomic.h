@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_ATOMIC_H
+#define MN_BENCH_ATOMIC_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchAtomic();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_ATOMIC_H
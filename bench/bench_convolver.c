@@ -0,0 +1,154 @@
+#if defined(__linux__)
+//for pthread_getcpuclockid and CLOCK_THREAD_CPUTIME_ID
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include "atomic.h"
+#include "convolver.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_convolver.h"
+
+/*
+ * Convolves ten seconds of mono noise at 48 kHz with impulse responses of
+ * one to four seconds, in buffers of 256 frames with 128 frame blocks, and
+ * reports the CPU time each thread spends per second of audio, divided by
+ * the length of the response in seconds. First with every supported
+ * instruction set and all taps on the audio thread, then with the best one
+ * and 4096 frame tail blocks on the tail thread, which the audio thread
+ * waits for so that no tail block is lost.
+ */
+
+static const float sampleRate = 48000;
+static const int bufferSize = 256;
+static const int numBuffers = 48000 * 10 / 256;
+static const int blockSize = 128;
+static const int tailBlockSize = 4096;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static volatile float sink;
+
+static double getCPUSeconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/**
+ * Returns the audio thread's CPU seconds and stores the tail thread's in
+ * \c tailSeconds.
+ */
+static double run(mnConvolver* convolver, const float* noise, float* buffer, double* tailSeconds)
+{
+    clockid_t tailClock = CLOCK_THREAD_CPUTIME_ID;
+    double tailStart = 0.0;
+    if (convolver->hasTail)
+    {
+        pthread_getcpuclockid(convolver->thread, &tailClock);
+        tailStart = getCPUSeconds(tailClock);
+    }
+    
+    const double start = getCPUSeconds(CLOCK_THREAD_CPUTIME_ID);
+    for (int i = 0; i < numBuffers; i++)
+    {
+        //the tail of the last frame of the buffer comes from two blocks back
+        const int position = convolver->tailBlock * tailBlockSize + convolver->tailPosition + bufferSize - 1;
+        while (convolver->hasTail && mnAtomicLoadAcquire(&convolver->numTailBlocksRead) < position / tailBlockSize - 1)
+        {
+            sched_yield();
+        }
+        memcpy(buffer, noise, bufferSize * sizeof(float));
+        mnConvolver_processPlanar(convolver, &buffer, bufferSize);
+        sink = buffer[0];
+    }
+    const double audioSeconds = getCPUSeconds(CLOCK_THREAD_CPUTIME_ID) - start;
+    
+    *tailSeconds = convolver->hasTail ? getCPUSeconds(tailClock) - tailStart : 0.0;
+    return audioSeconds;
+}
+
+static void report(const char* name, double responseSeconds, double cpuSeconds)
+{
+    const double duration = (double)numBuffers * bufferSize / sampleRate;
+    char label[64];
+    snprintf(label, sizeof(label), "%.40s, %.0f s response", name, responseSeconds);
+    printf("  %-48s %10.4f CPU s per s of audio per s of response\n", label, cpuSeconds / duration / responseSeconds);
+}
+
+void benchConvolver()
+{
+    float* noise = malloc(bufferSize * sizeof(float));
+    float* buffer = malloc(bufferSize * sizeof(float));
+    for (int i = 0; i < bufferSize; i++)
+    {
+        noise[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    
+    printf("Convolver - mono, %d frame blocks, %d frame buffers\n", blockSize, bufferSize);
+    for (int seconds = 1; seconds <= 4; seconds *= 2)
+    {
+        const int length = (int)(seconds * sampleRate);
+        float* response = malloc(length * sizeof(float));
+        for (int i = 0; i < length; i++)
+        {
+            response[i] = 0.001f * (2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f);
+        }
+        
+        for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON + 1; level++)
+        {
+            //the extra pass runs the best level with a tail thread
+            const int hasTail = level > MN_SIMD_NEON;
+            mnSIMD_setLevel(hasTail ? mnSIMD_getBestLevel() : (mnSIMDLevel)level);
+            if (!hasTail && (int)mnSIMD_getLevel() != level)
+            {
+                continue;
+            }
+            
+            mnConvolverOptions options;
+            mnConvolverOptions_setDefaults(&options);
+            options.blockSize = blockSize;
+            options.tailBlockSize = hasTail ? tailBlockSize : 0;
+            options.sampleRate = sampleRate;
+            mnConvolver convolver;
+            mnConvolver_init(&convolver, &options, (const float* const*)&response, length);
+            
+            double tailSeconds;
+            const double audioSeconds = run(&convolver, noise, buffer, &tailSeconds);
+            mnConvolver_deinit(&convolver);
+            
+            char name[64];
+            const char* levelName = levelNames[mnSIMD_getLevel()];
+            if (hasTail)
+            {
+                snprintf(name, sizeof(name), "%s, audio thread with tail", levelName);
+                report(name, seconds, audioSeconds);
+                snprintf(name, sizeof(name), "%s, tail thread", levelName);
+                report(name, seconds, tailSeconds);
+            }
+            else
+            {
+                report(levelName, seconds, audioSeconds);
+            }
+        }
+        
+        free(response);
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    free(noise);
+    free(buffer);
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_CONVOLVER_H
+#define MN_BENCH_CONVOLVER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchConvolver();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_CONVOLVER_H
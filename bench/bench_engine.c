@@ -0,0 +1,133 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "engine.h"
+#include "backend_offline.h"
+#include "bench_timer.h"
+#include "bench_engine.h"
+
+/*
+ * Renders 10 seconds of audio through the offline backend with a fixed DSP
+ * load, reporting the time spent per buffer and the fraction of the real
+ * time budget it uses. The offline backend makes the numbers independent
+ * of the audio hardware and the scheduler.
+ */
+
+#define NUM_OSCILLATORS 32
+
+static const float sampleRate = 48000;
+static const int renderSeconds = 10;
+
+static volatile int sink;
+
+typedef struct
+{
+    float phases[NUM_OSCILLATORS];
+    float increments[NUM_OSCILLATORS];
+} Synth;
+
+static void renderSines(int numChannels, int numFrames, float* samples, void* context)
+{
+    Synth* synth = (Synth*)context;
+    for (int i = 0; i < numFrames; i++)
+    {
+        float sum = 0.0f;
+        for (int o = 0; o < NUM_OSCILLATORS; o++)
+        {
+            sum += sinf(synth->phases[o]);
+            synth->phases[o] += synth->increments[o];
+            if (synth->phases[o] > 6.2831853f)
+            {
+                synth->phases[o] -= 6.2831853f;
+            }
+        }
+        
+        for (int c = 0; c < numChannels; c++)
+        {
+            samples[i * numChannels + c] = sum / NUM_OSCILLATORS;
+        }
+    }
+}
+
+static void benchRender(mnSampleFormat format, const char* formatName, int bufferSize)
+{
+    Synth synth;
+    for (int o = 0; o < NUM_OSCILLATORS; o++)
+    {
+        synth.phases[o] = 0.0f;
+        synth.increments[o] = 6.2831853f * (110.0f * (o + 1)) / sampleRate;
+    }
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.sampleRate = sampleRate;
+    options.bufferSizeInFrames = bufferSize;
+    options.sampleFormat = format;
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, renderSines, &synth, &options);
+    mnEngine_start(&engine);
+    
+    const int numFrames = renderSeconds * (int)sampleRate;
+    const int numBuffers = numFrames / bufferSize;
+    void* output = malloc(bufferSize * 2 * sizeof(float));
+    
+    const double t0 = mnClock_getSeconds();
+    for (int i = 0; i < numBuffers; i++)
+    {
+        mnOfflineBackend_render(&engine, NULL, output, bufferSize);
+    }
+    const double t1 = mnClock_getSeconds();
+    
+    char name[64];
+    snprintf(name, sizeof(name), "%s, %4d frames (per buffer)", formatName, bufferSize);
+    mnBenchReport(name, numBuffers, t1 - t0);
+    mnTimingSnapshot timing;
+    mnEngine_getTimingStats(&engine, &timing);
+    printf("  %-48s %10.2f %% of real time, p99 load %.1f %%\n",
+           "",
+           100.0 * (t1 - t0) / renderSeconds,
+           100.0f * mnTimingSnapshot_getLoadPercentile(&timing, 99));
+    
+    mnEngine_deinit(&engine);
+    free(output);
+}
+
+static void benchTimingStats()
+{
+    const int numRecords = 10000000;
+    mnTimingStats stats;
+    mnTimingStats_init(&stats);
+    
+    double t0 = mnClock_getSeconds();
+    for (int i = 0; i < numRecords; i++)
+    {
+        mnTimingStats_record(&stats, (i & 63) * 1e-4, 256, sampleRate, 256.0 * i);
+    }
+    double t1 = mnClock_getSeconds();
+    mnBenchReport("timing stats, record", numRecords, t1 - t0);
+    
+    const int numSnapshots = 1000000;
+    mnTimingSnapshot snapshot;
+    t0 = mnClock_getSeconds();
+    for (int i = 0; i < numSnapshots; i++)
+    {
+        mnTimingStats_getSnapshot(&stats, &snapshot);
+    }
+    t1 = mnClock_getSeconds();
+    sink = snapshot.numCallbacks;
+    mnBenchReport("timing stats, snapshot", numSnapshots, t1 - t0);
+}
+
+void benchEngine()
+{
+    printf("Engine - %d sine oscillators, stereo output, offline backend\n", NUM_OSCILLATORS);
+    for (int bufferSize = 64; bufferSize <= 1024; bufferSize *= 4)
+    {
+        benchRender(MN_SAMPLE_FORMAT_FLOAT32, "float32", bufferSize);
+        benchRender(MN_SAMPLE_FORMAT_INT16, "int16", bufferSize);
+    }
+    
+    printf("Engine - instrumentation overhead\n");
+    benchTimingStats();
+}
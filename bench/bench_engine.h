@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_ENGINE_H
+#define MN_BENCH_ENGINE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchEngine();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_ENGINE_H
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "atomic.h"
+#include "fifo.h"
+#include "bench_timer.h"
+#include "bench_fifo.h"
+
+/*
+ * Measures mnFIFO throughput against the previous implementation, which wrapped
+ * indices with a modulo, kept head and tail next to each other and loaded the
+ * other side's index on every call. The previous implementation is reproduced
+ * below as LegacyFIFO.
+ *
+ * The printed gains are specific to the machine they are measured on. The
+ * cross-thread stream in particular depends on the number of cores and on
+ * how the two threads are scheduled: on a single core it mostly measures
+ * context switches, and the gain from removing false sharing only shows up
+ * when producer and consumer run on different cores.
+ */
+
+static const int batchCount = 200000;
+static const int batchSize = 64;
+static const int streamCount = 2000000;
+static const int capacity = 1024;
+
+static volatile int sink;
+
+typedef struct
+{
+    int capacity;
+    int elementSize;
+    unsigned char* elements;
+    int head;
+    int tail;
+} LegacyFIFO;
+
+static void legacyInit(LegacyFIFO* fifo, int capacity, int elementSize)
+{
+    memset(fifo, 0, sizeof(LegacyFIFO));
+    fifo->capacity = capacity + 1;
+    fifo->elementSize = elementSize;
+    fifo->elements = malloc(fifo->capacity * elementSize);
+}
+
+static int legacyIncrement(int idx, int capacity)
+{
+    return (idx + 1) % capacity;
+}
+
+static int legacyPush(LegacyFIFO* fifo, const void* element)
+{
+    const int currentTail = mnAtomicLoadRelaxed(&fifo->tail);
+    const int nextTail = legacyIncrement(currentTail, fifo->capacity);
+    if (nextTail != mnAtomicLoadAcquire(&fifo->head))
+    {
+        memcpy(&fifo->elements[currentTail * fifo->elementSize], element, fifo->elementSize);
+        mnAtomicStoreRelease(nextTail, &fifo->tail);
+        return 1;
+    }
+    return 0;
+}
+
+static int legacyPop(LegacyFIFO* fifo, void* element)
+{
+    const int currentHead = mnAtomicLoadRelaxed(&fifo->head);
+    if (currentHead == mnAtomicLoadAcquire(&fifo->tail))
+    {
+        return 0;
+    }
+    memcpy(element, &fifo->elements[currentHead * fifo->elementSize], fifo->elementSize);
+    mnAtomicStoreRelease(legacyIncrement(currentHead, fifo->capacity), &fifo->head);
+    return 1;
+}
+
+typedef struct
+{
+    int legacy;
+    LegacyFIFO legacyFifo;
+    mnFIFO fifo;
+} Queue;
+
+static inline int push(Queue* q, const int* value)
+{
+    return q->legacy ? legacyPush(&q->legacyFifo, value) : mnFIFO_push(&q->fifo, value);
+}
+
+static inline int pop(Queue* q, int* value)
+{
+    return q->legacy ? legacyPop(&q->legacyFifo, value) : mnFIFO_pop(&q->fifo, value);
+}
+
+static void queueInit(Queue* q, int legacy)
+{
+    q->legacy = legacy;
+    legacyInit(&q->legacyFifo, capacity, sizeof(int));
+    mnFIFO_init(&q->fifo, capacity, sizeof(int));
+}
+
+static void queueDeinit(Queue* q)
+{
+    free(q->legacyFifo.elements);
+    mnFIFO_deinit(&q->fifo);
+}
+
+static double benchBatches(int legacy)
+{
+    Queue q;
+    queueInit(&q, legacy);
+    
+    int sum = 0;
+    const double t0 = mnClock_getSeconds();
+    for (int b = 0; b < batchCount; b++)
+    {
+        for (int i = 0; i < batchSize; i++)
+        {
+            push(&q, &i);
+        }
+        for (int i = 0; i < batchSize; i++)
+        {
+            int val = 0;
+            pop(&q, &val);
+            sum += val;
+        }
+    }
+    const double t1 = mnClock_getSeconds();
+    
+    queueDeinit(&q);
+    
+    const double ops = 2.0 * batchCount * batchSize;
+    mnBenchReport(legacy ? "previous FIFO" : "mnFIFO", ops, t1 - t0);
+    sink = sum;
+    return ops / (t1 - t0);
+}
+
+static int entryPointProducer(void* data)
+{
+    Queue* q = (Queue*)data;
+    for (int i = 0; i < streamCount; i++)
+    {
+        while (!push(q, &i))
+        {
+            thrd_yield();
+        }
+    }
+    return 0;
+}
+
+static int entryPointConsumer(void* data)
+{
+    Queue* q = (Queue*)data;
+    for (int i = 0; i < streamCount; i++)
+    {
+        int val = 0;
+        while (!pop(q, &val))
+        {
+            thrd_yield();
+        }
+    }
+    return 0;
+}
+
+static double benchStream(int legacy)
+{
+    Queue q;
+    queueInit(&q, legacy);
+    
+    const double t0 = mnClock_getSeconds();
+    thrd_t t1, t2;
+    thrd_create(&t1, entryPointConsumer, &q);
+    thrd_create(&t2, entryPointProducer, &q);
+    int joinRes1, joinRes2;
+    thrd_join(t1, &joinRes1);
+    thrd_join(t2, &joinRes2);
+    const double t1s = mnClock_getSeconds();
+    
+    queueDeinit(&q);
+    
+    mnBenchReport(legacy ? "previous FIFO" : "mnFIFO", streamCount, t1s - t0);
+    return streamCount / (t1s - t0);
+}
+
+static const int blockCount = 20000;
+/** Read at run time, like the frame count passed to an audio callback. */
+static volatile int numBlockSamples = 512 * 2;
+
+typedef enum
+{
+    BLOCK_PER_ELEMENT = 0,
+    BLOCK_BULK,
+    BLOCK_SPANS
+} BlockMethod;
+
+static const char* blockMethodNames[] =
+{
+    "mnFIFO_push/mnFIFO_pop per sample",
+    "mnFIFO_pushN/mnFIFO_popN",
+    "mnFIFO_reserveWrite/mnFIFO_peekRead in place"
+};
+
+/** Stands in for DSP producing samples. */
+static void render(float* samples, int numSamples, int offset)
+{
+    for (int i = 0; i < numSamples; i++)
+    {
+        samples[i] = 0.5f * (float)(offset + i);
+    }
+}
+
+/** Stands in for an audio callback consuming samples. */
+static void consume(const float* samples, float* device, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++)
+    {
+        device[i] = samples[i];
+    }
+}
+
+/*
+ * Every method renders a block, passes it through the FIFO and consumes it.
+ * The copying methods use scratch buffers on both sides, the span method
+ * renders and consumes in place. The block size is only known at run time,
+ * as in a callback. A compile time block size would let the compiler fully
+ * vectorize the loops over the scratch buffers but not the loops over the
+ * spans, whose lengths depend on where the FIFO wraps, which measures the
+ * compiler rather than the FIFO.
+ */
+static void benchBlocks(BlockMethod method)
+{
+    const int blockSamples = numBlockSamples;
+    mnFIFO fifo;
+    mnFIFO_init(&fifo, 4 * blockSamples, sizeof(float));
+    
+    float* source = malloc(blockSamples * sizeof(float));
+    float* target = malloc(blockSamples * sizeof(float));
+    float* device = malloc(blockSamples * sizeof(float));
+    
+    const double t0 = mnClock_getSeconds();
+    for (int b = 0; b < blockCount; b++)
+    {
+        if (method == BLOCK_PER_ELEMENT)
+        {
+            render(source, blockSamples, 0);
+            for (int i = 0; i < blockSamples; i++)
+            {
+                mnFIFO_push(&fifo, &source[i]);
+            }
+            for (int i = 0; i < blockSamples; i++)
+            {
+                mnFIFO_pop(&fifo, &target[i]);
+            }
+            consume(target, device, blockSamples);
+        }
+        else if (method == BLOCK_BULK)
+        {
+            render(source, blockSamples, 0);
+            mnFIFO_pushN(&fifo, source, blockSamples);
+            mnFIFO_popN(&fifo, target, blockSamples);
+            consume(target, device, blockSamples);
+        }
+        else
+        {
+            mnFIFOSpans spans;
+            const int numReserved = mnFIFO_reserveWrite(&fifo, blockSamples, &spans);
+            render((float*)spans.elements[0], spans.numElements[0], 0);
+            render((float*)spans.elements[1], spans.numElements[1], spans.numElements[0]);
+            mnFIFO_commitWrite(&fifo, numReserved);
+            
+            const int numReadable = mnFIFO_peekRead(&fifo, blockSamples, &spans);
+            consume((const float*)spans.elements[0], device, spans.numElements[0]);
+            consume((const float*)spans.elements[1], device + spans.numElements[0], spans.numElements[1]);
+            mnFIFO_consumeRead(&fifo, numReadable);
+        }
+    }
+    const double t1 = mnClock_getSeconds();
+    sink = (int)device[blockSamples - 1];
+    
+    free(source);
+    free(target);
+    free(device);
+    mnFIFO_deinit(&fifo);
+    
+    mnBenchReport(blockMethodNames[method], blockCount, t1 - t0);
+}
+
+void benchFIFO()
+{
+    printf("FIFO - push %d / pop %d batches, single thread\n", batchSize, batchSize);
+    const double legacyBatch = benchBatches(1);
+    const double batch = benchBatches(0);
+    printf("  gain: %.2fx ops/sec\n", batch / legacyBatch);
+    
+    printf("FIFO - %d ints from producer thread to consumer thread\n", streamCount);
+    const double legacyStream = benchStream(1);
+    const double stream = benchStream(0);
+    printf("  gain: %.2fx ops/sec\n", stream / legacyStream);
+    
+    printf("FIFO - render, transfer and consume 512 stereo float frames per op, single thread\n");
+    for (int m = BLOCK_PER_ELEMENT; m <= BLOCK_SPANS; m++)
+    {
+        benchBlocks((BlockMethod)m);
+    }
+}
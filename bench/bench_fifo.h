@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_FIFO_H
+#define MN_BENCH_FIFO_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchFIFO();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_FIFO_H
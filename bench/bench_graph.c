@@ -0,0 +1,102 @@
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "graph.h"
+#include "bench_timer.h"
+#include "bench_graph.h"
+
+/*
+ * Processes 512 frame buffers of a graph with 16 independent nodes, each
+ * rendering a few sines into its own buffer and a final mix node depending
+ * on all of them, serially and with one worker per remaining core.
+ */
+
+#define NUM_VOICES 16
+#define NUM_FRAMES 512
+
+static const int bufferCount = 400;
+static const float sampleRate = 44100;
+
+static volatile float sink;
+
+typedef struct
+{
+    float phase;
+    float increment;
+    float samples[NUM_FRAMES];
+} Voice;
+
+static Voice voices[NUM_VOICES];
+static float mix[NUM_FRAMES];
+
+static void renderVoice(int numFrames, void* context)
+{
+    Voice* voice = (Voice*)context;
+    for (int i = 0; i < numFrames; i++)
+    {
+        float value = 0.0f;
+        for (int h = 1; h <= 8; h++)
+        {
+            value += sinf(h * voice->phase) / h;
+        }
+        voice->samples[i] = value;
+        voice->phase = fmodf(voice->phase + voice->increment, 6.2831853f);
+    }
+}
+
+static void mixVoices(int numFrames, void* context)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        float sum = 0.0f;
+        for (int v = 0; v < NUM_VOICES; v++)
+        {
+            sum += voices[v].samples[i];
+        }
+        mix[i] = sum;
+    }
+}
+
+static void benchGraphWithWorkers(int numWorkers)
+{
+    mnGraph graph;
+    mnGraph_init(&graph, NUM_VOICES + 1, numWorkers, sampleRate, NULL);
+    //measure the parallel speed even if buffers run late
+    graph.deadlineFraction = 1000.0f;
+    
+    const int mixNode = mnGraph_addNode(&graph, mixVoices, NULL);
+    for (int v = 0; v < NUM_VOICES; v++)
+    {
+        voices[v].phase = 0.0f;
+        voices[v].increment = 6.2831853f * 110.0f * (v + 1) / sampleRate;
+        mnGraph_addDependency(&graph, mixNode, mnGraph_addNode(&graph, renderVoice, &voices[v]));
+    }
+    mnGraph_compile(&graph);
+    
+    const double t0 = mnClock_getSeconds();
+    for (int b = 0; b < bufferCount; b++)
+    {
+        mnGraph_process(&graph, NUM_FRAMES);
+    }
+    const double t1 = mnClock_getSeconds();
+    sink = mix[NUM_FRAMES - 1];
+    
+    char name[64];
+    snprintf(name, sizeof(name), "%d workers (per buffer)", numWorkers);
+    mnBenchReport(name, bufferCount, t1 - t0);
+    printf("  %-48s %10.1f %% of real time\n", "", 100.0 * (t1 - t0) / (bufferCount * NUM_FRAMES / sampleRate));
+    
+    mnGraph_deinit(&graph);
+}
+
+void benchGraph()
+{
+    const long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("Graph - %d voice nodes and a mix node, %d frames, %ld cores\n", NUM_VOICES, NUM_FRAMES, numCores);
+    
+    benchGraphWithWorkers(0);
+    if (numCores > 1)
+    {
+        benchGraphWithWorkers((int)numCores - 1);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_GRAPH_H
+#define MN_BENCH_GRAPH_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchGraph();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_GRAPH_H
@@ -0,0 +1,75 @@
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <time.h>
+#include "log.h"
+#include "bench_timer.h"
+#include "bench_log.h"
+
+/*
+ * Measures what the audio thread pays for a log message: walking the format
+ * string, copying the arguments and pushing the record. The log thread
+ * writes to /dev/null and is given time to drain the queue between rounds,
+ * so no records are dropped.
+ */
+
+static const int numRecordsPerRound = 512;
+static const int numRounds = 400;
+
+static void benchFormat(mnLog* log, const char* name, int numArguments)
+{
+    double seconds = 0.0;
+    for (int r = 0; r < numRounds; r++)
+    {
+        const double t0 = mnClock_getSeconds();
+        for (int i = 0; i < numRecordsPerRound; i++)
+        {
+            switch (numArguments)
+            {
+                case 0:
+                    mnLog_write(log, i, "buffer done");
+                    break;
+                case 1:
+                    mnLog_write(log, i, "voice %d started", i);
+                    break;
+                default:
+                    mnLog_write(log, i, "voice %d: %.2f Hz, gain %5.1f dB, %s", i, 440.0, -6.0, "sustain");
+                    break;
+            }
+        }
+        seconds += mnClock_getSeconds() - t0;
+        
+        while (mnMPSCQueue_getNumElements(&log->queue) > 0)
+        {
+            struct timespec duration = {0, 100000};
+            nanosleep(&duration, NULL);
+        }
+    }
+    mnBenchReport(name, numRecordsPerRound * numRounds, seconds);
+}
+
+void benchLog()
+{
+    mnLogOptions options;
+    mnLogOptions_setDefaults(&options);
+    options.path = "/dev/null";
+    options.capacity = numRecordsPerRound;
+    options.flushIntervalMilliseconds = 1;
+    mnLog log;
+    if (!mnLog_start(&log, &options))
+    {
+        printf("Log - could not open /dev/null\n");
+        return;
+    }
+    
+    printf("Log - %d records per round\n", numRecordsPerRound);
+    benchFormat(&log, "mnLog_write, no arguments", 0);
+    benchFormat(&log, "mnLog_write, one int", 1);
+    benchFormat(&log, "mnLog_write, int, 2 doubles, string", 4);
+    printf("  %-48s %10d\n", "dropped records", mnLog_getNumDroppedRecords(&log));
+    
+    mnLog_stop(&log);
+}
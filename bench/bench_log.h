@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_LOG_H
+#define MN_BENCH_LOG_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchLog();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_LOG_H
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "meter.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_meter.h"
+
+/*
+ * Meters 8 interleaved channels in 512 frame buffers at 48 kHz with every
+ * supported instruction set, and reports the share of each buffer's
+ * duration spent measuring it.
+ */
+
+static const int blockFrames = 512;
+static const int numChannels = 8;
+static const int callCount = 4000;
+static const float sampleRate = 48000;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static volatile float sink;
+
+void benchMeter()
+{
+    float* input = malloc(blockFrames * numChannels * sizeof(float));
+    for (int i = 0; i < blockFrames * numChannels; i++)
+    {
+        input[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+    }
+    
+    printf("Meter - %d channels, %d frames per call\n", numChannels, blockFrames);
+    for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON; level++)
+    {
+        mnSIMD_setLevel((mnSIMDLevel)level);
+        if ((int)mnSIMD_getLevel() != level)
+        {
+            continue;
+        }
+        
+        mnMeter meter;
+        mnMeter_init(&meter, numChannels, sampleRate);
+        const double t0 = mnClock_getSeconds();
+        for (int i = 0; i < callCount; i++)
+        {
+            mnMeter_processInterleaved(&meter, input, blockFrames);
+        }
+        const double t1 = mnClock_getSeconds();
+        
+        mnMeterLevels levels[8];
+        mnMeter_getLevels(&meter, levels);
+        sink = levels[0].truePeak;
+        mnMeter_deinit(&meter);
+        
+        char name[64];
+        snprintf(name, sizeof(name), "%s (per buffer)", levelNames[level]);
+        mnBenchReport(name, callCount, t1 - t0);
+        
+        const double budget = callCount * blockFrames / sampleRate;
+        printf("  %-48s %10.3f %%\n", "share of the buffer duration", 100.0 * (t1 - t0) / budget);
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    free(input);
+}
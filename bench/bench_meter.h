@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_METER_H
+#define MN_BENCH_METER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchMeter();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_METER_H
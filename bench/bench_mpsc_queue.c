@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include "tinycthread.h"
+#include "fifo.h"
+#include "mpsc_queue.h"
+#include "bench_timer.h"
+#include "bench_mpsc_queue.h"
+
+/*
+ * Sends a fixed number of events from 1 to 16 producer threads to a single
+ * consumer, which drains them in batches like an audio callback would. Compares
+ * mnMPSCQueue with an mnFIFO whose producer side is serialized by a mutex.
+ */
+
+#define MAX_PRODUCERS 16
+
+static const int totalEventCount = 1 << 20;
+static const int queueCapacity = 1024;
+static const int batchSize = 64;
+
+typedef struct
+{
+    int type;
+    float value;
+} Event;
+
+typedef struct
+{
+    int useMutex;
+    int eventsPerProducer;
+    mnMPSCQueue queue;
+    mnFIFO fifo;
+    mtx_t mutex;
+} Channel;
+
+static int entryPointProducer(void* data)
+{
+    Channel* c = (Channel*)data;
+    Event e;
+    e.type = 0;
+    
+    for (int i = 0; i < c->eventsPerProducer; i++)
+    {
+        e.value = (float)i;
+        while (1)
+        {
+            int success = 0;
+            if (c->useMutex)
+            {
+                mtx_lock(&c->mutex);
+                success = mnFIFO_push(&c->fifo, &e);
+                mtx_unlock(&c->mutex);
+            }
+            else
+            {
+                success = mnMPSCQueue_push(&c->queue, &e);
+            }
+            
+            if (success)
+            {
+                break;
+            }
+            thrd_yield();
+        }
+    }
+    
+    return 0;
+}
+
+static void benchProducers(int useMutex, int numProducers)
+{
+    Channel c;
+    c.useMutex = useMutex;
+    c.eventsPerProducer = totalEventCount / numProducers;
+    mnMPSCQueue_init(&c.queue, queueCapacity, sizeof(Event));
+    mnFIFO_init(&c.fifo, queueCapacity, sizeof(Event));
+    mtx_init(&c.mutex, mtx_plain);
+    
+    const int numEvents = c.eventsPerProducer * numProducers;
+    
+    const double t0 = mnClock_getSeconds();
+    thrd_t threads[MAX_PRODUCERS];
+    for (int p = 0; p < numProducers; p++)
+    {
+        thrd_create(&threads[p], entryPointProducer, &c);
+    }
+    
+    Event batch[64];
+    int numReceived = 0;
+    while (numReceived < numEvents)
+    {
+        const int n = useMutex ? mnFIFO_popN(&c.fifo, batch, batchSize) :
+                                 mnMPSCQueue_popN(&c.queue, batch, batchSize);
+        if (n == 0)
+        {
+            thrd_yield();
+        }
+        numReceived += n;
+    }
+    
+    for (int p = 0; p < numProducers; p++)
+    {
+        int joinRes;
+        thrd_join(threads[p], &joinRes);
+    }
+    const double t1 = mnClock_getSeconds();
+    
+    char name[64];
+    snprintf(name, sizeof(name), "%s, %2d producers", useMutex ? "mutex + mnFIFO" : "mnMPSCQueue", numProducers);
+    mnBenchReport(name, numEvents, t1 - t0);
+    
+    mtx_destroy(&c.mutex);
+    mnFIFO_deinit(&c.fifo);
+    mnMPSCQueue_deinit(&c.queue);
+}
+
+void benchMPSCQueue()
+{
+    printf("MPSC queue - %d events, batched draining by one consumer\n", totalEventCount);
+    for (int numProducers = 1; numProducers <= MAX_PRODUCERS; numProducers *= 2)
+    {
+        benchProducers(0, numProducers);
+        benchProducers(1, numProducers);
+    }
+}
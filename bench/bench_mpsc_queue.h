@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_MPSC_QUEUE_H
+#define MN_BENCH_MPSC_QUEUE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchMPSCQueue();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_MPSC_QUEUE_H
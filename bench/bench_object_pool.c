@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "atomic.h"
+#include "arena.h"
+#include "object_pool.h"
+#include "bench_timer.h"
+#include "bench_object_pool.h"
+
+/*
+ * Times what an audio callback allocating voices, events and a scratch buffer
+ * pays per buffer, with malloc/free and with an object pool and an arena.
+ * Meanwhile a control thread churns the general purpose heap with allocations
+ * of random sizes, and reclaims objects retired by the audio thread. What
+ * matters for real time use is the tail of the latency distribution, not
+ * the mean.
+ */
+
+#define VOICES_PER_BUFFER 8
+#define EVENTS_PER_BUFFER 4
+
+static const int bufferCount = 200000;
+static const int scratchSize = 4096;
+/** Room for the voices retired between two reclaims. */
+static const int retiredCapacity = 256;
+
+typedef struct
+{
+    float state[60];
+} Voice;
+
+typedef struct
+{
+    double sampleTime;
+    int type;
+    float value;
+} Event;
+
+typedef struct
+{
+    int done;
+    mnObjectPool* voicePool;
+} Control;
+
+static int entryPointControl(void* data)
+{
+    Control* control = (Control*)data;
+    void* blocks[256] = {0};
+    unsigned int seed = 1;
+    
+    while (!mnAtomicLoad(&control->done))
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            free(blocks[i]);
+            blocks[i] = malloc(16 + (seed >> 16) % 8192);
+        }
+        
+        if (control->voicePool)
+        {
+            mnObjectPool_reclaim(control->voicePool, NULL, NULL);
+        }
+        thrd_yield();
+    }
+    
+    for (int i = 0; i < 256; i++)
+    {
+        free(blocks[i]);
+    }
+    return 0;
+}
+
+static int compareDoubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void report(const char* name, double* latencies)
+{
+    qsort(latencies, bufferCount, sizeof(double), compareDoubles);
+    printf("  %-28s p50 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns  max %10.0f ns\n",
+           name,
+           1e9 * latencies[bufferCount / 2],
+           1e9 * latencies[bufferCount * 99 / 100],
+           1e9 * latencies[bufferCount * 999 / 1000],
+           1e9 * latencies[bufferCount - 1]);
+}
+
+static void benchMalloc(double* latencies)
+{
+    Control control;
+    memset(&control, 0, sizeof(Control));
+    thrd_t thread;
+    thrd_create(&thread, entryPointControl, &control);
+    
+    Voice* voices[VOICES_PER_BUFFER];
+    Event* events[EVENTS_PER_BUFFER];
+    for (int b = 0; b < bufferCount; b++)
+    {
+        const double t0 = mnClock_getSeconds();
+        for (int i = 0; i < VOICES_PER_BUFFER; i++)
+        {
+            voices[i] = malloc(sizeof(Voice));
+            voices[i]->state[0] = (float)i;
+        }
+        for (int i = 0; i < EVENTS_PER_BUFFER; i++)
+        {
+            events[i] = malloc(sizeof(Event));
+            events[i]->value = (float)i;
+        }
+        float* scratch = malloc(scratchSize);
+        scratch[0] = 0.0f;
+        
+        free(scratch);
+        for (int i = 0; i < EVENTS_PER_BUFFER; i++)
+        {
+            free(events[i]);
+        }
+        for (int i = 0; i < VOICES_PER_BUFFER; i++)
+        {
+            free(voices[i]);
+        }
+        latencies[b] = mnClock_getSeconds() - t0;
+        
+        //wait for the next callback
+        thrd_yield();
+    }
+    
+    mnAtomicStore(1, &control.done);
+    thrd_join(thread, NULL);
+    report("malloc/free", latencies);
+}
+
+static void benchPool(double* latencies)
+{
+    mnObjectPool voicePool;
+    mnObjectPool_init(&voicePool, sizeof(Voice), retiredCapacity + VOICES_PER_BUFFER);
+    mnObjectPool eventPool;
+    mnObjectPool_init(&eventPool, sizeof(Event), EVENTS_PER_BUFFER);
+    mnArena arena;
+    mnArena_init(&arena, 4 * scratchSize);
+    
+    Control control;
+    memset(&control, 0, sizeof(Control));
+    control.voicePool = &voicePool;
+    thrd_t thread;
+    thrd_create(&thread, entryPointControl, &control);
+    
+    Voice* voices[VOICES_PER_BUFFER];
+    Event* events[EVENTS_PER_BUFFER];
+    int numMissing = 0;
+    for (int b = 0; b < bufferCount; b++)
+    {
+        const double t0 = mnClock_getSeconds();
+        const int mark = mnArena_getMark(&arena);
+        for (int i = 0; i < VOICES_PER_BUFFER; i++)
+        {
+            voices[i] = mnObjectPool_alloc(&voicePool);
+            if (voices[i])
+            {
+                voices[i]->state[0] = (float)i;
+            }
+        }
+        for (int i = 0; i < EVENTS_PER_BUFFER; i++)
+        {
+            events[i] = mnObjectPool_alloc(&eventPool);
+            events[i]->value = (float)i;
+        }
+        float* scratch = mnArena_alloc(&arena, scratchSize);
+        scratch[0] = 0.0f;
+        
+        //one voice per buffer is handed to the control thread, the rest
+        //are freed by the audio thread
+        mnArena_reset(&arena, mark);
+        for (int i = 0; i < EVENTS_PER_BUFFER; i++)
+        {
+            mnObjectPool_free(&eventPool, events[i]);
+        }
+        for (int i = 0; i < VOICES_PER_BUFFER; i++)
+        {
+            if (!voices[i])
+            {
+                numMissing++;
+            }
+            else if (i == 0)
+            {
+                mnObjectPool_retire(&voicePool, voices[i]);
+            }
+            else
+            {
+                mnObjectPool_free(&voicePool, voices[i]);
+            }
+        }
+        latencies[b] = mnClock_getSeconds() - t0;
+        
+        //wait for the next callback
+        thrd_yield();
+    }
+    
+    mnAtomicStore(1, &control.done);
+    thrd_join(thread, NULL);
+    report("object pool + arena", latencies);
+    if (numMissing > 0)
+    {
+        printf("  %-28s %d voices not yet reclaimed when needed\n", "", numMissing);
+    }
+    
+    mnArena_deinit(&arena);
+    mnObjectPool_deinit(&eventPool);
+    mnObjectPool_deinit(&voicePool);
+}
+
+void benchObjectPool()
+{
+    printf("Object pool - per buffer, %d voices, %d events and a %d byte scratch buffer, heap churned by another thread\n",
+           VOICES_PER_BUFFER, EVENTS_PER_BUFFER, scratchSize);
+    double* latencies = malloc(bufferCount * sizeof(double));
+    benchMalloc(latencies);
+    benchPool(latencies);
+    free(latencies);
+}
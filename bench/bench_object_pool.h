@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_OBJECT_POOL_H
+#define MN_BENCH_OBJECT_POOL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchObjectPool();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_OBJECT_POOL_H
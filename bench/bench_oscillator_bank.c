@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "dsp_math.h"
+#include "oscillator_bank.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_oscillator_bank.h"
+
+/*
+ * Renders blocks of 512 frames at 44.1 kHz and reports how many voices one
+ * core could render in real time, for the oscillator bank with every
+ * supported instruction set and for the per sample sinf loop the demo synth
+ * used before, with the same per sample frequency and amplitude smoothing.
+ */
+
+#define SAMPLE_RATE 44100.0f
+#define BLOCK_SIZE 512
+#define NUM_VOICES 256
+
+static const int blockCount = 400;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static volatile float sink;
+
+static void reportVoicesPerCore(const char* name, double seconds)
+{
+    const double secondsPerVoiceBlock = seconds / ((double)blockCount * NUM_VOICES);
+    const double blockSeconds = BLOCK_SIZE / SAMPLE_RATE;
+    
+    char fullName[128];
+    snprintf(fullName, sizeof(fullName), "%s (per voice and block)", name);
+    mnBenchReport(fullName, (double)blockCount * NUM_VOICES, seconds);
+    printf("  %-48s %10.0f voices per core\n", "", blockSeconds / secondsPerVoiceBlock);
+}
+
+typedef struct
+{
+    float phase;
+    float frequency;
+    float targetFrequency;
+    float amplitude;
+    float targetAmplitude;
+} SinfVoice;
+
+static void renderSinf(SinfVoice* voices, float* output)
+{
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        output[i] = 0.0f;
+    }
+    
+    for (int v = 0; v < NUM_VOICES; v++)
+    {
+        SinfVoice* voice = &voices[v];
+        float phase = voice->phase;
+        float frequency = voice->frequency;
+        float amplitude = voice->amplitude;
+        for (int i = 0; i < BLOCK_SIZE; i++)
+        {
+            output[i] += amplitude * sinf(phase);
+            phase += 2.0f * (float)MN_PI * frequency / SAMPLE_RATE;
+            frequency = 0.9995f * frequency + 0.0005f * voice->targetFrequency;
+            amplitude = 0.999f * amplitude + 0.001f * voice->targetAmplitude;
+        }
+        
+        voice->phase = fmodf(phase, 2.0f * (float)MN_PI);
+        voice->frequency = frequency;
+        voice->amplitude = amplitude;
+    }
+}
+
+static void benchSinf()
+{
+    SinfVoice* voices = malloc(NUM_VOICES * sizeof(SinfVoice));
+    for (int v = 0; v < NUM_VOICES; v++)
+    {
+        voices[v].phase = 0.0f;
+        voices[v].frequency = 110.0f + 10.0f * v;
+        voices[v].targetFrequency = voices[v].frequency;
+        voices[v].amplitude = 0.0f;
+        voices[v].targetAmplitude = 1.0f / NUM_VOICES;
+    }
+    
+    float output[BLOCK_SIZE];
+    const double t0 = mnClock_getSeconds();
+    for (int b = 0; b < blockCount; b++)
+    {
+        renderSinf(voices, output);
+    }
+    const double t1 = mnClock_getSeconds();
+    sink = output[BLOCK_SIZE - 1];
+    
+    reportVoicesPerCore("per sample sinf", t1 - t0);
+    free(voices);
+}
+
+static void benchBank(int level)
+{
+    mnOscillatorBank bank;
+    mnOscillatorBank_init(&bank, NUM_VOICES, SAMPLE_RATE);
+    for (int v = 0; v < NUM_VOICES; v++)
+    {
+        mnOscillatorBank_noteOn(&bank, 110.0f + 10.0f * v, 1.0f / NUM_VOICES);
+    }
+    
+    //a quarter of the voices glide every block
+    float output[BLOCK_SIZE];
+    const double t0 = mnClock_getSeconds();
+    for (int b = 0; b < blockCount; b++)
+    {
+        for (int v = b % 4; v < NUM_VOICES; v += 4)
+        {
+            mnOscillatorBank_setFrequency(&bank, v, (110.0f + 10.0f * v) * (b % 8 < 4 ? 1.0f : 1.01f));
+        }
+        mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    }
+    const double t1 = mnClock_getSeconds();
+    sink = output[BLOCK_SIZE - 1];
+    
+    char name[64];
+    snprintf(name, sizeof(name), "%s oscillator bank", levelNames[level]);
+    reportVoicesPerCore(name, t1 - t0);
+    
+    mnOscillatorBank_deinit(&bank);
+}
+
+void benchOscillatorBank()
+{
+    printf("Oscillator bank - %d voices, %d frames at %.0f Hz\n", NUM_VOICES, BLOCK_SIZE, SAMPLE_RATE);
+    
+    benchSinf();
+    
+    for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON; level++)
+    {
+        mnSIMD_setLevel((mnSIMDLevel)level);
+        if ((int)mnSIMD_getLevel() != level)
+        {
+            continue;
+        }
+        benchBank(level);
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_OSCILLATOR_BANK_H
+#define MN_BENCH_OSCILLATOR_BANK_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchOscillatorBank();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_OSCILLATOR_BANK_H
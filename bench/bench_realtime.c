@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include "backend_offline.h"
+#include "engine.h"
+#include "bench_timer.h"
+#include "bench_realtime.h"
+
+/*
+ * Runs an output callback made of one pole smoothers, like the gain and
+ * frequency smoothers of a synth voice, through the offline backend. Once
+ * the input goes silent, the smoothers decay into the denormal range, where
+ * a coefficient as close to 1 as 0.99995 keeps them forever: the product
+ * rounds back to the same denormal. Measures a buffer with the smoothers
+ * in the normal range, and in silence with and without the engine
+ * flushing denormals to zero.
+ */
+
+#define NUM_SMOOTHERS 64
+
+static const int bufferSize = 512;
+static const int numBuffers = 2000;
+
+typedef struct
+{
+    float coefficients[NUM_SMOOTHERS];
+    float states[NUM_SMOOTHERS];
+    float input;
+} Smoothers;
+
+static void renderSmoothers(int numChannels, int numFrames, float* samples, void* context)
+{
+    Smoothers* smoothers = (Smoothers*)context;
+    for (int i = 0; i < numFrames; i++)
+    {
+        float sum = 0.0f;
+        for (int s = 0; s < NUM_SMOOTHERS; s++)
+        {
+            const float c = smoothers->coefficients[s];
+            smoothers->states[s] = c * smoothers->states[s] + (1.0f - c) * smoothers->input;
+            sum += smoothers->states[s];
+        }
+        for (int c = 0; c < numChannels; c++)
+        {
+            samples[i * numChannels + c] = sum;
+        }
+    }
+}
+
+/**
+ * @param input The value the smoothers are fed, 0 for silence.
+ */
+static void benchSmoothers(const char* name, float input, float initialState, int flushDenormals)
+{
+    Smoothers smoothers;
+    for (int s = 0; s < NUM_SMOOTHERS; s++)
+    {
+        //half of them like the synth's slow parameter smoothing, half faster
+        smoothers.coefficients[s] = s % 2 ? 0.999f : 0.99995f;
+        smoothers.states[s] = initialState;
+    }
+    smoothers.input = input;
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.bufferSizeInFrames = bufferSize;
+    options.flushDenormals = flushDenormals;
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, renderSmoothers, &smoothers, &options);
+    mnEngine_start(&engine);
+    
+    const double t0 = mnClock_getSeconds();
+    for (int i = 0; i < numBuffers; i++)
+    {
+        mnOfflineBackend_render(&engine, NULL, NULL, bufferSize);
+    }
+    const double t1 = mnClock_getSeconds();
+    mnEngine_deinit(&engine);
+    
+    mnBenchReport(name, numBuffers, t1 - t0);
+}
+
+void benchRealtime()
+{
+    printf("Realtime - %d one pole smoothers, %d frame buffers (ns per buffer)\n", NUM_SMOOTHERS, bufferSize);
+    benchSmoothers("normal range", 1.0f, 1.0f, 0);
+    benchSmoothers("silence, denormals kept", 0.0f, 1e-40f, 0);
+    benchSmoothers("silence, denormals flushed", 0.0f, 1e-40f, 1);
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_REALTIME_H
+#define MN_BENCH_REALTIME_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchRealtime();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_REALTIME_H
@@ -0,0 +1,170 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "resampler.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_resampler.h"
+
+/*
+ * Resamples a stereo stream in 512 frame blocks, as the engine does between a
+ * device and its callbacks, at every quality with every supported instruction
+ * set. Throughput is reported per output frame. THD+N is measured on a 1 kHz
+ * sine with a least squares sine fit.
+ */
+
+#define TWO_PI 6.283185307179586
+
+static const int blockFrames = 512;
+static const int numChannels = 2;
+static const int callCount = 2000;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static const char* qualityNames[] =
+{
+    "none",
+    "low",
+    "medium",
+    "high"
+};
+
+static volatile float sink;
+
+/**
+ * Returns the power of what is left of \c samples after subtracting the best
+ * fitting sine at \c frequency, relative to the power of that sine, in dB.
+ */
+static double measureTHDN(const float* samples, int numFrames, int stride, double frequency, double sampleRate)
+{
+    double ss = 0.0, cc = 0.0, sc = 0.0, xs = 0.0, xc = 0.0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const double s = sin(TWO_PI * frequency * i / sampleRate);
+        const double c = cos(TWO_PI * frequency * i / sampleRate);
+        const double x = samples[i * stride];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += x * s;
+        xc += x * c;
+    }
+    
+    const double det = ss * cc - sc * sc;
+    const double a = (xs * cc - xc * sc) / det;
+    const double b = (xc * ss - xs * sc) / det;
+    
+    double signal = 0.0, residual = 0.0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const double fit = a * sin(TWO_PI * frequency * i / sampleRate) + b * cos(TWO_PI * frequency * i / sampleRate);
+        const double e = samples[i * stride] - fit;
+        signal += fit * fit;
+        residual += e * e;
+    }
+    
+    return 10.0 * log10(residual / signal);
+}
+
+static void benchThroughput(double inputSampleRate, double outputSampleRate)
+{
+    float* input = malloc(blockFrames * numChannels * sizeof(float));
+    for (int i = 0; i < blockFrames * numChannels; i++)
+    {
+        input[i] = 0.9f * ((float)rand() / (float)RAND_MAX) - 0.45f;
+    }
+    
+    printf("Resampler - %.0f Hz -> %.0f Hz, stereo, %d frames per call\n",
+           inputSampleRate,
+           outputSampleRate,
+           blockFrames);
+    for (int quality = MN_RESAMPLER_QUALITY_LOW; quality <= MN_RESAMPLER_QUALITY_HIGH; quality++)
+    {
+        mnResampler resampler;
+        mnResampler_init(&resampler,
+                         numChannels,
+                         inputSampleRate,
+                         outputSampleRate,
+                         (mnResamplerQuality)quality,
+                         blockFrames);
+        float* output = malloc(mnResampler_getMaxOutputFrames(&resampler) * numChannels * sizeof(float));
+        
+        for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON; level++)
+        {
+            mnSIMD_setLevel((mnSIMDLevel)level);
+            if ((int)mnSIMD_getLevel() != level)
+            {
+                continue;
+            }
+            
+            mnResampler_reset(&resampler);
+            double numOutputFrames = 0.0;
+            const double t0 = mnClock_getSeconds();
+            for (int i = 0; i < callCount; i++)
+            {
+                numOutputFrames += mnResampler_process(&resampler,
+                                                       input,
+                                                       blockFrames,
+                                                       output,
+                                                       mnResampler_getMaxOutputFrames(&resampler));
+            }
+            const double t1 = mnClock_getSeconds();
+            sink = output[0];
+            
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %d taps, %s (per frame)", qualityNames[quality], resampler.numTaps, levelNames[level]);
+            mnBenchReport(name, numOutputFrames, t1 - t0);
+        }
+        
+        mnSIMD_setLevel(mnSIMD_getBestLevel());
+        mnResampler_deinit(&resampler);
+        free(output);
+    }
+    
+    free(input);
+}
+
+static void benchDistortion(double inputSampleRate, double outputSampleRate)
+{
+    const int numFrames = 16 * blockFrames;
+    float* input = malloc(numFrames * sizeof(float));
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = (float)(0.5 * sin(TWO_PI * 1000.0 * i / inputSampleRate));
+    }
+    
+    printf("Resampler - THD+N of a 1 kHz sine, %.0f Hz -> %.0f Hz\n", inputSampleRate, outputSampleRate);
+    for (int quality = MN_RESAMPLER_QUALITY_LOW; quality <= MN_RESAMPLER_QUALITY_HIGH; quality++)
+    {
+        mnResampler resampler;
+        mnResampler_init(&resampler, 1, inputSampleRate, outputSampleRate, (mnResamplerQuality)quality, numFrames);
+        const int maxOutputFrames = mnResampler_getMaxOutputFrames(&resampler);
+        float* output = malloc(maxOutputFrames * sizeof(float));
+        const int numOutputFrames = mnResampler_process(&resampler, input, numFrames, output, maxOutputFrames);
+        
+        //skip the filter's warm up
+        const int skip = resampler.numTaps * 2;
+        printf("  %-48s %10.1f dB\n",
+               qualityNames[quality],
+               measureTHDN(output + skip, numOutputFrames - skip, 1, 1000.0, outputSampleRate));
+        
+        mnResampler_deinit(&resampler);
+        free(output);
+    }
+    
+    free(input);
+}
+
+void benchResampler()
+{
+    benchThroughput(48000.0, 44100.0);
+    benchThroughput(44100.0, 48000.0);
+    benchDistortion(48000.0, 44100.0);
+    benchDistortion(44100.0, 48000.0);
+}
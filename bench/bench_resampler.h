@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_RESAMPLER_H
+#define MN_BENCH_RESAMPLER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchResampler();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_RESAMPLER_H
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "sample_format.h"
+#include "simd.h"
+#include "bench_timer.h"
+#include "bench_sample_format.h"
+
+/*
+ * Converts 512 stereo frames per call, the size of a typical hardware buffer,
+ * with every supported instruction set.
+ */
+
+static const int bufferSamples = 512 * 2;
+static const int callCount = 20000;
+
+static const char* levelNames[] =
+{
+    "scalar",
+    "SSE2",
+    "AVX2",
+    "NEON"
+};
+
+static volatile float sink;
+
+static void benchFormat(mnSampleFormat format, int useDither, const char* formatName)
+{
+    float* source = malloc(bufferSamples * sizeof(float));
+    float* target = malloc(bufferSamples * sizeof(float));
+    void* converted = malloc(bufferSamples * 4);
+    for (int i = 0; i < bufferSamples; i++)
+    {
+        source[i] = 0.9f * ((float)rand() / (float)RAND_MAX) - 0.45f;
+    }
+    
+    mnDither dither;
+    mnDither_init(&dither, 1);
+    
+    printf("Sample format - %s%s, %d samples per call\n", formatName, useDither ? " with dither" : "", bufferSamples);
+    for (int level = MN_SIMD_NONE; level <= MN_SIMD_NEON; level++)
+    {
+        mnSIMD_setLevel((mnSIMDLevel)level);
+        if ((int)mnSIMD_getLevel() != level)
+        {
+            continue;
+        }
+        
+        double t0 = mnClock_getSeconds();
+        for (int i = 0; i < callCount; i++)
+        {
+            mnConvertFromFloat(source, converted, format, bufferSamples, useDither ? &dither : NULL);
+        }
+        double t1 = mnClock_getSeconds();
+        
+        char name[64];
+        snprintf(name, sizeof(name), "%s float -> %s (per sample)", levelNames[level], formatName);
+        mnBenchReport(name, (double)callCount * bufferSamples, t1 - t0);
+        
+        if (useDither)
+        {
+            continue;
+        }
+        
+        t0 = mnClock_getSeconds();
+        for (int i = 0; i < callCount; i++)
+        {
+            mnConvertToFloat(converted, format, target, bufferSamples);
+        }
+        t1 = mnClock_getSeconds();
+        sink = target[bufferSamples - 1];
+        
+        snprintf(name, sizeof(name), "%s %s -> float (per sample)", levelNames[level], formatName);
+        mnBenchReport(name, (double)callCount * bufferSamples, t1 - t0);
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    
+    free(source);
+    free(target);
+    free(converted);
+}
+
+/**
+ * Compares getting planar stereo floats from an interleaved stream by converting
+ * and then deinterleaving with a strided loop, as interleaved callbacks force
+ * per channel DSP to do, with the fused planar conversions.
+ */
+static void benchPlanar(mnSampleFormat format, const char* formatName)
+{
+    const int numFrames = bufferSamples / 2;
+    float* interleaved = malloc(bufferSamples * sizeof(float));
+    float* left = malloc(numFrames * sizeof(float));
+    float* right = malloc(numFrames * sizeof(float));
+    void* stream = malloc(bufferSamples * 4);
+    float* channels[2] = {left, right};
+    for (int i = 0; i < bufferSamples; i++)
+    {
+        interleaved[i] = 0.9f * ((float)rand() / (float)RAND_MAX) - 0.45f;
+    }
+    mnConvertFromFloat(interleaved, stream, format, bufferSamples, NULL);
+    
+    printf("Sample format - %s stereo stream <-> planar floats, %d frames per call\n", formatName, numFrames);
+    
+    double t0 = mnClock_getSeconds();
+    for (int i = 0; i < callCount; i++)
+    {
+        mnConvertToFloat(stream, format, interleaved, bufferSamples);
+        for (int j = 0; j < numFrames; j++)
+        {
+            left[j] = interleaved[2 * j];
+            right[j] = interleaved[2 * j + 1];
+        }
+    }
+    double t1 = mnClock_getSeconds();
+    sink = right[numFrames - 1];
+    mnBenchReport("convert, then deinterleave (per frame)", (double)callCount * numFrames, t1 - t0);
+    
+    t0 = mnClock_getSeconds();
+    for (int i = 0; i < callCount; i++)
+    {
+        mnConvertToFloatPlanar(stream, format, channels, 2, numFrames);
+    }
+    t1 = mnClock_getSeconds();
+    sink = right[numFrames - 1];
+    mnBenchReport("fused planar conversion (per frame)", (double)callCount * numFrames, t1 - t0);
+    
+    t0 = mnClock_getSeconds();
+    for (int i = 0; i < callCount; i++)
+    {
+        for (int j = 0; j < numFrames; j++)
+        {
+            interleaved[2 * j] = left[j];
+            interleaved[2 * j + 1] = right[j];
+        }
+        mnConvertFromFloat(interleaved, stream, format, bufferSamples, NULL);
+    }
+    t1 = mnClock_getSeconds();
+    sink = interleaved[0];
+    mnBenchReport("interleave, then convert (per frame)", (double)callCount * numFrames, t1 - t0);
+    
+    t0 = mnClock_getSeconds();
+    for (int i = 0; i < callCount; i++)
+    {
+        mnConvertFromFloatPlanar((const float* const*)channels, 2, stream, format, numFrames, NULL);
+    }
+    t1 = mnClock_getSeconds();
+    sink = ((float*)stream)[0];
+    mnBenchReport("fused planar conversion (per frame)", (double)callCount * numFrames, t1 - t0);
+    
+    free(interleaved);
+    free(left);
+    free(right);
+    free(stream);
+}
+
+void benchSampleFormat()
+{
+    benchFormat(MN_SAMPLE_FORMAT_INT16, 0, "int16");
+    benchFormat(MN_SAMPLE_FORMAT_INT16, 1, "int16");
+    benchFormat(MN_SAMPLE_FORMAT_INT24, 0, "int24");
+    benchFormat(MN_SAMPLE_FORMAT_INT32, 0, "int32");
+    benchFormat(MN_SAMPLE_FORMAT_FLOAT32, 0, "float32");
+    benchPlanar(MN_SAMPLE_FORMAT_INT16, "int16");
+    benchPlanar(MN_SAMPLE_FORMAT_FLOAT32, "float32");
+}
@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_SAMPLE_FORMAT_H
+#define MN_BENCH_SAMPLE_FORMAT_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchSampleFormat();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_SAMPLE_FORMAT_H
@@ -0,0 +1,22 @@
+#ifndef MN_BENCH_TIMER_H
+#define MN_BENCH_TIMER_H
+
+#include "clock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    /**
+     * Prints a benchmark result line. \c ops is the number of operations performed
+     * in \c seconds.
+     */
+    #define mnBenchReport(name, ops, seconds) \
+        printf("  %-48s %10.2f ns/op %14.0f ops/sec\n", \
+               (name), 1e9 * (seconds) / (double)(ops), (double)(ops) / (seconds))
+    
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MN_BENCH_TIMER_H
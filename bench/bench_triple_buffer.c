@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include "fifo.h"
+#include "triple_buffer.h"
+#include "bench_timer.h"
+#include "bench_triple_buffer.h"
+
+/*
+ * Hands a patch of 300 parameters to a consumer once per update, through a
+ * triple buffer and through a FIFO carrying one event per parameter, the way
+ * the demo synth used to. Also measures a read when nothing was published,
+ * which is what the audio thread pays for on most buffers.
+ */
+
+#define NUM_PARAMETERS 300
+
+static const int updateCount = 100000;
+
+static volatile float sink;
+
+typedef struct
+{
+    float parameters[NUM_PARAMETERS];
+} Patch;
+
+typedef struct
+{
+    int index;
+    float value;
+} Event;
+
+static void benchTriple()
+{
+    Patch patch = {{0}};
+    mnTripleBuffer buffer;
+    mnTripleBuffer_init(&buffer, sizeof(Patch), &patch);
+    
+    double t0 = mnClock_getSeconds();
+    for (int u = 0; u < updateCount; u++)
+    {
+        patch.parameters[u % NUM_PARAMETERS] = (float)u;
+        mnTripleBuffer_write(&buffer, &patch);
+        const Patch* latest = mnTripleBuffer_read(&buffer, NULL);
+        sink = latest->parameters[u % NUM_PARAMETERS];
+    }
+    double t1 = mnClock_getSeconds();
+    mnBenchReport("triple buffer write + read (per update)", updateCount, t1 - t0);
+    
+    t0 = mnClock_getSeconds();
+    for (int u = 0; u < updateCount; u++)
+    {
+        const Patch* latest = mnTripleBuffer_read(&buffer, NULL);
+        sink = latest->parameters[0];
+    }
+    t1 = mnClock_getSeconds();
+    mnBenchReport("triple buffer unchanged read", updateCount, t1 - t0);
+    
+    mnTripleBuffer_deinit(&buffer);
+}
+
+static void benchEvents()
+{
+    Patch patch = {{0}};
+    mnFIFO fifo;
+    mnFIFO_init(&fifo, NUM_PARAMETERS, sizeof(Event));
+    
+    const double t0 = mnClock_getSeconds();
+    for (int u = 0; u < updateCount; u++)
+    {
+        patch.parameters[u % NUM_PARAMETERS] = (float)u;
+        for (int i = 0; i < NUM_PARAMETERS; i++)
+        {
+            Event e;
+            e.index = i;
+            e.value = patch.parameters[i];
+            mnFIFO_push(&fifo, &e);
+        }
+        
+        Event e;
+        while (mnFIFO_pop(&fifo, &e))
+        {
+            sink = e.value;
+        }
+    }
+    const double t1 = mnClock_getSeconds();
+    mnBenchReport("FIFO event per parameter (per update)", updateCount, t1 - t0);
+    
+    mnFIFO_deinit(&fifo);
+}
+
+void benchTripleBuffer()
+{
+    printf("Triple buffer - %d parameter patch\n", NUM_PARAMETERS);
+    benchTriple();
+    benchEvents();
+}
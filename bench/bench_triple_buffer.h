@@ -0,0 +1,16 @@
+#ifndef MN_BENCH_TRIPLE_BUFFER_H
+#define MN_BENCH_TRIPLE_BUFFER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void benchTripleBuffer();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //MN_BENCH_TRIPLE_BUFFER_H
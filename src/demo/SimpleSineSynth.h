@@ -23,7 +23,9 @@
  */
 
 #import "MNAudioEngine.h"
-#import "fifo.h"
+#import "meter.h"
+#import "oscillator_bank.h"
+#import "triple_buffer.h"
 
 @protocol SimpleSineSynthDelegate <NSObject>
 
@@ -33,25 +35,29 @@
 
 @end
 
+/**
+ * The synth parameters, sent to the audio thread as a whole.
+ */
+typedef struct {
+    float toneFrequency;
+    float toneAmplitude;
+} SynthParameters;
+
 /**
  * A primitive proof of concept sine wave synthesizer.
  */
 @interface SimpleSineSynth : MNAudioEngine
 {
 @public
-    mnFIFO toAudioThreadFifo;
-    mnFIFO fromAudioThreadFifo;
-    
-    float targetToneFrequency;
-    float smoothedToneFrequency;
-    
-    float targetToneAmplitude;
-    float smoothedToneAmplitude;
+    mnTripleBuffer parametersToAudioThread;
+    /** The parameters last sent to the audio thread. Only accessed by the main thread. */
+    SynthParameters sentParameters;
     
-    float smoothedInputPeakValue;
-    float smoothedOutputPeakValue;
+    mnOscillatorBank oscillators;
+    int toneVoice;
     
-    float sinePhase;
+    mnMeter inputMeter;
+    mnMeter outputMeter;
 }
 
 +(SimpleSineSynth*)sharedInstance;
@@ -25,110 +25,33 @@
 #import "SimpleSineSynth.h"
 
 #define kSampleRate 44100
-#define kFIFOCapacity 100
-typedef enum {
-    EVENT_INPUT_LEVEL = 0,
-    EVENT_OUTPUT_LEVEL = 1,
-    EVENT_TONE_AMPLITUDE = 2,
-    EVENT_TONE_FREQUENCY = 3
-
-} EventType;
-
-typedef struct {
-    EventType type;
-    float value;
-} Event;
 
 #pragma mark Audio buffer callbacks
-void inputBufferCallback(int numChannels, int numFrames, const float* samples, void* callbackContext)
+void inputBufferCallback(int numChannels, int numFrames, const float* const* channels, void* callbackContext)
 {
-    SimpleSineSynth* audioEngine = (__bridge SimpleSineSynth*)callbackContext;
- 
-    float smoothedPeak = audioEngine->smoothedInputPeakValue;
-    float peak = 0;
-    for (int i = 0; i < numFrames; i++) {
-        const float value = fabsf(samples[i * numChannels]);
-        
-        const float a = value > smoothedPeak ? 0.1 : 0.99995;
-        smoothedPeak = a * smoothedPeak + (1.0f - a) * value;
-        
-        if (value > peak) {
-            peak = value;
-        }
-    }
-    
-    audioEngine->smoothedInputPeakValue = smoothedPeak;
-    
-    //pass the smoothed peak value to the main thread.
-    Event e;
-    e.type = EVENT_INPUT_LEVEL;
-    e.value = smoothedPeak;
-    mnFIFO_push(&audioEngine->fromAudioThreadFifo, &e);
+    //the input is only metered, which the engine does before calling this
 }
 
-void outputBufferCallback(int numChannels, int numFrames, float* samples, void* callbackContext)
+void outputBufferCallback(int numChannels, int numFrames, float* const* channels, void* callbackContext)
 {
     SimpleSineSynth* audioEngine = (__bridge SimpleSineSynth*)callbackContext;
     
-    while (!mnFIFO_isEmpty(&audioEngine->toAudioThreadFifo)) {
-        Event event;
-        mnFIFO_pop(&audioEngine->toAudioThreadFifo, &event);
-        
-        if (event.type == EVENT_TONE_AMPLITUDE) {
-            audioEngine->targetToneAmplitude = event.value;
-        }
-        else if (event.type == EVENT_TONE_FREQUENCY) {
-            audioEngine->targetToneFrequency = event.value;
-        }
+    //pick up the latest parameters. changes are ramped linearly over the buffer.
+    int isNew = 0;
+    const SynthParameters* parameters = mnTripleBuffer_read(&audioEngine->parametersToAudioThread, &isNew);
+    if (isNew) {
+        mnOscillatorBank_setFrequency(&audioEngine->oscillators, audioEngine->toneVoice, parameters->toneFrequency);
+        mnOscillatorBank_setAmplitude(&audioEngine->oscillators, audioEngine->toneVoice, parameters->toneAmplitude);
     }
     
-    const float targetAmplitude = audioEngine->targetToneAmplitude;
-    const float targetFrequency = audioEngine->targetToneFrequency;
-    
-    const float amplitudeSmoothing = 0.999f;
-    const float frequencySmoothing = 0.9995f;
-    
-
     for (int c = 0; c < numChannels; c++) {
         if (c == 0) {
             //render first channel
-            float phase = audioEngine->sinePhase;
-            float amplitude = audioEngine->smoothedToneAmplitude;
-            float frequency = audioEngine->smoothedToneFrequency;
-            float smoothedOutputLevel = audioEngine->smoothedOutputPeakValue;
-            
-            for (int i = 0; i < numFrames; i++) {
-                const float value = amplitude * sinf(phase);
-                
-                const float a = value > smoothedOutputLevel ? 0.1 : 0.99995;
-                smoothedOutputLevel = a * smoothedOutputLevel + (1.0f - a) * value;
-                
-                samples[i * numChannels + c] = value;
-                
-                phase += (2.0f * M_PI * frequency / (float)kSampleRate);
-                
-                frequency = frequencySmoothing * frequency +
-                            (1.0f - frequencySmoothing) * targetFrequency;
-                amplitude = amplitudeSmoothing * amplitude +
-                            (1.0f - amplitudeSmoothing) * targetAmplitude;
-            }
-            
-            audioEngine->smoothedToneAmplitude = amplitude;
-            audioEngine->smoothedToneFrequency = frequency;
-            audioEngine->sinePhase = fmodf(phase, 2.0f * M_PI);
-            audioEngine->smoothedOutputPeakValue = smoothedOutputLevel;
-            
-            //pass the smoothed peak value to the main thread.
-            Event e;
-            e.type = EVENT_OUTPUT_LEVEL;
-            e.value = smoothedOutputLevel;
-            mnFIFO_push(&audioEngine->fromAudioThreadFifo, &e);
+            mnOscillatorBank_render(&audioEngine->oscillators, channels[c], numFrames);
         }
         else {
             //copy rendered channel
-            for (int i = 0; i < numFrames; i++) {
-                samples[i * numChannels + c] = samples[i * numChannels];
-            }
+            memcpy(channels[c], channels[0], numFrames * sizeof(float));
         }
     }
 }
@@ -150,19 +73,31 @@ void outputBufferCallback(int numChannels, int numFrames, float* samples, void*
 -(id)init
 {
     MNOptions options;
+    mnOptions_setDefaults(&options);
     options.sampleRate = kSampleRate;
     options.numberOfInputChannels = 1;
     options.numberOfOutputChannels = 2;
     options.bufferSizeInFrames = 512;
+    options.sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
     
-    self = [super initWithInputCallback:inputBufferCallback
-                         outputCallback:outputBufferCallback
-                        callbackContext:(void*)self
-                                options:&options];
+    self = [super initWithPlanarInputCallback:inputBufferCallback
+                               outputCallback:outputBufferCallback
+                              callbackContext:(void*)self
+                                      options:&options];
 
     if (self) {
-        mnFIFO_init(&toAudioThreadFifo, kFIFOCapacity, sizeof(Event));
-        mnFIFO_init(&fromAudioThreadFifo, kFIFOCapacity, sizeof(Event));
+        mnTripleBuffer_init(&parametersToAudioThread, sizeof(SynthParameters), NULL);
+        
+        //peak meters with instant attack and a release of about half a second
+        mnMeter_init(&inputMeter, options.numberOfInputChannels, kSampleRate);
+        mnMeter_init(&outputMeter, options.numberOfOutputChannels, kSampleRate);
+        mnMeter_setBallistics(&inputMeter, 0.0f, 0.45f, 0.3f);
+        mnMeter_setBallistics(&outputMeter, 0.0f, 0.45f, 0.3f);
+        [self setInputMeter:&inputMeter outputMeter:&outputMeter];
+        
+        //the tone is a single voice that plays as long as the synth exists
+        mnOscillatorBank_init(&oscillators, 1, kSampleRate);
+        toneVoice = mnOscillatorBank_noteOn(&oscillators, 0.0f, 0.0f);
     }
     
     return self;
@@ -170,33 +105,30 @@ void outputBufferCallback(int numChannels, int numFrames, float* samples, void*
 
 -(void)dealloc
 {
-    mnFIFO_deinit(&toAudioThreadFifo);
-    mnFIFO_deinit(&fromAudioThreadFifo);
+    mnTripleBuffer_deinit(&parametersToAudioThread);
+    mnMeter_deinit(&inputMeter);
+    mnMeter_deinit(&outputMeter);
+    mnOscillatorBank_deinit(&oscillators);
 }
 
 -(void)update
 {
-    //process incoming level events
-    while (!mnFIFO_isEmpty(&fromAudioThreadFifo)) {
-        Event event;
-        mnFIFO_pop(&fromAudioThreadFifo, &event);
-        if (event.type == EVENT_INPUT_LEVEL) {
-            _inputLevel = event.value;
-        }
-        else if (event.type == EVENT_OUTPUT_LEVEL) {
-            _outputLevel = event.value;
-        }
-    }
+    //read the latest levels of the first input and output channels
+    mnMeterLevels inputLevels[1];
+    mnMeterLevels outputLevels[2];
+    mnMeter_getLevels(&inputMeter, inputLevels);
+    mnMeter_getLevels(&outputMeter, outputLevels);
+    _inputLevel = inputLevels[0].peak;
+    _outputLevel = outputLevels[0].peak;
     
-    //send control events
-    Event event;
-    event.type = EVENT_TONE_FREQUENCY;
-    event.value = self.toneFrequency;
-    mnFIFO_push(&toAudioThreadFifo, &event);
-    
-    event.type = EVENT_TONE_AMPLITUDE;
-    event.value = self.toneAmplitude;
-    mnFIFO_push(&toAudioThreadFifo, &event);
+    //send the parameters as a whole, only if any of them changed
+    SynthParameters parameters;
+    parameters.toneFrequency = self.toneFrequency;
+    parameters.toneAmplitude = self.toneAmplitude;
+    if (memcmp(&parameters, &sentParameters, sizeof(SynthParameters)) != 0) {
+        mnTripleBuffer_write(&parametersToAudioThread, &parameters);
+        sentParameters = parameters;
+    }
     
     //notify delegate of level changes (powf for nicer falloff)
     [self.delegate inputLevelChanged:powf(self.inputLevel, 0.4f)];
@@ -24,41 +24,12 @@
 
 #import <AVFoundation/AVFoundation.h>
 
-/**
- * Audio engine options.
- */
-typedef struct {
-    float sampleRate;
-    int numberOfInputChannels;
-    int numberOfOutputChannels;
-    int bufferSizeInFrames;
-} MNOptions;
+#import "engine.h"
 
 /**
- * A callback for receiving input audio buffers.
- * @param numChannels The number of input channels.
- * @param numFrames The number of input frames.
- * @param samples The input sample buffer. Samples are interleaved, so sample for
- * channel i of frame j is at \c samples[j * numChannels + i].
- * @param callbackContext A user specified pointer.
+ * Audio engine options. See ::mnOptions.
  */
-typedef void (*mnAudioInputCallback)(int numChannels,
-                                     int numFrames,
-                                     const float* samples,
-                                     void* callbackContext);
-
-/**
- * A callback for rendering output audio buffers.
- * @param numChannels The number of output channels.
- * @param numFrames The number of output frames.
- * @param samples The target output buffer Samples are interleaved, so sample for 
- * channel i of frame j is at \c samples[j * numChannels + i].
- * @param callbackContext A user specified pointer.
- */
-typedef void (*mnAudioOutputCallback)(int numChannels,
-                                      int numFrames,
-                                      float* samples,
-                                      void* callbackContext);
+typedef mnOptions MNOptions;
 
 /**
  *
@@ -86,6 +57,32 @@ typedef void (*mnAudioOutputCallback)(int numChannels,
            callbackContext:(void*)context
                    options:(MNOptions*)options;
 
+/**
+ * Creates a new audio engine instance with callbacks that get one buffer per
+ * channel instead of interleaved samples, so per channel DSP can run on
+ * contiguous memory.
+ * @param inputCallback A callback for receiving input audio data. Ignored if NULL.
+ * @param outputCallback A callback for rendering output audio data. Ignored if NULL.
+ * @param callbackContext A pointer to pass to \c inputCallback and \c outputCallback.
+ * @param options Optional audio I/O options.
+ */
+-(id)initWithPlanarInputCallback:(mnAudioPlanarInputCallback)inputCallback
+                  outputCallback:(mnAudioPlanarOutputCallback)outputCallback
+                 callbackContext:(void*)context
+                         options:(MNOptions*)options;
+
+/**
+ * Creates a new audio engine instance with a single callback that processes
+ * the input and output of each device cycle together, for the lowest possible
+ * latency from the microphone to the speaker. See ::mnEngine_initDuplex.
+ * @param duplexCallback A callback processing input and output audio data.
+ * @param callbackContext A pointer to pass to \c duplexCallback.
+ * @param options Optional audio I/O options.
+ */
+-(id)initWithDuplexCallback:(mnAudioDuplexCallback)duplexCallback
+            callbackContext:(void*)context
+                    options:(MNOptions*)options;
+
 -(void)start;
 
 -(void)stop;
@@ -94,4 +91,100 @@ typedef void (*mnAudioOutputCallback)(int numChannels,
 
 -(void)resume;
 
+/**
+ * Gets the audio callback timing statistics gathered since the engine was created:
+ * callback count, missed deadlines, the longest callback duration and a histogram
+ * of callback load. Lock free, so it may be called while audio is running, for
+ * example from a timer reporting the p99 load with ::mnTimingSnapshot_getLoadPercentile.
+ */
+-(void)getTimingStats:(mnTimingSnapshot*)snapshot;
+
+/**
+ * YES if every buffer the audio callbacks touch is locked into physical
+ * memory, see ::mnEngine_isMemoryLocked. Call while audio is running.
+ */
+-(BOOL)isMemoryLocked;
+
+/**
+ * The time in seconds from a sound reaching the microphone until it is played
+ * back when passed straight through a duplex callback, based on the latencies
+ * reported by the audio session and the current buffer size. Valid once
+ * audio has started.
+ */
+-(double)roundTripLatency;
+
+/**
+ * The number of frames by which \c fixedBufferSize blocks delay the signal,
+ * see ::mnEngine_getBlockLatency. Included in \c roundTripLatency.
+ */
+-(int)blockLatency;
+
+/**
+ * Meters the input and output, see ::mnEngine_setMeters. The meters' levels can
+ * be polled from the main thread, for example once per screen refresh, with
+ * ::mnMeter_getLevels. Call before starting the engine.
+ * @param inputMeter A meter with a channel per input, or NULL.
+ * @param outputMeter A meter with a channel per output, or NULL.
+ */
+-(void)setInputMeter:(mnMeter*)inputMeter outputMeter:(mnMeter*)outputMeter;
+
+/**
+ * Analyzes the spectrum and pitch of the input, see ::mnEngine_setAnalyzer.
+ * The latest results can be picked up from the main thread with
+ * ::mnAnalyzer_getSnapshot. Call before starting the engine.
+ * @param analyzer A started analyzer with a channel per input, or NULL.
+ */
+-(void)setAnalyzer:(mnAnalyzer*)analyzer;
+
+/**
+ * Convolves the output with an impulse response, see ::mnEngine_setConvolver.
+ * Call before starting the engine.
+ * @param convolver A convolver with a channel per output, or NULL.
+ */
+-(void)setConvolver:(mnConvolver*)convolver;
+
+/**
+ * Logs missed deadlines and render-ahead underruns from the audio thread,
+ * see ::mnEngine_setLog. Callbacks may write to the same log with
+ * ::mnLog_write. Call before starting the engine.
+ * @param log A started log, or NULL.
+ */
+-(void)setLog:(mnLog*)log;
+
+/**
+ * Changes how many frames the render thread keeps ready ahead of the device,
+ * see ::mnEngine_setRenderAheadFrames. Only has an effect if \c renderAheadFrames
+ * was set in the options.
+ */
+-(void)setRenderAheadFrames:(int)numFrames;
+
+/**
+ * The number of frames currently rendered ahead of the device. Watching how
+ * low it gets helps pick the smallest safe \c renderAheadFrames.
+ */
+-(int)renderAheadFill;
+
+/**
+ * Enables sample accurate scheduled events, see ::mnEngine_setEventCallback.
+ * Event times are on the timeline of the \c mSampleTime field of the remote I/O
+ * unit's \c AudioTimeStamp. Call before starting the engine.
+ * @param eventCallback Invoked from the audio thread with the callback context.
+ * @param capacity The largest number of events posted but not yet applied.
+ * @return NO if \c capacity is out of range or allocation failed.
+ */
+-(BOOL)setEventCallback:(mnAudioEventCallback)eventCallback capacity:(int)capacity;
+
+/**
+ * Schedules an event. Lock free. Call from one thread only, for example the main thread.
+ * @return NO if too many events are waiting or events are not enabled.
+ */
+-(BOOL)postEvent:(const mnScheduledEvent*)event;
+
+/**
+ * The sample time of the first frame after the most recent buffer, or a negative
+ * value if audio hasn't started. Adding one buffer of latency gives a time that
+ * events can reliably be scheduled at.
+ */
+-(double)nextSampleTime;
+
 @end
\ No newline at end of file
@@ -23,75 +23,86 @@
  */
 
 #import "MNAudioEngine.h"
+#import "arena.h"
 
 #import <UIKit/UIKit.h>
 
-#pragma mark Buffer conversion helpers
+#pragma mark Remote I/O backend
 
 /**
- * Converts a buffer of floats to a buffer of signed shorts. The floats are assumed
- * to be in the range [-1, 1].
- * @param sourceBuffer The buffer containing the values to convert.
- * @param targetBuffer The buffer to write converted samples to.
- * @param size The size of the source and target buffers.
- */
-static inline void mnFloatToInt16(const float* sourceBuffer, short* targetBuffer, int size)
-{
-    assert(sourceBuffer != NULL);
-    assert(targetBuffer != NULL);
-    
-    int i = 0;
-    while (i < size)
-    {
-        targetBuffer[i] = (short)(32767 * sourceBuffer[i]);
-        i++;
-    }
-}
-
-/**
- * Converts a buffer of signed short values to a buffer of floats
- * in the range [-1, 1].
- * @param sourceBuffer The buffer containing the values to convert.
- * @param targetBuffer The buffer to write converted samples to.
- * @param size The size of the source and target buffers.
- */
-static inline void mnInt16ToFloat(const short* sourceBuffer, float* targetBuffer, int size)
-{
-    assert(sourceBuffer != NULL);
-    assert(targetBuffer != NULL);
-    
-    int i = 0;
-    while (i < size)
-    {
-        targetBuffer[i] = (float)(sourceBuffer[i] / 32768.0);
-        i++;
-    }
-}
-
-#pragma mark Remote I/O buffer callbacks
-
-/**
- * This struct contains everything needed to receive input buffers and 
- * render output buffers in the remote I/O callbacks.
+ * The state of the remote I/O backend, stored in the engine's \c backendData.
  */
 typedef struct {
-    /** A callback to receive audio input buffers. */
-    mnAudioInputCallback inputCallback;
-    /** A callback to render audio output buffers. */
-    mnAudioOutputCallback outputCallback;
-    /** A pointer passed to \c inputCallback and \c outputCallback. */
-    void* userCallbackContext;
     /** The remote I/O instance. */
     AudioComponentInstance remoteIOInstance;
     /** A buffer list for storing input samples. */
     AudioBufferList inputBufferList;
     /** The size in bytes of the input sample buffer. */
     int inputBufferSizeInBytes;
-    /** A buffer for temporary storage of input samples.*/
-    float* inputScratchBuffer;
-    /** A buffer for temporary storage of output samples.*/
-    float* outputScratchBuffer;
-} CoreAudioCallbackContext;
+} RemoteIOState;
+
+static void ensureNoAudioUnitError(OSStatus result)
+{
+#ifdef DEBUG
+    switch (result)
+    {
+        case kAudioUnitErr_InvalidProperty:
+            assert(0 && "kAudioUnitErr_InvalidProperty");
+            break;
+        case kAudioUnitErr_InvalidParameter:
+            assert(0 && "kAudioUnitErr_InvalidParameter");
+            break;
+        case kAudioUnitErr_InvalidElement:
+            assert(0 && "kAudioUnitErr_InvalidElement");
+            break;
+        case kAudioUnitErr_NoConnection:
+            assert(0 && "kAudioUnitErr_NoConnection");
+            break;
+        case kAudioUnitErr_FailedInitialization:
+            assert(0 && "kAudioUnitErr_FailedInitialization");
+            break;
+        case kAudioUnitErr_TooManyFramesToProcess:
+            assert(0 && "kAudioUnitErr_TooManyFramesToProcess");
+            break;
+        case kAudioUnitErr_InvalidFile:
+            assert(0 && "kAudioUnitErr_InvalidFile");
+            break;
+        case kAudioUnitErr_FormatNotSupported:
+            assert(0 && "kAudioUnitErr_FormatNotSupported");
+            break;
+        case kAudioUnitErr_Uninitialized:
+            assert(0 && "kAudioUnitErr_Uninitialized");
+            break;
+        case kAudioUnitErr_InvalidScope:
+            assert(0 && "kAudioUnitErr_InvalidScope");
+            break;
+        case kAudioUnitErr_PropertyNotWritable:
+            assert(0 && "kAudioUnitErr_PropertyNotWritable");
+            break;
+        case kAudioUnitErr_CannotDoInCurrentContext:
+            assert(0 && "kAudioUnitErr_CannotDoInCurrentContext");
+            break;
+        case kAudioUnitErr_InvalidPropertyValue:
+            assert(0 && "kAudioUnitErr_InvalidPropertyValue");
+            break;
+        case kAudioUnitErr_PropertyNotInUse:
+            assert(0 && "kAudioUnitErr_PropertyNotInUse");
+            break;
+        case kAudioUnitErr_Initialized:
+            assert(0 && "kAudioUnitErr_Initialized");
+            break;
+        case kAudioUnitErr_InvalidOfflineRender:
+            assert(0 && "kAudioUnitErr_InvalidOfflineRender");
+            break;
+        case kAudioUnitErr_Unauthorized:
+            assert(0 && "kAudioUnitErr_Unauthorized");
+            break;
+        default:
+            assert(result == noErr);
+            break;
+    }
+#endif //DEBUG
+}
 
 /**
  * Remote I/O callback for receiving input audio buffers.
@@ -103,33 +114,24 @@ static OSStatus remoteIOInputCallback(void *inRefCon,
                                       UInt32 inNumberFrames,
                                       AudioBufferList *ioData)
 {
-    CoreAudioCallbackContext* context = (CoreAudioCallbackContext*)inRefCon;
+    mnEngine* engine = (mnEngine*)inRefCon;
+    RemoteIOState* state = (RemoteIOState*)engine->backendData;
     
     //fill the already allocated input buffer list with samples
-    OSStatus status = AudioUnitRender(context->remoteIOInstance,
+    state->inputBufferList.mBuffers[0].mDataByteSize = state->inputBufferSizeInBytes;
+    OSStatus status = AudioUnitRender(state->remoteIOInstance,
                                       ioActionFlags,
                                       inTimeStamp,
                                       inBusNumber,
                                       inNumberFrames,
-                                      &context->inputBufferList);
+                                      &state->inputBufferList);
     assert(status == 0);
     
-    const int numChannels = context->inputBufferList.mBuffers[0].mNumberChannels;
-    const short* sourceBuffer = (short*)context->inputBufferList.mBuffers[0].mData;
-    
-    //Convert input samples to floats
-    mnInt16ToFloat(sourceBuffer,
-                   context->inputScratchBuffer,
-                   inNumberFrames * numChannels);
-    
-    //Pass the converted buffer to the user
-    if (context->inputCallback)
-    {
-        context->inputCallback(numChannels,
-                               inNumberFrames,
-                               context->inputScratchBuffer,
-                               context->userCallbackContext);
-    }
+    //Pass the samples to the user
+    mnEngine_processInput(engine,
+                          state->inputBufferList.mBuffers[0].mData,
+                          inNumberFrames,
+                          inTimeStamp->mSampleTime);
     
     return noErr;
 }
@@ -144,42 +146,262 @@ static OSStatus remoteIOOutputCallback(void *inRefCon,
                                        UInt32 inNumberFrames,
                                        AudioBufferList *ioData)
 {
-//#define MN_DEBUG_CA_DEADLINE
-#ifdef MN_DEBUG_CA_DEADLINE
-    static double prevDelta = 0.0;
-    static double ht = 0.0;
-    double delta = inTimeStamp->mSampleTime - ht;
-    ht = inTimeStamp->mSampleTime;
-    if (delta > inNumberFrames && prevDelta > 0.0)
+    mnEngine* engine = (mnEngine*)inRefCon;
+    
+    //let the user render some audio. the sample time places scheduled events,
+    //and gaps in it are counted as missed deadlines.
+    mnEngine_processOutput(engine,
+                           ioData->mBuffers[0].mData,
+                           inNumberFrames,
+                           inTimeStamp->mSampleTime);
+    
+    return noErr;
+}
+
+/**
+ * Remote I/O callback for duplex engines. Pulls the input of the same cycle
+ * with \c AudioUnitRender, so input and output are processed in one call.
+ */
+static OSStatus remoteIODuplexCallback(void *inRefCon,
+                                       AudioUnitRenderActionFlags *ioActionFlags,
+                                       const AudioTimeStamp *inTimeStamp,
+                                       UInt32 inBusNumber,
+                                       UInt32 inNumberFrames,
+                                       AudioBufferList *ioData)
+{
+    mnEngine* engine = (mnEngine*)inRefCon;
+    RemoteIOState* state = (RemoteIOState*)engine->backendData;
+    
+    const void* input = NULL;
+    if (engine->options.numberOfInputChannels > 0)
+    {
+        //fill the already allocated input buffer list with samples from the input bus
+        state->inputBufferList.mBuffers[0].mDataByteSize = state->inputBufferSizeInBytes;
+        OSStatus status = AudioUnitRender(state->remoteIOInstance,
+                                          ioActionFlags,
+                                          inTimeStamp,
+                                          1,
+                                          inNumberFrames,
+                                          &state->inputBufferList);
+        if (status != noErr)
+        {
+            //no input this cycle, for example without mic permission. pass silence.
+            memset(state->inputBufferList.mBuffers[0].mData, 0, state->inputBufferSizeInBytes);
+        }
+        input = state->inputBufferList.mBuffers[0].mData;
+    }
+    
+    mnEngine_processDuplex(engine,
+                           input,
+                           ioData->mBuffers[0].mData,
+                           inNumberFrames,
+                           inTimeStamp->mSampleTime);
+    
+    return noErr;
+}
+
+static void setASBD(AudioStreamBasicDescription* asbd,
+                    int numChannels,
+                    float sampleRate,
+                    mnSampleFormat sampleFormat)
+{
+    memset(asbd, 0, sizeof(AudioStreamBasicDescription));
+    assert(numChannels > 0);
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(sampleFormat);
+    asbd->mBitsPerChannel = 8 * bytesPerSample;
+    asbd->mBytesPerFrame = bytesPerSample * numChannels;
+    asbd->mBytesPerPacket = asbd->mBytesPerFrame;
+    asbd->mChannelsPerFrame = numChannels;
+    asbd->mFormatFlags = kAudioFormatFlagIsPacked;
+    if (sampleFormat == MN_SAMPLE_FORMAT_FLOAT32) {
+        asbd->mFormatFlags |= kAudioFormatFlagIsFloat;
+    }
+    else {
+        asbd->mFormatFlags |= kAudioFormatFlagIsSignedInteger;
+    }
+    asbd->mFormatID = kAudioFormatLinearPCM;
+    asbd->mFramesPerPacket = 1;
+    asbd->mSampleRate = sampleRate;
+}
+
+static int remoteIOOpen(mnEngine* engine, int* maxFramesPerBuffer)
+{
+    RemoteIOState* state = calloc(1, sizeof(RemoteIOState));
+    engine->backendData = state;
+    
+    //create audio component description
+    AudioComponentDescription auDescription;
+    
+    auDescription.componentType          = kAudioUnitType_Output;
+    auDescription.componentSubType       = kAudioUnitSubType_RemoteIO;
+    auDescription.componentManufacturer  = kAudioUnitManufacturer_Apple;
+    auDescription.componentFlags         = 0;
+    auDescription.componentFlagsMask     = 0;
+    
+    //get a component reference
+    AudioComponent auComponent = AudioComponentFindNext(NULL, &auDescription);
+    
+    //get the actual instance
+    OSStatus status = AudioComponentInstanceNew(auComponent, &state->remoteIOInstance);
+    assert(status == noErr);
+    
+    //Get an upper limit on the number of frames that an audio callback
+    //will request/provide. This number is used to allocate buffers.
+    int maxNumberOfFramesPerSlice = 0;
+    UInt32 s = sizeof(maxNumberOfFramesPerSlice);
+    ensureNoAudioUnitError(AudioUnitGetProperty(state->remoteIOInstance,
+                                                kAudioUnitProperty_MaximumFramesPerSlice,
+                                                kAudioUnitScope_Global,
+                                                0,
+                                                &maxNumberOfFramesPerSlice,
+                                                &s));
+    *maxFramesPerBuffer = maxNumberOfFramesPerSlice;
+    
+    //enable input/output
+    const int numInChannels = engine->options.numberOfInputChannels;
+    const int numOutChannels = engine->options.numberOfOutputChannels;
+    const mnSampleFormat sampleFormat = engine->options.sampleFormat;
+    
+    //Run the streams at the hardware rate, which may differ from the preferred
+    //one, and let the engine resample them to the requested rate. Without
+    //resampling, RemoteIO converts to the requested rate itself.
+    engine->deviceSampleRate = engine->options.sampleRate;
+    if (engine->options.resamplerQuality != MN_RESAMPLER_QUALITY_NONE &&
+        [AVAudioSession sharedInstance].sampleRate > 0.0)
     {
-        printf("missed deadline, time since prev callback: %f samples, curr buffer size %d samples\n",
-               delta,
-               inNumberFrames);
+        engine->deviceSampleRate = [AVAudioSession sharedInstance].sampleRate;
     }
-    prevDelta = delta;
-#endif //MN_DEBUG_CA_DEADLINE
+    const float sampleRate = engine->deviceSampleRate;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(sampleFormat);
     
-    CoreAudioCallbackContext* context = (CoreAudioCallbackContext*)inRefCon;
+    const unsigned int OUTPUT_BUS_ID = 0;
+    const unsigned int INPUT_BUS_ID = 1;
+    
+    if (numOutChannels > 0)
+    {
+        //enable playback if requested
+        UInt32 flag = 1;
+        ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                    kAudioOutputUnitProperty_EnableIO,
+                                                    kAudioUnitScope_Output,
+                                                    OUTPUT_BUS_ID,
+                                                    &flag,
+                                                    sizeof(flag)));
+        
+        //Set output format
+        AudioStreamBasicDescription outputFormat;
+        setASBD(&outputFormat, numOutChannels, sampleRate, sampleFormat);
+        ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                    kAudioUnitProperty_StreamFormat,
+                                                    kAudioUnitScope_Input,
+                                                    OUTPUT_BUS_ID,
+                                                    &outputFormat,
+                                                    sizeof(outputFormat)));
+        
+        //Hook up output callback. Duplex engines process input from it too.
+        AURenderCallbackStruct renderCallbackStruct;
+        renderCallbackStruct.inputProc = engine->duplexCallback ? remoteIODuplexCallback : remoteIOOutputCallback;
+        renderCallbackStruct.inputProcRefCon = engine;
+        
+        ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                    kAudioUnitProperty_SetRenderCallback,
+                                                    kAudioUnitScope_Global,
+                                                    OUTPUT_BUS_ID,
+                                                    &renderCallbackStruct,
+                                                    sizeof(renderCallbackStruct)));
+    }
     
-    const int numChannels = ioData->mBuffers[0].mNumberChannels;
+    if (numInChannels > 0)
+    {
+        //Enable recording if requested
+        UInt32 flag = 1;
+        ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                    kAudioOutputUnitProperty_EnableIO,
+                                                    kAudioUnitScope_Input,
+                                                    INPUT_BUS_ID,
+                                                    &flag,
+                                                    sizeof(flag)));
     
-    //let the user render some audio
-    if (context->outputCallback) {
-        context->outputCallback(numChannels,
-                                inNumberFrames,
-                                context->outputScratchBuffer,
-                                context->userCallbackContext);
+        //Set input format
+        AudioStreamBasicDescription inputFormat;
+        setASBD(&inputFormat, numInChannels, sampleRate, sampleFormat);
+        
+        ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                    kAudioUnitProperty_StreamFormat,
+                                                    kAudioUnitScope_Output,
+                                                    INPUT_BUS_ID,
+                                                    &inputFormat,
+                                                    sizeof(inputFormat)));
+        
+        //Allocate a locked buffer to store raw input samples in
+        state->inputBufferList.mNumberBuffers = 1;
+        state->inputBufferList.mBuffers[0].mNumberChannels = numInChannels;
+        state->inputBufferSizeInBytes = bytesPerSample * numInChannels * maxNumberOfFramesPerSlice;
+        state->inputBufferList.mBuffers[0].mDataByteSize = state->inputBufferSizeInBytes;
+        state->inputBufferList.mBuffers[0].mData = mnLockedMemory_alloc(state->inputBufferSizeInBytes, NULL);
         
-        //convert the float samples and copy them to the target buffer
-        short* targetBuffer = (short*)ioData->mBuffers[0].mData;
-        mnFloatToInt16(context->outputScratchBuffer,
-                       targetBuffer,
-                       inNumberFrames * numChannels);
+        if (!engine->duplexCallback)
+        {
+            //Hook up input callback
+            AURenderCallbackStruct renderCallbackStruct;
+            renderCallbackStruct.inputProc = remoteIOInputCallback;
+            renderCallbackStruct.inputProcRefCon = engine;
+            
+            ensureNoAudioUnitError(AudioUnitSetProperty(state->remoteIOInstance,
+                                                        kAudioOutputUnitProperty_SetInputCallback,
+                                                        kAudioUnitScope_Global,
+                                                        OUTPUT_BUS_ID,
+                                                        &renderCallbackStruct,
+                                                        sizeof(renderCallbackStruct)));
+        }
     }
     
-    return noErr;
+    //Report the latencies the audio session measured for the current route
+    AVAudioSession* audioSession = [AVAudioSession sharedInstance];
+    engine->inputLatency = numInChannels > 0 ? audioSession.inputLatency : 0.0;
+    engine->outputLatency = numOutChannels > 0 ? audioSession.outputLatency : 0.0;
+    
+    //Initialize the audio unit, which is now ready to start.
+    ensureNoAudioUnitError(AudioUnitInitialize(state->remoteIOInstance));
+    
+    return 1;
+}
+
+static void remoteIOClose(mnEngine* engine)
+{
+    RemoteIOState* state = (RemoteIOState*)engine->backendData;
+    
+    //destroy the instance
+    ensureNoAudioUnitError(AudioUnitUninitialize(state->remoteIOInstance));
+    AudioComponentInstanceDispose(state->remoteIOInstance);
+    
+    //release buffers
+    mnLockedMemory_free(state->inputBufferList.mBuffers[0].mData);
+    free(state);
+    engine->backendData = NULL;
+}
+
+static int remoteIOStart(mnEngine* engine)
+{
+    RemoteIOState* state = (RemoteIOState*)engine->backendData;
+    ensureNoAudioUnitError(AudioOutputUnitStart(state->remoteIOInstance));
+    return 1;
 }
 
+static void remoteIOStop(mnEngine* engine)
+{
+    RemoteIOState* state = (RemoteIOState*)engine->backendData;
+    ensureNoAudioUnitError(AudioOutputUnitStop(state->remoteIOInstance));
+}
+
+static const mnBackend remoteIOBackend = {
+    "remote I/O",
+    remoteIOOpen,
+    remoteIOClose,
+    remoteIOStart,
+    remoteIOStop
+};
+
 #pragma mark MNAudioEngine
 
 #define kHasShownMicPermissionPromptSettingsKey @"kHasShownMicPermissionPromptSettingsKey"
@@ -189,8 +411,7 @@ static int instanceCount = 0;
 @interface MNAudioEngine()
 {
     @private
-    CoreAudioCallbackContext caCallbackContext;
-    MNOptions desiredOptions;
+    mnEngine engine;
     BOOL hasShownMicPermissionErrorDialog;
 }
 
@@ -206,10 +427,7 @@ static int instanceCount = 0;
 @implementation MNAudioEngine
 
 #pragma mark Lifecycle
--(id)initWithInputCallback:(mnAudioInputCallback)inputCallback
-            outputCallback:(mnAudioOutputCallback)outputCallback
-           callbackContext:(void*)context
-                   options:(MNOptions*)optionsPtr
+-(id)initCommon
 {
     if (instanceCount > 0) {
         @throw [NSException exceptionWithName:@"MNAudioEngineException"
@@ -228,22 +446,50 @@ static int instanceCount = 0;
         self.defaultMicPermissionAlertMessage =
             @"You have not given permission to access the microphone. Go to the settings menu to fix this.";
         self.defaultMicPermissionAlertButtonText = @"OK";
-        
-        //set up options struct and callback context
-        if (optionsPtr) {
-            memcpy(&desiredOptions, optionsPtr, sizeof(MNOptions));
-        }
-        else {
-            //default options
-            desiredOptions.sampleRate = 44100;
-            desiredOptions.numberOfInputChannels = 0;
-            desiredOptions.numberOfOutputChannels = 2;
-            desiredOptions.bufferSizeInFrames = 512;
-        }
-        
-        caCallbackContext.inputCallback = inputCallback;
-        caCallbackContext.outputCallback = outputCallback;
-        caCallbackContext.userCallbackContext = context;
+    }
+    
+    return self;
+}
+
+-(id)initWithInputCallback:(mnAudioInputCallback)inputCallback
+            outputCallback:(mnAudioOutputCallback)outputCallback
+           callbackContext:(void*)context
+                   options:(MNOptions*)optionsPtr
+{
+    self = [self initCommon];
+    
+    if (self) {
+        //set up the platform independent part of the engine
+        mnEngine_init(&engine, &remoteIOBackend, inputCallback, outputCallback, context, optionsPtr);
+    }
+    
+    return self;
+}
+
+-(id)initWithPlanarInputCallback:(mnAudioPlanarInputCallback)inputCallback
+                  outputCallback:(mnAudioPlanarOutputCallback)outputCallback
+                 callbackContext:(void*)context
+                         options:(MNOptions*)optionsPtr
+{
+    self = [self initCommon];
+    
+    if (self) {
+        //set up the platform independent part of the engine
+        mnEngine_initPlanar(&engine, &remoteIOBackend, inputCallback, outputCallback, context, optionsPtr);
+    }
+    
+    return self;
+}
+
+-(id)initWithDuplexCallback:(mnAudioDuplexCallback)duplexCallback
+            callbackContext:(void*)context
+                    options:(MNOptions*)optionsPtr
+{
+    self = [self initCommon];
+    
+    if (self) {
+        //set up the platform independent part of the engine
+        mnEngine_initDuplex(&engine, &remoteIOBackend, duplexCallback, context, optionsPtr);
     }
     
     return self;
@@ -252,9 +498,84 @@ static int instanceCount = 0;
 -(void)dealloc
 {
     [self stop];
+    mnEngine_deinit(&engine);
     instanceCount--;
 }
 
+#pragma mark Timing statistics
+-(void)getTimingStats:(mnTimingSnapshot*)snapshot
+{
+    mnEngine_getTimingStats(&engine, snapshot);
+}
+
+#pragma mark Real time setup
+-(BOOL)isMemoryLocked
+{
+    return mnEngine_isMemoryLocked(&engine) ? YES : NO;
+}
+
+#pragma mark Latency
+-(double)roundTripLatency
+{
+    return mnEngine_getRoundTripLatency(&engine);
+}
+
+-(int)blockLatency
+{
+    return mnEngine_getBlockLatency(&engine);
+}
+
+#pragma mark Metering
+-(void)setInputMeter:(mnMeter*)inputMeter outputMeter:(mnMeter*)outputMeter
+{
+    mnEngine_setMeters(&engine, inputMeter, outputMeter);
+}
+
+#pragma mark Analysis
+-(void)setAnalyzer:(mnAnalyzer*)analyzer
+{
+    mnEngine_setAnalyzer(&engine, analyzer);
+}
+
+#pragma mark Convolution
+-(void)setConvolver:(mnConvolver*)convolver
+{
+    mnEngine_setConvolver(&engine, convolver);
+}
+
+#pragma mark Logging
+-(void)setLog:(mnLog*)log
+{
+    mnEngine_setLog(&engine, log);
+}
+
+#pragma mark Render-ahead
+-(void)setRenderAheadFrames:(int)numFrames
+{
+    mnEngine_setRenderAheadFrames(&engine, numFrames);
+}
+
+-(int)renderAheadFill
+{
+    return mnEngine_getRenderAheadFill(&engine);
+}
+
+#pragma mark Scheduled events
+-(BOOL)setEventCallback:(mnAudioEventCallback)eventCallback capacity:(int)capacity
+{
+    return mnEngine_setEventCallback(&engine, eventCallback, capacity) ? YES : NO;
+}
+
+-(BOOL)postEvent:(const mnScheduledEvent*)event
+{
+    return mnEngine_postEvent(&engine, event) ? YES : NO;
+}
+
+-(double)nextSampleTime
+{
+    return mnEngine_getNextSampleTime(&engine);
+}
+
 #pragma mark Logging
 -(void)logAudioSessionRouteChange:(NSString*)message
 {
@@ -290,13 +611,13 @@ static int instanceCount = 0;
 -(void)startAudio
 {
     [self activateAudioSession];
-    [self createRemoteIOInstance];
-    [self startRemoteIOInstance];
+    mnEngine_stop(&engine);
+    mnEngine_start(&engine);
 }
 
 -(void)start
 {
-    BOOL micNeeded = desiredOptions.numberOfInputChannels > 0;
+    BOOL micNeeded = engine.options.numberOfInputChannels > 0;
     
     if (micNeeded) {
         AVAudioSession* audioSession = [AVAudioSession sharedInstance];
@@ -340,24 +661,23 @@ static int instanceCount = 0;
 
 -(void)stop
 {
-    [self stopRemoteIOInstance];
-    [self destroyRemoteIOInstance];
+    mnEngine_stop(&engine);
     [self deactivateAudioSession];
 }
 
 -(void)suspend
 {
-    if (caCallbackContext.remoteIOInstance) {
-        [self stopRemoteIOInstance];
+    if (engine.isOpen) {
+        mnEngine_suspend(&engine);
         [self deactivateAudioSession];
     }
 }
 
 -(void)resume
 {
-    if (caCallbackContext.remoteIOInstance) {
+    if (engine.isOpen) {
         [self activateAudioSession];
-        [self startRemoteIOInstance];
+        mnEngine_resume(&engine);
     }
     
 }
@@ -405,256 +725,6 @@ static int instanceCount = 0;
 }
 
 
--(void)ensureNoAudioUnitError:(OSStatus)result
-{
-#ifdef DEBUG
-    switch (result)
-    {
-        case kAudioUnitErr_InvalidProperty:
-            assert(0 && "kAudioUnitErr_InvalidProperty");
-            break;
-        case kAudioUnitErr_InvalidParameter:
-            assert(0 && "kAudioUnitErr_InvalidParameter");
-            break;
-        case kAudioUnitErr_InvalidElement:
-            assert(0 && "kAudioUnitErr_InvalidElement");
-            break;
-        case kAudioUnitErr_NoConnection:
-            assert(0 && "kAudioUnitErr_NoConnection");
-            break;
-        case kAudioUnitErr_FailedInitialization:
-            assert(0 && "kAudioUnitErr_FailedInitialization");
-            break;
-        case kAudioUnitErr_TooManyFramesToProcess:
-            assert(0 && "kAudioUnitErr_TooManyFramesToProcess");
-            break;
-        case kAudioUnitErr_InvalidFile:
-            assert(0 && "kAudioUnitErr_InvalidFile");
-            break;
-        case kAudioUnitErr_FormatNotSupported:
-            assert(0 && "kAudioUnitErr_FormatNotSupported");
-            break;
-        case kAudioUnitErr_Uninitialized:
-            assert(0 && "kAudioUnitErr_Uninitialized");
-            break;
-        case kAudioUnitErr_InvalidScope:
-            assert(0 && "kAudioUnitErr_InvalidScope");
-            break;
-        case kAudioUnitErr_PropertyNotWritable:
-            assert(0 && "kAudioUnitErr_PropertyNotWritable");
-            break;
-        case kAudioUnitErr_CannotDoInCurrentContext:
-            assert(0 && "kAudioUnitErr_CannotDoInCurrentContext");
-            break;
-        case kAudioUnitErr_InvalidPropertyValue:
-            assert(0 && "kAudioUnitErr_InvalidPropertyValue");
-            break;
-        case kAudioUnitErr_PropertyNotInUse:
-            assert(0 && "kAudioUnitErr_PropertyNotInUse");
-            break;
-        case kAudioUnitErr_Initialized:
-            assert(0 && "kAudioUnitErr_Initialized");
-            break;
-        case kAudioUnitErr_InvalidOfflineRender:
-            assert(0 && "kAudioUnitErr_InvalidOfflineRender");
-            break;
-        case kAudioUnitErr_Unauthorized:
-            assert(0 && "kAudioUnitErr_Unauthorized");
-            break;
-        default:
-            assert(result == noErr);
-            break;
-    }
-#endif //DEBUG
-}
-
--(void)setASBD:(AudioStreamBasicDescription*)asbd
-              :(int)numChannels
-              :(float)sampleRate
-{
-    memset(asbd, 0, sizeof(AudioStreamBasicDescription));
-    assert(numChannels == 1 || numChannels == 2);
-    asbd->mBitsPerChannel = 16;
-    asbd->mBytesPerFrame = 2 * numChannels;
-    asbd->mBytesPerPacket = asbd->mBytesPerFrame;
-    asbd->mChannelsPerFrame = numChannels;
-    asbd->mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
-    asbd->mFormatID = kAudioFormatLinearPCM;
-    asbd->mFramesPerPacket = 1;
-    asbd->mSampleRate = sampleRate;
-}
-
--(void)createRemoteIOInstance
-{
-    if (caCallbackContext.remoteIOInstance) {
-        [self destroyRemoteIOInstance];
-    }
-    
-    //create audio component description
-    AudioComponentDescription auDescription;
-    
-    auDescription.componentType          = kAudioUnitType_Output;
-    auDescription.componentSubType       = kAudioUnitSubType_RemoteIO;
-    auDescription.componentManufacturer  = kAudioUnitManufacturer_Apple;
-    auDescription.componentFlags         = 0;
-    auDescription.componentFlagsMask     = 0;
-    
-    //get a component reference
-    AudioComponent auComponent = AudioComponentFindNext(NULL, &auDescription);
-    
-    //get the actual instance
-    OSStatus status = AudioComponentInstanceNew(auComponent, &caCallbackContext.remoteIOInstance);
-    assert(status == noErr);
-    
-    //Get an upper limit on the number of frames that an audio callback
-    //will request/provide. This number is used to allocate buffers.
-    int maxNumberOfFramesPerSlice = 0;
-    UInt32 s = sizeof(maxNumberOfFramesPerSlice);
-    [self ensureNoAudioUnitError:AudioUnitGetProperty(caCallbackContext.remoteIOInstance,
-                                                      kAudioUnitProperty_MaximumFramesPerSlice,
-                                                      kAudioUnitScope_Global,
-                                                      0,
-                                                      &maxNumberOfFramesPerSlice,
-                                                      &s)];
-    
-    //enable input/output
-    const int numInChannels = desiredOptions.numberOfInputChannels;
-    const int numOutChannels = desiredOptions.numberOfOutputChannels;
-    const float sampleRate = desiredOptions.sampleRate;
-    
-    const unsigned int OUTPUT_BUS_ID = 0;
-    const unsigned int INPUT_BUS_ID = 1;
-    
-    if (numOutChannels > 0)
-    {
-        //enable playback if requested
-        UInt32 flag = 1;
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioOutputUnitProperty_EnableIO,
-                                                          kAudioUnitScope_Output,
-                                                          OUTPUT_BUS_ID,
-                                                          &flag,
-                                                          sizeof(flag))];
-        
-        //Set output format
-        AudioStreamBasicDescription outputFormat;
-        [self setASBD:&outputFormat :numOutChannels :sampleRate];
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioUnitProperty_StreamFormat,
-                                                          kAudioUnitScope_Input,
-                                                          OUTPUT_BUS_ID,
-                                                          &outputFormat,
-                                                          sizeof(outputFormat))];
-        
-        //Allocate buffer for storing float output values passed to the user
-        caCallbackContext.outputScratchBuffer = malloc(maxNumberOfFramesPerSlice * sizeof(float) * numOutChannels);
-        
-        //Hook up output callback
-        AURenderCallbackStruct renderCallbackStruct;
-        renderCallbackStruct.inputProc = remoteIOOutputCallback;
-        renderCallbackStruct.inputProcRefCon = &caCallbackContext;
-        
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioUnitProperty_SetRenderCallback,
-                                                          kAudioUnitScope_Global,
-                                                          OUTPUT_BUS_ID,
-                                                          &renderCallbackStruct,
-                                                          sizeof(renderCallbackStruct))];
-    }
-    
-    if (numInChannels > 0)
-    {
-        //Enable recording if requested
-        UInt32 flag = 1;
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioOutputUnitProperty_EnableIO,
-                                                          kAudioUnitScope_Input,
-                                                          INPUT_BUS_ID,
-                                                          &flag,
-                                                          sizeof(flag))];
-    
-        //Set input format
-        AudioStreamBasicDescription inputFormat;
-        [self setASBD:&inputFormat :numInChannels :sampleRate];
-        
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioUnitProperty_StreamFormat,
-                                                          kAudioUnitScope_Output,
-                                                          INPUT_BUS_ID,
-                                                          &inputFormat,
-                                                          sizeof(inputFormat))];
-        
-        //Allocate a buffer to store raw input samples in
-        memset(&caCallbackContext.inputBufferList, 0, sizeof(AudioBufferList));
-        caCallbackContext.inputBufferList.mNumberBuffers = 1;
-        caCallbackContext.inputBufferList.mBuffers[0].mNumberChannels = numInChannels;
-        caCallbackContext.inputBufferSizeInBytes = 2 * numInChannels * maxNumberOfFramesPerSlice;
-        caCallbackContext.inputBufferList.mBuffers[0].mDataByteSize = caCallbackContext.inputBufferSizeInBytes;
-        caCallbackContext.inputBufferList.mBuffers[0].mData =
-            malloc(caCallbackContext.inputBufferList.mBuffers[0].mDataByteSize);
-        
-        //Allocate a buffer to store float input values passed to the user
-        caCallbackContext.inputScratchBuffer =
-            malloc(maxNumberOfFramesPerSlice * sizeof(float) * numInChannels);
-        
-        //Hook up input callback
-        AURenderCallbackStruct renderCallbackStruct;
-        renderCallbackStruct.inputProc = remoteIOInputCallback;
-        renderCallbackStruct.inputProcRefCon = &caCallbackContext;
-        
-        [self ensureNoAudioUnitError:AudioUnitSetProperty(caCallbackContext.remoteIOInstance,
-                                                          kAudioOutputUnitProperty_SetInputCallback,
-                                                          kAudioUnitScope_Global,
-                                                          OUTPUT_BUS_ID,
-                                                          &renderCallbackStruct,
-                                                          sizeof(renderCallbackStruct))];
-    }
-    
-    //Initialize the audio unit, which is now ready to start.
-    [self ensureNoAudioUnitError:AudioUnitInitialize(caCallbackContext.remoteIOInstance)];
-}
-
--(void)startRemoteIOInstance
-{
-    if (caCallbackContext.remoteIOInstance) {
-        [self ensureNoAudioUnitError:AudioOutputUnitStart(caCallbackContext.remoteIOInstance)];
-    }
-}
-
--(void)stopRemoteIOInstance
-{
-    if (caCallbackContext.remoteIOInstance) {
-        [self ensureNoAudioUnitError:AudioOutputUnitStop(caCallbackContext.remoteIOInstance)];
-    }
-}
-
--(void)destroyRemoteIOInstance
-{
-    if (caCallbackContext.remoteIOInstance) {
-        //stop and destroy the instance
-        [self stopRemoteIOInstance];
-        [self ensureNoAudioUnitError:AudioUnitUninitialize(caCallbackContext.remoteIOInstance)];
-        caCallbackContext.remoteIOInstance = NULL;
-        
-        //release buffers
-        if (caCallbackContext.outputScratchBuffer) {
-            free(caCallbackContext.outputScratchBuffer);
-            caCallbackContext.outputScratchBuffer = NULL;
-        }
-        
-        if (caCallbackContext.inputScratchBuffer) {
-            free(caCallbackContext.inputScratchBuffer);
-            caCallbackContext.inputScratchBuffer = NULL;
-        }
-        
-        if (caCallbackContext.inputBufferList.mBuffers[0].mData) {
-            free(caCallbackContext.inputBufferList.mBuffers[0].mData);
-            memset(&caCallbackContext.inputBufferList, 0, sizeof(AudioBufferList));
-            caCallbackContext.inputBufferSizeInBytes = 0;
-        }
-    }
-}
-
 #pragma mark Audio session activation/deactivation
 
 -(void)activateAudioSession
@@ -676,7 +746,7 @@ static int instanceCount = 0;
     BOOL inputAvailable = audioSession.inputAvailable;
     
     //pick and set a suitable audio session category
-    BOOL needsRecording = inputAvailable && desiredOptions.numberOfInputChannels > 0;
+    BOOL needsRecording = inputAvailable && engine.options.numberOfInputChannels > 0;
     NSString* sessionCategory = AVAudioSessionCategoryPlayback;
     if (needsRecording) {
         sessionCategory = AVAudioSessionCategoryPlayAndRecord;
@@ -698,14 +768,14 @@ static int instanceCount = 0;
     }
     
     //set sample rate
-    result = [[AVAudioSession sharedInstance] setPreferredSampleRate:desiredOptions.sampleRate error:&error];
+    result = [[AVAudioSession sharedInstance] setPreferredSampleRate:engine.options.sampleRate error:&error];
     if (!result) {
         NSLog(@"%@", [error localizedDescription]);
         assert(false);
     }
     
     //set buffer size (i.e latency)
-    Float32 preferredBufferDuration = desiredOptions.bufferSizeInFrames / (float)desiredOptions.sampleRate;
+    Float32 preferredBufferDuration = engine.options.bufferSizeInFrames / (float)engine.options.sampleRate;
     result = [[AVAudioSession sharedInstance] setPreferredIOBufferDuration:preferredBufferDuration error:&error];
     if (!result) {
         NSLog(@"%@", [error localizedDescription]);
@@ -781,7 +851,7 @@ static int instanceCount = 0;
 {
     //TODO: this API is deprecated
     
-    if (desiredOptions.numberOfInputChannels > 0) {
+    if (engine.options.numberOfInputChannels > 0) {
         if (isInputAvailable) {
             //recording is requested and input became available
             [self stop];
@@ -0,0 +1,187 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "atomic.h"
+#include "clock.h"
+#include "backend_null.h"
+
+/**
+ * Per engine state of the null backend.
+ */
+typedef struct
+{
+    pthread_t thread;
+    /** Only accessed through atomic operations. Cleared to make the thread exit. */
+    int isRunning;
+    /** A buffer of silent input samples in the stream format. */
+    void* silence;
+    /** Receives output samples, which are then discarded. */
+    void* output;
+} NullState;
+
+static void sleepFor(double seconds)
+{
+    if (seconds <= 0.0)
+    {
+        return;
+    }
+    
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+static void* audioThreadEntryPoint(void* data)
+{
+    mnEngine* engine = (mnEngine*)data;
+    NullState* state = (NullState*)engine->backendData;
+    
+    const int numFrames = engine->maxFramesPerBuffer;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(engine->options.sampleFormat);
+    const int outputSize = numFrames * engine->options.numberOfOutputChannels * bytesPerSample;
+    const double period = numFrames / engine->deviceSampleRate;
+    
+    //Buffers are due at fixed points in time, so time spent in the
+    //callbacks does not accumulate as drift.
+    const double startTime = mnClock_getSeconds();
+    double deadline = startTime;
+    
+    while (mnAtomicLoadAcquire(&state->isRunning))
+    {
+        //the device time of the buffer, which skips ahead when a deadline is missed
+        const double sampleTime = (double)(long long)((deadline - startTime) * engine->deviceSampleRate + 0.5);
+        
+        if (engine->duplexCallback)
+        {
+            memset(state->output, 0, outputSize);
+            mnEngine_processDuplex(engine,
+                                   engine->options.numberOfInputChannels > 0 ? state->silence : NULL,
+                                   state->output,
+                                   numFrames,
+                                   sampleTime);
+        }
+        else
+        {
+            if (engine->options.numberOfInputChannels > 0)
+            {
+                mnEngine_processInput(engine, state->silence, numFrames, sampleTime);
+            }
+            
+            if (engine->options.numberOfOutputChannels > 0)
+            {
+                memset(state->output, 0, outputSize);
+                mnEngine_processOutput(engine, state->output, numFrames, sampleTime);
+            }
+        }
+        
+        deadline += period;
+        const double now = mnClock_getSeconds();
+        if (now > deadline + period)
+        {
+            //More than a buffer late. Start over instead of trying to catch up.
+            deadline = now;
+        }
+        sleepFor(deadline - now);
+    }
+    
+    return NULL;
+}
+
+static int nullOpen(mnEngine* engine, int* maxFramesPerBuffer)
+{
+    if (engine->options.bufferSizeInFrames < 1)
+    {
+        engine->options.bufferSizeInFrames = 512;
+    }
+    
+    if (engine->options.sampleRate <= 0)
+    {
+        engine->options.sampleRate = 44100;
+    }
+    
+    const int numFrames = engine->options.bufferSizeInFrames;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(engine->options.sampleFormat);
+    
+    NullState* state = calloc(1, sizeof(NullState));
+    state->silence = calloc(numFrames * engine->options.numberOfInputChannels + 1, bytesPerSample);
+    state->output = calloc(numFrames * engine->options.numberOfOutputChannels + 1, bytesPerSample);
+    
+    engine->backendData = state;
+    *maxFramesPerBuffer = numFrames;
+    return 1;
+}
+
+static void nullClose(mnEngine* engine)
+{
+    NullState* state = (NullState*)engine->backendData;
+    free(state->silence);
+    free(state->output);
+    free(state);
+    engine->backendData = NULL;
+}
+
+static int nullStart(mnEngine* engine)
+{
+    NullState* state = (NullState*)engine->backendData;
+    mnAtomicStoreRelease(1, &state->isRunning);
+    if (pthread_create(&state->thread, NULL, audioThreadEntryPoint, engine) != 0)
+    {
+        mnAtomicStoreRelease(0, &state->isRunning);
+        return 0;
+    }
+    
+    return 1;
+}
+
+static void nullStop(mnEngine* engine)
+{
+    NullState* state = (NullState*)engine->backendData;
+    mnAtomicStoreRelease(0, &state->isRunning);
+    pthread_join(state->thread, NULL);
+}
+
+static const mnBackend nullBackend =
+{
+    "null",
+    nullOpen,
+    nullClose,
+    nullStart,
+    nullStop
+};
+
+const mnBackend* mnNullBackend_get()
+{
+    return &nullBackend;
+}
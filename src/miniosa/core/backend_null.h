@@ -0,0 +1,49 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_BACKEND_NULL_H
+#define MN_BACKEND_NULL_H
+
+/*! \file */ 
+
+#include "engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Returns a backend without an audio device. A thread invokes the callbacks
+     * once every \c bufferSizeInFrames / \c sampleRate seconds, feeding silence
+     * to the input callback and discarding rendered output. Use it to run an
+     * engine in real time on machines without sound hardware.
+     */
+    const mnBackend* mnNullBackend_get();
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_BACKEND_NULL_H
@@ -0,0 +1,153 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend_offline.h"
+
+/**
+ * Per engine state of the offline backend.
+ */
+typedef struct
+{
+    /** A buffer of silent input samples in the stream format. */
+    void* silence;
+    /** Receives output samples when the caller doesn't want them. */
+    void* discardedOutput;
+    /** The number of frames rendered since the backend was opened. */
+    double sampleTime;
+} OfflineState;
+
+static int offlineOpen(mnEngine* engine, int* maxFramesPerBuffer)
+{
+    if (engine->options.bufferSizeInFrames < 1)
+    {
+        engine->options.bufferSizeInFrames = 512;
+    }
+    
+    const int numFrames = engine->options.bufferSizeInFrames;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(engine->options.sampleFormat);
+    
+    OfflineState* state = calloc(1, sizeof(OfflineState));
+    state->silence = calloc(numFrames * engine->options.numberOfInputChannels + 1, bytesPerSample);
+    state->discardedOutput = calloc(numFrames * engine->options.numberOfOutputChannels + 1, bytesPerSample);
+    
+    engine->backendData = state;
+    *maxFramesPerBuffer = numFrames;
+    return 1;
+}
+
+static void offlineClose(mnEngine* engine)
+{
+    OfflineState* state = (OfflineState*)engine->backendData;
+    free(state->silence);
+    free(state->discardedOutput);
+    free(state);
+    engine->backendData = NULL;
+}
+
+static int offlineStart(mnEngine* engine)
+{
+    (void)engine;
+    return 1;
+}
+
+static void offlineStop(mnEngine* engine)
+{
+    (void)engine;
+}
+
+static const mnBackend offlineBackend =
+{
+    "offline",
+    offlineOpen,
+    offlineClose,
+    offlineStart,
+    offlineStop
+};
+
+const mnBackend* mnOfflineBackend_get()
+{
+    return &offlineBackend;
+}
+
+int mnOfflineBackend_render(mnEngine* engine,
+                            const void* inputSamples,
+                            void* outputSamples,
+                            int numFrames)
+{
+    if (!engine->isRunning || engine->backend != &offlineBackend)
+    {
+        return 0;
+    }
+    
+    OfflineState* state = (OfflineState*)engine->backendData;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(engine->options.sampleFormat);
+    const int inputFrameSize = bytesPerSample * engine->options.numberOfInputChannels;
+    const int outputFrameSize = bytesPerSample * engine->options.numberOfOutputChannels;
+    const unsigned char* input = (const unsigned char*)inputSamples;
+    unsigned char* output = (unsigned char*)outputSamples;
+    
+    int numRendered = 0;
+    while (numRendered < numFrames)
+    {
+        int n = numFrames - numRendered;
+        if (n > engine->maxFramesPerBuffer)
+        {
+            n = engine->maxFramesPerBuffer;
+        }
+        
+        const void* source = input ? input + numRendered * inputFrameSize : state->silence;
+        void* target = output ? output + numRendered * outputFrameSize : state->discardedOutput;
+        
+        if (engine->duplexCallback)
+        {
+            memset(target, 0, n * outputFrameSize);
+            mnEngine_processDuplex(engine,
+                                   engine->options.numberOfInputChannels > 0 ? source : NULL,
+                                   target,
+                                   n,
+                                   state->sampleTime);
+        }
+        else
+        {
+            if (engine->options.numberOfInputChannels > 0)
+            {
+                mnEngine_processInput(engine, source, n, state->sampleTime);
+            }
+            
+            if (engine->options.numberOfOutputChannels > 0)
+            {
+                memset(target, 0, n * outputFrameSize);
+                mnEngine_processOutput(engine, target, n, state->sampleTime);
+            }
+        }
+        
+        numRendered += n;
+        state->sampleTime += n;
+    }
+    
+    return numRendered;
+}
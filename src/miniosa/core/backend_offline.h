@@ -0,0 +1,64 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_BACKEND_OFFLINE_H
+#define MN_BACKEND_OFFLINE_H
+
+/*! \file */ 
+
+#include "engine.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Returns a backend that has no thread of its own. The callbacks are invoked
+     * on the calling thread by ::mnOfflineBackend_render, as fast as possible.
+     * The streams run at \c engine->deviceSampleRate if that is set before the
+     * engine is started, which is useful for testing sample rate conversion.
+     */
+    const mnBackend* mnOfflineBackend_get();
+    
+    /**
+     * Runs the callbacks of a started engine using the offline backend, in
+     * buffers of at most \c bufferSizeInFrames frames at the device's rate.
+     * @param inputSamples Interleaved input samples in the stream format. Silence is
+     * used if NULL.
+     * @param outputSamples Receives interleaved output samples in the stream format.
+     * Ignored if NULL.
+     * @param numFrames The number of frames to render.
+     * @return The number of frames rendered, which is 0 if the engine is not running.
+     */
+    int mnOfflineBackend_render(mnEngine* engine,
+                                const void* inputSamples,
+                                void* outputSamples,
+                                int numFrames);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_BACKEND_OFFLINE_H
@@ -0,0 +1,1743 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "atomic.h"
+#include "clock.h"
+#include "engine.h"
+
+void mnOptions_setDefaults(mnOptions* options)
+{
+    options->sampleRate = 44100;
+    options->numberOfInputChannels = 0;
+    options->numberOfOutputChannels = 2;
+    options->bufferSizeInFrames = 512;
+    options->sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    options->resamplerQuality = MN_RESAMPLER_QUALITY_MEDIUM;
+    options->renderAheadFrames = 0;
+    options->maxRenderAheadFrames = 0;
+    options->fixedBufferSize = 0;
+    options->flushDenormals = 1;
+    mnThreadOptions_setDefaults(&options->renderThreadOptions);
+    options->renderThreadOptions.priority = 98;
+}
+
+void mnEngine_init(mnEngine* engine,
+                   const mnBackend* backend,
+                   mnAudioInputCallback inputCallback,
+                   mnAudioOutputCallback outputCallback,
+                   void* callbackContext,
+                   const mnOptions* options)
+{
+    memset(engine, 0, sizeof(mnEngine));
+    
+    engine->backend = backend;
+    engine->inputCallback = inputCallback;
+    engine->outputCallback = outputCallback;
+    engine->callbackContext = callbackContext;
+    mnTimingStats_init(&engine->timingStats);
+    
+    if (options)
+    {
+        memcpy(&engine->options, options, sizeof(mnOptions));
+    }
+    else
+    {
+        mnOptions_setDefaults(&engine->options);
+    }
+    
+    if (engine->options.sampleFormat < MN_SAMPLE_FORMAT_FLOAT32 ||
+        engine->options.sampleFormat > MN_SAMPLE_FORMAT_INT32)
+    {
+        engine->options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    }
+    
+    if (engine->options.resamplerQuality < MN_RESAMPLER_QUALITY_NONE ||
+        engine->options.resamplerQuality > MN_RESAMPLER_QUALITY_HIGH)
+    {
+        engine->options.resamplerQuality = MN_RESAMPLER_QUALITY_MEDIUM;
+    }
+    
+    if (engine->options.renderAheadFrames < 0)
+    {
+        engine->options.renderAheadFrames = 0;
+    }
+    if (engine->options.maxRenderAheadFrames < engine->options.renderAheadFrames)
+    {
+        engine->options.maxRenderAheadFrames = engine->options.renderAheadFrames;
+    }
+}
+
+void mnEngine_initPlanar(mnEngine* engine,
+                         const mnBackend* backend,
+                         mnAudioPlanarInputCallback inputCallback,
+                         mnAudioPlanarOutputCallback outputCallback,
+                         void* callbackContext,
+                         const mnOptions* options)
+{
+    mnEngine_init(engine, backend, NULL, NULL, callbackContext, options);
+    engine->planarInputCallback = inputCallback;
+    engine->planarOutputCallback = outputCallback;
+    engine->isPlanar = 1;
+}
+
+void mnEngine_initDuplex(mnEngine* engine,
+                         const mnBackend* backend,
+                         mnAudioDuplexCallback duplexCallback,
+                         void* callbackContext,
+                         const mnOptions* options)
+{
+    mnEngine_init(engine, backend, NULL, NULL, callbackContext, options);
+    engine->duplexCallback = duplexCallback;
+}
+
+void mnEngine_deinit(mnEngine* engine)
+{
+    mnEngine_stop(engine);
+    if (engine->eventCallback)
+    {
+        mnEventScheduler_deinit(&engine->eventScheduler);
+    }
+    memset(engine, 0, sizeof(mnEngine));
+}
+
+static void releaseBuffers(mnEngine* engine)
+{
+    mnLockedMemory_free(engine->inputScratchBuffer);
+    engine->inputScratchBuffer = NULL;
+    mnLockedMemory_free(engine->outputScratchBuffer);
+    engine->outputScratchBuffer = NULL;
+    mnLockedMemory_free(engine->inputChannels);
+    engine->inputChannels = NULL;
+    mnLockedMemory_free(engine->outputChannels);
+    engine->outputChannels = NULL;
+    mnLockedMemory_free(engine->outputSubBlockChannels);
+    engine->outputSubBlockChannels = NULL;
+    
+    if (engine->isResampling)
+    {
+        if (engine->options.numberOfInputChannels > 0)
+        {
+            mnResampler_deinit(&engine->inputResampler);
+        }
+        if (engine->options.numberOfOutputChannels > 0)
+        {
+            mnResampler_deinit(&engine->outputResampler);
+        }
+        mnLockedMemory_free(engine->deviceInputBuffer);
+        engine->deviceInputBuffer = NULL;
+        mnLockedMemory_free(engine->deviceOutputBuffer);
+        engine->deviceOutputBuffer = NULL;
+        mnLockedMemory_free(engine->resampledInput);
+        engine->resampledInput = NULL;
+        mnLockedMemory_free(engine->resampledOutput);
+        engine->resampledOutput = NULL;
+        engine->isResampling = 0;
+    }
+    
+    if (engine->isRenderingAhead)
+    {
+        mnFIFO_deinit(&engine->renderAheadRing);
+        mnLockedMemory_free(engine->renderAheadBlock);
+        engine->renderAheadBlock = NULL;
+        mnLockedMemory_free(engine->renderAheadOutput);
+        engine->renderAheadOutput = NULL;
+        engine->isRenderingAhead = 0;
+    }
+    
+    if (engine->isBufferSizeFixed)
+    {
+        //unused queues are zeroed, which is safe to deinitialize
+        mnFIFO_deinit(&engine->blockInputQueue);
+        mnFIFO_deinit(&engine->blockOutputQueue);
+        mnLockedMemory_free(engine->blockInput);
+        engine->blockInput = NULL;
+        mnLockedMemory_free(engine->blockOutput);
+        engine->blockOutput = NULL;
+        mnLockedMemory_free(engine->blockStaging);
+        engine->blockStaging = NULL;
+        engine->isBufferSizeFixed = 0;
+    }
+}
+
+/**
+ * Allocates a buffer holding \c numFrames samples per channel and an array of
+ * pointers to each channel. Channels start on cache line boundaries relative
+ * to the buffer, so that per channel loops run on aligned data. The buffer is
+ * locked into memory, since it is touched on every callback.
+ * @return NULL if allocation failed, in which case \c *buffer is NULL too.
+ */
+static float** allocateChannels(int numChannels, int numFrames, float** buffer)
+{
+    const int floatsPerLine = MN_CACHE_LINE_SIZE / sizeof(float);
+    const int stride = (numFrames + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    
+    *buffer = mnLockedMemory_alloc(stride * sizeof(float) * numChannels, NULL);
+    float** channels = mnLockedMemory_alloc(numChannels * sizeof(float*), NULL);
+    if (!*buffer || !channels)
+    {
+        mnLockedMemory_free(*buffer);
+        *buffer = NULL;
+        mnLockedMemory_free(channels);
+        return NULL;
+    }
+    for (int c = 0; c < numChannels; c++)
+    {
+        channels[c] = *buffer + c * stride;
+    }
+    
+    return channels;
+}
+
+/**
+ * Sets up resampling between the device's rate and the callbacks' rate, and
+ * the largest number of frames per callback.
+ * @return 0 if the rates are out of range or allocation failed.
+ */
+static int openResamplers(mnEngine* engine, int maxFramesPerBuffer)
+{
+    const int numIn = engine->options.numberOfInputChannels;
+    const int numOut = engine->options.numberOfOutputChannels;
+    const int isFloatStream = engine->options.sampleFormat == MN_SAMPLE_FORMAT_FLOAT32;
+    const double callbackRate = engine->options.sampleRate;
+    const double deviceRate = engine->deviceSampleRate;
+    
+    int maxFramesPerCallback = 0;
+    if (numIn > 0)
+    {
+        if (!mnResampler_init(&engine->inputResampler,
+                              numIn,
+                              deviceRate,
+                              callbackRate,
+                              engine->options.resamplerQuality,
+                              maxFramesPerBuffer))
+        {
+            return 0;
+        }
+        maxFramesPerCallback = mnResampler_getMaxOutputFrames(&engine->inputResampler);
+        if (!isFloatStream)
+        {
+            engine->deviceInputBuffer = mnLockedMemory_alloc(maxFramesPerBuffer * sizeof(float) * numIn, NULL);
+            if (!engine->deviceInputBuffer)
+            {
+                return 0;
+            }
+        }
+    }
+    
+    if (numOut > 0)
+    {
+        //the most frames a device buffer can need, given any fractional
+        //position the previous buffer left the resampler at
+        const double ratio = callbackRate / deviceRate;
+        const int maxFramesToRender = (int)ceil(maxFramesPerBuffer * ratio) + (int)ceil(ratio) + 2;
+        if (!mnResampler_init(&engine->outputResampler,
+                              numOut,
+                              callbackRate,
+                              deviceRate,
+                              engine->options.resamplerQuality,
+                              maxFramesToRender))
+        {
+            return 0;
+        }
+        if (maxFramesToRender > maxFramesPerCallback)
+        {
+            maxFramesPerCallback = maxFramesToRender;
+        }
+        if (!isFloatStream)
+        {
+            engine->deviceOutputBuffer = mnLockedMemory_alloc(maxFramesPerBuffer * sizeof(float) * numOut, NULL);
+            if (!engine->deviceOutputBuffer)
+            {
+                return 0;
+            }
+        }
+        engine->resampledOutput = mnLockedMemory_alloc(maxFramesPerCallback * sizeof(float) * numOut, NULL);
+        if (!engine->resampledOutput)
+        {
+            return 0;
+        }
+    }
+    
+    if (numIn > 0)
+    {
+        //duplex engines queue up to a callback's worth of frames on top of the
+        //frames being passed to the callback
+        const int capacity = engine->duplexCallback ? 2 * maxFramesPerCallback : maxFramesPerCallback;
+        engine->resampledInput = mnLockedMemory_alloc(capacity * sizeof(float) * numIn, NULL);
+        if (!engine->resampledInput)
+        {
+            return 0;
+        }
+    }
+    
+    engine->maxFramesPerCallback = maxFramesPerCallback;
+    engine->numResampledInputFrames = 0;
+    return 1;
+}
+
+/**
+ * Sets up the ring the render thread fills ahead of the device, and the
+ * blocks it renders in.
+ * @return 0 if \c maxRenderAheadFrames is out of range or allocation failed.
+ */
+static int openRenderAhead(mnEngine* engine)
+{
+    const int numOut = engine->options.numberOfOutputChannels;
+    const int maxFramesPerCallback = engine->maxFramesPerCallback;
+    
+    //the ring must hold at least what the device takes per buffer
+    mnOptions* options = &engine->options;
+    if (options->maxRenderAheadFrames < maxFramesPerCallback)
+    {
+        options->maxRenderAheadFrames = maxFramesPerCallback;
+    }
+    if (options->renderAheadFrames < maxFramesPerCallback)
+    {
+        options->renderAheadFrames = maxFramesPerCallback;
+    }
+    
+    engine->renderAheadBlockSize = options->bufferSizeInFrames > 0 && options->bufferSizeInFrames < maxFramesPerCallback ?
+                                   options->bufferSizeInFrames :
+                                   maxFramesPerCallback;
+    if (options->maxRenderAheadFrames > MN_MAX_POWER_OF_TWO - engine->renderAheadBlockSize)
+    {
+        return 0;
+    }
+    
+    //set first, so that releaseBuffers cleans up after a failure
+    engine->isRenderingAhead = 1;
+    if (!mnFIFO_init(&engine->renderAheadRing,
+                     options->maxRenderAheadFrames + engine->renderAheadBlockSize,
+                     numOut * sizeof(float)))
+    {
+        return 0;
+    }
+    engine->renderAheadBlock = mnLockedMemory_alloc(engine->renderAheadBlockSize * sizeof(float) * numOut, NULL);
+    if (!engine->renderAheadBlock)
+    {
+        return 0;
+    }
+    if (options->sampleFormat != MN_SAMPLE_FORMAT_FLOAT32 && !engine->isResampling)
+    {
+        engine->renderAheadOutput = mnLockedMemory_alloc(engine->maxFramesPerBuffer * sizeof(float) * numOut, NULL);
+        if (!engine->renderAheadOutput)
+        {
+            return 0;
+        }
+    }
+    //poll a few times per device buffer, without waking the render thread
+    //from the audio thread
+    engine->renderThreadPollInterval = 0.25 * maxFramesPerCallback / options->sampleRate;
+    if (engine->renderThreadPollInterval > 0.005)
+    {
+        engine->renderThreadPollInterval = 0.005;
+    }
+    else if (engine->renderThreadPollInterval < 0.0005)
+    {
+        engine->renderThreadPollInterval = 0.0005;
+    }
+    mnAtomicStoreRelaxed(options->renderAheadFrames, &engine->renderAheadTarget);
+    return 1;
+}
+
+/**
+ * Sets up the queues that turn the device's buffers into blocks of exactly
+ * \c bufferSizeInFrames frames at the callbacks' rate.
+ * @return 0 if allocation failed.
+ */
+static int openBlockAdapter(mnEngine* engine)
+{
+    const int numIn = engine->options.numberOfInputChannels;
+    const int numOut = engine->options.numberOfOutputChannels;
+    const int blockSize = engine->options.bufferSizeInFrames;
+    const int maxFramesPerCallback = engine->maxFramesPerCallback;
+    if (blockSize > MN_MAX_POWER_OF_TWO / 2 || maxFramesPerCallback > MN_MAX_POWER_OF_TWO - 2 * blockSize)
+    {
+        return 0;
+    }
+    
+    //set first, so that releaseBuffers cleans up after a failure
+    engine->isBufferSizeFixed = 1;
+    if (numIn > 0)
+    {
+        if (!mnFIFO_init(&engine->blockInputQueue, maxFramesPerCallback + blockSize, numIn * sizeof(float)))
+        {
+            return 0;
+        }
+        engine->blockInput = mnLockedMemory_alloc(blockSize * sizeof(float) * numIn, NULL);
+        if (!engine->blockInput)
+        {
+            return 0;
+        }
+    }
+    if (numOut > 0 && !engine->isRenderingAhead)
+    {
+        //room for the frames of a device buffer, the rest of a block and the
+        //silence that makes up for odd buffer sizes
+        if (!mnFIFO_init(&engine->blockOutputQueue, maxFramesPerCallback + 2 * blockSize, numOut * sizeof(float)))
+        {
+            return 0;
+        }
+        engine->blockOutput = mnLockedMemory_alloc(blockSize * sizeof(float) * numOut, NULL);
+        if (!engine->blockOutput)
+        {
+            return 0;
+        }
+    }
+    if (engine->options.sampleFormat != MN_SAMPLE_FORMAT_FLOAT32 && !engine->isResampling)
+    {
+        const int maxChannels = numIn > numOut ? numIn : numOut;
+        engine->blockStaging = mnLockedMemory_alloc(engine->maxFramesPerBuffer * sizeof(float) * maxChannels, NULL);
+        if (!engine->blockStaging)
+        {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0)
+    {
+        const int remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+/**
+ * Empties the block queues. Duplex engines start out delaying their output
+ * by the most frames that can be left over from whole device buffers, so
+ * that buffers of the size reported by the backend never run short.
+ */
+static void resetBlockAdapter(mnEngine* engine)
+{
+    const int blockSize = engine->options.bufferSizeInFrames;
+    if (engine->options.numberOfInputChannels > 0)
+    {
+        mnFIFO_consumeRead(&engine->blockInputQueue, mnFIFO_getNumElements(&engine->blockInputQueue));
+    }
+    
+    int latency = 0;
+    if (engine->blockOutput)
+    {
+        mnFIFO_consumeRead(&engine->blockOutputQueue, mnFIFO_getNumElements(&engine->blockOutputQueue));
+        if (engine->duplexCallback && engine->options.numberOfInputChannels > 0)
+        {
+            latency = blockSize - greatestCommonDivisor(blockSize, engine->maxFramesPerBuffer);
+            
+            mnFIFOSpans spans;
+            mnFIFO_reserveWrite(&engine->blockOutputQueue, latency, &spans);
+            for (int i = 0; i < 2; i++)
+            {
+                memset(spans.elements[i], 0, spans.numElements[i] * engine->blockOutputQueue.elementSize);
+            }
+            mnFIFO_commitWrite(&engine->blockOutputQueue, latency);
+        }
+    }
+    
+    mnAtomicStoreRelaxed(latency, &engine->blockLatency);
+}
+
+static int openBackend(mnEngine* engine)
+{
+    if (engine->isOpen)
+    {
+        return 1;
+    }
+    
+    int maxFramesPerBuffer = 0;
+    if (!engine->backend->open(engine, &maxFramesPerBuffer))
+    {
+        return 0;
+    }
+    engine->maxFramesPerBuffer = maxFramesPerBuffer;
+    
+    if (engine->deviceSampleRate <= 0.0)
+    {
+        engine->deviceSampleRate = engine->options.sampleRate;
+    }
+    
+    engine->isResampling = engine->deviceSampleRate != engine->options.sampleRate;
+    if (engine->options.resamplerQuality == MN_RESAMPLER_QUALITY_NONE)
+    {
+        //the callbacks run at whatever rate the device runs at
+        engine->options.sampleRate = engine->deviceSampleRate;
+        engine->isResampling = 0;
+    }
+    
+    const int numIn = engine->options.numberOfInputChannels;
+    const int numOut = engine->options.numberOfOutputChannels;
+    
+    engine->maxFramesPerCallback = maxFramesPerBuffer;
+    if (engine->isResampling && !openResamplers(engine, maxFramesPerBuffer))
+    {
+        releaseBuffers(engine);
+        engine->backend->close(engine);
+        return 0;
+    }
+    
+    const int isBufferSizeFixed = engine->options.fixedBufferSize && engine->options.bufferSizeInFrames > 0;
+    if (isBufferSizeFixed && engine->maxFramesPerCallback < engine->options.bufferSizeInFrames)
+    {
+        //the callbacks get whole blocks, however small the device's buffers are
+        engine->maxFramesPerCallback = engine->options.bufferSizeInFrames;
+    }
+    const int maxFramesPerCallback = engine->maxFramesPerCallback;
+    
+    int isAllocated = 1;
+    if (engine->isPlanar)
+    {
+        //planar callbacks always get their own buffers, which the stream
+        //is (de)interleaved to or from
+        if (numIn > 0)
+        {
+            engine->inputChannels = allocateChannels(numIn, maxFramesPerCallback, &engine->inputScratchBuffer);
+            isAllocated = engine->inputChannels != NULL;
+        }
+        if (numOut > 0 && isAllocated)
+        {
+            engine->outputChannels = allocateChannels(numOut, maxFramesPerCallback, &engine->outputScratchBuffer);
+            engine->outputSubBlockChannels = mnLockedMemory_alloc(numOut * sizeof(float*), NULL);
+            isAllocated = engine->outputChannels && engine->outputSubBlockChannels;
+        }
+    }
+    else if (engine->options.sampleFormat != MN_SAMPLE_FORMAT_FLOAT32 && !engine->isResampling)
+    {
+        //Float streams are passed to and from the callbacks as is,
+        //other formats need a buffer to convert via. Resampled streams
+        //are converted via the device rate buffers instead.
+        if (numIn > 0)
+        {
+            engine->inputScratchBuffer = mnLockedMemory_alloc(maxFramesPerBuffer * sizeof(float) * numIn, NULL);
+            isAllocated = engine->inputScratchBuffer != NULL;
+        }
+        if (numOut > 0)
+        {
+            engine->outputScratchBuffer = mnLockedMemory_alloc(maxFramesPerBuffer * sizeof(float) * numOut, NULL);
+            isAllocated = isAllocated && engine->outputScratchBuffer;
+        }
+    }
+    if (!isAllocated)
+    {
+        releaseBuffers(engine);
+        engine->backend->close(engine);
+        return 0;
+    }
+    
+    if (engine->options.renderAheadFrames > 0 && numOut > 0 && !engine->duplexCallback &&
+        !openRenderAhead(engine))
+    {
+        releaseBuffers(engine);
+        engine->backend->close(engine);
+        return 0;
+    }
+    if (isBufferSizeFixed && !openBlockAdapter(engine))
+    {
+        releaseBuffers(engine);
+        engine->backend->close(engine);
+        return 0;
+    }
+    
+    engine->isOpen = 1;
+    return 1;
+}
+
+int mnEngine_start(mnEngine* engine)
+{
+    if (engine->isRunning)
+    {
+        return 1;
+    }
+    
+    if (!openBackend(engine))
+    {
+        return 0;
+    }
+    
+    return mnEngine_resume(engine);
+}
+
+void mnEngine_stop(mnEngine* engine)
+{
+    mnEngine_suspend(engine);
+    
+    if (engine->isOpen)
+    {
+        engine->backend->close(engine);
+        releaseBuffers(engine);
+        engine->isOpen = 0;
+    }
+}
+
+static void renderAhead(mnEngine* engine);
+
+static void sleepFor(double seconds)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+static void* renderThreadEntryPoint(void* data)
+{
+    mnEngine* engine = (mnEngine*)data;
+    if (engine->options.flushDenormals)
+    {
+        //the thread is the engine's own, so the state is never restored
+        mnFloatState_enterFlushToZero();
+    }
+    
+    while (!mnAtomicLoad(&engine->isRenderThreadStopping))
+    {
+        renderAhead(engine);
+        sleepFor(engine->renderThreadPollInterval);
+    }
+    return NULL;
+}
+
+/**
+ * Starts the render thread, with real time priority if the process is allowed to.
+ */
+static int startRenderThread(mnEngine* engine)
+{
+    mnAtomicStore(0, &engine->isRenderThreadStopping);
+    return mnThread_create(&engine->renderThread,
+                           &engine->options.renderThreadOptions,
+                           renderThreadEntryPoint,
+                           engine);
+}
+
+static void stopRenderThread(mnEngine* engine)
+{
+    mnAtomicStore(1, &engine->isRenderThreadStopping);
+    pthread_join(engine->renderThread, NULL);
+}
+
+void mnEngine_suspend(mnEngine* engine)
+{
+    if (engine->isRunning)
+    {
+        engine->backend->stop(engine);
+        if (engine->isRenderingAhead)
+        {
+            stopRenderThread(engine);
+        }
+        engine->isRunning = 0;
+    }
+}
+
+int mnEngine_resume(mnEngine* engine)
+{
+    if (!engine->isOpen)
+    {
+        return 0;
+    }
+    
+    if (!engine->isRunning)
+    {
+        if (engine->isResampling)
+        {
+            //don't mix stale history into the resumed streams
+            if (engine->options.numberOfInputChannels > 0)
+            {
+                mnResampler_reset(&engine->inputResampler);
+            }
+            if (engine->options.numberOfOutputChannels > 0)
+            {
+                mnResampler_reset(&engine->outputResampler);
+            }
+            engine->numResampledInputFrames = 0;
+        }
+        
+        if (engine->isBufferSizeFixed)
+        {
+            resetBlockAdapter(engine);
+        }
+        
+        mnTimingStats_restart(&engine->timingStats);
+        engine->inputCallbackDuration = 0.0;
+        
+        if (engine->isRenderingAhead)
+        {
+            //fill the ring before the device starts taking frames from it
+            renderAhead(engine);
+            if (!startRenderThread(engine))
+            {
+                return 0;
+            }
+        }
+        
+        engine->isRunning = engine->backend->start(engine) ? 1 : 0;
+        if (!engine->isRunning && engine->isRenderingAhead)
+        {
+            stopRenderThread(engine);
+        }
+    }
+    
+    return engine->isRunning;
+}
+
+/**
+ * Applies all events due at or before \c sampleTime.
+ */
+static void applyDueEvents(mnEngine* engine, double sampleTime)
+{
+    mnScheduledEvent event;
+    while (mnEventScheduler_popDue(&engine->eventScheduler, sampleTime, &event))
+    {
+        engine->eventCallback(&event, engine->callbackContext);
+    }
+}
+
+/**
+ * Applies the events due by the last frame of a block before the block is
+ * processed, for callbacks that can't be split at event times.
+ */
+static void beginEventBlock(mnEngine* engine, double sampleTime, int numFrames)
+{
+    mnEventScheduler_beginBuffer(&engine->eventScheduler, sampleTime, numFrames);
+    applyDueEvents(engine, sampleTime < 0.0 ? HUGE_VAL : sampleTime + numFrames - 1);
+}
+
+/**
+ * Converts a device time to a time at the callbacks' rate.
+ */
+static double getCallbackSampleTime(mnEngine* engine, double sampleTime)
+{
+    if (!engine->isResampling || sampleTime < 0.0)
+    {
+        return sampleTime;
+    }
+    
+    return floor(sampleTime * engine->options.sampleRate / engine->deviceSampleRate + 0.5);
+}
+
+/**
+ * Resamples a buffer of input to the callbacks' rate.
+ * @param samples \c numFrames frames in the stream format.
+ * @param target Receives interleaved floats.
+ * @return The number of frames written to \c target.
+ */
+static int resampleInput(mnEngine* engine, const void* samples, int numFrames, float* target, int maxFrames)
+{
+    const float* floatSamples = (const float*)samples;
+    if (engine->options.sampleFormat != MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        mnConvertToFloat(samples,
+                         engine->options.sampleFormat,
+                         engine->deviceInputBuffer,
+                         numFrames * engine->options.numberOfInputChannels);
+        floatSamples = engine->deviceInputBuffer;
+    }
+    
+    return mnResampler_process(&engine->inputResampler, floatSamples, numFrames, target, maxFrames);
+}
+
+/**
+ * Passes interleaved float input at the callbacks' rate to the input meter
+ * and the analyzer, if set.
+ */
+static void measureInput(mnEngine* engine, const float* samples, int numFrames)
+{
+    if (engine->inputMeter)
+    {
+        mnMeter_processInterleaved(engine->inputMeter, samples, numFrames);
+    }
+    if (engine->analyzer)
+    {
+        mnAnalyzer_writeInterleaved(engine->analyzer, samples, numFrames);
+    }
+}
+
+/**
+ * Passes a buffer of input to the input callback.
+ * @param format The format of \c samples, which is float if they have been resampled.
+ */
+static void dispatchInput(mnEngine* engine, const void* samples, mnSampleFormat format, int numFrames)
+{
+    if (engine->planarInputCallback)
+    {
+        const int numChannels = engine->options.numberOfInputChannels;
+        mnConvertToFloatPlanar(samples,
+                               format,
+                               engine->inputChannels,
+                               numChannels,
+                               numFrames);
+        if (engine->inputMeter)
+        {
+            mnMeter_processPlanar(engine->inputMeter, (const float* const*)engine->inputChannels, numFrames);
+        }
+        if (engine->analyzer)
+        {
+            mnAnalyzer_writePlanar(engine->analyzer, (const float* const*)engine->inputChannels, numFrames);
+        }
+        engine->planarInputCallback(numChannels,
+                                    numFrames,
+                                    (const float* const*)engine->inputChannels,
+                                    engine->callbackContext);
+    }
+    else if (engine->inputCallback)
+    {
+        const int numChannels = engine->options.numberOfInputChannels;
+        
+        //Float samples are passed to the user as is. Other formats are
+        //converted to floats first.
+        const float* floatSamples = (const float*)samples;
+        if (format != MN_SAMPLE_FORMAT_FLOAT32)
+        {
+            mnConvertToFloat(samples,
+                             format,
+                             engine->inputScratchBuffer,
+                             numFrames * numChannels);
+            floatSamples = engine->inputScratchBuffer;
+        }
+        
+        measureInput(engine, floatSamples, numFrames);
+        engine->inputCallback(numChannels, numFrames, floatSamples, engine->callbackContext);
+    }
+}
+
+/**
+ * Raises the reported block latency to \c numFrames, if it is lower.
+ */
+static void raiseBlockLatency(mnEngine* engine, int numFrames)
+{
+    if (numFrames > mnAtomicLoadRelaxed(&engine->blockLatency))
+    {
+        mnAtomicStoreRelaxed(numFrames, &engine->blockLatency);
+    }
+}
+
+/**
+ * Queues input at the callbacks' rate and passes each complete block to the
+ * input callback. Frames left over wait for the next buffer.
+ * @param callbackTime The time at the callbacks' rate of the first frame, or negative.
+ */
+static void dispatchInputBlocks(mnEngine* engine,
+                                const void* samples,
+                                mnSampleFormat format,
+                                int numFrames,
+                                double callbackTime)
+{
+    const int blockSize = engine->options.bufferSizeInFrames;
+    const float* floatSamples = (const float*)samples;
+    if (format != MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        mnConvertToFloat(samples,
+                         format,
+                         engine->blockStaging,
+                         numFrames * engine->options.numberOfInputChannels);
+        floatSamples = engine->blockStaging;
+    }
+    
+    double blockTime = callbackTime < 0.0 ? -1.0 : callbackTime - mnFIFO_getNumElements(&engine->blockInputQueue);
+    mnFIFO_pushN(&engine->blockInputQueue, floatSamples, numFrames);
+    
+    while (mnFIFO_getNumElements(&engine->blockInputQueue) >= blockSize)
+    {
+        mnFIFO_popN(&engine->blockInputQueue, engine->blockInput, blockSize);
+        if (engine->eventCallback && engine->options.numberOfOutputChannels == 0)
+        {
+            beginEventBlock(engine, blockTime, blockSize);
+        }
+        dispatchInput(engine, engine->blockInput, MN_SAMPLE_FORMAT_FLOAT32, blockSize);
+        blockTime = blockTime < 0.0 ? -1.0 : blockTime + blockSize;
+    }
+    
+    raiseBlockLatency(engine, mnFIFO_getNumElements(&engine->blockInputQueue));
+}
+
+/**
+ * Prepares the backend's thread for running the callbacks.
+ * @return The state to restore with ::leaveCallbacks.
+ */
+static mnFloatState enterCallbacks(mnEngine* engine)
+{
+    return engine->options.flushDenormals ? mnFloatState_enterFlushToZero() : 0;
+}
+
+static void leaveCallbacks(mnEngine* engine, mnFloatState floatState)
+{
+    if (engine->options.flushDenormals)
+    {
+        mnFloatState_restore(floatState);
+    }
+}
+
+/**
+ * Records the timing of a device buffer, logging it if it missed its deadline.
+ */
+static void recordTiming(mnEngine* engine, double duration, int numFrames, double sampleTime)
+{
+    if (mnTimingStats_record(&engine->timingStats, duration, numFrames, engine->deviceSampleRate, sampleTime) &&
+        engine->log)
+    {
+        mnLog_write(engine->log, sampleTime, "missed deadline, buffer of %d frames", numFrames);
+    }
+}
+
+void mnEngine_processInput(mnEngine* engine, const void* samples, int numFrames, double sampleTime)
+{
+    const double startTime = mnClock_getSeconds();
+    const mnFloatState floatState = enterCallbacks(engine);
+    
+    const void* callbackSamples = samples;
+    mnSampleFormat callbackFormat = engine->options.sampleFormat;
+    int numCallbackFrames = numFrames;
+    if (engine->isResampling)
+    {
+        numCallbackFrames = resampleInput(engine,
+                                          samples,
+                                          numFrames,
+                                          engine->resampledInput,
+                                          engine->maxFramesPerCallback);
+        callbackSamples = engine->resampledInput;
+        callbackFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    }
+    
+    if (engine->eventCallback && engine->options.numberOfOutputChannels == 0 && !engine->isBufferSizeFixed)
+    {
+        //no output to split, so events take effect at buffer granularity
+        beginEventBlock(engine, getCallbackSampleTime(engine, sampleTime), numCallbackFrames);
+    }
+    
+    if (numCallbackFrames > 0)
+    {
+        if (engine->recorder)
+        {
+            mnRecorder_write(engine->recorder, callbackSamples, callbackFormat, numCallbackFrames);
+        }
+        if (engine->isBufferSizeFixed)
+        {
+            dispatchInputBlocks(engine,
+                                callbackSamples,
+                                callbackFormat,
+                                numCallbackFrames,
+                                getCallbackSampleTime(engine, sampleTime));
+        }
+        else
+        {
+            dispatchInput(engine, callbackSamples, callbackFormat, numCallbackFrames);
+        }
+    }
+    
+    leaveCallbacks(engine, floatState);
+    const double duration = mnClock_getSeconds() - startTime;
+    if (engine->options.numberOfOutputChannels > 0)
+    {
+        //recorded together with the output callback of the same buffer
+        engine->inputCallbackDuration = duration;
+    }
+    else
+    {
+        recordTiming(engine, duration, numFrames, sampleTime);
+    }
+}
+
+/**
+ * Lets the output callback render \c numFrames frames starting at \c offset.
+ * @param floatSamples The interleaved buffer rendered to by non-planar callbacks.
+ */
+static void renderOutput(mnEngine* engine, float* floatSamples, int offset, int numFrames)
+{
+    const int numChannels = engine->options.numberOfOutputChannels;
+    if (engine->planarOutputCallback)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            engine->outputSubBlockChannels[c] = engine->outputChannels[c] + offset;
+        }
+        engine->planarOutputCallback(numChannels,
+                                     numFrames,
+                                     engine->outputSubBlockChannels,
+                                     engine->callbackContext);
+    }
+    else if (engine->duplexCallback)
+    {
+        const int numInputChannels = engine->options.numberOfInputChannels;
+        engine->duplexCallback(engine->duplexInput ? engine->duplexInput + offset * numInputChannels : NULL,
+                               floatSamples + offset * numChannels,
+                               numInputChannels,
+                               numChannels,
+                               numFrames,
+                               engine->callbackContext);
+    }
+    else if (engine->outputCallback)
+    {
+        engine->outputCallback(numChannels,
+                               numFrames,
+                               floatSamples + offset * numChannels,
+                               engine->callbackContext);
+    }
+}
+
+/**
+ * Renders a buffer in sub-blocks that end where scheduled events take effect,
+ * applying the events between sub-blocks.
+ */
+static void renderScheduled(mnEngine* engine, float* floatSamples, int numFrames, double sampleTime)
+{
+    mnEventScheduler_beginBuffer(&engine->eventScheduler, sampleTime, numFrames);
+    
+    if (sampleTime < 0.0)
+    {
+        //without a device time, events take effect at the start of the buffer
+        applyDueEvents(engine, HUGE_VAL);
+        renderOutput(engine, floatSamples, 0, numFrames);
+        return;
+    }
+    
+    int offset = 0;
+    while (offset < numFrames)
+    {
+        applyDueEvents(engine, sampleTime + offset);
+        
+        int end = mnEventScheduler_getNextOffset(&engine->eventScheduler, sampleTime, numFrames);
+        if (end <= offset)
+        {
+            //guards against rounding in the time comparisons
+            end = offset + 1;
+        }
+        
+        renderOutput(engine, floatSamples, offset, end - offset);
+        offset = end;
+    }
+}
+
+/**
+ * Lets the output or duplex callback render a buffer and converts it to \c format.
+ * @param samples Receives \c numFrames interleaved frames in \c format, which
+ * is float if they are to be resampled.
+ */
+static void renderToStream(mnEngine* engine, void* samples, mnSampleFormat format, int numFrames, double sampleTime)
+{
+    //Float samples are rendered straight into the target buffer, unless
+    //the callbacks are planar. Other formats are rendered to a scratch buffer.
+    const int isFloatStream = format == MN_SAMPLE_FORMAT_FLOAT32;
+    float* floatSamples = isFloatStream && !engine->isPlanar ? (float*)samples : engine->outputScratchBuffer;
+    
+    if (engine->eventCallback && engine->isBufferSizeFixed)
+    {
+        //blocks aren't split, so events take effect at block granularity
+        beginEventBlock(engine, sampleTime, numFrames);
+        renderOutput(engine, floatSamples, 0, numFrames);
+    }
+    else if (engine->eventCallback)
+    {
+        renderScheduled(engine, floatSamples, numFrames, sampleTime);
+    }
+    else
+    {
+        renderOutput(engine, floatSamples, 0, numFrames);
+    }
+    
+    if (engine->convolver && engine->options.numberOfOutputChannels > 0)
+    {
+        if (engine->planarOutputCallback)
+        {
+            mnConvolver_processPlanar(engine->convolver, engine->outputChannels, numFrames);
+        }
+        else if (engine->outputCallback || engine->duplexCallback)
+        {
+            mnConvolver_processInterleaved(engine->convolver, floatSamples, numFrames);
+        }
+    }
+    
+    if (engine->outputMeter && engine->options.numberOfOutputChannels > 0)
+    {
+        if (engine->planarOutputCallback)
+        {
+            mnMeter_processPlanar(engine->outputMeter, (const float* const*)engine->outputChannels, numFrames);
+        }
+        else if (engine->outputCallback || engine->duplexCallback)
+        {
+            mnMeter_processInterleaved(engine->outputMeter, floatSamples, numFrames);
+        }
+    }
+    
+    if (engine->planarOutputCallback)
+    {
+        //interleave and convert in one pass
+        mnConvertFromFloatPlanar((const float* const*)engine->outputChannels,
+                                 engine->options.numberOfOutputChannels,
+                                 samples,
+                                 format,
+                                 numFrames,
+                                 NULL);
+    }
+    else if ((engine->outputCallback || engine->duplexCallback) &&
+             !isFloatStream &&
+             engine->options.numberOfOutputChannels > 0)
+    {
+        //convert the float samples and copy them to the target buffer
+        mnConvertFromFloat(engine->outputScratchBuffer,
+                           samples,
+                           format,
+                           numFrames * engine->options.numberOfOutputChannels,
+                           NULL);
+    }
+}
+
+/**
+ * Returns the number of frames the callbacks need to render for the next
+ * \c numFrames frames of resampled output.
+ */
+static int getNumFramesToRender(mnEngine* engine, int numFrames)
+{
+    const int numFramesToRender = mnResampler_getInputFramesNeeded(&engine->outputResampler, numFrames);
+    return numFramesToRender < engine->outputResampler.maxInputFrames ? numFramesToRender : engine->outputResampler.maxInputFrames;
+}
+
+/**
+ * Resamples \c numFramesToRender frames at the callbacks' rate in
+ * \c resampledOutput to \c numFrames frames at the device's rate.
+ * @param samples Receives interleaved frames in the stream format.
+ */
+static void resampleOutput(mnEngine* engine, void* samples, int numFrames, int numFramesToRender)
+{
+    const int numChannels = engine->options.numberOfOutputChannels;
+    if (numChannels == 0)
+    {
+        return;
+    }
+    
+    const int isFloatStream = engine->options.sampleFormat == MN_SAMPLE_FORMAT_FLOAT32;
+    float* floatSamples = isFloatStream ? (float*)samples : engine->deviceOutputBuffer;
+    const int numResampled = mnResampler_process(&engine->outputResampler,
+                                                 engine->resampledOutput,
+                                                 numFramesToRender,
+                                                 floatSamples,
+                                                 numFrames);
+    if (numResampled < numFrames)
+    {
+        memset(floatSamples + numResampled * numChannels, 0, (numFrames - numResampled) * numChannels * sizeof(float));
+    }
+    
+    if (!isFloatStream)
+    {
+        mnConvertFromFloat(engine->deviceOutputBuffer,
+                           samples,
+                           engine->options.sampleFormat,
+                           numFrames * numChannels,
+                           NULL);
+    }
+}
+
+/**
+ * Lets the callbacks render \c numFramesToRender frames at their rate and
+ * resamples them to \c numFrames frames at the device's rate.
+ * @param samples Receives interleaved frames in the stream format.
+ */
+static void renderResampled(mnEngine* engine, void* samples, int numFrames, int numFramesToRender, double sampleTime)
+{
+    renderToStream(engine,
+                   engine->resampledOutput,
+                   MN_SAMPLE_FORMAT_FLOAT32,
+                   numFramesToRender,
+                   getCallbackSampleTime(engine, sampleTime));
+    resampleOutput(engine, samples, numFrames, numFramesToRender);
+}
+
+/**
+ * Takes \c numFrames frames from the block output queue. If the queue runs
+ * short, which only happens to duplex engines when a device buffer leaves
+ * more input frames over than ever before, the missing frames are played as
+ * silence, delaying the rest of the output for good.
+ */
+static void takeBlocks(mnEngine* engine, float* target, int numFrames)
+{
+    const int numTaken = mnFIFO_popN(&engine->blockOutputQueue, target, numFrames);
+    if (numTaken < numFrames)
+    {
+        const int numChannels = engine->options.numberOfOutputChannels;
+        memset(target + numTaken * numChannels, 0, (numFrames - numTaken) * numChannels * sizeof(float));
+        raiseBlockLatency(engine, mnAtomicLoadRelaxed(&engine->blockLatency) + numFrames - numTaken);
+    }
+}
+
+/**
+ * Fills a device buffer from the block output queue, resampling and
+ * converting the frames as needed.
+ * @param numCallbackFrames The number of frames at the callbacks' rate the buffer takes.
+ */
+static void playBlocks(mnEngine* engine, void* samples, int numFrames, int numCallbackFrames)
+{
+    if (engine->isResampling)
+    {
+        takeBlocks(engine, engine->resampledOutput, numCallbackFrames);
+        resampleOutput(engine, samples, numFrames, numCallbackFrames);
+    }
+    else if (engine->options.sampleFormat == MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        takeBlocks(engine, (float*)samples, numFrames);
+    }
+    else
+    {
+        takeBlocks(engine, engine->blockStaging, numFrames);
+        mnConvertFromFloat(engine->blockStaging,
+                           samples,
+                           engine->options.sampleFormat,
+                           numFrames * engine->options.numberOfOutputChannels,
+                           NULL);
+    }
+}
+
+/**
+ * Renders a block and queues it for output.
+ * @param offset The number of frames before the block's first frame,
+ * counting from the first frame of the current device buffer.
+ */
+static void renderBlock(mnEngine* engine, double callbackTime, int offset)
+{
+    const int blockSize = engine->options.bufferSizeInFrames;
+    renderToStream(engine,
+                   engine->blockOutput,
+                   MN_SAMPLE_FORMAT_FLOAT32,
+                   blockSize,
+                   callbackTime < 0.0 ? -1.0 : callbackTime + offset);
+    if (engine->blockOutput)
+    {
+        mnFIFO_pushN(&engine->blockOutputQueue, engine->blockOutput, blockSize);
+    }
+}
+
+/**
+ * Renders as many whole blocks as a device buffer needs and plays them.
+ * Frames left over are played in the next buffer.
+ */
+static void processOutputBlocks(mnEngine* engine, void* samples, int numFrames, double sampleTime)
+{
+    const int numCallbackFrames = engine->isResampling ? getNumFramesToRender(engine, numFrames) : numFrames;
+    const double callbackTime = getCallbackSampleTime(engine, sampleTime);
+    
+    int numQueued = mnFIFO_getNumElements(&engine->blockOutputQueue);
+    while (numQueued < numCallbackFrames)
+    {
+        renderBlock(engine, callbackTime, numQueued);
+        numQueued += engine->options.bufferSizeInFrames;
+    }
+    
+    playBlocks(engine, samples, numFrames, numCallbackFrames);
+}
+
+/**
+ * Renders blocks into the render-ahead ring until it holds the target number
+ * of frames. The frames have no device time yet, so scheduled events take
+ * effect at the start of the next block rendered after they are posted.
+ */
+static void renderAhead(mnEngine* engine)
+{
+    const int target = mnAtomicLoadRelaxed(&engine->renderAheadTarget);
+    while (mnFIFO_getNumElements(&engine->renderAheadRing) < target)
+    {
+        renderToStream(engine,
+                       engine->renderAheadBlock,
+                       MN_SAMPLE_FORMAT_FLOAT32,
+                       engine->renderAheadBlockSize,
+                       -1.0);
+        mnFIFO_pushN(&engine->renderAheadRing, engine->renderAheadBlock, engine->renderAheadBlockSize);
+    }
+}
+
+/**
+ * Takes \c numFrames frames from the render-ahead ring, padding with silence
+ * and counting an underrun if the render thread has fallen behind.
+ */
+static void takeRenderedAhead(mnEngine* engine, float* target, int numFrames, double sampleTime)
+{
+    const int numTaken = mnFIFO_popN(&engine->renderAheadRing, target, numFrames);
+    if (numTaken < numFrames)
+    {
+        const int numChannels = engine->options.numberOfOutputChannels;
+        memset(target + numTaken * numChannels, 0, (numFrames - numTaken) * numChannels * sizeof(float));
+        mnTimingStats_addUnderrun(&engine->timingStats);
+        if (engine->log)
+        {
+            mnLog_write(engine->log,
+                        sampleTime,
+                        "render-ahead underrun, %d of %d frames missing",
+                        numFrames - numTaken,
+                        numFrames);
+        }
+    }
+}
+
+/**
+ * Copies a buffer of frames rendered ahead to the device, resampling and
+ * converting them as needed. The render thread notices the ring draining
+ * the next time it polls, so nothing here can block or enter the kernel.
+ */
+static void playRenderedAhead(mnEngine* engine, void* samples, int numFrames, double sampleTime)
+{
+    if (engine->isResampling)
+    {
+        const int numFramesToRender = getNumFramesToRender(engine, numFrames);
+        takeRenderedAhead(engine, engine->resampledOutput, numFramesToRender, sampleTime);
+        resampleOutput(engine, samples, numFrames, numFramesToRender);
+    }
+    else if (engine->options.sampleFormat == MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        takeRenderedAhead(engine, (float*)samples, numFrames, sampleTime);
+    }
+    else
+    {
+        takeRenderedAhead(engine, engine->renderAheadOutput, numFrames, sampleTime);
+        mnConvertFromFloat(engine->renderAheadOutput,
+                           samples,
+                           engine->options.sampleFormat,
+                           numFrames * engine->options.numberOfOutputChannels,
+                           NULL);
+    }
+}
+
+void mnEngine_processOutput(mnEngine* engine, void* samples, int numFrames, double sampleTime)
+{
+    const double startTime = mnClock_getSeconds();
+    const mnFloatState floatState = enterCallbacks(engine);
+    
+    if (engine->isRenderingAhead)
+    {
+        playRenderedAhead(engine, samples, numFrames, sampleTime);
+    }
+    else if (engine->isBufferSizeFixed)
+    {
+        processOutputBlocks(engine, samples, numFrames, sampleTime);
+    }
+    else if (engine->isResampling)
+    {
+        renderResampled(engine, samples, numFrames, getNumFramesToRender(engine, numFrames), sampleTime);
+    }
+    else
+    {
+        renderToStream(engine, samples, engine->options.sampleFormat, numFrames, sampleTime);
+    }
+    
+    mnAtomicStoreRelaxed(numFrames, &engine->lastFramesPerBuffer);
+    
+    leaveCallbacks(engine, floatState);
+    const double duration = mnClock_getSeconds() - startTime;
+    recordTiming(engine, engine->inputCallbackDuration + duration, numFrames, sampleTime);
+    engine->inputCallbackDuration = 0.0;
+}
+
+/**
+ * Runs a duplex callback on resampled streams. The input and output resamplers
+ * produce and consume slightly different numbers of frames per buffer, so the
+ * resampled input is queued and the callback gets as many input frames as it
+ * renders output frames, padded with leading silence when the queue runs short.
+ */
+static void processResampledDuplex(mnEngine* engine,
+                                   const void* inputSamples,
+                                   void* outputSamples,
+                                   int numFrames,
+                                   double sampleTime)
+{
+    const int numChannels = engine->options.numberOfInputChannels;
+    float* queue = engine->resampledInput;
+    
+    if (numChannels > 0 && inputSamples)
+    {
+        if (engine->numResampledInputFrames > engine->maxFramesPerCallback)
+        {
+            //the input runs ahead of the output. drop the oldest frames to
+            //make room for a full buffer.
+            const int excess = engine->numResampledInputFrames - engine->maxFramesPerCallback;
+            memmove(queue, queue + excess * numChannels, engine->maxFramesPerCallback * numChannels * sizeof(float));
+            engine->numResampledInputFrames = engine->maxFramesPerCallback;
+        }
+        
+        float* resampled = queue + engine->numResampledInputFrames * numChannels;
+        const int numResampled = resampleInput(engine,
+                                               inputSamples,
+                                               numFrames,
+                                               resampled,
+                                               engine->maxFramesPerCallback);
+        engine->numResampledInputFrames += numResampled;
+        if (engine->recorder)
+        {
+            mnRecorder_write(engine->recorder, resampled, MN_SAMPLE_FORMAT_FLOAT32, numResampled);
+        }
+        if (numResampled > 0)
+        {
+            measureInput(engine, resampled, numResampled);
+        }
+    }
+    
+    const int numFramesToRender = engine->options.numberOfOutputChannels > 0 ?
+                                  getNumFramesToRender(engine, numFrames) :
+                                  engine->numResampledInputFrames;
+    
+    engine->duplexInput = NULL;
+    if (numChannels > 0)
+    {
+        const int numQueued = engine->numResampledInputFrames;
+        if (numQueued < numFramesToRender)
+        {
+            const int numMissing = numFramesToRender - numQueued;
+            memmove(queue + numMissing * numChannels, queue, numQueued * numChannels * sizeof(float));
+            memset(queue, 0, numMissing * numChannels * sizeof(float));
+            engine->numResampledInputFrames = numFramesToRender;
+        }
+        engine->duplexInput = queue;
+    }
+    
+    renderResampled(engine, outputSamples, numFrames, numFramesToRender, sampleTime);
+    
+    if (numChannels > 0)
+    {
+        engine->numResampledInputFrames -= numFramesToRender;
+        memmove(queue,
+                queue + numFramesToRender * numChannels,
+                engine->numResampledInputFrames * numChannels * sizeof(float));
+    }
+}
+
+/**
+ * Queues a device buffer of duplex input at the callbacks' rate, resampling
+ * and converting it as needed.
+ */
+static void queueDuplexBlockInput(mnEngine* engine, const void* samples, int numFrames)
+{
+    const float* floatSamples = (const float*)samples;
+    int numCallbackFrames = numFrames;
+    if (engine->isResampling)
+    {
+        numCallbackFrames = resampleInput(engine,
+                                          samples,
+                                          numFrames,
+                                          engine->resampledInput,
+                                          engine->maxFramesPerCallback);
+        floatSamples = engine->resampledInput;
+    }
+    else if (engine->options.sampleFormat != MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        mnConvertToFloat(samples,
+                         engine->options.sampleFormat,
+                         engine->blockStaging,
+                         numFrames * engine->options.numberOfInputChannels);
+        floatSamples = engine->blockStaging;
+    }
+    
+    if (numCallbackFrames > 0)
+    {
+        if (engine->recorder)
+        {
+            mnRecorder_write(engine->recorder, floatSamples, MN_SAMPLE_FORMAT_FLOAT32, numCallbackFrames);
+        }
+        measureInput(engine, floatSamples, numCallbackFrames);
+        mnFIFO_pushN(&engine->blockInputQueue, floatSamples, numCallbackFrames);
+    }
+}
+
+/**
+ * Runs a duplex callback on whole blocks. Each complete block of input is
+ * processed right away and its output queued behind the frames still to
+ * be played, which are delayed by the block latency.
+ */
+static void processDuplexBlocks(mnEngine* engine,
+                                const void* inputSamples,
+                                void* outputSamples,
+                                int numFrames,
+                                double sampleTime)
+{
+    const int numIn = engine->options.numberOfInputChannels;
+    const int numOut = engine->options.numberOfOutputChannels;
+    const int blockSize = engine->options.bufferSizeInFrames;
+    const int numCallbackFrames = engine->isResampling && numOut > 0 ? getNumFramesToRender(engine, numFrames) : numFrames;
+    const double callbackTime = getCallbackSampleTime(engine, sampleTime);
+    
+    //blocks are timed by their output, or by their input if there is none
+    int offset = numOut > 0 ?
+                 mnFIFO_getNumElements(&engine->blockOutputQueue) :
+                 -mnFIFO_getNumElements(&engine->blockInputQueue);
+    if (numIn > 0 && inputSamples)
+    {
+        queueDuplexBlockInput(engine, inputSamples, numFrames);
+    }
+    
+    while (numIn > 0 ? mnFIFO_getNumElements(&engine->blockInputQueue) >= blockSize : offset < numCallbackFrames)
+    {
+        if (numIn > 0)
+        {
+            mnFIFO_popN(&engine->blockInputQueue, engine->blockInput, blockSize);
+            engine->duplexInput = engine->blockInput;
+        }
+        renderBlock(engine, callbackTime, offset);
+        offset += blockSize;
+    }
+    engine->duplexInput = NULL;
+    
+    if (numOut > 0)
+    {
+        playBlocks(engine, outputSamples, numFrames, numCallbackFrames);
+    }
+}
+
+void mnEngine_processDuplex(mnEngine* engine,
+                            const void* inputSamples,
+                            void* outputSamples,
+                            int numFrames,
+                            double sampleTime)
+{
+    const double startTime = mnClock_getSeconds();
+    const mnFloatState floatState = enterCallbacks(engine);
+    
+    if (engine->isBufferSizeFixed)
+    {
+        processDuplexBlocks(engine, inputSamples, outputSamples, numFrames, sampleTime);
+    }
+    else if (engine->isResampling)
+    {
+        processResampledDuplex(engine, inputSamples, outputSamples, numFrames, sampleTime);
+    }
+    else
+    {
+        //Float samples are used in place in the backend's buffers. Other formats
+        //are converted via the scratch buffers.
+        const int numInputChannels = engine->options.numberOfInputChannels;
+        engine->duplexInput = numInputChannels > 0 ? (const float*)inputSamples : NULL;
+        if (engine->duplexInput && engine->recorder)
+        {
+            mnRecorder_write(engine->recorder, inputSamples, engine->options.sampleFormat, numFrames);
+        }
+        if (engine->duplexInput && engine->options.sampleFormat != MN_SAMPLE_FORMAT_FLOAT32)
+        {
+            mnConvertToFloat(inputSamples,
+                             engine->options.sampleFormat,
+                             engine->inputScratchBuffer,
+                             numFrames * numInputChannels);
+            engine->duplexInput = engine->inputScratchBuffer;
+        }
+        if (engine->duplexInput)
+        {
+            measureInput(engine, engine->duplexInput, numFrames);
+        }
+        
+        renderToStream(engine, outputSamples, engine->options.sampleFormat, numFrames, sampleTime);
+    }
+    
+    engine->duplexInput = NULL;
+    mnAtomicStoreRelaxed(numFrames, &engine->lastFramesPerBuffer);
+    
+    leaveCallbacks(engine, floatState);
+    const double duration = mnClock_getSeconds() - startTime;
+    recordTiming(engine, duration, numFrames, sampleTime);
+}
+
+void mnEngine_setRecorder(mnEngine* engine, mnRecorder* recorder)
+{
+    engine->recorder = recorder;
+}
+
+void mnEngine_setMeters(mnEngine* engine, mnMeter* inputMeter, mnMeter* outputMeter)
+{
+    engine->inputMeter = inputMeter;
+    engine->outputMeter = outputMeter;
+}
+
+void mnEngine_setAnalyzer(mnEngine* engine, mnAnalyzer* analyzer)
+{
+    engine->analyzer = analyzer;
+}
+
+void mnEngine_setConvolver(mnEngine* engine, mnConvolver* convolver)
+{
+    engine->convolver = convolver;
+}
+
+void mnEngine_setLog(mnEngine* engine, mnLog* log)
+{
+    engine->log = log;
+}
+
+int mnEngine_setEventCallback(mnEngine* engine, mnAudioEventCallback eventCallback, int capacity)
+{
+    if (engine->eventCallback)
+    {
+        mnEventScheduler_deinit(&engine->eventScheduler);
+        engine->eventCallback = NULL;
+    }
+    
+    if (eventCallback)
+    {
+        if (!mnEventScheduler_init(&engine->eventScheduler, capacity))
+        {
+            return 0;
+        }
+        engine->eventCallback = eventCallback;
+    }
+    
+    return 1;
+}
+
+int mnEngine_postEvent(mnEngine* engine, const mnScheduledEvent* event)
+{
+    if (!engine->eventCallback)
+    {
+        return 0;
+    }
+    
+    return mnEventScheduler_post(&engine->eventScheduler, event);
+}
+
+double mnEngine_getNextSampleTime(mnEngine* engine)
+{
+    if (!engine->eventCallback)
+    {
+        return -1.0;
+    }
+    
+    return mnEventScheduler_getNextSampleTime(&engine->eventScheduler);
+}
+
+double mnEngine_getRoundTripLatency(mnEngine* engine)
+{
+    int numFrames = mnAtomicLoadRelaxed(&engine->lastFramesPerBuffer);
+    if (numFrames <= 0)
+    {
+        numFrames = engine->options.bufferSizeInFrames;
+    }
+    
+    //A frame is captured during one device cycle and rendered into the output
+    //buffer that is played back during the next.
+    const double sampleRate = engine->deviceSampleRate > 0.0 ? engine->deviceSampleRate : engine->options.sampleRate;
+    double latency = engine->inputLatency + engine->outputLatency + 2.0 * numFrames / sampleRate;
+    
+    if (engine->isResampling)
+    {
+        if (engine->options.numberOfInputChannels > 0)
+        {
+            latency += mnResampler_getLatency(&engine->inputResampler);
+        }
+        if (engine->options.numberOfOutputChannels > 0)
+        {
+            latency += mnResampler_getLatency(&engine->outputResampler);
+        }
+    }
+    
+    return latency + mnEngine_getBlockLatency(engine) / engine->options.sampleRate;
+}
+
+int mnEngine_getBlockLatency(mnEngine* engine)
+{
+    if (!engine->isBufferSizeFixed)
+    {
+        return 0;
+    }
+    
+    return mnAtomicLoadRelaxed(&engine->blockLatency);
+}
+
+void mnEngine_setRenderAheadFrames(mnEngine* engine, int numFrames)
+{
+    if (!engine->isRenderingAhead)
+    {
+        return;
+    }
+    
+    if (numFrames < engine->maxFramesPerCallback)
+    {
+        numFrames = engine->maxFramesPerCallback;
+    }
+    else if (numFrames > engine->options.maxRenderAheadFrames)
+    {
+        numFrames = engine->options.maxRenderAheadFrames;
+    }
+    mnAtomicStoreRelaxed(numFrames, &engine->renderAheadTarget);
+}
+
+int mnEngine_getRenderAheadFill(mnEngine* engine)
+{
+    if (!engine->isRenderingAhead)
+    {
+        return 0;
+    }
+    
+    return mnFIFO_getNumElements(&engine->renderAheadRing);
+}
+
+void mnEngine_getTimingStats(mnEngine* engine, mnTimingSnapshot* snapshot)
+{
+    mnTimingStats_getSnapshot(&engine->timingStats, snapshot);
+}
+
+int mnEngine_isMemoryLocked(mnEngine* engine)
+{
+    const void* buffers[] =
+    {
+        engine->inputScratchBuffer,
+        engine->outputScratchBuffer,
+        engine->inputChannels,
+        engine->outputChannels,
+        engine->outputSubBlockChannels,
+        engine->deviceInputBuffer,
+        engine->deviceOutputBuffer,
+        engine->resampledInput,
+        engine->resampledOutput,
+        engine->inputResampler.coefficients,
+        engine->inputResampler.coefficientSteps,
+        engine->inputResampler.filter,
+        engine->inputResampler.history,
+        engine->outputResampler.coefficients,
+        engine->outputResampler.coefficientSteps,
+        engine->outputResampler.filter,
+        engine->outputResampler.history,
+        engine->renderAheadRing.elements,
+        engine->renderAheadBlock,
+        engine->renderAheadOutput,
+        engine->blockInputQueue.elements,
+        engine->blockOutputQueue.elements,
+        engine->blockInput,
+        engine->blockOutput,
+        engine->blockStaging,
+        engine->eventScheduler.postedEvents.elements,
+        engine->eventScheduler.pendingEvents
+    };
+    
+    //buffers the engine's configuration doesn't use are NULL
+    for (int i = 0; i < (int)(sizeof(buffers) / sizeof(buffers[0])); i++)
+    {
+        if (buffers[i] && !mnLockedMemory_isLocked(buffers[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
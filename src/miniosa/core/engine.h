@@ -0,0 +1,608 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_ENGINE_H
+#define MN_ENGINE_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "analyzer.h"
+#include "convolver.h"
+#include "event_scheduler.h"
+#include "fifo.h"
+#include "log.h"
+#include "meter.h"
+#include "realtime.h"
+#include "recorder.h"
+#include "resampler.h"
+#include "sample_format.h"
+#include "timing_stats.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * A callback for receiving input audio buffers.
+     * @param numChannels The number of input channels.
+     * @param numFrames The number of input frames.
+     * @param samples The input sample buffer. Samples are interleaved, so sample for
+     * channel i of frame j is at \c samples[j * numChannels + i].
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioInputCallback)(int numChannels,
+                                         int numFrames,
+                                         const float* samples,
+                                         void* callbackContext);
+    
+    /**
+     * A callback for rendering output audio buffers.
+     * @param numChannels The number of output channels.
+     * @param numFrames The number of output frames.
+     * @param samples The target output buffer Samples are interleaved, so sample for
+     * channel i of frame j is at \c samples[j * numChannels + i].
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioOutputCallback)(int numChannels,
+                                          int numFrames,
+                                          float* samples,
+                                          void* callbackContext);
+    
+    /**
+     * A callback for receiving input audio buffers, one buffer per channel.
+     * @param numChannels The number of input channels.
+     * @param numFrames The number of input frames.
+     * @param channels \c numChannels buffers of \c numFrames samples. Sample j of
+     * channel i is at \c channels[i][j].
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioPlanarInputCallback)(int numChannels,
+                                               int numFrames,
+                                               const float* const* channels,
+                                               void* callbackContext);
+    
+    /**
+     * A callback for rendering output audio buffers, one buffer per channel.
+     * @param numChannels The number of output channels.
+     * @param numFrames The number of output frames.
+     * @param channels \c numChannels buffers of \c numFrames samples to fill. Sample j
+     * of channel i is at \c channels[i][j].
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioPlanarOutputCallback)(int numChannels,
+                                                int numFrames,
+                                                float* const* channels,
+                                                void* callbackContext);
+    
+    /**
+     * A callback for processing input and output in one call, for effects that
+     * pass the input through to the output with as little latency as possible.
+     * @param inputSamples The input sample buffer, interleaved like in
+     * ::mnAudioInputCallback. NULL if there are no input channels.
+     * @param outputSamples The target output buffer, interleaved like in
+     * ::mnAudioOutputCallback.
+     * @param numInputChannels The number of input channels.
+     * @param numOutputChannels The number of output channels.
+     * @param numFrames The number of frames in both buffers.
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioDuplexCallback)(const float* inputSamples,
+                                          float* outputSamples,
+                                          int numInputChannels,
+                                          int numOutputChannels,
+                                          int numFrames,
+                                          void* callbackContext);
+    
+    /**
+     * Audio engine options.
+     */
+    typedef struct mnOptions
+    {
+        /** The sample rate the callbacks run at, whatever rate the device runs at. */
+        float sampleRate;
+        /** Any number of channels supported by the backend. */
+        int numberOfInputChannels;
+        /** Any number of channels supported by the backend. */
+        int numberOfOutputChannels;
+        int bufferSizeInFrames;
+        /**
+         * The sample format of the backend's streams. With \c MN_SAMPLE_FORMAT_FLOAT32
+         * the callbacks read and write the backend's buffers directly, skipping
+         * a conversion pass and a scratch buffer copy.
+         */
+        mnSampleFormat sampleFormat;
+        /**
+         * The quality of the conversion between the device's sample rate and
+         * \c sampleRate when they differ. With ::MN_RESAMPLER_QUALITY_NONE the
+         * callbacks run at the device's rate instead.
+         */
+        mnResamplerQuality resamplerQuality;
+        /**
+         * The number of output frames at \c sampleRate that a render thread
+         * keeps ready ahead of the device, or 0 to render in the device's
+         * callback. The render thread polls the ring a few times per device
+         * buffer rather than being woken by the device's callback, which
+         * never blocks or makes system calls. Rendering ahead lets a slow buffer borrow time from the
+         * frames already rendered instead of causing a dropout, at the cost
+         * of this much extra output latency. Raised to at least a device
+         * buffer. Can be changed while running with ::mnEngine_setRenderAheadFrames.
+         * Ignored by duplex engines, whose output depends on the current input.
+         */
+        int renderAheadFrames;
+        /**
+         * The largest value ::mnEngine_setRenderAheadFrames accepts, which
+         * sizes the render-ahead ring. Raised to \c renderAheadFrames if smaller.
+         * ::mnEngine_start fails if the ring can't be allocated.
+         */
+        int maxRenderAheadFrames;
+        /**
+         * Non-zero to call the callbacks with exactly \c bufferSizeInFrames
+         * frames every time, however many frames the device's buffers hold.
+         * Input is queued until a whole block has arrived, and output blocks
+         * are rendered as the device needs them, with frames left over kept
+         * for its next buffer. Events then take effect at the start of the
+         * block they fall in. See ::mnEngine_getBlockLatency for the cost.
+         */
+        int fixedBufferSize;
+        /**
+         * Non-zero to flush denormals to zero while the callbacks run, see
+         * ::mnFloatState_enterFlushToZero. The backend's own floating point
+         * state is restored before each buffer is handed back to it.
+         */
+        int flushDenormals;
+        /** The scheduling of the render thread, if \c renderAheadFrames is set. */
+        mnThreadOptions renderThreadOptions;
+    } mnOptions;
+    
+    /**
+     * Fills in the default options: 44100 Hz, no input, stereo output,
+     * 512 frame buffers of any size the device picks, float samples, medium
+     * quality resampling, rendering in the device's callback and flushing
+     * denormals. A render thread runs one below the highest real time
+     * priority, on any core.
+     */
+    void mnOptions_setDefaults(mnOptions* options);
+    
+    struct mnEngine;
+    
+    /**
+     * A set of functions driving an engine's callbacks from some audio device.
+     * Backends move samples in the engine's stream format and call
+     * ::mnEngine_processInput and ::mnEngine_processOutput from their audio thread,
+     * or ::mnEngine_processDuplex if the engine has a \c duplexCallback.
+     */
+    typedef struct mnBackend
+    {
+        const char* name;
+        /**
+         * Acquires the device and any per engine state, which is stored in
+         * \c engine->backendData. May change \c engine->options to what the
+         * device actually supports, and set the engine's device latencies.
+         * Sets \c engine->deviceSampleRate to the rate of the streams, if it
+         * differs from \c engine->options.sampleRate.
+         * @param maxFramesPerBuffer Receives an upper limit on the number of
+         * frames passed to the engine per buffer.
+         * @return Non-zero on success.
+         */
+        int (*open)(struct mnEngine* engine, int* maxFramesPerBuffer);
+        /** Releases everything acquired by \c open. */
+        void (*close)(struct mnEngine* engine);
+        /** Starts invoking the engine. Returns non-zero on success. */
+        int (*start)(struct mnEngine* engine);
+        /** Stops invoking the engine. No callbacks are running when this returns. */
+        void (*stop)(struct mnEngine* engine);
+    } mnBackend;
+    
+    /**
+     * The platform independent part of an audio engine. Handles options, scratch
+     * buffers, sample format conversion and callback dispatch, leaving the
+     * device to a ::mnBackend.
+     */
+    typedef struct mnEngine
+    {
+        mnAudioInputCallback inputCallback;
+        mnAudioOutputCallback outputCallback;
+        /** Used instead of \c inputCallback if the engine was initialized with ::mnEngine_initPlanar. */
+        mnAudioPlanarInputCallback planarInputCallback;
+        /** Used instead of \c outputCallback if the engine was initialized with ::mnEngine_initPlanar. */
+        mnAudioPlanarOutputCallback planarOutputCallback;
+        /** Non-zero if the callbacks get one buffer per channel. */
+        int isPlanar;
+        /** Used instead of the input and output callbacks if the engine was initialized with ::mnEngine_initDuplex. */
+        mnAudioDuplexCallback duplexCallback;
+        /** A pointer passed to \c inputCallback and \c outputCallback. */
+        void* callbackContext;
+        mnOptions options;
+        const mnBackend* backend;
+        /** Owned by the backend. */
+        void* backendData;
+        /** The largest number of frames per buffer, as reported by the backend. */
+        int maxFramesPerBuffer;
+        /**
+         * A buffer for temporary storage of input samples. NULL if the stream format
+         * is float and the callbacks are interleaved.
+         */
+        float* inputScratchBuffer;
+        /**
+         * A buffer for temporary storage of output samples. NULL if the stream format
+         * is float and the callbacks are interleaved.
+         */
+        float* outputScratchBuffer;
+        /** Pointers to each input channel's part of \c inputScratchBuffer, if planar. */
+        float** inputChannels;
+        /** Pointers to each output channel's part of \c outputScratchBuffer, if planar. */
+        float** outputChannels;
+        /** Pointers into \c outputChannels at the start of the sub-block being rendered, if planar. */
+        float** outputSubBlockChannels;
+        int isOpen;
+        int isRunning;
+        /** Callback timing, recorded once per buffer. */
+        mnTimingStats timingStats;
+        /**
+         * Time in seconds spent in the input callback of the current buffer, when
+         * it is recorded together with the output callback. Only accessed by the audio thread.
+         */
+        double inputCallbackDuration;
+        /** Applies scheduled events. NULL unless set with ::mnEngine_setEventCallback. */
+        mnAudioEventCallback eventCallback;
+        /** Valid if \c eventCallback is set. */
+        mnEventScheduler eventScheduler;
+        /** Receives the input at the callbacks' rate. NULL unless set with ::mnEngine_setRecorder. */
+        mnRecorder* recorder;
+        /** Measures the input at the callbacks' rate. NULL unless set with ::mnEngine_setMeters. */
+        mnMeter* inputMeter;
+        /** Measures the output of the callbacks. NULL unless set with ::mnEngine_setMeters. */
+        mnMeter* outputMeter;
+        /** Receives the input at the callbacks' rate. NULL unless set with ::mnEngine_setAnalyzer. */
+        mnAnalyzer* analyzer;
+        /** Applied to the output of the callbacks. NULL unless set with ::mnEngine_setConvolver. */
+        mnConvolver* convolver;
+        /** Receives diagnostics from the audio thread. NULL unless set with ::mnEngine_setLog. */
+        mnLog* log;
+        /**
+         * The float input samples of the buffer being processed by the duplex
+         * callback. Only accessed by the audio thread.
+         */
+        const float* duplexInput;
+        /** The device input latency in seconds, as reported by the backend. 0 if unknown. */
+        double inputLatency;
+        /** The device output latency in seconds, as reported by the backend. 0 if unknown. */
+        double outputLatency;
+        /**
+         * The sample rate of the backend's streams. Set when the backend is
+         * opened, to \c options.sampleRate unless the backend says otherwise.
+         */
+        double deviceSampleRate;
+        /**
+         * Non-zero if the streams are resampled between \c deviceSampleRate and
+         * \c options.sampleRate. Event times are then in frames at \c options.sampleRate.
+         */
+        int isResampling;
+        /** The largest number of frames per callback. Differs from \c maxFramesPerBuffer when resampling. */
+        int maxFramesPerCallback;
+        /** Resamples input from the device rate, if resampling. */
+        mnResampler inputResampler;
+        /** Resamples output to the device rate, if resampling. */
+        mnResampler outputResampler;
+        /** Input samples converted to floats at the device rate, if resampling a non-float stream. */
+        float* deviceInputBuffer;
+        /** Output samples as floats at the device rate, if resampling a non-float stream. */
+        float* deviceOutputBuffer;
+        /**
+         * Interleaved input at the callback rate, if resampling. For duplex
+         * engines, a queue of \c numResampledInputFrames frames that evens out
+         * the number of frames coming from the input and going to the output.
+         */
+        float* resampledInput;
+        int numResampledInputFrames;
+        /** Interleaved output at the callback rate, if resampling. */
+        float* resampledOutput;
+        /** The number of frames in the most recent output buffer. Only accessed through atomic operations. */
+        int lastFramesPerBuffer;
+        /**
+         * Non-zero if a render thread runs the output callbacks and the
+         * device's callback only copies frames out of \c renderAheadRing.
+         */
+        int isRenderingAhead;
+        /** Interleaved output frames at the callback rate, rendered ahead of the device. */
+        mnFIFO renderAheadRing;
+        /** The render thread renders a block of \c renderAheadBlockSize frames here, then pushes it. */
+        float* renderAheadBlock;
+        int renderAheadBlockSize;
+        /** Frames taken from the ring for conversion, if the stream isn't float. */
+        float* renderAheadOutput;
+        /** The number of frames the render thread keeps in the ring. Only accessed through atomic operations. */
+        int renderAheadTarget;
+        /** Set to make the render thread exit. Only accessed through atomic operations. */
+        int isRenderThreadStopping;
+        /**
+         * How long the render thread sleeps once the ring is filled to
+         * \c renderAheadTarget. The audio thread never wakes it.
+         */
+        double renderThreadPollInterval;
+        pthread_t renderThread;
+        /** Non-zero if the callbacks get blocks of exactly \c options.bufferSizeInFrames frames. */
+        int isBufferSizeFixed;
+        /** Input frames at the callback rate waiting for a whole block, if the buffer size is fixed. */
+        mnFIFO blockInputQueue;
+        /**
+         * Output frames at the callback rate waiting to be played, if the buffer
+         * size is fixed and the engine doesn't render ahead.
+         */
+        mnFIFO blockOutputQueue;
+        /** The input block passed to the callbacks. */
+        float* blockInput;
+        /** The output block rendered by the callbacks. */
+        float* blockOutput;
+        /** Frames converted to or from the stream format, if it isn't float and not resampled. */
+        float* blockStaging;
+        /** The frames of delay added by the block queues. Only accessed through atomic operations. */
+        int blockLatency;
+    } mnEngine;
+    
+    /**
+     * Initializes an engine. No device is touched until ::mnEngine_start is called.
+     * @param backend The backend driving the callbacks.
+     * @param inputCallback A callback for receiving input audio data. Ignored if NULL.
+     * @param outputCallback A callback for rendering output audio data. Ignored if NULL.
+     * @param callbackContext A pointer to pass to \c inputCallback and \c outputCallback.
+     * @param options Optional audio I/O options. Defaults are used if NULL.
+     */
+    void mnEngine_init(mnEngine* engine,
+                       const mnBackend* backend,
+                       mnAudioInputCallback inputCallback,
+                       mnAudioOutputCallback outputCallback,
+                       void* callbackContext,
+                       const mnOptions* options);
+    
+    /**
+     * Initializes an engine whose callbacks get one contiguous buffer per channel
+     * instead of interleaved samples. Interleaving is done together with the sample
+     * format conversion, in one pass. Otherwise like ::mnEngine_init.
+     * The number of channels may not exceed ::MN_MAX_PLANAR_CHANNELS.
+     */
+    void mnEngine_initPlanar(mnEngine* engine,
+                             const mnBackend* backend,
+                             mnAudioPlanarInputCallback inputCallback,
+                             mnAudioPlanarOutputCallback outputCallback,
+                             void* callbackContext,
+                             const mnOptions* options);
+    
+    /**
+     * Initializes an engine with a single callback that gets the input and the
+     * output of the same device cycle together, with matching frame counts.
+     * Float input is passed straight from the backend's buffer, and input
+     * passed through to the output reaches it after the round trip latency
+     * of ::mnEngine_getRoundTripLatency, with no buffering in between.
+     * Needs at least one output channel. Otherwise like ::mnEngine_init.
+     */
+    void mnEngine_initDuplex(mnEngine* engine,
+                             const mnBackend* backend,
+                             mnAudioDuplexCallback duplexCallback,
+                             void* callbackContext,
+                             const mnOptions* options);
+    
+    /**
+     * Stops the engine if needed and releases all resources.
+     */
+    void mnEngine_deinit(mnEngine* engine);
+    
+    /**
+     * Opens the backend, allocates buffers and starts the callbacks.
+     * @return Non-zero on success.
+     */
+    int mnEngine_start(mnEngine* engine);
+    
+    /**
+     * Stops the callbacks, closes the backend and releases buffers.
+     */
+    void mnEngine_stop(mnEngine* engine);
+    
+    /**
+     * Stops the callbacks, keeping the backend open.
+     */
+    void mnEngine_suspend(mnEngine* engine);
+    
+    /**
+     * Restarts the callbacks of a suspended engine.
+     * @return Non-zero on success.
+     */
+    int mnEngine_resume(mnEngine* engine);
+    
+    /**
+     * Passes input samples to the input callback, converting them to floats if needed.
+     * Called by backends from the audio thread.
+     * @param samples Interleaved samples in the stream format.
+     * @param numFrames At most \c maxFramesPerBuffer.
+     * @param sampleTime The device time in frames of the first frame, used to
+     * detect missed deadlines. Negative if unknown.
+     */
+    void mnEngine_processInput(mnEngine* engine, const void* samples, int numFrames, double sampleTime);
+    
+    /**
+     * Lets the output callback render samples, converting them from floats if needed.
+     * The buffer is left untouched if there is no output callback. Called by backends
+     * from the audio thread.
+     * @param samples Receives interleaved samples in the stream format.
+     * @param numFrames At most \c maxFramesPerBuffer.
+     * @param sampleTime The device time in frames of the first frame, used to
+     * detect missed deadlines. Negative if unknown.
+     */
+    void mnEngine_processOutput(mnEngine* engine, void* samples, int numFrames, double sampleTime);
+    
+    /**
+     * Passes input samples and lets the duplex callback render output samples,
+     * converting both if needed. Called by backends from the audio thread
+     * instead of ::mnEngine_processInput and ::mnEngine_processOutput.
+     * @param inputSamples Interleaved input samples in the stream format, or
+     * NULL if there is no input.
+     * @param outputSamples Receives interleaved output samples in the stream format.
+     * @param numFrames The number of frames in both buffers. At most \c maxFramesPerBuffer.
+     * @param sampleTime The device time in frames of the first output frame.
+     * Negative if unknown.
+     */
+    void mnEngine_processDuplex(mnEngine* engine,
+                                const void* inputSamples,
+                                void* outputSamples,
+                                int numFrames,
+                                double sampleTime);
+    
+    /**
+     * Records the input to disk, as passed to the input or duplex callback.
+     * Call before ::mnEngine_start or while the engine is suspended.
+     * @param recorder A started recorder with as many channels as the engine
+     * has inputs, or NULL to stop passing input to it.
+     */
+    void mnEngine_setRecorder(mnEngine* engine, mnRecorder* recorder);
+    
+    /**
+     * Meters the input and output, as seen by the callbacks. The levels can
+     * then be read from any thread with ::mnMeter_getLevels.
+     * Call before ::mnEngine_start or while the engine is suspended.
+     * @param inputMeter A meter with as many channels as the engine has inputs, or NULL.
+     * @param outputMeter A meter with as many channels as the engine has outputs, or NULL.
+     */
+    void mnEngine_setMeters(mnEngine* engine, mnMeter* inputMeter, mnMeter* outputMeter);
+    
+    /**
+     * Analyzes the spectrum and pitch of the input, as seen by the callbacks,
+     * on the analyzer's worker thread. Call before ::mnEngine_start or while
+     * the engine is suspended.
+     * @param analyzer A started analyzer with as many channels as the engine
+     * has inputs, or NULL to stop passing input to it.
+     */
+    void mnEngine_setAnalyzer(mnEngine* engine, mnAnalyzer* analyzer);
+    
+    /**
+     * Convolves the output of the callbacks with an impulse response, for
+     * example a reverb, without adding latency. The output meter sees the
+     * convolved signal. Call before ::mnEngine_start or while the engine is
+     * suspended.
+     * @param convolver A convolver with as many channels as the engine has
+     * outputs, or NULL to leave the output as is.
+     */
+    void mnEngine_setConvolver(mnEngine* engine, mnConvolver* convolver);
+    
+    /**
+     * Logs missed deadlines and render-ahead underruns from the audio thread
+     * as they happen, stamped with the device sample time of the buffer.
+     * Callbacks may write their own messages to the same log with
+     * ::mnLog_write. Call before ::mnEngine_start or while the engine is
+     * suspended.
+     * @param log A started log, or NULL to stop logging.
+     */
+    void mnEngine_setLog(mnEngine* engine, mnLog* log);
+    
+    /**
+     * Enables scheduled events. The output callback is then invoked once per
+     * run of frames between event times, with \c eventCallback applying each
+     * event right before the frame it is scheduled at, so parameter changes
+     * are sample accurate regardless of the buffer size. Engines without
+     * output apply events before the input callback of the buffer they fall in.
+     * Call before ::mnEngine_start.
+     * @param eventCallback Invoked with \c callbackContext for each event.
+     * @param capacity The largest number of events posted but not yet applied.
+     * @return 0 if \c capacity is out of range or allocation failed, in which
+     * case events are disabled.
+     */
+    int mnEngine_setEventCallback(mnEngine* engine, mnAudioEventCallback eventCallback, int capacity);
+    
+    /**
+     * Schedules an event. Lock free. Called from a single control thread.
+     * @return Non-zero on success, zero if too many events are waiting or
+     * events are not enabled.
+     */
+    int mnEngine_postEvent(mnEngine* engine, const mnScheduledEvent* event);
+    
+    /**
+     * Returns the sample time of the first frame after the most recently
+     * started buffer, or a negative value if not known yet. Events stamped
+     * with this time plus one buffer of latency reliably take effect at their
+     * exact frame. Lock free, may be called from any thread.
+     */
+    double mnEngine_getNextSampleTime(mnEngine* engine);
+    
+    /**
+     * Returns the time in seconds it takes for input passed straight to the
+     * output in a duplex callback to be heard: the device latencies reported
+     * by the backend plus one buffer for capturing and one for playback, using
+     * the size of the most recent buffer, plus the delay of any resampling and
+     * of fixed size blocks. Separate input and output callbacks
+     * add whatever buffering the app does between them. May be called from any thread.
+     */
+    double mnEngine_getRoundTripLatency(mnEngine* engine);
+    
+    /**
+     * Returns the number of frames at \c options.sampleRate by which fixed
+     * size blocks delay the signal, or 0 if the buffer size isn't fixed.
+     * For duplex engines it is the delay of the output, which starts at the
+     * most frames whole device buffers can leave over and grows, with a gap of
+     * silence, if a buffer of an unexpected size needs more. For input
+     * callbacks it is the most frames that have waited for a block to fill
+     * up. Output callbacks add no delay. May be called from any thread.
+     */
+    int mnEngine_getBlockLatency(mnEngine* engine);
+    
+    /**
+     * Changes the number of frames rendered ahead of the device. Takes effect
+     * gradually: the render thread tops the ring up to a larger target the
+     * next time it polls, while a smaller target is reached as the device drains the ring.
+     * Ignored unless the engine renders ahead, see \c mnOptions.renderAheadFrames.
+     * May be called from any thread.
+     * @param numFrames Clamped to between a device buffer and \c mnOptions.maxRenderAheadFrames.
+     */
+    void mnEngine_setRenderAheadFrames(mnEngine* engine, int numFrames);
+    
+    /**
+     * Returns the number of frames currently rendered ahead of the device, or
+     * 0 if the engine renders in the device's callback. Frames the render
+     * thread failed to provide in time are counted as underruns in the timing
+     * stats. May be called from any thread.
+     */
+    int mnEngine_getRenderAheadFill(mnEngine* engine);
+    
+    /**
+     * Gets the callback timing statistics gathered since the engine was initialized.
+     * Lock free, so it may be called from any thread while the engine is running.
+     */
+    void mnEngine_getTimingStats(mnEngine* engine, mnTimingSnapshot* snapshot);
+    
+    /**
+     * Returns 1 if every buffer the engine's callbacks touch is locked into
+     * physical memory: the scratch, resampling, render-ahead and block
+     * buffers, their queues and the event queue. Locking fails if the
+     * process exceeds \c RLIMIT_MEMLOCK, in which case the engine runs
+     * anyway, at the risk of page faults on the audio thread. Call from the
+     * thread that starts and stops the engine.
+     */
+    int mnEngine_isMemoryLocked(mnEngine* engine);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_ENGINE_H
@@ -0,0 +1,171 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "atomic.h"
+#include "event_scheduler.h"
+
+int mnEventScheduler_init(mnEventScheduler* scheduler, int capacity)
+{
+    memset(scheduler, 0, sizeof(mnEventScheduler));
+    if (capacity < 1 || capacity > INT_MAX / (int)sizeof(mnScheduledEvent))
+    {
+        return 0;
+    }
+    
+    const int isQueueAllocated = mnFIFO_init(&scheduler->postedEvents, capacity, sizeof(mnScheduledEvent));
+    scheduler->pendingEvents = mnLockedMemory_alloc(capacity * (int)sizeof(mnScheduledEvent), NULL);
+    if (!isQueueAllocated || !scheduler->pendingEvents)
+    {
+        mnEventScheduler_deinit(scheduler);
+        return 0;
+    }
+    scheduler->capacity = capacity;
+    
+    const double unknown = -1.0;
+    memcpy(scheduler->nextSampleTime, &unknown, sizeof(double));
+    return 1;
+}
+
+void mnEventScheduler_deinit(mnEventScheduler* scheduler)
+{
+    mnFIFO_deinit(&scheduler->postedEvents);
+    mnLockedMemory_free(scheduler->pendingEvents);
+    memset(scheduler, 0, sizeof(mnEventScheduler));
+}
+
+int mnEventScheduler_post(mnEventScheduler* scheduler, const mnScheduledEvent* event)
+{
+    return mnFIFO_push(&scheduler->postedEvents, event);
+}
+
+double mnEventScheduler_getNextSampleTime(mnEventScheduler* scheduler)
+{
+    int words[2];
+    while (1)
+    {
+        const int sequenceBefore = mnAtomicLoadAcquire(&scheduler->sequence);
+        if (sequenceBefore & 1)
+        {
+            continue;
+        }
+        
+        words[0] = mnAtomicLoadRelaxed(&scheduler->nextSampleTime[0]);
+        words[1] = mnAtomicLoadRelaxed(&scheduler->nextSampleTime[1]);
+        
+        mnAtomicFenceAcquire();
+        if (mnAtomicLoadRelaxed(&scheduler->sequence) == sequenceBefore)
+        {
+            break;
+        }
+    }
+    
+    double sampleTime;
+    memcpy(&sampleTime, words, sizeof(double));
+    return sampleTime;
+}
+
+static void publishNextSampleTime(mnEventScheduler* scheduler, double sampleTime)
+{
+    int words[2];
+    memcpy(words, &sampleTime, sizeof(double));
+    
+    //an odd sequence number tells readers that the time is being updated
+    const int sequence = mnAtomicLoadRelaxed(&scheduler->sequence);
+    mnAtomicStoreRelaxed(sequence + 1, &scheduler->sequence);
+    mnAtomicFenceRelease();
+    
+    mnAtomicStoreRelaxed(words[0], &scheduler->nextSampleTime[0]);
+    mnAtomicStoreRelaxed(words[1], &scheduler->nextSampleTime[1]);
+    
+    mnAtomicStoreRelease(sequence + 2, &scheduler->sequence);
+}
+
+/**
+ * Inserts an event into the sorted pending list, after any events with the
+ * same time. Pending lists are short, so a linear search is fine.
+ */
+static void insertPending(mnEventScheduler* scheduler, const mnScheduledEvent* event)
+{
+    int i = scheduler->numPendingEvents;
+    while (i > 0 && scheduler->pendingEvents[i - 1].sampleTime > event->sampleTime)
+    {
+        scheduler->pendingEvents[i] = scheduler->pendingEvents[i - 1];
+        i--;
+    }
+    
+    scheduler->pendingEvents[i] = *event;
+    scheduler->numPendingEvents++;
+}
+
+void mnEventScheduler_beginBuffer(mnEventScheduler* scheduler, double sampleTime, int numFrames)
+{
+    //events stay in the FIFO while the pending list is full
+    while (scheduler->numPendingEvents < scheduler->capacity)
+    {
+        mnScheduledEvent event;
+        if (!mnFIFO_pop(&scheduler->postedEvents, &event))
+        {
+            break;
+        }
+        insertPending(scheduler, &event);
+    }
+    
+    if (sampleTime >= 0.0)
+    {
+        publishNextSampleTime(scheduler, sampleTime + numFrames);
+    }
+}
+
+int mnEventScheduler_popDue(mnEventScheduler* scheduler, double sampleTime, mnScheduledEvent* event)
+{
+    if (scheduler->numPendingEvents == 0 ||
+        scheduler->pendingEvents[0].sampleTime > sampleTime)
+    {
+        return 0;
+    }
+    
+    *event = scheduler->pendingEvents[0];
+    scheduler->numPendingEvents--;
+    memmove(scheduler->pendingEvents,
+            scheduler->pendingEvents + 1,
+            scheduler->numPendingEvents * sizeof(mnScheduledEvent));
+    return 1;
+}
+
+int mnEventScheduler_getNextOffset(mnEventScheduler* scheduler, double bufferSampleTime, int numFrames)
+{
+    if (scheduler->numPendingEvents == 0)
+    {
+        return numFrames;
+    }
+    
+    const double offset = ceil(scheduler->pendingEvents[0].sampleTime - bufferSampleTime);
+    return offset < numFrames ? (int)offset : numFrames;
+}
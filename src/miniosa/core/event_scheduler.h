@@ -0,0 +1,146 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_EVENT_SCHEDULER_H
+#define MN_EVENT_SCHEDULER_H
+
+/*! \file */ 
+
+#include "fifo.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * A control message that takes effect at a given frame of the output stream.
+     * The meaning of \c type, \c target and \c value is up to the user.
+     */
+    typedef struct mnScheduledEvent
+    {
+        /**
+         * The device time in frames at which the event takes effect, on the
+         * same timeline as the sample times backends pass to the engine.
+         * Fractional times are rounded up to the next frame. Events whose
+         * time has passed take effect at the start of the next buffer.
+         */
+        double sampleTime;
+        int type;
+        int target;
+        float value;
+    } mnScheduledEvent;
+    
+    /**
+     * A callback for applying a scheduled event, invoked from the audio thread
+     * right before rendering the frame the event is scheduled at.
+     * @param event The event.
+     * @param callbackContext A user specified pointer.
+     */
+    typedef void (*mnAudioEventCallback)(const mnScheduledEvent* event,
+                                         void* callbackContext);
+    
+    /**
+     * Moves timestamped events from a control thread to the audio thread and
+     * hands them out in time order.
+     *
+     * Events are posted through a single producer, single consumer FIFO. At
+     * the start of each buffer the audio thread moves them into a pending list
+     * sorted by time, so events may be posted in any order and long before
+     * they are due. Events with equal times are handed out in posting order.
+     *
+     * The audio thread also publishes the sample time following the last
+     * buffer, so control threads know which timeline to stamp events on.
+     */
+    typedef struct mnEventScheduler
+    {
+        /** Posted events not yet seen by the audio thread. */
+        mnFIFO postedEvents;
+        /** Events received by the audio thread, sorted by time. Only accessed by the audio thread. */
+        mnScheduledEvent* pendingEvents;
+        int numPendingEvents;
+        int capacity;
+        /** Odd while \c nextSampleTime is being written. Only accessed through atomic operations. */
+        int sequence;
+        /** The bits of a double. Only accessed through atomic operations. */
+        int nextSampleTime[2];
+    } mnEventScheduler;
+    
+    /**
+     * Initializes a scheduler.
+     * @param capacity The largest number of events that can be posted and
+     * pending at the same time.
+     * @return 0 if \c capacity is out of range or allocation failed, in
+     * which case there is nothing to deinitialize.
+     */
+    int mnEventScheduler_init(mnEventScheduler* scheduler, int capacity);
+    
+    /**
+     *
+     */
+    void mnEventScheduler_deinit(mnEventScheduler* scheduler);
+    
+    /**
+     * Posts an event. Called from a single control thread.
+     * @return Non-zero on success, zero if the scheduler is full.
+     */
+    int mnEventScheduler_post(mnEventScheduler* scheduler, const mnScheduledEvent* event);
+    
+    /**
+     * Returns the sample time of the first frame after the most recent buffer,
+     * which is the earliest time an event posted now can take effect at.
+     * Negative until a buffer with a known sample time has started. Lock free,
+     * may be called from any thread.
+     */
+    double mnEventScheduler_getNextSampleTime(mnEventScheduler* scheduler);
+    
+    /**
+     * Receives posted events and publishes the next sample time. Called from
+     * the audio thread at the start of each buffer.
+     * @param sampleTime The device time of the first frame of the buffer.
+     * Negative if unknown.
+     * @param numFrames The number of frames in the buffer.
+     */
+    void mnEventScheduler_beginBuffer(mnEventScheduler* scheduler, double sampleTime, int numFrames);
+    
+    /**
+     * Removes the earliest pending event if it is due. Called from the audio thread.
+     * @param sampleTime Events at or before this time are due.
+     * @return Non-zero if an event was removed.
+     */
+    int mnEventScheduler_popDue(mnEventScheduler* scheduler, double sampleTime, mnScheduledEvent* event);
+    
+    /**
+     * Returns the offset within a buffer of the frame where the earliest
+     * pending event takes effect, or \c numFrames if that is beyond the buffer
+     * or there are no pending events. Called from the audio thread.
+     * @param bufferSampleTime The device time of the first frame of the buffer.
+     */
+    int mnEventScheduler_getNextOffset(mnEventScheduler* scheduler, double bufferSampleTime, int numFrames);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_EVENT_SCHEDULER_H
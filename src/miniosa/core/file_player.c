@@ -0,0 +1,536 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for pread and nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "atomic.h"
+#include "file_player.h"
+#include "realtime.h"
+
+/* WAV files */
+
+static int get16LE(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32LE(const unsigned char* p)
+{
+    return (unsigned int)get16LE(p) | ((unsigned int)get16LE(p + 2) << 16);
+}
+
+/**
+ * Reads the format and the location of the samples from the chunks of a WAV file.
+ */
+static int parseWAV(mnFileStream* stream)
+{
+    unsigned char header[40];
+    if (pread(stream->file, header, 12, 0) != 12 ||
+        memcmp(header, "RIFF", 4) != 0 ||
+        memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        return 0;
+    }
+    
+    struct stat fileInfo;
+    if (fstat(stream->file, &fileInfo) != 0)
+    {
+        return 0;
+    }
+    const long long fileSize = fileInfo.st_size;
+    
+    int formatTag = 0;
+    int bitsPerSample = 0;
+    long long offset = 12;
+    while (offset + 8 <= fileSize)
+    {
+        if (pread(stream->file, header, 8, offset) != 8)
+        {
+            return 0;
+        }
+        long long size = get32LE(header + 4);
+        
+        if (memcmp(header, "fmt ", 4) == 0)
+        {
+            const int n = size < 40 ? (int)size : 40;
+            if (n < 16 || pread(stream->file, header, n, offset + 8) != n)
+            {
+                return 0;
+            }
+            formatTag = get16LE(header);
+            stream->numChannels = get16LE(header + 2);
+            stream->sampleRate = (float)get32LE(header + 4);
+            bitsPerSample = get16LE(header + 14);
+            if (formatTag == 0xfffe && n >= 26)
+            {
+                //WAVE_FORMAT_EXTENSIBLE. the sub format GUID starts with the format tag.
+                formatTag = get16LE(header + 24);
+            }
+        }
+        else if (memcmp(header, "data", 4) == 0)
+        {
+            stream->dataOffset = offset + 8;
+            if (size == 0 || stream->dataOffset + size > fileSize)
+            {
+                //a recording that was never finished. use what is there.
+                size = fileSize - stream->dataOffset;
+            }
+            
+            if (formatTag == 1 && bitsPerSample == 16)
+            {
+                stream->sampleFormat = MN_SAMPLE_FORMAT_INT16;
+            }
+            else if (formatTag == 1 && bitsPerSample == 24)
+            {
+                stream->sampleFormat = MN_SAMPLE_FORMAT_INT24;
+            }
+            else if (formatTag == 1 && bitsPerSample == 32)
+            {
+                stream->sampleFormat = MN_SAMPLE_FORMAT_INT32;
+            }
+            else if (formatTag == 3 && bitsPerSample == 32)
+            {
+                stream->sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+            }
+            else
+            {
+                return 0;
+            }
+            
+            if (stream->numChannels < 1)
+            {
+                return 0;
+            }
+            const int frameSize = stream->numChannels * mnSampleFormat_getBytesPerSample(stream->sampleFormat);
+            stream->numFrames = size / frameSize;
+            return 1;
+        }
+        
+        //chunks are padded to an even size
+        offset += 8 + size + (size & 1);
+    }
+    
+    return 0;
+}
+
+/* Prefetching */
+
+static void sleepFor(double seconds)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+static int getFrameSize(mnFileStream* stream)
+{
+    return stream->numChannels * mnSampleFormat_getBytesPerSample(stream->sampleFormat);
+}
+
+/**
+ * Reads up to \c numFrames frames at \c position into the player's read buffer.
+ * @return The number of whole frames read.
+ */
+static int readFrames(mnFilePlayer* player, mnFileStream* stream, long long position, int numFrames)
+{
+    const int frameSize = getFrameSize(stream);
+    const int numBytes = numFrames * frameSize;
+    int numRead = 0;
+    while (numRead < numBytes)
+    {
+        const ssize_t n = pread(stream->file,
+                                player->readBuffer + numRead,
+                                numBytes - numRead,
+                                stream->dataOffset + position * frameSize + numRead);
+        if (n <= 0)
+        {
+            break;
+        }
+        numRead += (int)n;
+    }
+    
+    return numRead / frameSize;
+}
+
+/**
+ * Decodes up to \c numFrames frames at \c position into one or two runs of samples.
+ * @return The number of frames decoded.
+ */
+static int decode(mnFilePlayer* player, mnFileStream* stream, long long position, int numFrames, mnFIFOSpans* spans)
+{
+    const int numRead = readFrames(player, stream, position, numFrames);
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(stream->sampleFormat);
+    
+    const unsigned char* source = player->readBuffer;
+    int remaining = numRead * stream->numChannels;
+    for (int s = 0; s < 2 && remaining > 0; s++)
+    {
+        const int n = spans->numElements[s] < remaining ? spans->numElements[s] : remaining;
+        mnConvertToFloat(source, stream->sampleFormat, (float*)spans->elements[s], n);
+        source += n * bytesPerSample;
+        remaining -= n;
+    }
+    
+    return numRead;
+}
+
+/**
+ * Prepares a requested seek and refills the ring. Called with the mutex held.
+ * @return The number of frames decoded.
+ */
+static int prefetch(mnFilePlayer* player, mnFileStream* stream)
+{
+    const int numChannels = stream->numChannels;
+    const int maxFramesPerRead = MN_FILE_PLAYER_READ_SIZE / getFrameSize(stream);
+    const int publishedSeek = mnAtomicLoadRelaxed(&stream->publishedSeek);
+    const int isSeekTaken = mnAtomicLoadAcquire(&stream->acknowledgedSeek) == publishedSeek;
+    int numDecoded = 0;
+    
+    if (stream->isSeekRequested && isSeekTaken)
+    {
+        //decode the pre-roll into the buffer the audio thread is not using
+        long long target = stream->requestedSeekFrame;
+        target = target < 0 ? 0 : (target > stream->numFrames ? stream->numFrames : target);
+        const int slot = (publishedSeek + 1) & 1;
+        
+        int numPreRollFrames = 0;
+        while (numPreRollFrames < stream->maxPreRollFrames && target + numPreRollFrames < stream->numFrames)
+        {
+            long long n = stream->maxPreRollFrames - numPreRollFrames;
+            n = n < maxFramesPerRead ? n : maxFramesPerRead;
+            n = n < stream->numFrames - target - numPreRollFrames ? n : stream->numFrames - target - numPreRollFrames;
+            
+            mnFIFOSpans spans;
+            memset(&spans, 0, sizeof(spans));
+            spans.elements[0] = stream->preRoll[slot] + numPreRollFrames * numChannels;
+            spans.numElements[0] = (int)n * numChannels;
+            const int numRead = decode(player, stream, target + numPreRollFrames, (int)n, &spans);
+            numPreRollFrames += numRead;
+            if (numRead < n)
+            {
+                break;
+            }
+        }
+        
+        stream->numPreRollFrames[slot] = numPreRollFrames;
+        stream->readPosition = target + numPreRollFrames;
+        stream->isSeekRequested = 0;
+        mnAtomicStoreRelaxed(stream->readPosition >= stream->numFrames, &stream->isFinished[slot]);
+        mnAtomicStoreRelease(publishedSeek + 1, &stream->publishedSeek);
+        
+        //the ring is refilled once the audio thread has emptied it
+        return numPreRollFrames > 0 ? numPreRollFrames : 1;
+    }
+    
+    if (!isSeekTaken)
+    {
+        return 0;
+    }
+    
+    const int slot = publishedSeek & 1;
+    while (stream->readPosition < stream->numFrames)
+    {
+        long long n = stream->numFrames - stream->readPosition;
+        n = n < maxFramesPerRead ? n : maxFramesPerRead;
+        
+        //only whole frames are pushed, so the audio thread never sees a partial frame
+        mnFIFOSpans spans;
+        const int numReserved = mnFIFO_reserveWrite(&stream->ring, (int)n * numChannels, &spans) / numChannels;
+        if (numReserved == 0)
+        {
+            break;
+        }
+        
+        const int numRead = decode(player, stream, stream->readPosition, numReserved, &spans);
+        mnFIFO_commitWrite(&stream->ring, numRead * numChannels);
+        stream->readPosition += numRead;
+        numDecoded += numRead;
+        if (numRead < numReserved)
+        {
+            //the file is shorter than its header says
+            stream->numFrames = stream->readPosition;
+        }
+    }
+    
+    if (stream->readPosition >= stream->numFrames && !mnAtomicLoadRelaxed(&stream->isFinished[slot]))
+    {
+        mnAtomicStoreRelease(1, &stream->isFinished[slot]);
+    }
+    
+    return numDecoded;
+}
+
+static void* prefetchThreadEntryPoint(void* data)
+{
+    mnFilePlayer* player = (mnFilePlayer*)data;
+    
+    while (mnAtomicLoadAcquire(&player->isRunning))
+    {
+        int numDecoded = 0;
+        pthread_mutex_lock(&player->mutex);
+        for (int i = 0; i < player->maxStreams; i++)
+        {
+            if (mnAtomicLoadRelaxed(&player->streams[i].isOpen))
+            {
+                numDecoded += prefetch(player, &player->streams[i]);
+            }
+        }
+        pthread_mutex_unlock(&player->mutex);
+        
+        if (numDecoded == 0)
+        {
+            sleepFor(player->pollInterval);
+        }
+    }
+    
+    return NULL;
+}
+
+/* Player */
+
+int mnFilePlayer_init(mnFilePlayer* player, int maxStreams, mnEngine* engine)
+{
+    memset(player, 0, sizeof(mnFilePlayer));
+    if (maxStreams < 1 || maxStreams > INT_MAX / (int)sizeof(mnFileStream))
+    {
+        return 0;
+    }
+    
+    player->engine = engine;
+    player->maxStreams = maxStreams;
+    //the audio thread reads the stream state, so it is locked along with the rings
+    player->streams = mnLockedMemory_alloc(maxStreams * (int)sizeof(mnFileStream), NULL);
+    player->pollInterval = 0.005;
+    player->readBuffer = malloc(MN_FILE_PLAYER_READ_SIZE);
+    if (!player->streams || !player->readBuffer)
+    {
+        mnLockedMemory_free(player->streams);
+        free(player->readBuffer);
+        memset(player, 0, sizeof(mnFilePlayer));
+        return 0;
+    }
+    pthread_mutex_init(&player->mutex, NULL);
+    
+    mnAtomicStoreRelease(1, &player->isRunning);
+    if (!mnThread_create(&player->thread, NULL, prefetchThreadEntryPoint, player))
+    {
+        pthread_mutex_destroy(&player->mutex);
+        mnLockedMemory_free(player->streams);
+        free(player->readBuffer);
+        memset(player, 0, sizeof(mnFilePlayer));
+        return 0;
+    }
+    
+    return 1;
+}
+
+void mnFilePlayer_deinit(mnFilePlayer* player)
+{
+    mnAtomicStoreRelease(0, &player->isRunning);
+    pthread_join(player->thread, NULL);
+    
+    for (int i = 0; i < player->maxStreams; i++)
+    {
+        mnFilePlayer_close(player, i);
+    }
+    
+    pthread_mutex_destroy(&player->mutex);
+    mnLockedMemory_free(player->streams);
+    free(player->readBuffer);
+    memset(player, 0, sizeof(mnFilePlayer));
+}
+
+int mnFilePlayer_setThreadOptions(mnFilePlayer* player, const mnThreadOptions* options)
+{
+    return mnThread_setOptions(player->thread, options);
+}
+
+int mnFilePlayer_open(mnFilePlayer* player, const char* path, int bufferSizeInFrames, int preRollFrames)
+{
+    pthread_mutex_lock(&player->mutex);
+    
+    int index = -1;
+    for (int i = 0; i < player->maxStreams && index < 0; i++)
+    {
+        if (!mnAtomicLoadRelaxed(&player->streams[i].isOpen))
+        {
+            index = i;
+        }
+    }
+    
+    mnFileStream* stream = index >= 0 ? &player->streams[index] : NULL;
+    if (stream)
+    {
+        memset(stream, 0, sizeof(mnFileStream));
+        stream->file = open(path, O_RDONLY);
+        if (stream->file < 0 || !parseWAV(stream) || getFrameSize(stream) > MN_FILE_PLAYER_READ_SIZE)
+        {
+            if (stream->file >= 0)
+            {
+                close(stream->file);
+            }
+            index = -1;
+        }
+    }
+    
+    if (index >= 0)
+    {
+        //the ring and the pre-roll buffers are read by the audio thread, so they are locked
+        const int numChannels = stream->numChannels;
+        const int ringIsValid = mnFIFO_init(&stream->ring, bufferSizeInFrames * numChannels, sizeof(float));
+        stream->maxPreRollFrames = preRollFrames > 0 ? preRollFrames : 0;
+        for (int i = 0; i < 2; i++)
+        {
+            stream->preRoll[i] = mnLockedMemory_alloc((stream->maxPreRollFrames * numChannels + 1) * sizeof(float), NULL);
+        }
+        
+        if (!ringIsValid || !stream->preRoll[0] || !stream->preRoll[1])
+        {
+            close(stream->file);
+            mnFIFO_deinit(&stream->ring);
+            mnLockedMemory_free(stream->preRoll[0]);
+            mnLockedMemory_free(stream->preRoll[1]);
+            memset(stream, 0, sizeof(mnFileStream));
+            index = -1;
+        }
+    }
+    
+    if (index >= 0)
+    {
+        //fill the ring, so playback can start right away
+        prefetch(player, stream);
+        mnAtomicStoreRelease(1, &stream->isOpen);
+    }
+    
+    pthread_mutex_unlock(&player->mutex);
+    return index;
+}
+
+void mnFilePlayer_close(mnFilePlayer* player, int stream)
+{
+    pthread_mutex_lock(&player->mutex);
+    
+    mnFileStream* s = &player->streams[stream];
+    if (mnAtomicLoadRelaxed(&s->isOpen))
+    {
+        mnAtomicStoreRelease(0, &s->isOpen);
+        close(s->file);
+        mnFIFO_deinit(&s->ring);
+        mnLockedMemory_free(s->preRoll[0]);
+        mnLockedMemory_free(s->preRoll[1]);
+        memset(s, 0, sizeof(mnFileStream));
+    }
+    
+    pthread_mutex_unlock(&player->mutex);
+}
+
+void mnFilePlayer_seek(mnFilePlayer* player, int stream, long long frame)
+{
+    pthread_mutex_lock(&player->mutex);
+    player->streams[stream].requestedSeekFrame = frame;
+    player->streams[stream].isSeekRequested = 1;
+    pthread_mutex_unlock(&player->mutex);
+}
+
+int mnFilePlayer_isSeeking(mnFilePlayer* player, int stream)
+{
+    pthread_mutex_lock(&player->mutex);
+    const int isSeeking = player->streams[stream].isSeekRequested;
+    pthread_mutex_unlock(&player->mutex);
+    return isSeeking;
+}
+
+int mnFilePlayer_read(mnFilePlayer* player, int stream, float* output, int numFrames)
+{
+    mnFileStream* s = &player->streams[stream];
+    if (!mnAtomicLoadAcquire(&s->isOpen))
+    {
+        return 0;
+    }
+    
+    const int numChannels = s->numChannels;
+    
+    const int publishedSeek = mnAtomicLoadAcquire(&s->publishedSeek);
+    if (publishedSeek != s->playedSeek)
+    {
+        //take the seek. the prefetch thread doesn't refill the ring until it is
+        //acknowledged, so everything in it is from before the seek.
+        mnFIFOSpans spans;
+        mnFIFO_consumeRead(&s->ring, mnFIFO_peekRead(&s->ring, s->ring.capacity, &spans));
+        s->playedSeek = publishedSeek;
+        s->preRollPosition = 0;
+        mnAtomicStoreRelease(publishedSeek, &s->acknowledgedSeek);
+    }
+    
+    //checked before reading the ring, so that frames pushed right before the
+    //end of the file was flagged are not mistaken for an underrun
+    const int slot = s->playedSeek & 1;
+    const int isFinished = mnAtomicLoadAcquire(&s->isFinished[slot]);
+    
+    int numCopied = s->numPreRollFrames[slot] - s->preRollPosition;
+    numCopied = numCopied < numFrames ? numCopied : numFrames;
+    memcpy(output, s->preRoll[slot] + s->preRollPosition * numChannels, numCopied * numChannels * sizeof(float));
+    s->preRollPosition += numCopied;
+    
+    mnFIFOSpans spans;
+    const int numSamples = mnFIFO_peekRead(&s->ring, (numFrames - numCopied) * numChannels, &spans);
+    float* target = output + numCopied * numChannels;
+    memcpy(target, spans.elements[0], spans.numElements[0] * sizeof(float));
+    memcpy(target + spans.numElements[0], spans.elements[1], spans.numElements[1] * sizeof(float));
+    mnFIFO_consumeRead(&s->ring, numSamples);
+    numCopied += numSamples / numChannels;
+    
+    if (numCopied < numFrames)
+    {
+        memset(output + numCopied * numChannels, 0, (numFrames - numCopied) * numChannels * sizeof(float));
+        if (!isFinished)
+        {
+            mnAtomicAdd(&s->numUnderruns, 1);
+            if (player->engine)
+            {
+                mnTimingStats_addUnderrun(&player->engine->timingStats);
+            }
+        }
+    }
+    
+    return numCopied;
+}
+
+int mnFilePlayer_getNumUnderruns(mnFilePlayer* player, int stream)
+{
+    return mnAtomicLoad(&player->streams[stream].numUnderruns);
+}
@@ -0,0 +1,198 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef MN_FILE_PLAYER_H
+#define MN_FILE_PLAYER_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "engine.h"
+#include "fifo.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * The largest number of bytes the prefetch thread reads from a file at once.
+     */
+    #define MN_FILE_PLAYER_READ_SIZE (64 * 1024)
+    
+    /**
+     * A WAV file streamed by an ::mnFilePlayer.
+     *
+     * The prefetch thread keeps \c ring filled with decoded frames. A seek is
+     * prepared by decoding the frames at the target into one of two pre-roll
+     * buffers, which is then published by incrementing \c publishedSeek. The
+     * audio thread takes it by discarding the ring, playing the pre-roll buffer
+     * and incrementing \c acknowledgedSeek. Only then does the prefetch thread
+     * refill the ring, from the frame after the pre-roll, so the ring never
+     * mixes frames from before and after a seek.
+     */
+    typedef struct mnFileStream
+    {
+        /** Non-zero while the stream is open. Only accessed through atomic operations. */
+        int isOpen;
+        int file;
+        int numChannels;
+        float sampleRate;
+        mnSampleFormat sampleFormat;
+        /** The offset of the first sample in the file. */
+        long long dataOffset;
+        /** The length of the file in frames. */
+        long long numFrames;
+        
+        /** Decoded interleaved float samples. */
+        mnFIFO ring;
+        /** The capacity of each pre-roll buffer in frames. */
+        int maxPreRollFrames;
+        float* preRoll[2];
+        int numPreRollFrames[2];
+        
+        /** A seek not yet prepared. Protected by the player's mutex. */
+        int isSeekRequested;
+        long long requestedSeekFrame;
+        /** The next frame to decode. Only accessed by the prefetch thread. */
+        long long readPosition;
+        /**
+         * Set when the last frame since a seek has been decoded, indexed like
+         * the pre-roll buffers. Only accessed through atomic operations.
+         */
+        int isFinished[2];
+        /** The number of seeks prepared. Only accessed through atomic operations. */
+        int publishedSeek;
+        /** The number of seeks taken by the audio thread. Only accessed through atomic operations. */
+        int acknowledgedSeek;
+        
+        /** The seek being played. Only accessed by the audio thread. */
+        int playedSeek;
+        /** The next frame of the pre-roll buffer to play. Only accessed by the audio thread. */
+        int preRollPosition;
+        /** Only accessed through atomic operations. */
+        int numUnderruns;
+    } mnFileStream;
+    
+    /**
+     * Streams WAV files from disk for playback in output callbacks, with memory
+     * use bounded by the ring sizes regardless of the file lengths.
+     *
+     * A prefetch thread reads each open file with \c pread in blocks of up to
+     * ::MN_FILE_PLAYER_READ_SIZE bytes and decodes them to floats into the
+     * stream's single producer, single consumer ring. The audio thread only
+     * copies decoded frames out of the rings with ::mnFilePlayer_read, which
+     * never blocks, allocates or makes system calls. Running out of frames is
+     * counted as an underrun of the stream, and of the engine if the player has one.
+     *
+     * The prefetch thread polls the streams every \c pollInterval seconds, so
+     * rings should hold several poll intervals worth of frames.
+     */
+    typedef struct mnFilePlayer
+    {
+        /** Receives underruns in its timing stats. May be NULL. */
+        mnEngine* engine;
+        int maxStreams;
+        mnFileStream* streams;
+        /** Defaults to 5 ms. */
+        double pollInterval;
+        /** Raw samples read from a file. Protected by \c mutex. */
+        unsigned char* readBuffer;
+        /** Held while opening, closing or seeking streams, and while prefetching. */
+        pthread_mutex_t mutex;
+        pthread_t thread;
+        /** Only accessed through atomic operations. Cleared to make the prefetch thread exit. */
+        int isRunning;
+    } mnFilePlayer;
+    
+    /**
+     * Initializes a player and starts its prefetch thread.
+     * @param maxStreams The largest number of streams open at once.
+     * @param engine The engine whose timing stats count underruns, or NULL.
+     * @return 0 if \c maxStreams is out of range, allocation failed or the
+     * thread could not be created, in which case there is nothing to
+     * deinitialize.
+     */
+    int mnFilePlayer_init(mnFilePlayer* player, int maxStreams, mnEngine* engine);
+    
+    /**
+     * Stops the prefetch thread and closes all streams.
+     */
+    void mnFilePlayer_deinit(mnFilePlayer* player);
+    
+    /**
+     * Changes the scheduling of the prefetch thread, see ::mnThread_setOptions.
+     * @return 1 if every option could be applied.
+     */
+    int mnFilePlayer_setThreadOptions(mnFilePlayer* player, const mnThreadOptions* options);
+    
+    /**
+     * Opens a 16, 24 or 32 bit integer or 32 bit float WAV file and fills its
+     * ring, so that it can be played right away. Not called from the audio thread.
+     * @param bufferSizeInFrames The capacity of the stream's ring.
+     * @param preRollFrames The number of frames decoded up front when seeking,
+     * which should cover the time the prefetch thread takes to refill the ring.
+     * @return The index of the stream, or -1 if the file could not be opened,
+     * is not supported or all streams are in use.
+     */
+    int mnFilePlayer_open(mnFilePlayer* player, const char* path, int bufferSizeInFrames, int preRollFrames);
+    
+    /**
+     * Closes a stream. Not to be called while the audio thread may read from it.
+     */
+    void mnFilePlayer_close(mnFilePlayer* player, int stream);
+    
+    /**
+     * Makes playback of a stream continue at \c frame. The audio thread keeps
+     * playing from the old position until the frames at \c frame are decoded,
+     * then switches to them exactly at the start of a call to ::mnFilePlayer_read.
+     * Not called from the audio thread.
+     */
+    void mnFilePlayer_seek(mnFilePlayer* player, int stream, long long frame);
+    
+    /**
+     * Returns non-zero until the frames at the most recently requested seek
+     * are decoded and ready to play. Not called from the audio thread.
+     */
+    int mnFilePlayer_isSeeking(mnFilePlayer* player, int stream);
+    
+    /**
+     * Copies decoded frames from a stream. Called from the audio thread only.
+     * @param output Receives \c numFrames interleaved frames of the file's
+     * channels. Frames past the end of the file or missing because of an
+     * underrun are silent.
+     * @return The number of frames copied from the file.
+     */
+    int mnFilePlayer_read(mnFilePlayer* player, int stream, float* output, int numFrames);
+    
+    /**
+     *
+     */
+    int mnFilePlayer_getNumUnderruns(mnFilePlayer* player, int stream);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_FILE_PLAYER_H
@@ -0,0 +1,538 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "clock.h"
+#include "graph.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/** The number of busy wait iterations before spinning workers start yielding. */
+#define NUM_PAUSE_SPINS 64
+/** The number of busy wait iterations between clock reads. */
+#define NUM_SPINS_PER_CLOCK_READ 64
+
+static void pauseCPU()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/*
+ * Waiting workers spin on a CPU pause instruction for a short while and then
+ * yield to the scheduler between checks, so that spinning doesn't starve
+ * threads doing work on an oversubscribed machine. The audio thread only
+ * ever pauses.
+ */
+static void backOff(int iteration)
+{
+    if (iteration < NUM_PAUSE_SPINS)
+    {
+        pauseCPU();
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+static void sleepFor(double seconds)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+/* Processing */
+
+static void processNode(mnGraph* graph, int threadIndex, int nodeIndex)
+{
+    mnGraphNode* node = &graph->nodes[nodeIndex];
+    node->callback(graph->numFrames, node->context);
+    
+    for (int i = 0; i < node->numDependents; i++)
+    {
+        const int dependent = graph->dependents[node->firstDependent + i];
+        if (mnAtomicAdd(&graph->nodes[dependent].numPendingDependencies, -1) == 0)
+        {
+            //every node is pushed once per buffer, so the deque can't be full
+            const int wasPushed = mnWorkDeque_push(&graph->deques[threadIndex], dependent);
+            assert(wasPushed);
+            (void)wasPushed;
+        }
+    }
+    
+    //last, so that a finished buffer has no node bookkeeping left
+    mnAtomicAdd(&graph->numRemainingNodes, -1);
+}
+
+static int stealNode(mnGraph* graph, int threadIndex, int* nodeIndex)
+{
+    const int numDeques = graph->numWorkers + 1;
+    for (int i = 1; i < numDeques; i++)
+    {
+        if (mnWorkDeque_steal(&graph->deques[(threadIndex + i) % numDeques], nodeIndex))
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+static int takeNode(mnGraph* graph, int threadIndex, int* nodeIndex)
+{
+    return mnWorkDeque_take(&graph->deques[threadIndex], nodeIndex) || stealNode(graph, threadIndex, nodeIndex);
+}
+
+/**
+ * Processes nodes on a worker until all nodes of the current buffer are
+ * done, or the buffer is past its deadline and the audio thread finishes it.
+ */
+static void processNodesOnWorker(mnGraph* graph, int threadIndex)
+{
+    int numIdleSpins = 0;
+    while (mnAtomicLoadAcquire(&graph->numRemainingNodes) > 0 &&
+           !mnAtomicLoadRelaxed(&graph->isPastDeadline))
+    {
+        int nodeIndex;
+        if (takeNode(graph, threadIndex, &nodeIndex))
+        {
+            processNode(graph, threadIndex, nodeIndex);
+            numIdleSpins = 0;
+        }
+        else
+        {
+            backOff(numIdleSpins++);
+        }
+    }
+}
+
+/**
+ * Processes nodes on the audio thread until all nodes of the current buffer
+ * are done. Once the clock passes \c deadline while waiting, the workers
+ * stop starting nodes and the audio thread only waits for the ones they
+ * have already started.
+ * @return 1 if the deadline was passed.
+ */
+static int processNodesOnAudioThread(mnGraph* graph, double deadline)
+{
+    int isPastDeadline = 0;
+    int numIdleSpins = 0;
+    while (mnAtomicLoadAcquire(&graph->numRemainingNodes) > 0)
+    {
+        int nodeIndex;
+        if (takeNode(graph, 0, &nodeIndex))
+        {
+            processNode(graph, 0, nodeIndex);
+        }
+        else
+        {
+            pauseCPU();
+            if (!isPastDeadline &&
+                ++numIdleSpins % NUM_SPINS_PER_CLOCK_READ == 0 &&
+                mnClock_getSeconds() > deadline)
+            {
+                isPastDeadline = 1;
+                mnAtomicStoreRelaxed(1, &graph->isPastDeadline);
+            }
+        }
+    }
+    
+    return isPastDeadline;
+}
+
+static void processSerially(mnGraph* graph)
+{
+    for (int i = 0; i < graph->numNodes; i++)
+    {
+        mnGraphNode* node = &graph->nodes[graph->serialOrder[i]];
+        node->callback(graph->numFrames, node->context);
+    }
+}
+
+/* Workers */
+
+static int hasNewWork(mnGraph* graph, int seenGeneration)
+{
+    return mnAtomicLoad(&graph->generation) != seenGeneration || mnAtomicLoad(&graph->isShuttingDown);
+}
+
+/**
+ * Waits until a buffer newer than \c seenGeneration is started, spinning for
+ * up to a buffer period and then polling a few times per buffer period.
+ * The audio thread never wakes the workers.
+ */
+static void waitForWork(mnGraph* graph, int seenGeneration)
+{
+    const double spinSeconds = 1e-6 * mnAtomicLoadRelaxed(&graph->spinMicroseconds);
+    const double spinDeadline = mnClock_getSeconds() + spinSeconds;
+    int numSpins = 0;
+    while (!hasNewWork(graph, seenGeneration))
+    {
+        if ((numSpins & 63) == 63 && mnClock_getSeconds() > spinDeadline)
+        {
+            double pollInterval = 0.25 * spinSeconds;
+            if (pollInterval > 0.005)
+            {
+                pollInterval = 0.005;
+            }
+            else if (pollInterval < 0.00025)
+            {
+                pollInterval = 0.00025;
+            }
+            
+            while (!hasNewWork(graph, seenGeneration))
+            {
+                sleepFor(pollInterval);
+            }
+            return;
+        }
+        
+        backOff(numSpins++);
+    }
+}
+
+static void* workerEntryPoint(void* data)
+{
+    mnGraphWorker* worker = (mnGraphWorker*)data;
+    mnGraph* graph = worker->graph;
+    mnFloatState_enterFlushToZero();
+    
+    int seenGeneration = 0;
+    while (1)
+    {
+        waitForWork(graph, seenGeneration);
+        if (mnAtomicLoad(&graph->isShuttingDown))
+        {
+            break;
+        }
+        
+        seenGeneration = mnAtomicLoad(&graph->generation);
+        processNodesOnWorker(graph, worker->index);
+    }
+    
+    return NULL;
+}
+
+/**
+ * Stops and joins the first \c numStarted workers.
+ */
+static void stopWorkers(mnGraph* graph, int numStarted)
+{
+    mnAtomicStore(1, &graph->isShuttingDown);
+    for (int i = 0; i < numStarted; i++)
+    {
+        pthread_join(graph->workers[i].thread, NULL);
+    }
+}
+
+static void releaseBuffers(mnGraph* graph)
+{
+    if (graph->deques)
+    {
+        for (int i = 0; i < graph->numWorkers + 1; i++)
+        {
+            mnWorkDeque_deinit(&graph->deques[i]);
+        }
+    }
+    
+    free(graph->workers);
+    free(graph->deques);
+    free(graph->nodes);
+    free(graph->edges);
+    free(graph->dependents);
+    free(graph->serialOrder);
+    memset(graph, 0, sizeof(mnGraph));
+}
+
+/* Graph */
+
+int mnGraph_init(mnGraph* graph, int maxNodes, int numWorkers, float sampleRate, const mnThreadOptions* options)
+{
+    memset(graph, 0, sizeof(mnGraph));
+    if (maxNodes < 1 || numWorkers < 0 || numWorkers == INT_MAX || sampleRate <= 0.0f)
+    {
+        return 0;
+    }
+    
+    graph->sampleRate = sampleRate;
+    graph->deadlineFraction = 0.75f;
+    graph->maxNodes = maxNodes;
+    graph->numWorkers = numWorkers;
+    graph->nodes = calloc(maxNodes, sizeof(mnGraphNode));
+    graph->serialOrder = calloc(maxNodes, sizeof(int));
+    graph->deques = calloc(numWorkers + 1, sizeof(mnWorkDeque));
+    graph->workers = calloc(numWorkers > 0 ? numWorkers : 1, sizeof(mnGraphWorker));
+    if (!graph->nodes || !graph->serialOrder || !graph->deques || !graph->workers)
+    {
+        releaseBuffers(graph);
+        return 0;
+    }
+    for (int i = 0; i < numWorkers + 1; i++)
+    {
+        if (!mnWorkDeque_init(&graph->deques[i], maxNodes))
+        {
+            releaseBuffers(graph);
+            return 0;
+        }
+    }
+    
+    //the audio thread spins on the workers, so by default they run at real
+    //time priority too, spread over the cores after the first one
+    mnThreadOptions workerOptions;
+    mnThreadOptions_setDefaults(&workerOptions);
+    workerOptions.priority = 98;
+    if (options)
+    {
+        workerOptions = *options;
+    }
+    const int firstCore = workerOptions.core >= 0 ? workerOptions.core : 1;
+    const long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < numWorkers; i++)
+    {
+        mnGraphWorker* worker = &graph->workers[i];
+        worker->graph = graph;
+        worker->index = i + 1;
+        
+        mnThreadOptions threadOptions = workerOptions;
+        threadOptions.core = numCores > 1 ? (int)((firstCore + i) % numCores) : -1;
+        if (!mnThread_create(&worker->thread, &threadOptions, workerEntryPoint, worker))
+        {
+            stopWorkers(graph, i);
+            releaseBuffers(graph);
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+void mnGraph_deinit(mnGraph* graph)
+{
+    stopWorkers(graph, graph->numWorkers);
+    releaseBuffers(graph);
+}
+
+int mnGraph_addNode(mnGraph* graph, mnGraphNodeCallback callback, void* context)
+{
+    if (graph->numNodes >= graph->maxNodes)
+    {
+        return -1;
+    }
+    
+    mnGraphNode* node = &graph->nodes[graph->numNodes];
+    memset(node, 0, sizeof(mnGraphNode));
+    node->callback = callback;
+    node->context = context;
+    graph->isCompiled = 0;
+    
+    return graph->numNodes++;
+}
+
+int mnGraph_addDependency(mnGraph* graph, int node, int dependency)
+{
+    if (node < 0 || node >= graph->numNodes ||
+        dependency < 0 || dependency >= graph->numNodes ||
+        node == dependency)
+    {
+        return 0;
+    }
+    
+    if (graph->numEdges == graph->maxEdges)
+    {
+        const int maxEdges = graph->maxEdges > 0 ? 2 * graph->maxEdges : 16;
+        int* edges = realloc(graph->edges, 2 * maxEdges * sizeof(int));
+        if (!edges)
+        {
+            return 0;
+        }
+        graph->edges = edges;
+        graph->maxEdges = maxEdges;
+    }
+    
+    graph->edges[2 * graph->numEdges] = node;
+    graph->edges[2 * graph->numEdges + 1] = dependency;
+    graph->numEdges++;
+    graph->isCompiled = 0;
+    
+    return 1;
+}
+
+int mnGraph_compile(mnGraph* graph)
+{
+    const int numNodes = graph->numNodes;
+    const int numEdges = graph->numEdges;
+    
+    //group the dependents by node
+    for (int i = 0; i < numNodes; i++)
+    {
+        graph->nodes[i].numDependencies = 0;
+        graph->nodes[i].numDependents = 0;
+    }
+    for (int e = 0; e < numEdges; e++)
+    {
+        graph->nodes[graph->edges[2 * e]].numDependencies++;
+        graph->nodes[graph->edges[2 * e + 1]].numDependents++;
+    }
+    
+    int first = 0;
+    for (int i = 0; i < numNodes; i++)
+    {
+        graph->nodes[i].firstDependent = first;
+        first += graph->nodes[i].numDependents;
+        graph->nodes[i].numDependents = 0;
+    }
+    
+    free(graph->dependents);
+    graph->dependents = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    if (!graph->dependents)
+    {
+        graph->isCompiled = 0;
+        return 0;
+    }
+    for (int e = 0; e < numEdges; e++)
+    {
+        mnGraphNode* dependency = &graph->nodes[graph->edges[2 * e + 1]];
+        graph->dependents[dependency->firstDependent + dependency->numDependents++] = graph->edges[2 * e];
+    }
+    
+    //topological sort (Kahn's algorithm), using serialOrder as the queue
+    int numOrdered = 0;
+    for (int i = 0; i < numNodes; i++)
+    {
+        graph->nodes[i].numPendingDependencies = graph->nodes[i].numDependencies;
+        if (graph->nodes[i].numDependencies == 0)
+        {
+            graph->serialOrder[numOrdered++] = i;
+        }
+    }
+    
+    for (int i = 0; i < numOrdered; i++)
+    {
+        const mnGraphNode* node = &graph->nodes[graph->serialOrder[i]];
+        for (int d = 0; d < node->numDependents; d++)
+        {
+            const int dependent = graph->dependents[node->firstDependent + d];
+            if (--graph->nodes[dependent].numPendingDependencies == 0)
+            {
+                graph->serialOrder[numOrdered++] = dependent;
+            }
+        }
+    }
+    
+    graph->isCompiled = numOrdered == numNodes;
+    return graph->isCompiled;
+}
+
+void mnGraph_process(mnGraph* graph, int numFrames)
+{
+    if (!graph->isCompiled || graph->numNodes == 0)
+    {
+        return;
+    }
+    
+    graph->numFrames = numFrames;
+    
+    if (graph->numWorkers == 0 || graph->numSerialBuffersLeft > 0)
+    {
+        if (graph->numSerialBuffersLeft > 0)
+        {
+            graph->numSerialBuffersLeft--;
+        }
+        processSerially(graph);
+        return;
+    }
+    
+    const double startTime = mnClock_getSeconds();
+    const double period = numFrames / graph->sampleRate;
+    const double deadline = startTime + graph->deadlineFraction * period;
+    mnAtomicStoreRelaxed((int)(1e6 * period), &graph->spinMicroseconds);
+    mnAtomicStoreRelaxed(0, &graph->isPastDeadline);
+    
+    //reset the bookkeeping, then publish the ready nodes. pushing has
+    //release semantics, so threads stealing a node see the reset counters.
+    for (int i = 0; i < graph->numNodes; i++)
+    {
+        mnAtomicStoreRelaxed(graph->nodes[i].numDependencies, &graph->nodes[i].numPendingDependencies);
+    }
+    mnAtomicStoreRelaxed(graph->numNodes, &graph->numRemainingNodes);
+    
+    for (int i = graph->numNodes - 1; i >= 0; i--)
+    {
+        if (graph->nodes[i].numDependencies == 0)
+        {
+            mnWorkDeque_push(&graph->deques[0], i);
+        }
+    }
+    
+    mnAtomicAdd(&graph->generation, 1);
+    
+    const int isPastDeadline = processNodesOnAudioThread(graph, deadline);
+    if (isPastDeadline || mnClock_getSeconds() > deadline)
+    {
+        graph->numSerialBuffersLeft = MN_GRAPH_SERIAL_BUFFERS;
+        mnAtomicAdd(&graph->numSerialFallbacks, 1);
+    }
+}
+
+int mnGraph_getNumSerialFallbacks(mnGraph* graph)
+{
+    return mnAtomicLoadRelaxed(&graph->numSerialFallbacks);
+}
+
+int mnGraph_setThreadOptions(mnGraph* graph, const mnThreadOptions* options)
+{
+    const long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int isApplied = 1;
+    for (int i = 0; i < graph->numWorkers; i++)
+    {
+        mnThreadOptions workerOptions = *options;
+        if (options->core >= 0)
+        {
+            workerOptions.core = (int)((options->core + i) % numCores);
+        }
+        isApplied = mnThread_setOptions(graph->workers[i].thread, &workerOptions) && isApplied;
+    }
+    return isApplied;
+}
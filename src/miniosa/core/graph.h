@@ -0,0 +1,212 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_GRAPH_H
+#define MN_GRAPH_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "realtime.h"
+#include "work_deque.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * The number of buffers processed serially after a parallel buffer
+     * misses its deadline, before parallel processing is tried again.
+     */
+    #define MN_GRAPH_SERIAL_BUFFERS 64
+    
+    /**
+     * A callback processing one node of a graph. Nodes pass audio to each
+     * other through buffers of their own, typically kept in \c context.
+     * @param numFrames The number of frames to process.
+     * @param context The pointer the node was added with.
+     */
+    typedef void (*mnGraphNodeCallback)(int numFrames, void* context);
+    
+    /**
+     * A node of a graph.
+     */
+    typedef struct mnGraphNode
+    {
+        mnGraphNodeCallback callback;
+        void* context;
+        int numDependencies;
+        /** The first of this node's entries in \c dependents of the graph. */
+        int firstDependent;
+        int numDependents;
+        /** Dependencies not yet processed in the current buffer. Only accessed through atomic operations. */
+        int numPendingDependencies;
+    } mnGraphNode;
+    
+    struct mnGraph;
+    
+    /**
+     * A pre-spawned thread helping the audio thread process a graph.
+     */
+    typedef struct mnGraphWorker
+    {
+        struct mnGraph* graph;
+        /** The index of the worker's deque. */
+        int index;
+        pthread_t thread;
+    } mnGraphWorker;
+    
+    /**
+     * Processes nodes with dependencies on the audio thread and a pool of
+     * worker threads, for spreading the work of an output callback over
+     * several cores.
+     *
+     * ::mnGraph_process is called from the audio thread once per buffer.
+     * Every thread, the audio thread included, owns a work stealing deque.
+     * Nodes without dependencies are pushed onto the audio thread's deque.
+     * A thread finishing a node pushes the dependents that became ready onto
+     * its own deque, and idle threads steal from the others.
+     *
+     * The workers are spawned and pinned to cores up front, run at real time
+     * priority unless told otherwise, and flush denormals to zero like the
+     * audio thread. Between buffers they spin for up to one buffer period and
+     * then sleep, polling a few times per buffer period. The audio thread
+     * never wakes them, yields or blocks: it only pauses the CPU while it
+     * waits. Once a buffer has taken \c deadlineFraction of the buffer period,
+     * for example because workers were descheduled, the workers stop starting
+     * nodes, the audio thread finishes the buffer on its own, waiting only
+     * for nodes already started, and the next ::MN_GRAPH_SERIAL_BUFFERS
+     * buffers are processed serially on the audio thread.
+     */
+    typedef struct mnGraph
+    {
+        float sampleRate;
+        /** The fraction of the buffer period that processing a buffer may take. Defaults to 0.75. */
+        float deadlineFraction;
+        int maxNodes;
+        int numNodes;
+        mnGraphNode* nodes;
+        /** Dependency edges added since the last compilation, as (node, dependency) pairs. */
+        int* edges;
+        int numEdges;
+        int maxEdges;
+        /** The dependents of all nodes, grouped by node. */
+        int* dependents;
+        /** The nodes in an order where every node follows its dependencies. */
+        int* serialOrder;
+        int isCompiled;
+        
+        int numWorkers;
+        mnGraphWorker* workers;
+        /** One per thread. Deque 0 belongs to the thread calling ::mnGraph_process. */
+        mnWorkDeque* deques;
+        
+        /** The number of frames of the current buffer. */
+        int numFrames;
+        /** Only accessed by the audio thread. */
+        int numSerialBuffersLeft;
+        /** Only accessed through atomic operations. */
+        int numSerialFallbacks;
+        /** Incremented for every buffer processed in parallel. Only accessed through atomic operations. */
+        int generation;
+        /** Only accessed through atomic operations. */
+        int numRemainingNodes;
+        /** How long idle workers spin before polling. Only accessed through atomic operations. */
+        int spinMicroseconds;
+        /** Set once the current buffer is past its deadline. Only accessed through atomic operations. */
+        int isPastDeadline;
+        /** Only accessed through atomic operations. */
+        int isShuttingDown;
+    } mnGraph;
+    
+    /**
+     * Initializes an empty graph and spawns its worker threads.
+     * @param maxNodes The largest number of nodes.
+     * @param numWorkers The number of worker threads. With 0 workers the
+     * graph is processed serially on the audio thread.
+     * @param sampleRate Used to compute buffer deadlines.
+     * @param options The scheduling of the workers, which are pinned to
+     * consecutive cores starting at \c options->core, or at the second core
+     * if it is -1. NULL for one below the highest real time priority.
+     * @return 0 if the arguments are invalid, allocation failed or a worker
+     * couldn't be started, in which case nothing needs to be released.
+     */
+    int mnGraph_init(mnGraph* graph, int maxNodes, int numWorkers, float sampleRate, const mnThreadOptions* options);
+    
+    /**
+     * Stops the worker threads and releases all resources.
+     */
+    void mnGraph_deinit(mnGraph* graph);
+    
+    /**
+     * Adds a node. Not thread safe, call when the graph is not being processed.
+     * @return The index of the node, or -1 if the graph is full.
+     */
+    int mnGraph_addNode(mnGraph* graph, mnGraphNodeCallback callback, void* context);
+    
+    /**
+     * Makes \c node wait for \c dependency to be processed. Not thread safe,
+     * call when the graph is not being processed.
+     * @return Non-zero on success.
+     */
+    int mnGraph_addDependency(mnGraph* graph, int node, int dependency);
+    
+    /**
+     * Prepares the graph for processing after nodes or dependencies were added.
+     * Not thread safe, call when the graph is not being processed.
+     * @return Non-zero on success, zero if the dependencies form a cycle or
+     * allocation failed.
+     */
+    int mnGraph_compile(mnGraph* graph);
+    
+    /**
+     * Processes every node once, in parallel where dependencies allow.
+     * Returns when all nodes are done. Called from the audio thread, for
+     * example from the output callback.
+     */
+    void mnGraph_process(mnGraph* graph, int numFrames);
+    
+    /**
+     * Returns the number of times processing fell back to serial because a
+     * buffer missed its deadline. May be called from any thread.
+     */
+    int mnGraph_getNumSerialFallbacks(mnGraph* graph);
+    
+    /**
+     * Changes the scheduling of the workers, for example to give them real
+     * time priority like the audio thread they work for. Workers are pinned
+     * to consecutive cores starting at \c options->core, or stay on the
+     * cores they were pinned to at startup if it is -1. Called from a non
+     * real time thread.
+     * @return 1 if the options could be applied to every worker.
+     */
+    int mnGraph_setThreadOptions(mnGraph* graph, const mnThreadOptions* options);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_GRAPH_H
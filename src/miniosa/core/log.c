@@ -0,0 +1,554 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "atomic.h"
+#include "log.h"
+
+/** The number of records the log thread pops at a time. */
+#define BATCH_SIZE 32
+/** The longest formatted message, including the timestamp. Longer ones are truncated. */
+#define MAX_LINE_LENGTH 512
+/** The most characters allowed for the flags, width and precision of a conversion. */
+#define MAX_OPTIONS_LENGTH 24
+/** The most characters a * width or precision expands to, as in -2147483648. */
+#define MAX_INT_LENGTH 11
+/**
+ * The longest rebuilt conversion: the %, the options with the * width and
+ * precision expanded, ll, the specifier and the null character.
+ */
+#define MAX_SPECIFICATION_LENGTH (1 + MAX_OPTIONS_LENGTH + 2 * MAX_INT_LENGTH + 2 + 1 + 1)
+
+void mnLogOptions_setDefaults(mnLogOptions* options)
+{
+    memset(options, 0, sizeof(mnLogOptions));
+    options->capacity = 1024;
+    options->path = NULL;
+    options->flushIntervalMilliseconds = 10;
+    mnThreadOptions_setDefaults(&options->threadOptions);
+}
+
+/* Format strings */
+
+typedef enum
+{
+    /** \c %%, which takes no argument. */
+    CONVERSION_PERCENT = 0,
+    CONVERSION_SIGNED,
+    CONVERSION_UNSIGNED,
+    CONVERSION_CHARACTER,
+    CONVERSION_REAL,
+    CONVERSION_STRING,
+    CONVERSION_POINTER,
+    CONVERSION_UNSUPPORTED
+} ConversionType;
+
+typedef enum
+{
+    LENGTH_DEFAULT = 0,
+    LENGTH_CHAR,
+    LENGTH_SHORT,
+    LENGTH_LONG,
+    LENGTH_LONG_LONG,
+    LENGTH_INTMAX,
+    LENGTH_SIZE,
+    LENGTH_PTRDIFF,
+    LENGTH_LONG_DOUBLE
+} LengthModifier;
+
+/**
+ * A conversion specification of a format string.
+ */
+typedef struct Conversion
+{
+    ConversionType type;
+    LengthModifier length;
+    /** The flags, width and precision, between the % and the length modifier. */
+    const char* options;
+    int numOptions;
+    /** The number of \c * widths and precisions, each taking an int argument. At most one of each. */
+    int numStars;
+    char specifier;
+} Conversion;
+
+/**
+ * Parses the conversion starting at the % that \c format points to.
+ * @return The character after the conversion.
+ */
+static const char* parseConversion(const char* format, Conversion* conversion)
+{
+    const char* p = format + 1;
+    memset(conversion, 0, sizeof(Conversion));
+    
+    conversion->options = p;
+    int numWidthStars = 0;
+    int numPrecisionStars = 0;
+    while (*p && strchr("-+ #0123456789.*", *p))
+    {
+        if (*p == '*')
+        {
+            if (p > conversion->options && p[-1] == '.')
+            {
+                numPrecisionStars++;
+            }
+            else
+            {
+                numWidthStars++;
+            }
+        }
+        p++;
+    }
+    conversion->numOptions = (int)(p - conversion->options);
+    conversion->numStars = numWidthStars + numPrecisionStars;
+    const int hasValidStars = numWidthStars <= 1 && numPrecisionStars <= 1;
+    
+    if (p[0] == 'h' && p[1] == 'h')
+    {
+        conversion->length = LENGTH_CHAR;
+        p += 2;
+    }
+    else if (p[0] == 'l' && p[1] == 'l')
+    {
+        conversion->length = LENGTH_LONG_LONG;
+        p += 2;
+    }
+    else if (*p && strchr("hlqjztL", *p))
+    {
+        const LengthModifier lengths[] = {LENGTH_SHORT, LENGTH_LONG, LENGTH_LONG_LONG, LENGTH_INTMAX,
+                                          LENGTH_SIZE, LENGTH_PTRDIFF, LENGTH_LONG_DOUBLE};
+        conversion->length = lengths[strchr("hlqjztL", *p) - "hlqjztL"];
+        p++;
+    }
+    
+    conversion->specifier = *p;
+    const int isWide = conversion->length == LENGTH_LONG;
+    const int isLongDouble = conversion->length == LENGTH_LONG_DOUBLE;
+    switch (*p)
+    {
+        case '%':
+            conversion->type = CONVERSION_PERCENT;
+            break;
+        case 'd':
+        case 'i':
+            conversion->type = isLongDouble ? CONVERSION_UNSUPPORTED : CONVERSION_SIGNED;
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            conversion->type = isLongDouble ? CONVERSION_UNSUPPORTED : CONVERSION_UNSIGNED;
+            break;
+        case 'c':
+            conversion->type = isWide || isLongDouble ? CONVERSION_UNSUPPORTED : CONVERSION_CHARACTER;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            conversion->type = isLongDouble ? CONVERSION_UNSUPPORTED : CONVERSION_REAL;
+            break;
+        case 's':
+            conversion->type = isWide || isLongDouble ? CONVERSION_UNSUPPORTED : CONVERSION_STRING;
+            break;
+        case 'p':
+            conversion->type = CONVERSION_POINTER;
+            break;
+        default:
+            //includes %n and a % at the end of the string
+            conversion->type = CONVERSION_UNSUPPORTED;
+            return *p ? p + 1 : p;
+    }
+    if (conversion->numOptions > MAX_OPTIONS_LENGTH || !hasValidStars)
+    {
+        conversion->type = CONVERSION_UNSUPPORTED;
+    }
+    
+    return p + 1;
+}
+
+/**
+ * Appends the conversion of the arguments starting at \c arguments to
+ * \c line, after \c numUsed characters.
+ * @return The number of arguments used.
+ */
+static int formatConversion(const Conversion* conversion,
+                            const mnLogArgument* arguments,
+                            char* line,
+                            int* numUsed)
+{
+    //rebuild the conversion with the * values filled in and integers widened
+    char specification[MAX_SPECIFICATION_LENGTH];
+    int length = 0;
+    int numArguments = 0;
+    specification[length++] = '%';
+    const char* options = conversion->options;
+    const char* end = options + conversion->numOptions;
+    while (options < end)
+    {
+        if (options[0] == '.' && options + 1 < end && options[1] == '*')
+        {
+            //a negative precision counts as none
+            const int precision = (int)arguments[numArguments++].integer;
+            if (precision >= 0)
+            {
+                length += snprintf(specification + length, sizeof(specification) - length, ".%d", precision);
+            }
+            options += 2;
+        }
+        else if (options[0] == '*')
+        {
+            const int width = (int)arguments[numArguments++].integer;
+            length += snprintf(specification + length, sizeof(specification) - length, "%d", width);
+            options++;
+        }
+        else
+        {
+            specification[length++] = *options++;
+        }
+    }
+    if (conversion->type == CONVERSION_SIGNED || conversion->type == CONVERSION_UNSIGNED)
+    {
+        specification[length++] = 'l';
+        specification[length++] = 'l';
+    }
+    specification[length++] = conversion->specifier;
+    specification[length] = '\0';
+    
+    const mnLogArgument argument = arguments[numArguments++];
+    char* target = line + *numUsed;
+    const int size = MAX_LINE_LENGTH - *numUsed;
+    int numWritten = 0;
+    switch (conversion->type)
+    {
+        case CONVERSION_SIGNED:
+            numWritten = snprintf(target, size, specification, argument.integer);
+            break;
+        case CONVERSION_UNSIGNED:
+            numWritten = snprintf(target, size, specification, (unsigned long long)argument.integer);
+            break;
+        case CONVERSION_CHARACTER:
+            numWritten = snprintf(target, size, specification, (int)argument.integer);
+            break;
+        case CONVERSION_REAL:
+            numWritten = snprintf(target, size, specification, argument.real);
+            break;
+        case CONVERSION_STRING:
+            numWritten = snprintf(target, size, specification, argument.pointer ? (const char*)argument.pointer : "(null)");
+            break;
+        default:
+            numWritten = snprintf(target, size, specification, argument.pointer);
+            break;
+    }
+    
+    //snprintf fails outright on widths and precisions it can't honor
+    if (numWritten < 0)
+    {
+        numWritten = 0;
+    }
+    *numUsed += numWritten < size ? numWritten : size - 1;
+    return numArguments;
+}
+
+/**
+ * Formats a record into a line of at most ::MAX_LINE_LENGTH characters,
+ * including the terminating newline and null character.
+ */
+static void formatRecord(const mnLogRecord* record, char* line)
+{
+    int numUsed = snprintf(line, MAX_LINE_LENGTH, "[%.0f] ", record->sampleTime);
+    if (record->numArguments < 0)
+    {
+        numUsed += snprintf(line + numUsed, MAX_LINE_LENGTH - numUsed, "(unsupported format) ");
+    }
+    
+    int argumentIndex = 0;
+    const char* p = record->format;
+    while (*p && numUsed < MAX_LINE_LENGTH - 2)
+    {
+        if (*p != '%' || record->numArguments < 0)
+        {
+            line[numUsed++] = *p++;
+            continue;
+        }
+        
+        Conversion conversion;
+        p = parseConversion(p, &conversion);
+        if (conversion.type == CONVERSION_PERCENT)
+        {
+            line[numUsed++] = '%';
+            continue;
+        }
+        argumentIndex += formatConversion(&conversion, record->arguments + argumentIndex, line, &numUsed);
+    }
+    
+    //room for the newline is always left
+    if (numUsed > MAX_LINE_LENGTH - 2)
+    {
+        numUsed = MAX_LINE_LENGTH - 2;
+    }
+    if (numUsed == 0 || line[numUsed - 1] != '\n')
+    {
+        line[numUsed++] = '\n';
+    }
+    line[numUsed] = '\0';
+}
+
+/* Log thread */
+
+static void writeRecords(mnLog* log)
+{
+    mnLogRecord records[BATCH_SIZE];
+    char line[MAX_LINE_LENGTH];
+    
+    int numRecords;
+    while ((numRecords = mnMPSCQueue_popN(&log->queue, records, BATCH_SIZE)) > 0)
+    {
+        for (int i = 0; i < numRecords; i++)
+        {
+            formatRecord(&records[i], line);
+            fputs(line, log->file);
+        }
+    }
+    
+    const int numDropped = mnAtomicLoad(&log->numDroppedRecords);
+    if (numDropped != log->numReportedDrops)
+    {
+        fprintf(log->file, "[log] %d records dropped\n", numDropped - log->numReportedDrops);
+        log->numReportedDrops = numDropped;
+    }
+    fflush(log->file);
+}
+
+static void* logThreadEntryPoint(void* data)
+{
+    mnLog* log = (mnLog*)data;
+    const int interval = log->options.flushIntervalMilliseconds;
+    const struct timespec duration = {interval / 1000, (interval % 1000) * 1000000L};
+    
+    while (1)
+    {
+        //writers are done once this is cleared, so one more pass empties the queue
+        const int isRunning = mnAtomicLoadAcquire(&log->isRunning);
+        writeRecords(log);
+        if (!isRunning)
+        {
+            break;
+        }
+        nanosleep(&duration, NULL);
+    }
+    
+    return NULL;
+}
+
+/* Log */
+
+int mnLog_start(mnLog* log, const mnLogOptions* options)
+{
+    memset(log, 0, sizeof(mnLog));
+    memcpy(&log->options, options, sizeof(mnLogOptions));
+    if (options->capacity < 1 || options->flushIntervalMilliseconds < 1)
+    {
+        return 0;
+    }
+    
+    log->file = options->path ? fopen(options->path, "a") : stderr;
+    if (!log->file)
+    {
+        return 0;
+    }
+    
+    mnAtomicStoreRelease(1, &log->isRunning);
+    if (!mnMPSCQueue_init(&log->queue, options->capacity, sizeof(mnLogRecord)) ||
+        !mnThread_create(&log->thread, &options->threadOptions, logThreadEntryPoint, log))
+    {
+        mnMPSCQueue_deinit(&log->queue);
+        if (options->path)
+        {
+            fclose(log->file);
+        }
+        memset(log, 0, sizeof(mnLog));
+        return 0;
+    }
+    
+    return 1;
+}
+
+void mnLog_stop(mnLog* log)
+{
+    if (!mnAtomicLoadAcquire(&log->isRunning))
+    {
+        return;
+    }
+    
+    mnAtomicStoreRelease(0, &log->isRunning);
+    pthread_join(log->thread, NULL);
+    
+    mnMPSCQueue_deinit(&log->queue);
+    if (log->options.path)
+    {
+        fclose(log->file);
+    }
+    log->file = NULL;
+}
+
+int mnLog_write(mnLog* log, double sampleTime, const char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    const int result = mnLog_writeV(log, sampleTime, format, arguments);
+    va_end(arguments);
+    return result;
+}
+
+int mnLog_writeV(mnLog* log, double sampleTime, const char* format, va_list arguments)
+{
+    mnLogRecord record;
+    record.format = format;
+    record.sampleTime = sampleTime;
+    record.numArguments = 0;
+    
+    //pick up the arguments in the types the conversions promise
+    mnLogArgument* argument = record.arguments;
+    const char* p = format;
+    while (*p)
+    {
+        if (*p != '%')
+        {
+            p++;
+            continue;
+        }
+        
+        Conversion conversion;
+        p = parseConversion(p, &conversion);
+        if (conversion.type == CONVERSION_PERCENT)
+        {
+            continue;
+        }
+        if (conversion.type == CONVERSION_UNSUPPORTED ||
+            record.numArguments + conversion.numStars + 1 > MN_LOG_MAX_ARGUMENTS)
+        {
+            record.numArguments = -1;
+            break;
+        }
+        
+        for (int i = 0; i < conversion.numStars; i++)
+        {
+            (argument++)->integer = va_arg(arguments, int);
+        }
+        record.numArguments += conversion.numStars + 1;
+        
+        switch (conversion.type)
+        {
+            case CONVERSION_SIGNED:
+                switch (conversion.length)
+                {
+                    case LENGTH_CHAR:
+                        argument->integer = (signed char)va_arg(arguments, int);
+                        break;
+                    case LENGTH_SHORT:
+                        argument->integer = (short)va_arg(arguments, int);
+                        break;
+                    case LENGTH_LONG:
+                        argument->integer = va_arg(arguments, long);
+                        break;
+                    case LENGTH_LONG_LONG:
+                        argument->integer = va_arg(arguments, long long);
+                        break;
+                    case LENGTH_INTMAX:
+                        argument->integer = va_arg(arguments, intmax_t);
+                        break;
+                    case LENGTH_SIZE:
+                    case LENGTH_PTRDIFF:
+                        argument->integer = va_arg(arguments, ptrdiff_t);
+                        break;
+                    default:
+                        argument->integer = va_arg(arguments, int);
+                        break;
+                }
+                break;
+            case CONVERSION_UNSIGNED:
+                switch (conversion.length)
+                {
+                    case LENGTH_CHAR:
+                        argument->integer = (unsigned char)va_arg(arguments, unsigned int);
+                        break;
+                    case LENGTH_SHORT:
+                        argument->integer = (unsigned short)va_arg(arguments, unsigned int);
+                        break;
+                    case LENGTH_LONG:
+                        argument->integer = va_arg(arguments, unsigned long);
+                        break;
+                    case LENGTH_LONG_LONG:
+                        argument->integer = va_arg(arguments, unsigned long long);
+                        break;
+                    case LENGTH_INTMAX:
+                        argument->integer = va_arg(arguments, uintmax_t);
+                        break;
+                    case LENGTH_SIZE:
+                    case LENGTH_PTRDIFF:
+                        argument->integer = va_arg(arguments, size_t);
+                        break;
+                    default:
+                        argument->integer = va_arg(arguments, unsigned int);
+                        break;
+                }
+                break;
+            case CONVERSION_CHARACTER:
+                argument->integer = va_arg(arguments, int);
+                break;
+            case CONVERSION_REAL:
+                argument->real = va_arg(arguments, double);
+                break;
+            default:
+                argument->pointer = va_arg(arguments, const void*);
+                break;
+        }
+        argument++;
+    }
+    
+    if (!mnMPSCQueue_push(&log->queue, &record))
+    {
+        mnAtomicAdd(&log->numDroppedRecords, 1);
+        return 0;
+    }
+    return 1;
+}
+
+int mnLog_getNumDroppedRecords(mnLog* log)
+{
+    return mnAtomicLoad(&log->numDroppedRecords);
+}
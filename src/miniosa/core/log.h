@@ -0,0 +1,160 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_LOG_H
+#define MN_LOG_H
+
+/*! \file */ 
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "mpsc_queue.h"
+#include "realtime.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The maximum number of arguments of a log record, counting \c * widths and precisions. */
+    #define MN_LOG_MAX_ARGUMENTS 6
+    
+    /**
+     * Log options.
+     */
+    typedef struct mnLogOptions
+    {
+        /** The number of records the queue holds. Rounded up to a power of two. */
+        int capacity;
+        /** The file to append the messages to, or NULL for stderr. */
+        const char* path;
+        /** How often the log thread formats the queued records. */
+        int flushIntervalMilliseconds;
+        /** The scheduling of the log thread. */
+        mnThreadOptions threadOptions;
+    } mnLogOptions;
+    
+    /**
+     * An argument of a log record, in the widest type of its kind.
+     */
+    typedef union mnLogArgument
+    {
+        long long integer;
+        double real;
+        const void* pointer;
+    } mnLogArgument;
+    
+    /**
+     * A message waiting to be formatted.
+     */
+    typedef struct mnLogRecord
+    {
+        /** A printf style format string that stays valid, such as a literal. */
+        const char* format;
+        double sampleTime;
+        /** The number of arguments, or -1 if the format isn't supported. */
+        int numArguments;
+        mnLogArgument arguments[MN_LOG_MAX_ARGUMENTS];
+    } mnLogRecord;
+    
+    /**
+     * A log that real time threads can write to without blocking.
+     *
+     * Writing only walks the format string to pick up the arguments in binary
+     * form, and pushes a fixed size record holding them, the format string
+     * pointer and a timestamp to a lock free multiple producer queue. Nothing
+     * is allocated, formatted or locked, so the audio thread, the engine's
+     * render thread and graph workers may all write to the same log. A log
+     * thread formats the queued records with \c snprintf every
+     * \c flushIntervalMilliseconds and writes them out. Records that don't
+     * fit in the queue are dropped, counted and reported in the output.
+     *
+     * Format strings support the printf conversions of integers, doubles,
+     * characters and pointers, with flags, widths and precisions. Strings
+     * are passed by pointer, so \c %s arguments must stay valid until the
+     * record is written out, as literals do. <tt>long double</tt> and \c %n
+     * are not supported.
+     */
+    typedef struct mnLog
+    {
+        mnLogOptions options;
+        /** Holds mnLogRecord elements. */
+        mnMPSCQueue queue;
+        FILE* file;
+        pthread_t thread;
+        /** Only accessed through atomic operations. Cleared to make the log thread finish. */
+        int isRunning;
+        /** Only accessed through atomic operations. */
+        int numDroppedRecords;
+        /** The number of dropped records reported so far. Only accessed by the log thread. */
+        int numReportedDrops;
+    } mnLog;
+    
+    /**
+     * Fills in the default options: 1024 records, stderr and a flush every 10 ms.
+     */
+    void mnLogOptions_setDefaults(mnLogOptions* options);
+    
+    /**
+     * Opens the output and starts the log thread.
+     * @return 0 if the options are invalid, the file could not be opened or
+     * the thread could not be created.
+     */
+    int mnLog_start(mnLog* log, const mnLogOptions* options);
+    
+    /**
+     * Writes out the records left in the queue, stops the log thread and
+     * closes the output. Not to be called while other threads may write to
+     * the log.
+     */
+    void mnLog_stop(mnLog* log);
+    
+    /**
+     * Queues a printf style message. Lock free and allocation free, so it may
+     * be called from the audio thread and from any number of threads at once.
+     * @param sampleTime The time the message is stamped with, typically the
+     * sample time of the buffer being processed.
+     * @param format A format string that stays valid, such as a literal.
+     * @return 1 if the message was queued, 0 if it was dropped because the
+     * queue was full.
+     */
+    int mnLog_write(mnLog* log, double sampleTime, const char* format, ...);
+    
+    /**
+     * Like ::mnLog_write, with the arguments in a \c va_list.
+     */
+    int mnLog_writeV(mnLog* log, double sampleTime, const char* format, va_list arguments);
+    
+    /**
+     * Returns the number of records dropped because the queue was full.
+     */
+    int mnLog_getNumDroppedRecords(mnLog* log);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_LOG_H
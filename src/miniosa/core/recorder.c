@@ -0,0 +1,466 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for pwrite, posix_memalign and nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "recorder.h"
+
+/** The byte alignment of the write buffer. */
+#define WRITE_BUFFER_ALIGNMENT 4096
+
+static const char* fileExtensions[] =
+{
+    "wav",
+    "caf"
+};
+
+void mnRecorderOptions_setDefaults(mnRecorderOptions* options)
+{
+    memset(options, 0, sizeof(mnRecorderOptions));
+    options->fileType = MN_AUDIO_FILE_WAV;
+    options->sampleFormat = MN_SAMPLE_FORMAT_INT24;
+    options->useDither = 1;
+    options->numChannels = 1;
+    options->sampleRate = 44100;
+    options->bufferSizeInFrames = 2 * 44100;
+    mnThreadOptions_setDefaults(&options->threadOptions);
+}
+
+/* Headers */
+
+static void put16LE(unsigned char* p, unsigned int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void put32LE(unsigned char* p, unsigned int value)
+{
+    put16LE(p, value & 0xffff);
+    put16LE(p + 2, value >> 16);
+}
+
+static void put32BE(unsigned char* p, unsigned int value)
+{
+    p[0] = (value >> 24) & 0xff;
+    p[1] = (value >> 16) & 0xff;
+    p[2] = (value >> 8) & 0xff;
+    p[3] = value & 0xff;
+}
+
+static void put64BE(unsigned char* p, unsigned long long value)
+{
+    put32BE(p, (unsigned int)(value >> 32));
+    put32BE(p + 4, (unsigned int)value);
+}
+
+static int getHeaderSize(mnAudioFileType fileType)
+{
+    //WAV: RIFF header, fmt chunk and data chunk header.
+    //CAF: file header, desc chunk and data chunk header with edit count.
+    return fileType == MN_AUDIO_FILE_CAF ? 68 : 44;
+}
+
+static int getFrameSize(const mnRecorderOptions* options)
+{
+    return options->numChannels * mnSampleFormat_getBytesPerSample(options->sampleFormat);
+}
+
+/**
+ * Fills in the header of a file holding \c numFrames frames.
+ */
+static void makeHeader(const mnRecorderOptions* options, unsigned char* header, long long numFrames)
+{
+    const int isFloat = options->sampleFormat == MN_SAMPLE_FORMAT_FLOAT32;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(options->sampleFormat);
+    const int frameSize = getFrameSize(options);
+    const long long numDataBytes = numFrames * frameSize;
+    
+    if (options->fileType == MN_AUDIO_FILE_CAF)
+    {
+        memcpy(header, "caff", 4);
+        //version 1, no flags
+        put32BE(header + 4, 0x00010000);
+        
+        memcpy(header + 8, "desc", 4);
+        put64BE(header + 12, 32);
+        double sampleRate = options->sampleRate;
+        unsigned long long sampleRateBits;
+        memcpy(&sampleRateBits, &sampleRate, sizeof(sampleRateBits));
+        put64BE(header + 20, sampleRateBits);
+        memcpy(header + 28, "lpcm", 4);
+        //the samples are little endian, floats or signed integers
+        put32BE(header + 32, (isFloat ? 1 : 0) | 2);
+        put32BE(header + 36, frameSize);
+        put32BE(header + 40, 1);
+        put32BE(header + 44, options->numChannels);
+        put32BE(header + 48, 8 * bytesPerSample);
+        
+        memcpy(header + 52, "data", 4);
+        put64BE(header + 56, 4 + numDataBytes);
+        put32BE(header + 64, 0);
+    }
+    else
+    {
+        memcpy(header, "RIFF", 4);
+        put32LE(header + 4, (unsigned int)(36 + numDataBytes));
+        memcpy(header + 8, "WAVE", 4);
+        
+        memcpy(header + 12, "fmt ", 4);
+        put32LE(header + 16, 16);
+        put16LE(header + 20, isFloat ? 3 : 1);
+        put16LE(header + 22, options->numChannels);
+        put32LE(header + 24, (unsigned int)options->sampleRate);
+        put32LE(header + 28, (unsigned int)options->sampleRate * frameSize);
+        put16LE(header + 32, frameSize);
+        put16LE(header + 34, 8 * bytesPerSample);
+        
+        memcpy(header + 36, "data", 4);
+        put32LE(header + 40, (unsigned int)numDataBytes);
+    }
+}
+
+/* Writer thread */
+
+static void sleepFor(double seconds)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+static int openFile(mnRecorder* recorder)
+{
+    const char* extension = fileExtensions[recorder->options.fileType];
+    if (recorder->options.maxFramesPerFile > 0)
+    {
+        snprintf(recorder->filePath, recorder->filePathSize, "%s-%03d.%s", recorder->options.path, recorder->fileIndex, extension);
+    }
+    else
+    {
+        snprintf(recorder->filePath, recorder->filePathSize, "%s.%s", recorder->options.path, extension);
+    }
+    
+    recorder->file = open(recorder->filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (recorder->file < 0)
+    {
+        mnAtomicAdd(&recorder->numWriteErrors, 1);
+        return 0;
+    }
+    
+    //the header goes into the first block, so blocks stay at multiples of the block size
+    makeHeader(&recorder->options, recorder->writeBuffer, 0);
+    recorder->numBytesBuffered = getHeaderSize(recorder->options.fileType);
+    recorder->fileOffset = 0;
+    recorder->numFramesInFile = 0;
+    recorder->fileIndex++;
+    mnAtomicAdd(&recorder->numFiles, 1);
+    return 1;
+}
+
+/**
+ * Writes the first \c numBytes buffered bytes and moves the rest to the front.
+ */
+static void writeBuffered(mnRecorder* recorder, int numBytes)
+{
+    if (pwrite(recorder->file, recorder->writeBuffer, numBytes, recorder->fileOffset) != numBytes)
+    {
+        mnAtomicAdd(&recorder->numWriteErrors, 1);
+    }
+    
+    recorder->fileOffset += numBytes;
+    recorder->numBytesBuffered -= numBytes;
+    memmove(recorder->writeBuffer, recorder->writeBuffer + numBytes, recorder->numBytesBuffered);
+}
+
+static void closeFile(mnRecorder* recorder)
+{
+    if (recorder->numBytesBuffered > 0)
+    {
+        writeBuffered(recorder, recorder->numBytesBuffered);
+    }
+    
+    unsigned char header[68];
+    makeHeader(&recorder->options, header, recorder->numFramesInFile);
+    const int headerSize = getHeaderSize(recorder->options.fileType);
+    if (pwrite(recorder->file, header, headerSize, 0) != headerSize)
+    {
+        mnAtomicAdd(&recorder->numWriteErrors, 1);
+    }
+    
+    close(recorder->file);
+    recorder->file = -1;
+    recorder->numFramesInFile = 0;
+}
+
+/**
+ * Moves everything in the ring to the write buffer, writing full blocks and
+ * rotating files as needed.
+ * @return The number of frames taken from the ring.
+ */
+static int drain(mnRecorder* recorder)
+{
+    const int numChannels = recorder->options.numChannels;
+    const int frameSize = getFrameSize(&recorder->options);
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(recorder->options.sampleFormat);
+    mnDither* dither = recorder->options.useDither ? &recorder->dither : NULL;
+    
+    int numDrained = 0;
+    while (1)
+    {
+        //fill the buffer up to at least a block, which may take a partial frame past it
+        long long numFrames = (MN_RECORDER_WRITE_SIZE - recorder->numBytesBuffered + frameSize - 1) / frameSize;
+        if (recorder->maxFramesPerFile > 0 && numFrames > recorder->maxFramesPerFile - recorder->numFramesInFile)
+        {
+            numFrames = recorder->maxFramesPerFile - recorder->numFramesInFile;
+        }
+        
+        mnFIFOSpans spans;
+        const int numSamples = mnFIFO_peekRead(&recorder->ring, (int)numFrames * numChannels, &spans) / numChannels * numChannels;
+        if (numSamples == 0)
+        {
+            return numDrained;
+        }
+        
+        if (recorder->file < 0 && !openFile(recorder))
+        {
+            //nowhere to write to. keep the ring moving anyway.
+            mnFIFO_consumeRead(&recorder->ring, numSamples);
+            numDrained += numSamples / numChannels;
+            continue;
+        }
+        
+        unsigned char* target = recorder->writeBuffer + recorder->numBytesBuffered;
+        int remaining = numSamples;
+        for (int s = 0; s < 2 && remaining > 0; s++)
+        {
+            const int n = spans.numElements[s] < remaining ? spans.numElements[s] : remaining;
+            mnConvertFromFloat((const float*)spans.elements[s], target, recorder->options.sampleFormat, n, dither);
+            target += n * bytesPerSample;
+            remaining -= n;
+        }
+        mnFIFO_consumeRead(&recorder->ring, numSamples);
+        
+        const int numFramesConverted = numSamples / numChannels;
+        recorder->numBytesBuffered += numFramesConverted * frameSize;
+        recorder->numFramesInFile += numFramesConverted;
+        recorder->numFramesWritten += numFramesConverted;
+        numDrained += numFramesConverted;
+        
+        if (recorder->numBytesBuffered >= MN_RECORDER_WRITE_SIZE)
+        {
+            writeBuffered(recorder, MN_RECORDER_WRITE_SIZE);
+        }
+        
+        if (recorder->numFramesInFile == recorder->maxFramesPerFile)
+        {
+            //the next file is opened when there is something to write to it
+            closeFile(recorder);
+        }
+    }
+}
+
+static void* writerThreadEntryPoint(void* data)
+{
+    mnRecorder* recorder = (mnRecorder*)data;
+    
+    while (1)
+    {
+        //the audio thread is done writing once this is cleared, so one more
+        //pass empties the ring
+        const int isRunning = mnAtomicLoadAcquire(&recorder->isRunning);
+        const int numDrained = drain(recorder);
+        if (!isRunning)
+        {
+            break;
+        }
+        
+        if (numDrained == 0)
+        {
+            sleepFor(recorder->pollInterval);
+        }
+    }
+    
+    if (recorder->file >= 0)
+    {
+        closeFile(recorder);
+    }
+    
+    return NULL;
+}
+
+/* Recorder */
+
+int mnRecorder_start(mnRecorder* recorder, const mnRecorderOptions* options)
+{
+    memset(recorder, 0, sizeof(mnRecorder));
+    memcpy(&recorder->options, options, sizeof(mnRecorderOptions));
+    if (recorder->options.bufferSizeInFrames < 1)
+    {
+        recorder->options.bufferSizeInFrames = (int)(2 * options->sampleRate);
+    }
+    recorder->file = -1;
+    if (options->numChannels < 1 || recorder->options.bufferSizeInFrames > INT_MAX / options->numChannels)
+    {
+        memset(recorder, 0, sizeof(mnRecorder));
+        return 0;
+    }
+    
+    //WAV sizes are 32 bit
+    const int frameSize = getFrameSize(options);
+    recorder->maxFramesPerFile = options->maxFramesPerFile;
+    if (options->fileType == MN_AUDIO_FILE_WAV)
+    {
+        const long long maxWAVFrames = (0xffffffffLL - getHeaderSize(MN_AUDIO_FILE_WAV)) / frameSize;
+        if (recorder->maxFramesPerFile <= 0 || recorder->maxFramesPerFile > maxWAVFrames)
+        {
+            recorder->maxFramesPerFile = maxWAVFrames;
+        }
+    }
+    
+    //the ring's storage is locked, zeroed and touched, so the audio thread
+    //doesn't fault its pages in
+    const int numSamples = recorder->options.bufferSizeInFrames * options->numChannels;
+    const int isRingAllocated = mnFIFO_init(&recorder->ring, numSamples, sizeof(float));
+    
+    recorder->filePathSize = (int)strlen(options->path) + 32;
+    recorder->filePath = malloc(recorder->filePathSize);
+    if (posix_memalign((void**)&recorder->writeBuffer, WRITE_BUFFER_ALIGNMENT, 2 * MN_RECORDER_WRITE_SIZE) != 0)
+    {
+        recorder->writeBuffer = NULL;
+    }
+    mnDither_init(&recorder->dither, 1);
+    
+    if (!isRingAllocated || !recorder->filePath || !recorder->writeBuffer || !openFile(recorder))
+    {
+        mnFIFO_deinit(&recorder->ring);
+        free(recorder->filePath);
+        free(recorder->writeBuffer);
+        memset(recorder, 0, sizeof(mnRecorder));
+        return 0;
+    }
+    
+    //poll a few times per ring length
+    recorder->pollInterval = 0.25 * recorder->options.bufferSizeInFrames / options->sampleRate;
+    if (recorder->pollInterval > 0.05)
+    {
+        recorder->pollInterval = 0.05;
+    }
+    else if (recorder->pollInterval < 0.001)
+    {
+        recorder->pollInterval = 0.001;
+    }
+    
+    mnAtomicStoreRelease(1, &recorder->isRunning);
+    if (!mnThread_create(&recorder->thread, &recorder->options.threadOptions, writerThreadEntryPoint, recorder))
+    {
+        closeFile(recorder);
+        mnFIFO_deinit(&recorder->ring);
+        free(recorder->filePath);
+        free(recorder->writeBuffer);
+        memset(recorder, 0, sizeof(mnRecorder));
+        return 0;
+    }
+    
+    return 1;
+}
+
+void mnRecorder_stop(mnRecorder* recorder)
+{
+    if (!mnAtomicLoadAcquire(&recorder->isRunning))
+    {
+        return;
+    }
+    
+    mnAtomicStoreRelease(0, &recorder->isRunning);
+    pthread_join(recorder->thread, NULL);
+    
+    mnFIFO_deinit(&recorder->ring);
+    free(recorder->filePath);
+    recorder->filePath = NULL;
+    free(recorder->writeBuffer);
+    recorder->writeBuffer = NULL;
+}
+
+int mnRecorder_write(mnRecorder* recorder, const void* samples, mnSampleFormat format, int numFrames)
+{
+    const int numChannels = recorder->options.numChannels;
+    const int bytesPerSample = mnSampleFormat_getBytesPerSample(format);
+    
+    //only whole frames are queued, so the writer never sees a partial frame
+    mnFIFOSpans spans;
+    const int numQueued = mnFIFO_reserveWrite(&recorder->ring, numFrames * numChannels, &spans) / numChannels;
+    
+    const unsigned char* source = (const unsigned char*)samples;
+    int remaining = numQueued * numChannels;
+    for (int s = 0; s < 2 && remaining > 0; s++)
+    {
+        const int n = spans.numElements[s] < remaining ? spans.numElements[s] : remaining;
+        mnConvertToFloat(source, format, (float*)spans.elements[s], n);
+        source += n * bytesPerSample;
+        remaining -= n;
+    }
+    mnFIFO_commitWrite(&recorder->ring, numQueued * numChannels);
+    
+    if (numQueued < numFrames)
+    {
+        mnAtomicAdd(&recorder->numDroppedFrames, numFrames - numQueued);
+        mnAtomicAdd(&recorder->numOverflows, 1);
+    }
+    
+    return numQueued;
+}
+
+int mnRecorder_getNumDroppedFrames(mnRecorder* recorder)
+{
+    return mnAtomicLoad(&recorder->numDroppedFrames);
+}
+
+int mnRecorder_getNumOverflows(mnRecorder* recorder)
+{
+    return mnAtomicLoad(&recorder->numOverflows);
+}
+
+int mnRecorder_getNumWriteErrors(mnRecorder* recorder)
+{
+    return mnAtomicLoad(&recorder->numWriteErrors);
+}
+
+int mnRecorder_getNumFiles(mnRecorder* recorder)
+{
+    return mnAtomicLoad(&recorder->numFiles);
+}
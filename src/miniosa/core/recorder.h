@@ -0,0 +1,191 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef MN_RECORDER_H
+#define MN_RECORDER_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "fifo.h"
+#include "realtime.h"
+#include "sample_format.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * The size in bytes of the blocks the recorder writes to disk.
+     */
+    #define MN_RECORDER_WRITE_SIZE (256 * 1024)
+    
+    /**
+     * Audio file containers.
+     */
+    typedef enum
+    {
+        /** RIFF WAVE, limited to 4 GB per file. */
+        MN_AUDIO_FILE_WAV = 0,
+        /** Core Audio Format. */
+        MN_AUDIO_FILE_CAF
+    } mnAudioFileType;
+    
+    /**
+     * Recorder options.
+     */
+    typedef struct mnRecorderOptions
+    {
+        /**
+         * The path of the file to record to, without an extension. With file
+         * rotation, a running number is appended to it, as in "take-002.wav".
+         */
+        const char* path;
+        mnAudioFileType fileType;
+        /** The sample format of the file. */
+        mnSampleFormat sampleFormat;
+        /** Non-zero to dither samples converted to 16 or 24 bits. */
+        int useDither;
+        int numChannels;
+        float sampleRate;
+        /** The number of frames the ring between the audio thread and the writer thread holds. */
+        int bufferSizeInFrames;
+        /**
+         * The number of frames after which the recording continues in a new
+         * file, or 0 for a single file. WAV files are rotated before they reach
+         * 4 GB regardless.
+         */
+        long long maxFramesPerFile;
+        /** The scheduling of the writer thread. */
+        mnThreadOptions threadOptions;
+    } mnRecorderOptions;
+    
+    /**
+     * Records interleaved samples from the audio thread to disk.
+     *
+     * The audio thread pushes samples into a single producer, single consumer
+     * ring with ::mnRecorder_write, which only converts them to floats and
+     * copies them into the ring. It never allocates, locks or makes system
+     * calls, not even to wake the writer. A writer thread instead polls the
+     * ring a few times per ring length, converts the samples to the file's
+     * format and writes them in blocks of ::MN_RECORDER_WRITE_SIZE bytes, at
+     * offsets that are multiples of the block size. Headers are written with
+     * placeholder sizes and patched when a file is closed.
+     *
+     * If the writer falls behind and the ring fills up, the frames that don't
+     * fit are dropped and counted.
+     */
+    typedef struct mnRecorder
+    {
+        mnRecorderOptions options;
+        /** Interleaved float samples. */
+        mnFIFO ring;
+        pthread_t thread;
+        /** How long the writer thread sleeps when the ring is empty. */
+        double pollInterval;
+        /** Only accessed through atomic operations. Cleared to make the writer thread finish. */
+        int isRunning;
+        
+        /** The fields below are only accessed by the writer thread while recording. */
+        char* filePath;
+        int filePathSize;
+        int file;
+        int fileIndex;
+        long long numFramesInFile;
+        long long maxFramesPerFile;
+        /** The total number of frames written. */
+        long long numFramesWritten;
+        /** A block aligned to the page size. */
+        unsigned char* writeBuffer;
+        int numBytesBuffered;
+        /** The offset in the current file of the first buffered byte. */
+        long long fileOffset;
+        mnDither dither;
+        
+        /** Only accessed through atomic operations. */
+        int numDroppedFrames;
+        /** The number of writes that dropped frames. Only accessed through atomic operations. */
+        int numOverflows;
+        /** The number of failed file operations. Only accessed through atomic operations. */
+        int numWriteErrors;
+        /** The number of files created. Only accessed through atomic operations. */
+        int numFiles;
+    } mnRecorder;
+    
+    /**
+     * Fills in the default options: a mono 44100 Hz 24 bit WAV file with
+     * dither, a two second ring and no rotation.
+     */
+    void mnRecorderOptions_setDefaults(mnRecorderOptions* options);
+    
+    /**
+     * Creates the first file and starts the writer thread.
+     * @return 0 if the options are invalid, allocation failed or the file
+     * could not be created.
+     */
+    int mnRecorder_start(mnRecorder* recorder, const mnRecorderOptions* options);
+    
+    /**
+     * Waits for the writer thread to write what is left in the ring, then
+     * finishes the file and releases the recorder's resources. Not to be
+     * called while the audio thread may call ::mnRecorder_write.
+     */
+    void mnRecorder_stop(mnRecorder* recorder);
+    
+    /**
+     * Queues frames for writing. Called from the audio thread only. Frames
+     * that don't fit in the ring are dropped.
+     * @param samples \c numFrames interleaved frames of \c numChannels samples.
+     * @param format The format of \c samples.
+     * @return The number of frames queued.
+     */
+    int mnRecorder_write(mnRecorder* recorder, const void* samples, mnSampleFormat format, int numFrames);
+    
+    /**
+     * Returns the number of frames dropped because the ring was full. The
+     * counters remain valid after ::mnRecorder_stop.
+     */
+    int mnRecorder_getNumDroppedFrames(mnRecorder* recorder);
+    
+    /**
+     *
+     */
+    int mnRecorder_getNumOverflows(mnRecorder* recorder);
+    
+    /**
+     *
+     */
+    int mnRecorder_getNumWriteErrors(mnRecorder* recorder);
+    
+    /**
+     *
+     */
+    int mnRecorder_getNumFiles(mnRecorder* recorder);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_RECORDER_H
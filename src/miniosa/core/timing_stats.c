@@ -0,0 +1,177 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "atomic.h"
+#include "timing_stats.h"
+
+void mnTimingStats_init(mnTimingStats* stats)
+{
+    memset(stats, 0, sizeof(mnTimingStats));
+}
+
+void mnTimingStats_restart(mnTimingStats* stats)
+{
+    stats->hasExpectedSampleTime = 0;
+}
+
+/**
+ * Increments a counter that only the calling thread writes to.
+ */
+static inline void increment(int* counter)
+{
+    mnAtomicStoreRelaxed(mnAtomicLoadRelaxed(counter) + 1, counter);
+}
+
+int mnTimingStats_record(mnTimingStats* stats,
+                         double duration,
+                         int numFrames,
+                         float sampleRate,
+                         double sampleTime)
+{
+    //work out what to record before entering the write section
+    const double load = numFrames > 0 ? duration * sampleRate / numFrames : 0.0;
+    int bin = (int)(load * MN_TIMING_LOAD_BINS_PER_PERIOD);
+    if (bin < 0)
+    {
+        bin = 0;
+    }
+    else if (bin >= MN_TIMING_NUM_LOAD_BINS)
+    {
+        bin = MN_TIMING_NUM_LOAD_BINS - 1;
+    }
+    
+    int missedDeadline = 0;
+    if (sampleTime >= 0.0)
+    {
+        //compare with half a frame of slack, since sample times may not be whole numbers
+        missedDeadline = stats->hasExpectedSampleTime && sampleTime > stats->expectedSampleTime + 0.5;
+        stats->expectedSampleTime = sampleTime + numFrames;
+        stats->hasExpectedSampleTime = 1;
+    }
+    
+    const int durationMicroseconds = (int)(1e6 * duration);
+    
+    //an odd sequence number tells readers that the counters are being updated
+    const int sequence = mnAtomicLoadRelaxed(&stats->sequence);
+    mnAtomicStoreRelaxed(sequence + 1, &stats->sequence);
+    mnAtomicFenceRelease();
+    
+    increment(&stats->counters.numCallbacks);
+    increment(&stats->counters.loadHistogram[bin]);
+    if (missedDeadline)
+    {
+        increment(&stats->counters.numMissedDeadlines);
+    }
+    if (mnAtomicLoadRelaxed(&stats->numPendingUnderruns) > 0)
+    {
+        //underruns may be added by other threads at any time, so take them in one go
+        const int numPendingUnderruns = mnAtomicExchange(0, &stats->numPendingUnderruns);
+        mnAtomicStoreRelaxed(mnAtomicLoadRelaxed(&stats->counters.numUnderruns) + numPendingUnderruns,
+                             &stats->counters.numUnderruns);
+    }
+    if (durationMicroseconds > mnAtomicLoadRelaxed(&stats->counters.maxDurationMicroseconds))
+    {
+        mnAtomicStoreRelaxed(durationMicroseconds, &stats->counters.maxDurationMicroseconds);
+    }
+    
+    mnAtomicStoreRelease(sequence + 2, &stats->sequence);
+    return missedDeadline;
+}
+
+void mnTimingStats_addUnderrun(mnTimingStats* stats)
+{
+    mnAtomicAdd(&stats->numPendingUnderruns, 1);
+}
+
+void mnTimingStats_getSnapshot(mnTimingStats* stats, mnTimingSnapshot* snapshot)
+{
+    while (1)
+    {
+        const int sequenceBefore = mnAtomicLoadAcquire(&stats->sequence);
+        if (sequenceBefore & 1)
+        {
+            //the audio thread is in the middle of a write
+            continue;
+        }
+        
+        snapshot->numCallbacks = mnAtomicLoadRelaxed(&stats->counters.numCallbacks);
+        snapshot->numMissedDeadlines = mnAtomicLoadRelaxed(&stats->counters.numMissedDeadlines);
+        snapshot->maxDurationMicroseconds = mnAtomicLoadRelaxed(&stats->counters.maxDurationMicroseconds);
+        snapshot->numUnderruns = mnAtomicLoadRelaxed(&stats->counters.numUnderruns);
+        for (int i = 0; i < MN_TIMING_NUM_LOAD_BINS; i++)
+        {
+            snapshot->loadHistogram[i] = mnAtomicLoadRelaxed(&stats->counters.loadHistogram[i]);
+        }
+        
+        mnAtomicFenceAcquire();
+        if (mnAtomicLoadRelaxed(&stats->sequence) == sequenceBefore)
+        {
+            return;
+        }
+    }
+}
+
+void mnTimingSnapshot_getInterval(const mnTimingSnapshot* newer,
+                                  const mnTimingSnapshot* older,
+                                  mnTimingSnapshot* interval)
+{
+    interval->numCallbacks = newer->numCallbacks - older->numCallbacks;
+    interval->numMissedDeadlines = newer->numMissedDeadlines - older->numMissedDeadlines;
+    interval->maxDurationMicroseconds = newer->maxDurationMicroseconds;
+    interval->numUnderruns = newer->numUnderruns - older->numUnderruns;
+    for (int i = 0; i < MN_TIMING_NUM_LOAD_BINS; i++)
+    {
+        interval->loadHistogram[i] = newer->loadHistogram[i] - older->loadHistogram[i];
+    }
+}
+
+float mnTimingSnapshot_getLoadPercentile(const mnTimingSnapshot* snapshot, float percentile)
+{
+    int total = 0;
+    for (int i = 0; i < MN_TIMING_NUM_LOAD_BINS; i++)
+    {
+        total += snapshot->loadHistogram[i];
+    }
+    
+    if (total == 0)
+    {
+        return 0.0f;
+    }
+    
+    //the smallest number of callbacks that covers the percentile
+    const double threshold = 0.01 * percentile * total;
+    int count = 0;
+    for (int i = 0; i < MN_TIMING_NUM_LOAD_BINS; i++)
+    {
+        count += snapshot->loadHistogram[i];
+        if (count >= threshold && count > 0)
+        {
+            return (float)(i + 1) / MN_TIMING_LOAD_BINS_PER_PERIOD;
+        }
+    }
+    
+    return (float)MN_TIMING_NUM_LOAD_BINS / MN_TIMING_LOAD_BINS_PER_PERIOD;
+}
@@ -0,0 +1,147 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_TIMING_STATS_H
+#define MN_TIMING_STATS_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The number of load histogram bins per 100% of the buffer period. */
+    #define MN_TIMING_LOAD_BINS_PER_PERIOD 64
+    
+    /**
+     * The number of load histogram bins. The last bin counts all callbacks
+     * taking twice the buffer period or longer.
+     */
+    #define MN_TIMING_NUM_LOAD_BINS (2 * MN_TIMING_LOAD_BINS_PER_PERIOD + 1)
+    
+    /**
+     * Callback timing statistics, accumulated since the engine was created.
+     */
+    typedef struct mnTimingSnapshot
+    {
+        /** The number of audio callbacks. */
+        int numCallbacks;
+        /** The number of callbacks that did not follow the previous one seamlessly. */
+        int numMissedDeadlines;
+        /** The duration in microseconds of the slowest callback. */
+        int maxDurationMicroseconds;
+        /**
+         * The number of times a streaming source ran out of prefetched frames,
+         * or the render thread fell behind the device.
+         */
+        int numUnderruns;
+        /**
+         * Callback counts by load, i.e the time spent in the user callbacks divided
+         * by the buffer period. Bin i counts loads in
+         * [i / MN_TIMING_LOAD_BINS_PER_PERIOD, (i + 1) / MN_TIMING_LOAD_BINS_PER_PERIOD).
+         */
+        int loadHistogram[MN_TIMING_NUM_LOAD_BINS];
+    } mnTimingSnapshot;
+    
+    /**
+     * Lock free callback timing statistics, written by the audio thread and read
+     * by any other thread. Recording never blocks or waits. A sequence counter
+     * lets readers detect and retry snapshots overlapping a write.
+     */
+    typedef struct mnTimingStats
+    {
+        /** Odd while a write is in progress. Only accessed through atomic operations. */
+        int sequence;
+        /** Only accessed through atomic operations. */
+        mnTimingSnapshot counters;
+        /** The sample time expected for the next callback. Only accessed by the audio thread. */
+        double expectedSampleTime;
+        /** Non-zero once \c expectedSampleTime is valid. Only accessed by the audio thread. */
+        int hasExpectedSampleTime;
+        /** Underruns to add to the counters with the next callback. Only accessed through atomic operations. */
+        int numPendingUnderruns;
+    } mnTimingStats;
+    
+    /**
+     * Clears all statistics. Not thread safe.
+     */
+    void mnTimingStats_init(mnTimingStats* stats);
+    
+    /**
+     * Makes the next recorded callback start a new timeline, so that a gap
+     * in sample time after stopping the audio thread is not counted as a
+     * missed deadline. Call when the audio thread is not running.
+     */
+    void mnTimingStats_restart(mnTimingStats* stats);
+    
+    /**
+     * Records a callback. Called from the audio thread only.
+     * @param duration The time in seconds spent in the user callbacks.
+     * @param numFrames The number of frames in the buffer.
+     * @param sampleRate The sample rate in Hz.
+     * @param sampleTime The time in frames of the first frame of the buffer, as
+     * reported by the device. Gaps in sample time are counted as missed deadlines.
+     * Pass a negative value if unknown.
+     * @return 1 if the callback was counted as a missed deadline, 0 otherwise.
+     */
+    int mnTimingStats_record(mnTimingStats* stats,
+                             double duration,
+                             int numFrames,
+                             float sampleRate,
+                             double sampleTime);
+    
+    /**
+     * Counts an underrun of a streaming source, which is added to the counters
+     * when the next callback is recorded. May be called from any thread, for
+     * example the render thread or a graph worker running the output callback.
+     */
+    void mnTimingStats_addUnderrun(mnTimingStats* stats);
+    
+    /**
+     * Takes a consistent snapshot of the statistics. May be called from any thread.
+     */
+    void mnTimingStats_getSnapshot(mnTimingStats* stats, mnTimingSnapshot* snapshot);
+    
+    /**
+     * Computes the statistics of the callbacks between two snapshots, for example
+     * to report the load of the last few seconds. \c maxDurationMicroseconds is
+     * taken from \c newer.
+     */
+    void mnTimingSnapshot_getInterval(const mnTimingSnapshot* newer,
+                                      const mnTimingSnapshot* older,
+                                      mnTimingSnapshot* interval);
+    
+    /**
+     * Returns the load that \c percentile percent of the callbacks stay below,
+     * e.g 99 for the p99 load. The result is the upper edge of a histogram bin,
+     * so 1.0 means 100% of the buffer period. Returns 0 if there are no callbacks.
+     */
+    float mnTimingSnapshot_getLoadPercentile(const mnTimingSnapshot* snapshot, float percentile);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_TIMING_STATS_H
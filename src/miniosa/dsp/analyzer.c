@@ -0,0 +1,419 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for nanosleep
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "analyzer.h"
+#include "dsp_math.h"
+
+/** Correlation peaks at least this close to the highest one count as the period. */
+#define PEAK_THRESHOLD 0.9f
+
+void mnAnalyzerOptions_setDefaults(mnAnalyzerOptions* options)
+{
+    memset(options, 0, sizeof(mnAnalyzerOptions));
+    options->numChannels = 1;
+    options->sampleRate = 44100;
+    options->fftSize = 2048;
+    options->hopSize = 512;
+    options->bufferSizeInFrames = 44100;
+    options->minPitch = 60.0f;
+    options->maxPitch = 1600.0f;
+    mnThreadOptions_setDefaults(&options->threadOptions);
+}
+
+/* Analysis */
+
+/**
+ * Computes the autocorrelation of the windowed signal in \c analyzer->windowed
+ * at lags 0 ... fftSize / 2 into \c analyzer->real, as the transform of its
+ * power spectrum, which is real and symmetric. Leaves the magnitudes of the
+ * signal's bins in \c analyzer->magnitudes.
+ */
+static void autocorrelate(mnAnalyzer* analyzer)
+{
+    const int size = analyzer->options.fftSize;
+    const int numBins = size / 2 + 1;
+    float* real = analyzer->real;
+    float* imag = analyzer->imag;
+    float* power = analyzer->windowed;
+    
+    mnFFT_forwardReal(&analyzer->fft, analyzer->windowed, real, imag);
+    for (int k = 0; k < numBins; k++)
+    {
+        power[k] = real[k] * real[k] + imag[k] * imag[k];
+        analyzer->magnitudes[k] = sqrtf(power[k]);
+    }
+    for (int k = 1; k < numBins - 1; k++)
+    {
+        power[size - k] = power[k];
+    }
+    
+    //the imaginary parts of the transform of a symmetric sequence are zero
+    mnFFT_forwardReal(&analyzer->fft, power, real, imag);
+}
+
+/**
+ * Finds the pitch from the normalized autocorrelation.
+ */
+static void findPitch(mnAnalyzer* analyzer, mnAnalyzerSnapshot* snapshot)
+{
+    const float* correlation = analyzer->real;
+    const float* windowCorrelation = analyzer->windowCorrelation;
+    float* normalized = analyzer->windowed;
+    
+    snapshot->pitch = 0.0f;
+    snapshot->pitchConfidence = 0.0f;
+    if (correlation[0] <= 1e-12f * analyzer->options.fftSize)
+    {
+        return;
+    }
+    
+    const int minLag = analyzer->minLag;
+    const int maxLag = analyzer->maxLag;
+    float highest = 0.0f;
+    for (int lag = minLag - 1; lag <= maxLag + 1; lag++)
+    {
+        normalized[lag] = correlation[lag] / (correlation[0] * windowCorrelation[lag]);
+        if (lag >= minLag && lag <= maxLag && normalized[lag] > highest)
+        {
+            highest = normalized[lag];
+        }
+    }
+    
+    //a period of T correlates almost as well at 2T, 3T ..., so the shortest
+    //lag that comes close wins over the highest peak
+    for (int lag = minLag; lag <= maxLag; lag++)
+    {
+        const float previous = normalized[lag - 1];
+        const float current = normalized[lag];
+        const float next = normalized[lag + 1];
+        if (current >= previous && current >= next && current >= PEAK_THRESHOLD * highest && current > 0.0f)
+        {
+            const float curvature = previous - 2.0f * current + next;
+            const float offset = curvature < 0.0f ? 0.5f * (previous - next) / curvature : 0.0f;
+            snapshot->pitch = analyzer->options.sampleRate / (lag + offset);
+            snapshot->pitchConfidence = current < 1.0f ? current : 1.0f;
+            return;
+        }
+    }
+}
+
+static void analyzeHop(mnAnalyzer* analyzer)
+{
+    const int size = analyzer->options.fftSize;
+    const int hopSize = analyzer->options.hopSize;
+    const int numBins = size / 2 + 1;
+    float* history = analyzer->history;
+    
+    memmove(history, history + hopSize, (size - hopSize) * sizeof(float));
+    mnFIFO_popN(&analyzer->ring, history + size - hopSize, hopSize);
+    analyzer->position += hopSize;
+    
+    float sumOfSquares = 0.0f;
+    for (int i = 0; i < size; i++)
+    {
+        sumOfSquares += history[i] * history[i];
+        analyzer->windowed[i] = history[i] * analyzer->window[i];
+    }
+    autocorrelate(analyzer);
+    
+    mnAnalyzerSnapshot* snapshot = (mnAnalyzerSnapshot*)mnTripleBuffer_getWriteBuffer(&analyzer->snapshots);
+    float* magnitudes = (float*)(snapshot + 1);
+    //a sine of amplitude a centered on a bin has a magnitude of a / 2 times the sum of the window
+    const float scale = 4.0f / size;
+    for (int k = 0; k < numBins; k++)
+    {
+        magnitudes[k] = scale * analyzer->magnitudes[k];
+    }
+    
+    snapshot->position = analyzer->position;
+    snapshot->numBins = numBins;
+    snapshot->binWidth = analyzer->options.sampleRate / size;
+    snapshot->magnitudes = magnitudes;
+    snapshot->level = sqrtf(sumOfSquares / size);
+    findPitch(analyzer, snapshot);
+    
+    mnTripleBuffer_publish(&analyzer->snapshots);
+    mnAtomicAdd(&analyzer->numSnapshots, 1);
+}
+
+static void sleepFor(double seconds)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)seconds;
+    t.tv_nsec = (long)(1e9 * (seconds - (double)t.tv_sec));
+    nanosleep(&t, NULL);
+}
+
+static void* workerThreadEntryPoint(void* data)
+{
+    mnAnalyzer* analyzer = (mnAnalyzer*)data;
+    //the windows of a signal fading out would otherwise end in denormals
+    mnFloatState_enterFlushToZero();
+    
+    while (1)
+    {
+        //the audio thread is done writing once this is cleared, so one more
+        //pass empties the ring
+        const int isRunning = mnAtomicLoadAcquire(&analyzer->isRunning);
+        int numHops = 0;
+        while (mnFIFO_getNumElements(&analyzer->ring) >= analyzer->options.hopSize)
+        {
+            analyzeHop(analyzer);
+            numHops++;
+        }
+        if (!isRunning)
+        {
+            break;
+        }
+        
+        if (numHops == 0)
+        {
+            sleepFor(analyzer->pollInterval);
+        }
+    }
+    
+    return NULL;
+}
+
+/* Analyzer */
+
+static void releaseBuffers(mnAnalyzer* analyzer)
+{
+    mnFIFO_deinit(&analyzer->ring);
+    mnFFT_deinit(&analyzer->fft);
+    mnTripleBuffer_deinit(&analyzer->snapshots);
+    free(analyzer->window);
+    analyzer->window = NULL;
+    free(analyzer->windowCorrelation);
+    analyzer->windowCorrelation = NULL;
+    free(analyzer->history);
+    analyzer->history = NULL;
+    free(analyzer->windowed);
+    analyzer->windowed = NULL;
+    free(analyzer->real);
+    analyzer->real = NULL;
+    free(analyzer->imag);
+    analyzer->imag = NULL;
+    free(analyzer->magnitudes);
+    analyzer->magnitudes = NULL;
+}
+
+int mnAnalyzer_start(mnAnalyzer* analyzer, const mnAnalyzerOptions* options)
+{
+    memset(analyzer, 0, sizeof(mnAnalyzer));
+    memcpy(&analyzer->options, options, sizeof(mnAnalyzerOptions));
+    const int size = options->fftSize;
+    if (options->numChannels < 1 ||
+        options->sampleRate <= 0.0f ||
+        options->hopSize < 1 ||
+        options->hopSize > size ||
+        !mnFFT_init(&analyzer->fft, size))
+    {
+        return 0;
+    }
+    if (analyzer->options.bufferSizeInFrames < 2 * size)
+    {
+        analyzer->options.bufferSizeInFrames = 2 * size;
+    }
+    
+    const int numBins = size / 2 + 1;
+    analyzer->window = malloc(size * sizeof(float));
+    analyzer->windowCorrelation = malloc(numBins * sizeof(float));
+    analyzer->history = calloc(size, sizeof(float));
+    analyzer->windowed = malloc(size * sizeof(float));
+    analyzer->real = malloc(numBins * sizeof(float));
+    analyzer->imag = malloc(numBins * sizeof(float));
+    analyzer->magnitudes = malloc(numBins * sizeof(float));
+    if (!analyzer->window || !analyzer->windowCorrelation || !analyzer->history ||
+        !analyzer->windowed || !analyzer->real || !analyzer->imag || !analyzer->magnitudes)
+    {
+        releaseBuffers(analyzer);
+        memset(analyzer, 0, sizeof(mnAnalyzer));
+        return 0;
+    }
+    
+    //the correlation of a window with itself falls off with the lag, which
+    //would favor short periods unless divided out
+    for (int i = 0; i < size; i++)
+    {
+        analyzer->window[i] = (float)(0.5 - 0.5 * cos(2.0 * MN_PI * i / size));
+    }
+    memcpy(analyzer->windowed, analyzer->window, size * sizeof(float));
+    autocorrelate(analyzer);
+    for (int lag = 0; lag < numBins; lag++)
+    {
+        analyzer->windowCorrelation[lag] = analyzer->real[lag] / analyzer->real[0];
+    }
+    
+    //keep a lag on each side for interpolation
+    const float sampleRate = options->sampleRate;
+    analyzer->minLag = options->maxPitch > 0.0f ? (int)(sampleRate / options->maxPitch) : 2;
+    analyzer->maxLag = options->minPitch > 0.0f ? (int)ceilf(sampleRate / options->minPitch) : size;
+    analyzer->minLag = analyzer->minLag < 2 ? 2 : analyzer->minLag;
+    analyzer->maxLag = analyzer->maxLag > size / 2 - 1 ? size / 2 - 1 : analyzer->maxLag;
+    
+    //the ring's storage is locked, zeroed and touched, so the audio thread
+    //doesn't fault its pages in
+    if (!mnFIFO_init(&analyzer->ring, analyzer->options.bufferSizeInFrames, sizeof(float)) ||
+        !mnTripleBuffer_init(&analyzer->snapshots, sizeof(mnAnalyzerSnapshot) + numBins * sizeof(float), NULL))
+    {
+        releaseBuffers(analyzer);
+        memset(analyzer, 0, sizeof(mnAnalyzer));
+        return 0;
+    }
+    
+    //poll a couple of times per hop
+    analyzer->pollInterval = 0.5 * options->hopSize / sampleRate;
+    if (analyzer->pollInterval > 0.05)
+    {
+        analyzer->pollInterval = 0.05;
+    }
+    else if (analyzer->pollInterval < 0.001)
+    {
+        analyzer->pollInterval = 0.001;
+    }
+    
+    mnAtomicStoreRelease(1, &analyzer->isRunning);
+    if (!mnThread_create(&analyzer->thread, &options->threadOptions, workerThreadEntryPoint, analyzer))
+    {
+        releaseBuffers(analyzer);
+        memset(analyzer, 0, sizeof(mnAnalyzer));
+        return 0;
+    }
+    
+    return 1;
+}
+
+void mnAnalyzer_stop(mnAnalyzer* analyzer)
+{
+    if (!mnAtomicLoadAcquire(&analyzer->isRunning))
+    {
+        return;
+    }
+    
+    mnAtomicStoreRelease(0, &analyzer->isRunning);
+    pthread_join(analyzer->thread, NULL);
+    
+    releaseBuffers(analyzer);
+}
+
+static void countDroppedFrames(mnAnalyzer* analyzer, int numQueued, int numFrames)
+{
+    if (numQueued < numFrames)
+    {
+        mnAtomicAdd(&analyzer->numDroppedFrames, numFrames - numQueued);
+    }
+}
+
+int mnAnalyzer_writeInterleaved(mnAnalyzer* analyzer, const float* samples, int numFrames)
+{
+    const int numChannels = analyzer->options.numChannels;
+    const float gain = 1.0f / numChannels;
+    
+    mnFIFOSpans spans;
+    const int numQueued = mnFIFO_reserveWrite(&analyzer->ring, numFrames, &spans);
+    
+    const float* frame = samples;
+    for (int s = 0; s < 2; s++)
+    {
+        float* mono = (float*)spans.elements[s];
+        for (int i = 0; i < spans.numElements[s]; i++)
+        {
+            float sum = frame[0];
+            for (int c = 1; c < numChannels; c++)
+            {
+                sum += frame[c];
+            }
+            mono[i] = gain * sum;
+            frame += numChannels;
+        }
+    }
+    mnFIFO_commitWrite(&analyzer->ring, numQueued);
+    
+    countDroppedFrames(analyzer, numQueued, numFrames);
+    return numQueued;
+}
+
+int mnAnalyzer_writePlanar(mnAnalyzer* analyzer, const float* const* channels, int numFrames)
+{
+    const int numChannels = analyzer->options.numChannels;
+    const float gain = 1.0f / numChannels;
+    
+    mnFIFOSpans spans;
+    const int numQueued = mnFIFO_reserveWrite(&analyzer->ring, numFrames, &spans);
+    
+    int start = 0;
+    for (int s = 0; s < 2; s++)
+    {
+        float* mono = (float*)spans.elements[s];
+        const int n = spans.numElements[s];
+        for (int i = 0; i < n; i++)
+        {
+            mono[i] = channels[0][start + i];
+        }
+        for (int c = 1; c < numChannels; c++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                mono[i] += channels[c][start + i];
+            }
+        }
+        if (numChannels > 1)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                mono[i] *= gain;
+            }
+        }
+        start += n;
+    }
+    mnFIFO_commitWrite(&analyzer->ring, numQueued);
+    
+    countDroppedFrames(analyzer, numQueued, numFrames);
+    return numQueued;
+}
+
+const mnAnalyzerSnapshot* mnAnalyzer_getSnapshot(mnAnalyzer* analyzer, int* isNew)
+{
+    return (const mnAnalyzerSnapshot*)mnTripleBuffer_read(&analyzer->snapshots, isNew);
+}
+
+int mnAnalyzer_getNumDroppedFrames(mnAnalyzer* analyzer)
+{
+    return mnAtomicLoad(&analyzer->numDroppedFrames);
+}
+
+int mnAnalyzer_getNumSnapshots(mnAnalyzer* analyzer)
+{
+    return mnAtomicLoad(&analyzer->numSnapshots);
+}
@@ -0,0 +1,202 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_ANALYZER_H
+#define MN_ANALYZER_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "fft.h"
+#include "fifo.h"
+#include "realtime.h"
+#include "triple_buffer.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Analyzer options.
+     */
+    typedef struct mnAnalyzerOptions
+    {
+        /** The number of channels written, which are mixed to mono. */
+        int numChannels;
+        float sampleRate;
+        /** The number of samples per analysis window, a power of two of at least 16. */
+        int fftSize;
+        /** The number of samples between the starts of consecutive windows, at most \c fftSize. */
+        int hopSize;
+        /** The number of frames the ring between the audio thread and the worker thread holds. */
+        int bufferSizeInFrames;
+        /** The lowest pitch in Hz to look for. Raised to fit two periods in a window. */
+        float minPitch;
+        /** The highest pitch in Hz to look for. */
+        float maxPitch;
+        /** The scheduling of the worker thread. */
+        mnThreadOptions threadOptions;
+    } mnAnalyzerOptions;
+    
+    /**
+     * The results of analyzing one window.
+     */
+    typedef struct mnAnalyzerSnapshot
+    {
+        /** The number of frames queued up to the end of the window. */
+        long long position;
+        /** The number of magnitudes, \c fftSize / 2 + 1. */
+        int numBins;
+        /** The distance in Hz between the center frequencies of bins. */
+        float binWidth;
+        /** The magnitude of each bin, scaled so that a full scale sine centered on a bin reads 1. */
+        const float* magnitudes;
+        /** The RMS level of the window, before windowing. */
+        float level;
+        /** The estimated pitch in Hz, or 0 if the window is silent. */
+        float pitch;
+        /**
+         * How periodic the window is at \c pitch, from 0 for noise to 1 for a
+         * perfectly periodic signal. Pitches with low confidence are best ignored.
+         */
+        float pitchConfidence;
+    } mnAnalyzerSnapshot;
+    
+    /**
+     * Analyzes the spectrum and pitch of a signal written from the audio thread.
+     *
+     * The audio thread only mixes its frames to mono and copies them into a
+     * single producer, single consumer ring with ::mnAnalyzer_writeInterleaved
+     * or ::mnAnalyzer_writePlanar, without locking or making system calls.
+     * The worker thread polls the ring a couple of times per hop, slides a
+     * Hann window over the signal, one hop at a time, and takes the
+     * vectorized real FFT of each window. The magnitudes give the spectrum. The autocorrelation, computed
+     * by a second FFT of the power spectrum and normalized by that of the
+     * window, gives the pitch: the shortest lag whose correlation peak comes
+     * close to the highest one, refined by parabolic interpolation.
+     *
+     * Each window's results are published through a triple buffer, so one
+     * reader thread, typically the UI, picks up the latest snapshot with
+     * ::mnAnalyzer_getSnapshot without ever blocking the worker. If the worker
+     * falls behind and the ring fills up, the frames that don't fit are
+     * dropped and counted.
+     */
+    typedef struct mnAnalyzer
+    {
+        mnAnalyzerOptions options;
+        /** Mono float samples. */
+        mnFIFO ring;
+        pthread_t thread;
+        /** How long the worker thread sleeps when the ring holds less than a hop. */
+        double pollInterval;
+        /** Only accessed through atomic operations. Cleared to make the worker thread finish. */
+        int isRunning;
+        
+        /** The fields below are only accessed by the worker thread while running. */
+        mnFFT fft;
+        /** The periodic Hann window. */
+        float* window;
+        /** The autocorrelation of the window, normalized to 1 at lag 0. */
+        float* windowCorrelation;
+        /** The last \c fftSize samples. */
+        float* history;
+        /** \c fftSize samples of scratch space. */
+        float* windowed;
+        /** The FFT output, \c fftSize / 2 + 1 bins each. */
+        float* real;
+        float* imag;
+        /** The magnitudes of the last window's bins, unscaled. */
+        float* magnitudes;
+        int minLag;
+        int maxLag;
+        long long position;
+        mnTripleBuffer snapshots;
+        
+        /** Only accessed through atomic operations. */
+        int numDroppedFrames;
+        /** The number of snapshots published. Only accessed through atomic operations. */
+        int numSnapshots;
+    } mnAnalyzer;
+    
+    /**
+     * Fills in the default options: mono 44100 Hz input, 2048 sample windows
+     * with a hop of 512 samples, a one second ring and pitches from 60 to
+     * 1600 Hz.
+     */
+    void mnAnalyzerOptions_setDefaults(mnAnalyzerOptions* options);
+    
+    /**
+     * Allocates the analyzer's buffers and starts the worker thread.
+     * @return 0 if the options are invalid, allocation failed or the thread
+     * could not be created.
+     */
+    int mnAnalyzer_start(mnAnalyzer* analyzer, const mnAnalyzerOptions* options);
+    
+    /**
+     * Analyzes the complete hops left in the ring, stops the worker thread and
+     * releases the analyzer's resources. Not to be called while the audio
+     * thread may write to the analyzer.
+     */
+    void mnAnalyzer_stop(mnAnalyzer* analyzer);
+    
+    /**
+     * Queues interleaved frames for analysis. Called from the audio thread
+     * only. Frames that don't fit in the ring are dropped.
+     * @return The number of frames queued.
+     */
+    int mnAnalyzer_writeInterleaved(mnAnalyzer* analyzer, const float* samples, int numFrames);
+    
+    /**
+     * Queues planar frames for analysis. Called from the audio thread only.
+     * Frames that don't fit in the ring are dropped.
+     * @return The number of frames queued.
+     */
+    int mnAnalyzer_writePlanar(mnAnalyzer* analyzer, const float* const* channels, int numFrames);
+    
+    /**
+     * Returns the results of the most recently analyzed window, which stay
+     * valid and unchanged until the next call or until the analyzer is stopped. Before the first window has
+     * been analyzed, \c numBins is 0. Called from a single reader thread only.
+     * @param isNew If not NULL, receives 1 if a window was analyzed since the
+     * previous call and 0 otherwise.
+     */
+    const mnAnalyzerSnapshot* mnAnalyzer_getSnapshot(mnAnalyzer* analyzer, int* isNew);
+    
+    /**
+     * Returns the number of frames dropped because the ring was full.
+     */
+    int mnAnalyzer_getNumDroppedFrames(mnAnalyzer* analyzer);
+    
+    /**
+     * Returns the number of windows analyzed so far.
+     */
+    int mnAnalyzer_getNumSnapshots(mnAnalyzer* analyzer);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_ANALYZER_H
@@ -0,0 +1,755 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "atomic.h"
+#include "convolver.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+void mnConvolverOptions_setDefaults(mnConvolverOptions* options)
+{
+    memset(options, 0, sizeof(mnConvolverOptions));
+    options->numChannels = 1;
+    options->blockSize = 128;
+    options->tailBlockSize = 0;
+    options->sampleRate = 44100.0f;
+    mnThreadOptions_setDefaults(&options->threadOptions);
+}
+
+/* Kernels */
+
+/*
+ * multiplyAccumulate adds the product of a packed input spectrum x and a
+ * packed partition spectrum h to a packed accumulator. Bin 0 of the result
+ * mixes up the DC and Nyquist bins and is fixed up by the caller.
+ *
+ * convolveHead computes output[i] = bias[i] + sum(head[k] * history[i + k])
+ * for k < blockSize. The vector versions run over i, with one broadcast tap
+ * at a time, so no horizontal sums are needed.
+ */
+
+static void multiplyAccumulateScalar(const float* x, const float* h, float* accumulator, int blockSize)
+{
+    const float* xr = x;
+    const float* xi = x + blockSize;
+    const float* hr = h;
+    const float* hi = h + blockSize;
+    float* ar = accumulator;
+    float* ai = accumulator + blockSize;
+    for (int k = 0; k < blockSize; k++)
+    {
+        ar[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        ai[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+}
+
+static void convolveHeadScalar(const float* head,
+                               const float* history,
+                               const float* bias,
+                               float* output,
+                               int numFrames,
+                               int blockSize)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        float sum = bias[i];
+        for (int k = 0; k < blockSize; k++)
+        {
+            sum += head[k] * history[i + k];
+        }
+        output[i] = sum;
+    }
+}
+
+#if MN_SIMD_X86
+
+static void multiplyAccumulateSSE2(const float* x, const float* h, float* accumulator, int blockSize)
+{
+    const float* xr = x;
+    const float* xi = x + blockSize;
+    const float* hr = h;
+    const float* hi = h + blockSize;
+    float* ar = accumulator;
+    float* ai = accumulator + blockSize;
+    for (int k = 0; k < blockSize; k += 4)
+    {
+        const __m128 a = _mm_load_ps(xr + k);
+        const __m128 b = _mm_load_ps(xi + k);
+        const __m128 c = _mm_load_ps(hr + k);
+        const __m128 d = _mm_load_ps(hi + k);
+        const __m128 real = _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d));
+        const __m128 imag = _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c));
+        _mm_store_ps(ar + k, _mm_add_ps(_mm_load_ps(ar + k), real));
+        _mm_store_ps(ai + k, _mm_add_ps(_mm_load_ps(ai + k), imag));
+    }
+}
+
+static void convolveHeadSSE2(const float* head,
+                             const float* history,
+                             const float* bias,
+                             float* output,
+                             int numFrames,
+                             int blockSize)
+{
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        __m128 sum = _mm_loadu_ps(bias + i);
+        for (int k = 0; k < blockSize; k++)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(head[k]), _mm_loadu_ps(history + i + k)));
+        }
+        _mm_storeu_ps(output + i, sum);
+    }
+    
+    convolveHeadScalar(head, history + i, bias + i, output + i, numFrames - i, blockSize);
+}
+
+MN_TARGET_AVX2
+static void multiplyAccumulateAVX2(const float* x, const float* h, float* accumulator, int blockSize)
+{
+    const float* xr = x;
+    const float* xi = x + blockSize;
+    const float* hr = h;
+    const float* hi = h + blockSize;
+    float* ar = accumulator;
+    float* ai = accumulator + blockSize;
+    for (int k = 0; k < blockSize; k += 8)
+    {
+        const __m256 a = _mm256_load_ps(xr + k);
+        const __m256 b = _mm256_load_ps(xi + k);
+        const __m256 c = _mm256_load_ps(hr + k);
+        const __m256 d = _mm256_load_ps(hi + k);
+        const __m256 real = _mm256_sub_ps(_mm256_mul_ps(a, c), _mm256_mul_ps(b, d));
+        const __m256 imag = _mm256_add_ps(_mm256_mul_ps(a, d), _mm256_mul_ps(b, c));
+        _mm256_store_ps(ar + k, _mm256_add_ps(_mm256_load_ps(ar + k), real));
+        _mm256_store_ps(ai + k, _mm256_add_ps(_mm256_load_ps(ai + k), imag));
+    }
+}
+
+MN_TARGET_AVX2
+static void convolveHeadAVX2(const float* head,
+                             const float* history,
+                             const float* bias,
+                             float* output,
+                             int numFrames,
+                             int blockSize)
+{
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        __m256 sum = _mm256_loadu_ps(bias + i);
+        for (int k = 0; k < blockSize; k++)
+        {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(head[k]), _mm256_loadu_ps(history + i + k)));
+        }
+        _mm256_storeu_ps(output + i, sum);
+    }
+    
+    convolveHeadSSE2(head, history + i, bias + i, output + i, numFrames - i, blockSize);
+}
+
+#elif MN_SIMD_ARM64
+
+static void multiplyAccumulateNEON(const float* x, const float* h, float* accumulator, int blockSize)
+{
+    const float* xr = x;
+    const float* xi = x + blockSize;
+    const float* hr = h;
+    const float* hi = h + blockSize;
+    float* ar = accumulator;
+    float* ai = accumulator + blockSize;
+    for (int k = 0; k < blockSize; k += 4)
+    {
+        const float32x4_t a = vld1q_f32(xr + k);
+        const float32x4_t b = vld1q_f32(xi + k);
+        const float32x4_t c = vld1q_f32(hr + k);
+        const float32x4_t d = vld1q_f32(hi + k);
+        vst1q_f32(ar + k, vfmsq_f32(vfmaq_f32(vld1q_f32(ar + k), a, c), b, d));
+        vst1q_f32(ai + k, vfmaq_f32(vfmaq_f32(vld1q_f32(ai + k), a, d), b, c));
+    }
+}
+
+static void convolveHeadNEON(const float* head,
+                             const float* history,
+                             const float* bias,
+                             float* output,
+                             int numFrames,
+                             int blockSize)
+{
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        float32x4_t sum = vld1q_f32(bias + i);
+        for (int k = 0; k < blockSize; k++)
+        {
+            sum = vfmaq_f32(sum, vdupq_n_f32(head[k]), vld1q_f32(history + i + k));
+        }
+        vst1q_f32(output + i, sum);
+    }
+    
+    convolveHeadScalar(head, history + i, bias + i, output + i, numFrames - i, blockSize);
+}
+
+#endif
+
+typedef void (*multiplyAccumulateFunction)(const float* x, const float* h, float* accumulator, int blockSize);
+typedef void (*convolveHeadFunction)(const float* head,
+                                     const float* history,
+                                     const float* bias,
+                                     float* output,
+                                     int numFrames,
+                                     int blockSize);
+
+static void getKernels(multiplyAccumulateFunction* multiplyAccumulate, convolveHeadFunction* convolveHead)
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            *multiplyAccumulate = multiplyAccumulateSSE2;
+            *convolveHead = convolveHeadSSE2;
+            return;
+        case MN_SIMD_AVX2:
+            *multiplyAccumulate = multiplyAccumulateAVX2;
+            *convolveHead = convolveHeadAVX2;
+            return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            *multiplyAccumulate = multiplyAccumulateNEON;
+            *convolveHead = convolveHeadNEON;
+            return;
+#endif
+        default:
+            *multiplyAccumulate = multiplyAccumulateScalar;
+            *convolveHead = convolveHeadScalar;
+            return;
+    }
+}
+
+/* Segments */
+
+static void deinitSegment(mnConvolverSegment* segment)
+{
+    mnFFT_deinit(&segment->fft);
+    mnLockedMemory_free(segment->partitions);
+    mnLockedMemory_free(segment->delayLine);
+    mnLockedMemory_free(segment->input);
+    mnLockedMemory_free(segment->accumulator);
+    mnLockedMemory_free(segment->real);
+    mnLockedMemory_free(segment->imag);
+    mnLockedMemory_free(segment->time);
+    memset(segment, 0, sizeof(mnConvolverSegment));
+}
+
+/**
+ * Stores the spectrum in \c segment->real and \c segment->imag packed into \c spectrum.
+ */
+static void packSpectrum(const mnConvolverSegment* segment, float* spectrum)
+{
+    const int blockSize = segment->blockSize;
+    memcpy(spectrum, segment->real, blockSize * sizeof(float));
+    memcpy(spectrum + blockSize, segment->imag, blockSize * sizeof(float));
+    spectrum[blockSize] = segment->real[blockSize];
+}
+
+/**
+ * Prepares a segment for taps \c offset ... \c offset + numPartitions * blockSize - 1
+ * of \c response, which has \c length taps. The segment only keeps the
+ * input if \c numPartitions is 0.
+ */
+static int initSegment(mnConvolverSegment* segment,
+                       int blockSize,
+                       int numPartitions,
+                       const float* response,
+                       int offset,
+                       int length)
+{
+    memset(segment, 0, sizeof(mnConvolverSegment));
+    segment->blockSize = blockSize;
+    segment->numPartitions = numPartitions;
+    
+    const int spectrumSize = 2 * blockSize * sizeof(float);
+    segment->input = mnLockedMemory_alloc(spectrumSize, NULL);
+    if (numPartitions == 0)
+    {
+        return segment->input != NULL;
+    }
+    
+    segment->partitions = mnLockedMemory_alloc(numPartitions * spectrumSize, NULL);
+    segment->delayLine = mnLockedMemory_alloc(numPartitions * spectrumSize, NULL);
+    segment->accumulator = mnLockedMemory_alloc(spectrumSize, NULL);
+    segment->real = mnLockedMemory_alloc((blockSize + 1) * sizeof(float), NULL);
+    segment->imag = mnLockedMemory_alloc((blockSize + 1) * sizeof(float), NULL);
+    segment->time = mnLockedMemory_alloc(spectrumSize, NULL);
+    if (!mnFFT_init(&segment->fft, 2 * blockSize) ||
+        !segment->input || !segment->partitions || !segment->delayLine ||
+        !segment->accumulator || !segment->real || !segment->imag || !segment->time)
+    {
+        deinitSegment(segment);
+        return 0;
+    }
+    
+    //each partition is zero padded to twice the block size, so the products
+    //are linear convolutions in the second half of the inverse transform
+    for (int j = 0; j < numPartitions; j++)
+    {
+        const int first = offset + j * blockSize;
+        const int numTaps = length - first < blockSize ? length - first : blockSize;
+        memset(segment->time, 0, spectrumSize);
+        memcpy(segment->time, response + first, numTaps * sizeof(float));
+        mnFFT_forwardReal(&segment->fft, segment->time, segment->real, segment->imag);
+        packSpectrum(segment, segment->partitions + 2 * j * blockSize);
+    }
+    
+    return 1;
+}
+
+/**
+ * Runs the segment on the block of input in the second half of
+ * \c segment->input, writing its output for the block after into \c output.
+ */
+static void processSegment(mnConvolverSegment* segment, multiplyAccumulateFunction multiplyAccumulate, float* output)
+{
+    const int blockSize = segment->blockSize;
+    const int numPartitions = segment->numPartitions;
+    if (numPartitions > 0)
+    {
+        mnFFT_forwardReal(&segment->fft, segment->input, segment->real, segment->imag);
+        segment->newest = segment->newest + 1 < numPartitions ? segment->newest + 1 : 0;
+        packSpectrum(segment, segment->delayLine + 2 * segment->newest * blockSize);
+        
+        //newer spectra meet earlier partitions
+        float* accumulator = segment->accumulator;
+        float dc = 0.0f;
+        float nyquist = 0.0f;
+        int slot = segment->newest;
+        memset(accumulator, 0, 2 * blockSize * sizeof(float));
+        for (int j = 0; j < numPartitions; j++)
+        {
+            const float* x = segment->delayLine + 2 * slot * blockSize;
+            const float* h = segment->partitions + 2 * j * blockSize;
+            multiplyAccumulate(x, h, accumulator, blockSize);
+            dc += x[0] * h[0];
+            nyquist += x[blockSize] * h[blockSize];
+            slot = slot > 0 ? slot - 1 : numPartitions - 1;
+        }
+        
+        memcpy(segment->real, accumulator, blockSize * sizeof(float));
+        memcpy(segment->imag, accumulator + blockSize, blockSize * sizeof(float));
+        segment->real[0] = dc;
+        segment->imag[0] = 0.0f;
+        segment->real[blockSize] = nyquist;
+        segment->imag[blockSize] = 0.0f;
+        mnFFT_inverseReal(&segment->fft, segment->real, segment->imag, segment->time);
+        memcpy(output, segment->time + blockSize, blockSize * sizeof(float));
+    }
+    
+    memcpy(segment->input, segment->input + blockSize, blockSize * sizeof(float));
+}
+
+/* Tail thread */
+
+/**
+ * Forgets the tail block that is next in line, whose input was not written
+ * because the tail thread had fallen too far behind.
+ */
+static void skipTailBlock(mnConvolver* convolver)
+{
+    for (int c = 0; c < convolver->options.numChannels; c++)
+    {
+        mnConvolverSegment* tail = &convolver->channels[c].tail;
+        const int blockSize = tail->blockSize;
+        tail->newest = tail->newest + 1 < tail->numPartitions ? tail->newest + 1 : 0;
+        memset(tail->delayLine + 2 * tail->newest * blockSize, 0, 2 * blockSize * sizeof(float));
+        memset(tail->input, 0, 2 * blockSize * sizeof(float));
+    }
+}
+
+static void processTailBlocks(mnConvolver* convolver)
+{
+    const int tailBlockSize = convolver->options.tailBlockSize;
+    multiplyAccumulateFunction multiplyAccumulate;
+    convolveHeadFunction convolveHead;
+    getKernels(&multiplyAccumulate, &convolveHead);
+    
+    while (convolver->nextTailBlock < mnAtomicLoadAcquire(&convolver->numTailBlocksWritten))
+    {
+        const int block = convolver->nextTailBlock;
+        const int inputSlot = block % MN_CONVOLVER_NUM_TAIL_SLOTS;
+        const int outputSlot = (block + 2) % MN_CONVOLVER_NUM_TAIL_SLOTS;
+        if (mnAtomicLoadAcquire(&convolver->tailInputBlocks[inputSlot]) == block)
+        {
+            for (int c = 0; c < convolver->options.numChannels; c++)
+            {
+                mnConvolverChannel* channel = &convolver->channels[c];
+                memcpy(channel->tail.input + tailBlockSize,
+                       channel->tailInput + inputSlot * tailBlockSize,
+                       tailBlockSize * sizeof(float));
+                processSegment(&channel->tail, multiplyAccumulate, channel->tailOutput + outputSlot * tailBlockSize);
+            }
+            mnAtomicStoreRelease(block + 2, &convolver->tailOutputBlocks[outputSlot]);
+        }
+        else
+        {
+            skipTailBlock(convolver);
+        }
+        
+        convolver->nextTailBlock++;
+        mnAtomicStoreRelease(convolver->nextTailBlock, &convolver->numTailBlocksRead);
+    }
+}
+
+static void* tailThreadEntryPoint(void* data)
+{
+    mnConvolver* convolver = (mnConvolver*)data;
+    //reverb tails decay into denormals
+    mnFloatState_enterFlushToZero();
+    
+    while (1)
+    {
+        //the audio thread is done writing once this is cleared, so one more
+        //pass processes the last blocks
+        const int isRunning = mnAtomicLoadAcquire(&convolver->isRunning);
+        processTailBlocks(convolver);
+        if (!isRunning)
+        {
+            break;
+        }
+        
+        mnSemaphore_waitFor(&convolver->wakeup, convolver->pollInterval);
+    }
+    
+    return NULL;
+}
+
+/* Convolver */
+
+static void releaseBuffers(mnConvolver* convolver)
+{
+    if (convolver->channels)
+    {
+        for (int c = 0; c < convolver->options.numChannels; c++)
+        {
+            mnConvolverChannel* channel = &convolver->channels[c];
+            mnLockedMemory_free(channel->head);
+            mnLockedMemory_free(channel->bodyOutput);
+            mnLockedMemory_free(channel->tailInput);
+            mnLockedMemory_free(channel->tailOutput);
+            deinitSegment(&channel->body);
+            deinitSegment(&channel->tail);
+        }
+    }
+    free(convolver->channels);
+    mnLockedMemory_free(convolver->scratch);
+    memset(convolver, 0, sizeof(mnConvolver));
+}
+
+static int initChannel(mnConvolver* convolver, mnConvolverChannel* channel, const float* response)
+{
+    const int blockSize = convolver->options.blockSize;
+    const int tailBlockSize = convolver->options.tailBlockSize;
+    const int length = convolver->length;
+    const int bodyEnd = convolver->hasTail ? 2 * tailBlockSize : length;
+    const int numBodyTaps = bodyEnd > blockSize ? bodyEnd - blockSize : 0;
+    
+    channel->head = mnLockedMemory_alloc(blockSize * sizeof(float), NULL);
+    channel->bodyOutput = mnLockedMemory_alloc(blockSize * sizeof(float), NULL);
+    if (!channel->head || !channel->bodyOutput ||
+        !initSegment(&channel->body, blockSize, (numBodyTaps + blockSize - 1) / blockSize, response, blockSize, length))
+    {
+        return 0;
+    }
+    for (int k = 0; k < blockSize && k < length; k++)
+    {
+        channel->head[blockSize - 1 - k] = response[k];
+    }
+    
+    if (convolver->hasTail)
+    {
+        const int numTailTaps = length - 2 * tailBlockSize;
+        const int ringSize = MN_CONVOLVER_NUM_TAIL_SLOTS * tailBlockSize * sizeof(float);
+        channel->tailInput = mnLockedMemory_alloc(ringSize, NULL);
+        channel->tailOutput = mnLockedMemory_alloc(ringSize, NULL);
+        if (!channel->tailInput || !channel->tailOutput ||
+            !initSegment(&channel->tail,
+                         tailBlockSize,
+                         (numTailTaps + tailBlockSize - 1) / tailBlockSize,
+                         response,
+                         2 * tailBlockSize,
+                         length))
+        {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+int mnConvolver_init(mnConvolver* convolver,
+                     const mnConvolverOptions* options,
+                     const float* const* responses,
+                     int length)
+{
+    memset(convolver, 0, sizeof(mnConvolver));
+    const int blockSize = options->blockSize;
+    const int tailBlockSize = options->tailBlockSize;
+    if (options->numChannels < 1 ||
+        length < 1 ||
+        blockSize < 16 ||
+        (blockSize & (blockSize - 1)) != 0 ||
+        (tailBlockSize != 0 && (tailBlockSize <= blockSize || (tailBlockSize & (tailBlockSize - 1)) != 0)) ||
+        options->sampleRate <= 0.0f)
+    {
+        return 0;
+    }
+    
+    memcpy(&convolver->options, options, sizeof(mnConvolverOptions));
+    convolver->length = length;
+    convolver->hasTail = tailBlockSize > 0 && length > 2 * tailBlockSize;
+    convolver->channels = calloc(options->numChannels, sizeof(mnConvolverChannel));
+    convolver->scratch = mnLockedMemory_alloc(blockSize * sizeof(float), NULL);
+    if (!convolver->channels || !convolver->scratch)
+    {
+        releaseBuffers(convolver);
+        return 0;
+    }
+    for (int c = 0; c < options->numChannels; c++)
+    {
+        if (!initChannel(convolver, &convolver->channels[c], responses[c]))
+        {
+            releaseBuffers(convolver);
+            return 0;
+        }
+    }
+    
+    if (!convolver->hasTail)
+    {
+        return 1;
+    }
+    
+    //the tail has no taps in the first two blocks, whose slots start out silent
+    for (int slot = 0; slot < MN_CONVOLVER_NUM_TAIL_SLOTS; slot++)
+    {
+        convolver->tailInputBlocks[slot] = -1;
+        convolver->tailOutputBlocks[slot] = slot < 2 ? slot : -1;
+    }
+    //poll a few times per tail block, which the thread has one tail block
+    //to process
+    convolver->pollInterval = 0.25 * tailBlockSize / options->sampleRate;
+    if (convolver->pollInterval > 0.005)
+    {
+        convolver->pollInterval = 0.005;
+    }
+    else if (convolver->pollInterval < 0.00025)
+    {
+        convolver->pollInterval = 0.00025;
+    }
+    mnSemaphore_init(&convolver->wakeup);
+    
+    mnAtomicStoreRelease(1, &convolver->isRunning);
+    if (!mnThread_create(&convolver->thread, &convolver->options.threadOptions, tailThreadEntryPoint, convolver))
+    {
+        mnSemaphore_deinit(&convolver->wakeup);
+        releaseBuffers(convolver);
+        return 0;
+    }
+    
+    return 1;
+}
+
+void mnConvolver_deinit(mnConvolver* convolver)
+{
+    if (convolver->hasTail && mnAtomicLoadAcquire(&convolver->isRunning))
+    {
+        mnAtomicStoreRelease(0, &convolver->isRunning);
+        mnSemaphore_post(&convolver->wakeup);
+        pthread_join(convolver->thread, NULL);
+        mnSemaphore_deinit(&convolver->wakeup);
+    }
+    
+    releaseBuffers(convolver);
+}
+
+/**
+ * Convolves \c numFrames samples of one channel in place, which don't cross
+ * the end of the current block.
+ * @param isTailReady 1 if the tail's output for the current tail block is ready.
+ */
+static void processChannel(mnConvolver* convolver,
+                           mnConvolverChannel* channel,
+                           float* samples,
+                           int numFrames,
+                           int isTailReady,
+                           convolveHeadFunction convolveHead)
+{
+    const int blockSize = convolver->options.blockSize;
+    const int position = convolver->position;
+    float* input = channel->body.input;
+    memcpy(input + blockSize + position, samples, numFrames * sizeof(float));
+    
+    if (convolver->hasTail)
+    {
+        const int tailBlockSize = convolver->options.tailBlockSize;
+        const int slot = convolver->tailBlock % MN_CONVOLVER_NUM_TAIL_SLOTS;
+        const int offset = slot * tailBlockSize + convolver->tailPosition;
+        if (convolver->isTailSlotFree)
+        {
+            memcpy(channel->tailInput + offset, samples, numFrames * sizeof(float));
+        }
+        if (isTailReady)
+        {
+            //the tail is added to the body's output, which is used up in this call
+            const float* tailOutput = channel->tailOutput + offset;
+            for (int i = 0; i < numFrames; i++)
+            {
+                channel->bodyOutput[position + i] += tailOutput[i];
+            }
+        }
+    }
+    
+    //the head sees the current sample and the blockSize - 1 before it
+    convolveHead(channel->head, input + position + 1, channel->bodyOutput + position, samples, numFrames, blockSize);
+}
+
+/**
+ * Moves on by \c numFrames, running the body at the end of a block and
+ * handing the input to the tail thread at the end of a tail block.
+ */
+static void advance(mnConvolver* convolver, int numFrames, multiplyAccumulateFunction multiplyAccumulate)
+{
+    convolver->position += numFrames;
+    if (convolver->position == convolver->options.blockSize)
+    {
+        convolver->position = 0;
+        for (int c = 0; c < convolver->options.numChannels; c++)
+        {
+            mnConvolverChannel* channel = &convolver->channels[c];
+            processSegment(&channel->body, multiplyAccumulate, channel->bodyOutput);
+        }
+    }
+    
+    if (!convolver->hasTail)
+    {
+        return;
+    }
+    
+    convolver->tailPosition += numFrames;
+    if (convolver->tailPosition == convolver->options.tailBlockSize)
+    {
+        const int block = convolver->tailBlock;
+        if (convolver->isTailSlotFree)
+        {
+            mnAtomicStoreRelease(block, &convolver->tailInputBlocks[block % MN_CONVOLVER_NUM_TAIL_SLOTS]);
+        }
+        mnAtomicStoreRelease(block + 1, &convolver->numTailBlocksWritten);
+        convolver->tailBlock++;
+        convolver->tailPosition = 0;
+    }
+}
+
+/**
+ * Convolves planar frames, or interleaved frames if \c channels is NULL.
+ */
+static void process(mnConvolver* convolver, float* const* channels, float* samples, int numFrames)
+{
+    const int numChannels = convolver->options.numChannels;
+    const int blockSize = convolver->options.blockSize;
+    multiplyAccumulateFunction multiplyAccumulate;
+    convolveHeadFunction convolveHead;
+    getKernels(&multiplyAccumulate, &convolveHead);
+    
+    int offset = 0;
+    while (offset < numFrames)
+    {
+        const int remaining = blockSize - convolver->position;
+        const int count = numFrames - offset < remaining ? numFrames - offset : remaining;
+        
+        int isTailReady = 0;
+        if (convolver->hasTail)
+        {
+            //a slot is only written once the tail thread is done with the
+            //block that last used it, otherwise that block of input is lost
+            const int block = convolver->tailBlock;
+            if (convolver->tailPosition == 0)
+            {
+                const int numRead = mnAtomicLoadAcquire(&convolver->numTailBlocksRead);
+                convolver->isTailSlotFree = numRead > block - MN_CONVOLVER_NUM_TAIL_SLOTS;
+            }
+            isTailReady = mnAtomicLoadAcquire(&convolver->tailOutputBlocks[block % MN_CONVOLVER_NUM_TAIL_SLOTS]) == block;
+            if (!isTailReady)
+            {
+                mnAtomicAdd(&convolver->numLateFrames, count);
+            }
+        }
+        
+        for (int c = 0; c < numChannels; c++)
+        {
+            mnConvolverChannel* channel = &convolver->channels[c];
+            if (channels)
+            {
+                processChannel(convolver, channel, channels[c] + offset, count, isTailReady, convolveHead);
+                continue;
+            }
+            
+            float* frames = samples + offset * numChannels + c;
+            for (int i = 0; i < count; i++)
+            {
+                convolver->scratch[i] = frames[i * numChannels];
+            }
+            processChannel(convolver, channel, convolver->scratch, count, isTailReady, convolveHead);
+            for (int i = 0; i < count; i++)
+            {
+                frames[i * numChannels] = convolver->scratch[i];
+            }
+        }
+        
+        advance(convolver, count, multiplyAccumulate);
+        offset += count;
+    }
+}
+
+void mnConvolver_processInterleaved(mnConvolver* convolver, float* samples, int numFrames)
+{
+    process(convolver, NULL, samples, numFrames);
+}
+
+void mnConvolver_processPlanar(mnConvolver* convolver, float* const* channels, int numFrames)
+{
+    process(convolver, channels, NULL, numFrames);
+}
+
+int mnConvolver_getNumLateFrames(mnConvolver* convolver)
+{
+    return mnAtomicLoad(&convolver->numLateFrames);
+}
@@ -0,0 +1,240 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_CONVOLVER_H
+#define MN_CONVOLVER_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#include "counting_semaphore.h"
+#include "fft.h"
+#include "realtime.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The number of tail blocks in flight between the audio thread and the tail thread. */
+    #define MN_CONVOLVER_NUM_TAIL_SLOTS 4
+    
+    /**
+     * Convolver options.
+     */
+    typedef struct mnConvolverOptions
+    {
+        int numChannels;
+        /**
+         * The number of taps convolved directly, which is also the size of
+         * the partitions convolved by FFT on the audio thread. A power of two
+         * of at least 16.
+         */
+        int blockSize;
+        /**
+         * The size of the partitions convolved on a background thread, a power
+         * of two larger than \c blockSize, or 0 to convolve all taps on the
+         * audio thread. Taps from twice this size onward go to the background
+         * thread.
+         */
+        int tailBlockSize;
+        /** The sample rate in Hz, which paces the background thread's polling. */
+        float sampleRate;
+        /** The scheduling of the background thread, if \c tailBlockSize is set. */
+        mnThreadOptions threadOptions;
+    } mnConvolverOptions;
+    
+    /**
+     * Uniformly partitioned overlap-save convolution with a range of taps of
+     * an impulse response. Used by the convolver, not meant to be used directly.
+     *
+     * Each block of input is transformed together with the block before it,
+     * and the spectrum is stored in a frequency domain delay line. Partition
+     * j of the response is then applied to the spectrum j blocks back, so
+     * one inverse transform of the accumulated products yields the output of
+     * all partitions. Spectra are packed into \c blockSize real parts
+     * followed by \c blockSize imaginary parts, with the purely real Nyquist
+     * bin in place of the imaginary part of the DC bin, so each spectrum
+     * starts on a cache line and the vector loops need no remainder.
+     */
+    typedef struct mnConvolverSegment
+    {
+        int blockSize;
+        int numPartitions;
+        /** The delay line slot of the latest input spectrum. */
+        int newest;
+        /** Transforms of \c 2 * blockSize samples. */
+        mnFFT fft;
+        /** The packed spectra of the partitions. */
+        float* partitions;
+        /** The packed spectra of the last \c numPartitions blocks of input. */
+        float* delayLine;
+        /** The previous and the current block of input. */
+        float* input;
+        /** The packed sum of the products of partitions and input spectra. */
+        float* accumulator;
+        /** Unpacked spectra, \c blockSize + 1 bins. */
+        float* real;
+        float* imag;
+        /** The output of the inverse transform, \c 2 * blockSize samples. */
+        float* time;
+    } mnConvolverSegment;
+    
+    /**
+     * The state of one channel of a convolver.
+     */
+    typedef struct mnConvolverChannel
+    {
+        /** The first \c blockSize taps, reversed. */
+        float* head;
+        /** The taps from \c blockSize up to the tail, or to the end. */
+        mnConvolverSegment body;
+        /** The output of \c body for the current block. */
+        float* bodyOutput;
+        /** The taps from twice \c tailBlockSize onward, if any. */
+        mnConvolverSegment tail;
+        /** A ring of ::MN_CONVOLVER_NUM_TAIL_SLOTS blocks of input for the tail thread. */
+        float* tailInput;
+        /** A ring of ::MN_CONVOLVER_NUM_TAIL_SLOTS blocks of output from the tail thread. */
+        float* tailOutput;
+    } mnConvolverChannel;
+    
+    /**
+     * Convolves the output with long impulse responses, such as reverbs or
+     * cabinet simulations, without adding latency.
+     *
+     * The response is split in up to three parts. The first \c blockSize
+     * taps are convolved directly, sample by sample, so the output keeps up
+     * with the input whatever the callback size. The taps up to twice
+     * \c tailBlockSize are convolved on the audio thread by a
+     * ::mnConvolverSegment with partitions of \c blockSize, whose output for
+     * a block is ready at the end of the block before. The remaining taps go
+     * to a background thread, which convolves whole tail blocks with larger
+     * partitions, so the audio thread only copies samples to and from it.
+     * The tail thread has a full tail block to finish each block, because
+     * its first partition starts two tail blocks into the response. It polls
+     * for new input a few times per tail block, so the audio thread never
+     * wakes it. A tail block that isn't ready in time is left out and
+     * counted.
+     *
+     * The delay lines and products run in vector kernels picked according to
+     * mnSIMD_getLevel, and all buffers are allocated up front with
+     * ::mnLockedMemory_alloc.
+     */
+    typedef struct mnConvolver
+    {
+        mnConvolverOptions options;
+        /** The number of taps of each channel's response. */
+        int length;
+        mnConvolverChannel* channels;
+        /** \c blockSize samples of scratch space for deinterleaving. */
+        float* scratch;
+        /** The number of frames into the current block. Only accessed by the audio thread. */
+        int position;
+        /** The number of frames into the current tail block. Only accessed by the audio thread. */
+        int tailPosition;
+        /** The index of the current tail block. Only accessed by the audio thread. */
+        int tailBlock;
+        /** 1 if the current tail block's input slot may be written. Only accessed by the audio thread. */
+        int isTailSlotFree;
+        /** 1 if there is a tail thread. */
+        int hasTail;
+        
+        pthread_t thread;
+        /**
+         * The tail thread waits on this for a quarter of a tail block between
+         * polls of \c numTailBlocksWritten. Only posted to make it finish,
+         * never by the audio thread.
+         */
+        mnSemaphore wakeup;
+        double pollInterval;
+        /** Only accessed through atomic operations. Cleared to make the tail thread finish. */
+        int isRunning;
+        /** The number of complete tail blocks of input. Only accessed through atomic operations. */
+        int numTailBlocksWritten;
+        /** The number of tail blocks the tail thread is done with. Only accessed through atomic operations. */
+        int numTailBlocksRead;
+        /**
+         * The index of the tail block whose input each slot of \c tailInput
+         * holds. Only accessed through atomic operations.
+         */
+        int tailInputBlocks[MN_CONVOLVER_NUM_TAIL_SLOTS];
+        /**
+         * The index of the tail block whose output each slot of \c tailOutput
+         * holds. Only accessed through atomic operations.
+         */
+        int tailOutputBlocks[MN_CONVOLVER_NUM_TAIL_SLOTS];
+        /** The index of the next tail block to process. Only accessed by the tail thread. */
+        int nextTailBlock;
+        
+        /** The number of frames output without the tail. Only accessed through atomic operations. */
+        int numLateFrames;
+    } mnConvolver;
+    
+    /**
+     * Fills in the default options: mono, 128 frame blocks and no tail thread.
+     */
+    void mnConvolverOptions_setDefaults(mnConvolverOptions* options);
+    
+    /**
+     * Prepares the convolver and starts its tail thread, if any.
+     * @param responses The impulse response of each channel, \c length taps each.
+     * @return 0 if the options are invalid, allocation failed or the thread
+     * could not be created.
+     */
+    int mnConvolver_init(mnConvolver* convolver,
+                         const mnConvolverOptions* options,
+                         const float* const* responses,
+                         int length);
+    
+    /**
+     * Stops the tail thread and releases the convolver's resources. Not to be
+     * called while the audio thread may use the convolver.
+     */
+    void mnConvolver_deinit(mnConvolver* convolver);
+    
+    /**
+     * Replaces interleaved frames with their convolution. Called from the
+     * audio thread only.
+     */
+    void mnConvolver_processInterleaved(mnConvolver* convolver, float* samples, int numFrames);
+    
+    /**
+     * Replaces planar frames with their convolution. Called from the audio
+     * thread only.
+     */
+    void mnConvolver_processPlanar(mnConvolver* convolver, float* const* channels, int numFrames);
+    
+    /**
+     * Returns the number of frames output without the tail because the tail
+     * thread fell behind.
+     */
+    int mnConvolver_getNumLateFrames(mnConvolver* convolver);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_CONVOLVER_H
@@ -0,0 +1,787 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_math.h"
+#include "fft.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+/*
+ * A stage of the Stockham transform takes sequences of length n, spaced s
+ * elements apart, and splits each into its even and odd halves:
+ *
+ *     a = x[q + s * p], b = x[q + s * (p + n / 2)]
+ *     y[q + s * 2p] = a + b
+ *     y[q + s * (2p + 1)] = (a - b) * exp(-2 pi i p / n)
+ *
+ * for p < n / 2 and q < s, after which n halves and s doubles. All stages do
+ * the same number of butterflies. Once s reaches the vector width, the
+ * kernels run over q with one broadcast twiddle per p. The first two stages
+ * run over p instead and interleave their outputs.
+ *
+ * The inverse transform entangles the bins back into a half size complex
+ * spectrum and runs the same stages with the real and imaginary parts
+ * swapped, which conjugates the transform.
+ */
+
+/* Kernels */
+
+static void stageScalar(const float* xr,
+                        const float* xi,
+                        float* yr,
+                        float* yi,
+                        const float* twiddlesReal,
+                        const float* twiddlesImag,
+                        int n,
+                        int s)
+{
+    const int m = n / 2;
+    for (int p = 0; p < m; p++)
+    {
+        const float wr = twiddlesReal[p * s];
+        const float wi = twiddlesImag[p * s];
+        for (int q = 0; q < s; q++)
+        {
+            const int a = q + s * p;
+            const int b = a + s * m;
+            const int even = q + s * 2 * p;
+            const int odd = even + s;
+            const float dr = xr[a] - xr[b];
+            const float di = xi[a] - xi[b];
+            yr[even] = xr[a] + xr[b];
+            yi[even] = xi[a] + xi[b];
+            yr[odd] = dr * wr - di * wi;
+            yi[odd] = dr * wi + di * wr;
+        }
+    }
+}
+
+/**
+ * Untangles bins first ... last - 1 of the real transform from the complex
+ * transform z of the even and odd samples. Used by the reference kernel and
+ * for the bins left over by the vector loops.
+ */
+static void untangleScalar(const float* zr,
+                           const float* zi,
+                           const float* cosines,
+                           const float* sines,
+                           float* real,
+                           float* imag,
+                           int m,
+                           int first,
+                           int last)
+{
+    for (int k = first; k < last; k++)
+    {
+        const int j = (m - k) & (m - 1);
+        const float evenReal = 0.5f * (zr[k] + zr[j]);
+        const float evenImag = 0.5f * (zi[k] - zi[j]);
+        const float oddReal = 0.5f * (zi[k] + zi[j]);
+        const float oddImag = 0.5f * (zr[j] - zr[k]);
+        real[k] = evenReal + cosines[k] * oddReal + sines[k] * oddImag;
+        imag[k] = evenImag + cosines[k] * oddImag - sines[k] * oddReal;
+    }
+}
+
+static void untangleEnds(const float* zr, const float* zi, float* real, float* imag, int m)
+{
+    real[0] = zr[0] + zi[0];
+    imag[0] = 0.0f;
+    real[m] = zr[0] - zi[0];
+    imag[m] = 0.0f;
+}
+
+static void postProcessScalar(const float* zr,
+                              const float* zi,
+                              const float* cosines,
+                              const float* sines,
+                              float* real,
+                              float* imag,
+                              int m)
+{
+    untangleEnds(zr, zi, real, imag, m);
+    untangleScalar(zr, zi, cosines, sines, real, imag, m, 1, m);
+}
+
+/**
+ * Undoes ::untangleScalar for bins first ... last - 1, scaled by 1 / m so
+ * that the inverse transform of a forward transform gives back its input.
+ */
+static void entangleScalar(const float* real,
+                           const float* imag,
+                           const float* cosines,
+                           const float* sines,
+                           float* zr,
+                           float* zi,
+                           int m,
+                           int first,
+                           int last)
+{
+    const float scale = 0.5f / m;
+    for (int k = first; k < last; k++)
+    {
+        const int j = m - k;
+        const float diffReal = real[k] - real[j];
+        const float diffImag = imag[k] + imag[j];
+        zr[k] = scale * (real[k] + real[j] - sines[k] * diffReal - cosines[k] * diffImag);
+        zi[k] = scale * (imag[k] - imag[j] + cosines[k] * diffReal - sines[k] * diffImag);
+    }
+}
+
+static void preProcessScalar(const float* real,
+                             const float* imag,
+                             const float* cosines,
+                             const float* sines,
+                             float* zr,
+                             float* zi,
+                             int m)
+{
+    entangleScalar(real, imag, cosines, sines, zr, zi, m, 0, m);
+}
+
+#if MN_SIMD_X86
+
+static void stageSSE2(const float* xr,
+                      const float* xi,
+                      float* yr,
+                      float* yi,
+                      const float* twiddlesReal,
+                      const float* twiddlesImag,
+                      int n,
+                      int s)
+{
+    const int m = n / 2;
+    if (s == 1)
+    {
+        for (int p = 0; p < m; p += 4)
+        {
+            const __m128 ar = _mm_loadu_ps(xr + p);
+            const __m128 ai = _mm_loadu_ps(xi + p);
+            const __m128 br = _mm_loadu_ps(xr + p + m);
+            const __m128 bi = _mm_loadu_ps(xi + p + m);
+            const __m128 wr = _mm_loadu_ps(twiddlesReal + p);
+            const __m128 wi = _mm_loadu_ps(twiddlesImag + p);
+            const __m128 sr = _mm_add_ps(ar, br);
+            const __m128 si = _mm_add_ps(ai, bi);
+            const __m128 dr = _mm_sub_ps(ar, br);
+            const __m128 di = _mm_sub_ps(ai, bi);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr));
+            _mm_storeu_ps(yr + 2 * p, _mm_unpacklo_ps(sr, tr));
+            _mm_storeu_ps(yr + 2 * p + 4, _mm_unpackhi_ps(sr, tr));
+            _mm_storeu_ps(yi + 2 * p, _mm_unpacklo_ps(si, ti));
+            _mm_storeu_ps(yi + 2 * p + 4, _mm_unpackhi_ps(si, ti));
+        }
+    }
+    else if (s == 2)
+    {
+        //lanes hold q = 0, 1 of two consecutive values of p
+        for (int p = 0; p < m; p += 2)
+        {
+            const __m128 ar = _mm_loadu_ps(xr + 2 * p);
+            const __m128 ai = _mm_loadu_ps(xi + 2 * p);
+            const __m128 br = _mm_loadu_ps(xr + 2 * (p + m));
+            const __m128 bi = _mm_loadu_ps(xi + 2 * (p + m));
+            const __m128 twr = _mm_loadu_ps(twiddlesReal + 2 * p);
+            const __m128 twi = _mm_loadu_ps(twiddlesImag + 2 * p);
+            const __m128 wr = _mm_shuffle_ps(twr, twr, _MM_SHUFFLE(2, 2, 0, 0));
+            const __m128 wi = _mm_shuffle_ps(twi, twi, _MM_SHUFFLE(2, 2, 0, 0));
+            const __m128 sr = _mm_add_ps(ar, br);
+            const __m128 si = _mm_add_ps(ai, bi);
+            const __m128 dr = _mm_sub_ps(ar, br);
+            const __m128 di = _mm_sub_ps(ai, bi);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr));
+            _mm_storeu_ps(yr + 4 * p, _mm_movelh_ps(sr, tr));
+            _mm_storeu_ps(yr + 4 * p + 4, _mm_movehl_ps(tr, sr));
+            _mm_storeu_ps(yi + 4 * p, _mm_movelh_ps(si, ti));
+            _mm_storeu_ps(yi + 4 * p + 4, _mm_movehl_ps(ti, si));
+        }
+    }
+    else
+    {
+        for (int p = 0; p < m; p++)
+        {
+            const __m128 wr = _mm_set1_ps(twiddlesReal[p * s]);
+            const __m128 wi = _mm_set1_ps(twiddlesImag[p * s]);
+            const float* ar = xr + s * p;
+            const float* ai = xi + s * p;
+            const float* br = ar + s * m;
+            const float* bi = ai + s * m;
+            float* evenReal = yr + s * 2 * p;
+            float* evenImag = yi + s * 2 * p;
+            for (int q = 0; q < s; q += 4)
+            {
+                const __m128 a0 = _mm_loadu_ps(ar + q);
+                const __m128 a1 = _mm_loadu_ps(ai + q);
+                const __m128 b0 = _mm_loadu_ps(br + q);
+                const __m128 b1 = _mm_loadu_ps(bi + q);
+                const __m128 dr = _mm_sub_ps(a0, b0);
+                const __m128 di = _mm_sub_ps(a1, b1);
+                _mm_storeu_ps(evenReal + q, _mm_add_ps(a0, b0));
+                _mm_storeu_ps(evenImag + q, _mm_add_ps(a1, b1));
+                _mm_storeu_ps(evenReal + s + q, _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi)));
+                _mm_storeu_ps(evenImag + s + q, _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr)));
+            }
+        }
+    }
+}
+
+static void postProcessSSE2(const float* zr,
+                            const float* zi,
+                            const float* cosines,
+                            const float* sines,
+                            float* real,
+                            float* imag,
+                            int m)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    untangleEnds(zr, zi, real, imag, m);
+    
+    int k = 1;
+    for (; k + 4 <= m; k += 4)
+    {
+        //bins m - k - 3 ... m - k, reversed to line up with k ... k + 3
+        const __m128 jr = _mm_loadu_ps(zr + m - k - 3);
+        const __m128 ji = _mm_loadu_ps(zi + m - k - 3);
+        const __m128 br = _mm_shuffle_ps(jr, jr, _MM_SHUFFLE(0, 1, 2, 3));
+        const __m128 bi = _mm_shuffle_ps(ji, ji, _MM_SHUFFLE(0, 1, 2, 3));
+        const __m128 ar = _mm_loadu_ps(zr + k);
+        const __m128 ai = _mm_loadu_ps(zi + k);
+        const __m128 c = _mm_loadu_ps(cosines + k);
+        const __m128 s = _mm_loadu_ps(sines + k);
+        const __m128 evenReal = _mm_mul_ps(half, _mm_add_ps(ar, br));
+        const __m128 evenImag = _mm_mul_ps(half, _mm_sub_ps(ai, bi));
+        const __m128 oddReal = _mm_mul_ps(half, _mm_add_ps(ai, bi));
+        const __m128 oddImag = _mm_mul_ps(half, _mm_sub_ps(br, ar));
+        _mm_storeu_ps(real + k, _mm_add_ps(evenReal, _mm_add_ps(_mm_mul_ps(c, oddReal), _mm_mul_ps(s, oddImag))));
+        _mm_storeu_ps(imag + k, _mm_add_ps(evenImag, _mm_sub_ps(_mm_mul_ps(c, oddImag), _mm_mul_ps(s, oddReal))));
+    }
+    
+    untangleScalar(zr, zi, cosines, sines, real, imag, m, k, m);
+}
+
+static void preProcessSSE2(const float* real,
+                           const float* imag,
+                           const float* cosines,
+                           const float* sines,
+                           float* zr,
+                           float* zi,
+                           int m)
+{
+    const __m128 scale = _mm_set1_ps(0.5f / m);
+    
+    int k = 0;
+    for (; k + 4 <= m; k += 4)
+    {
+        //bins m - k - 3 ... m - k, reversed to line up with k ... k + 3
+        const __m128 jr = _mm_loadu_ps(real + m - k - 3);
+        const __m128 ji = _mm_loadu_ps(imag + m - k - 3);
+        const __m128 br = _mm_shuffle_ps(jr, jr, _MM_SHUFFLE(0, 1, 2, 3));
+        const __m128 bi = _mm_shuffle_ps(ji, ji, _MM_SHUFFLE(0, 1, 2, 3));
+        const __m128 ar = _mm_loadu_ps(real + k);
+        const __m128 ai = _mm_loadu_ps(imag + k);
+        const __m128 c = _mm_loadu_ps(cosines + k);
+        const __m128 s = _mm_loadu_ps(sines + k);
+        const __m128 diffReal = _mm_sub_ps(ar, br);
+        const __m128 diffImag = _mm_add_ps(ai, bi);
+        const __m128 sumReal = _mm_sub_ps(_mm_add_ps(ar, br), _mm_add_ps(_mm_mul_ps(s, diffReal), _mm_mul_ps(c, diffImag)));
+        const __m128 sumImag = _mm_add_ps(_mm_sub_ps(ai, bi), _mm_sub_ps(_mm_mul_ps(c, diffReal), _mm_mul_ps(s, diffImag)));
+        _mm_storeu_ps(zr + k, _mm_mul_ps(scale, sumReal));
+        _mm_storeu_ps(zi + k, _mm_mul_ps(scale, sumImag));
+    }
+    
+    entangleScalar(real, imag, cosines, sines, zr, zi, m, k, m);
+}
+
+MN_TARGET_AVX2
+static void stageAVX2(const float* xr,
+                      const float* xi,
+                      float* yr,
+                      float* yi,
+                      const float* twiddlesReal,
+                      const float* twiddlesImag,
+                      int n,
+                      int s)
+{
+    const int m = n / 2;
+    if (s == 1 && m >= 8)
+    {
+        for (int p = 0; p < m; p += 8)
+        {
+            const __m256 ar = _mm256_loadu_ps(xr + p);
+            const __m256 ai = _mm256_loadu_ps(xi + p);
+            const __m256 br = _mm256_loadu_ps(xr + p + m);
+            const __m256 bi = _mm256_loadu_ps(xi + p + m);
+            const __m256 wr = _mm256_loadu_ps(twiddlesReal + p);
+            const __m256 wi = _mm256_loadu_ps(twiddlesImag + p);
+            const __m256 sr = _mm256_add_ps(ar, br);
+            const __m256 si = _mm256_add_ps(ai, bi);
+            const __m256 dr = _mm256_sub_ps(ar, br);
+            const __m256 di = _mm256_sub_ps(ai, bi);
+            const __m256 tr = _mm256_sub_ps(_mm256_mul_ps(dr, wr), _mm256_mul_ps(di, wi));
+            const __m256 ti = _mm256_add_ps(_mm256_mul_ps(dr, wi), _mm256_mul_ps(di, wr));
+            //the unpacks interleave within 128 bit lanes, the permutes put the lanes in order
+            const __m256 lowReal = _mm256_unpacklo_ps(sr, tr);
+            const __m256 highReal = _mm256_unpackhi_ps(sr, tr);
+            const __m256 lowImag = _mm256_unpacklo_ps(si, ti);
+            const __m256 highImag = _mm256_unpackhi_ps(si, ti);
+            _mm256_storeu_ps(yr + 2 * p, _mm256_permute2f128_ps(lowReal, highReal, 0x20));
+            _mm256_storeu_ps(yr + 2 * p + 8, _mm256_permute2f128_ps(lowReal, highReal, 0x31));
+            _mm256_storeu_ps(yi + 2 * p, _mm256_permute2f128_ps(lowImag, highImag, 0x20));
+            _mm256_storeu_ps(yi + 2 * p + 8, _mm256_permute2f128_ps(lowImag, highImag, 0x31));
+        }
+    }
+    else if (s < 8)
+    {
+        stageSSE2(xr, xi, yr, yi, twiddlesReal, twiddlesImag, n, s);
+    }
+    else
+    {
+        for (int p = 0; p < m; p++)
+        {
+            const __m256 wr = _mm256_set1_ps(twiddlesReal[p * s]);
+            const __m256 wi = _mm256_set1_ps(twiddlesImag[p * s]);
+            const float* ar = xr + s * p;
+            const float* ai = xi + s * p;
+            const float* br = ar + s * m;
+            const float* bi = ai + s * m;
+            float* evenReal = yr + s * 2 * p;
+            float* evenImag = yi + s * 2 * p;
+            for (int q = 0; q < s; q += 8)
+            {
+                const __m256 a0 = _mm256_loadu_ps(ar + q);
+                const __m256 a1 = _mm256_loadu_ps(ai + q);
+                const __m256 b0 = _mm256_loadu_ps(br + q);
+                const __m256 b1 = _mm256_loadu_ps(bi + q);
+                const __m256 dr = _mm256_sub_ps(a0, b0);
+                const __m256 di = _mm256_sub_ps(a1, b1);
+                _mm256_storeu_ps(evenReal + q, _mm256_add_ps(a0, b0));
+                _mm256_storeu_ps(evenImag + q, _mm256_add_ps(a1, b1));
+                _mm256_storeu_ps(evenReal + s + q, _mm256_sub_ps(_mm256_mul_ps(dr, wr), _mm256_mul_ps(di, wi)));
+                _mm256_storeu_ps(evenImag + s + q, _mm256_add_ps(_mm256_mul_ps(dr, wi), _mm256_mul_ps(di, wr)));
+            }
+        }
+    }
+}
+
+MN_TARGET_AVX2
+static void postProcessAVX2(const float* zr,
+                            const float* zi,
+                            const float* cosines,
+                            const float* sines,
+                            float* real,
+                            float* imag,
+                            int m)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    untangleEnds(zr, zi, real, imag, m);
+    
+    int k = 1;
+    for (; k + 8 <= m; k += 8)
+    {
+        //bins m - k - 7 ... m - k, reversed to line up with k ... k + 7
+        const __m256 br = _mm256_permutevar8x32_ps(_mm256_loadu_ps(zr + m - k - 7), reverse);
+        const __m256 bi = _mm256_permutevar8x32_ps(_mm256_loadu_ps(zi + m - k - 7), reverse);
+        const __m256 ar = _mm256_loadu_ps(zr + k);
+        const __m256 ai = _mm256_loadu_ps(zi + k);
+        const __m256 c = _mm256_loadu_ps(cosines + k);
+        const __m256 s = _mm256_loadu_ps(sines + k);
+        const __m256 evenReal = _mm256_mul_ps(half, _mm256_add_ps(ar, br));
+        const __m256 evenImag = _mm256_mul_ps(half, _mm256_sub_ps(ai, bi));
+        const __m256 oddReal = _mm256_mul_ps(half, _mm256_add_ps(ai, bi));
+        const __m256 oddImag = _mm256_mul_ps(half, _mm256_sub_ps(br, ar));
+        _mm256_storeu_ps(real + k, _mm256_add_ps(evenReal, _mm256_add_ps(_mm256_mul_ps(c, oddReal), _mm256_mul_ps(s, oddImag))));
+        _mm256_storeu_ps(imag + k, _mm256_add_ps(evenImag, _mm256_sub_ps(_mm256_mul_ps(c, oddImag), _mm256_mul_ps(s, oddReal))));
+    }
+    
+    untangleScalar(zr, zi, cosines, sines, real, imag, m, k, m);
+}
+
+MN_TARGET_AVX2
+static void preProcessAVX2(const float* real,
+                           const float* imag,
+                           const float* cosines,
+                           const float* sines,
+                           float* zr,
+                           float* zi,
+                           int m)
+{
+    const __m256 scale = _mm256_set1_ps(0.5f / m);
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    
+    int k = 0;
+    for (; k + 8 <= m; k += 8)
+    {
+        //bins m - k - 7 ... m - k, reversed to line up with k ... k + 7
+        const __m256 br = _mm256_permutevar8x32_ps(_mm256_loadu_ps(real + m - k - 7), reverse);
+        const __m256 bi = _mm256_permutevar8x32_ps(_mm256_loadu_ps(imag + m - k - 7), reverse);
+        const __m256 ar = _mm256_loadu_ps(real + k);
+        const __m256 ai = _mm256_loadu_ps(imag + k);
+        const __m256 c = _mm256_loadu_ps(cosines + k);
+        const __m256 s = _mm256_loadu_ps(sines + k);
+        const __m256 diffReal = _mm256_sub_ps(ar, br);
+        const __m256 diffImag = _mm256_add_ps(ai, bi);
+        const __m256 sumReal = _mm256_sub_ps(_mm256_add_ps(ar, br), _mm256_add_ps(_mm256_mul_ps(s, diffReal), _mm256_mul_ps(c, diffImag)));
+        const __m256 sumImag = _mm256_add_ps(_mm256_sub_ps(ai, bi), _mm256_sub_ps(_mm256_mul_ps(c, diffReal), _mm256_mul_ps(s, diffImag)));
+        _mm256_storeu_ps(zr + k, _mm256_mul_ps(scale, sumReal));
+        _mm256_storeu_ps(zi + k, _mm256_mul_ps(scale, sumImag));
+    }
+    
+    entangleScalar(real, imag, cosines, sines, zr, zi, m, k, m);
+}
+
+#elif MN_SIMD_ARM64
+
+static void stageNEON(const float* xr,
+                      const float* xi,
+                      float* yr,
+                      float* yi,
+                      const float* twiddlesReal,
+                      const float* twiddlesImag,
+                      int n,
+                      int s)
+{
+    const int m = n / 2;
+    if (s == 1)
+    {
+        for (int p = 0; p < m; p += 4)
+        {
+            const float32x4_t ar = vld1q_f32(xr + p);
+            const float32x4_t ai = vld1q_f32(xi + p);
+            const float32x4_t br = vld1q_f32(xr + p + m);
+            const float32x4_t bi = vld1q_f32(xi + p + m);
+            const float32x4_t wr = vld1q_f32(twiddlesReal + p);
+            const float32x4_t wi = vld1q_f32(twiddlesImag + p);
+            const float32x4_t dr = vsubq_f32(ar, br);
+            const float32x4_t di = vsubq_f32(ai, bi);
+            float32x4x2_t real;
+            float32x4x2_t imag;
+            real.val[0] = vaddq_f32(ar, br);
+            imag.val[0] = vaddq_f32(ai, bi);
+            real.val[1] = vfmsq_f32(vmulq_f32(dr, wr), di, wi);
+            imag.val[1] = vfmaq_f32(vmulq_f32(dr, wi), di, wr);
+            vst2q_f32(yr + 2 * p, real);
+            vst2q_f32(yi + 2 * p, imag);
+        }
+    }
+    else if (s == 2)
+    {
+        //lanes hold q = 0, 1 of two consecutive values of p
+        for (int p = 0; p < m; p += 2)
+        {
+            const float32x4_t ar = vld1q_f32(xr + 2 * p);
+            const float32x4_t ai = vld1q_f32(xi + 2 * p);
+            const float32x4_t br = vld1q_f32(xr + 2 * (p + m));
+            const float32x4_t bi = vld1q_f32(xi + 2 * (p + m));
+            const float32x4_t twr = vld1q_f32(twiddlesReal + 2 * p);
+            const float32x4_t twi = vld1q_f32(twiddlesImag + 2 * p);
+            const float32x4_t wr = vtrn1q_f32(twr, twr);
+            const float32x4_t wi = vtrn1q_f32(twi, twi);
+            const float32x4_t sr = vaddq_f32(ar, br);
+            const float32x4_t si = vaddq_f32(ai, bi);
+            const float32x4_t dr = vsubq_f32(ar, br);
+            const float32x4_t di = vsubq_f32(ai, bi);
+            const float32x4_t tr = vfmsq_f32(vmulq_f32(dr, wr), di, wi);
+            const float32x4_t ti = vfmaq_f32(vmulq_f32(dr, wi), di, wr);
+            vst1q_f32(yr + 4 * p, vcombine_f32(vget_low_f32(sr), vget_low_f32(tr)));
+            vst1q_f32(yr + 4 * p + 4, vcombine_f32(vget_high_f32(sr), vget_high_f32(tr)));
+            vst1q_f32(yi + 4 * p, vcombine_f32(vget_low_f32(si), vget_low_f32(ti)));
+            vst1q_f32(yi + 4 * p + 4, vcombine_f32(vget_high_f32(si), vget_high_f32(ti)));
+        }
+    }
+    else
+    {
+        for (int p = 0; p < m; p++)
+        {
+            const float32x4_t wr = vdupq_n_f32(twiddlesReal[p * s]);
+            const float32x4_t wi = vdupq_n_f32(twiddlesImag[p * s]);
+            const float* ar = xr + s * p;
+            const float* ai = xi + s * p;
+            const float* br = ar + s * m;
+            const float* bi = ai + s * m;
+            float* evenReal = yr + s * 2 * p;
+            float* evenImag = yi + s * 2 * p;
+            for (int q = 0; q < s; q += 4)
+            {
+                const float32x4_t a0 = vld1q_f32(ar + q);
+                const float32x4_t a1 = vld1q_f32(ai + q);
+                const float32x4_t b0 = vld1q_f32(br + q);
+                const float32x4_t b1 = vld1q_f32(bi + q);
+                const float32x4_t dr = vsubq_f32(a0, b0);
+                const float32x4_t di = vsubq_f32(a1, b1);
+                vst1q_f32(evenReal + q, vaddq_f32(a0, b0));
+                vst1q_f32(evenImag + q, vaddq_f32(a1, b1));
+                vst1q_f32(evenReal + s + q, vfmsq_f32(vmulq_f32(dr, wr), di, wi));
+                vst1q_f32(evenImag + s + q, vfmaq_f32(vmulq_f32(dr, wi), di, wr));
+            }
+        }
+    }
+}
+
+static void postProcessNEON(const float* zr,
+                            const float* zi,
+                            const float* cosines,
+                            const float* sines,
+                            float* real,
+                            float* imag,
+                            int m)
+{
+    untangleEnds(zr, zi, real, imag, m);
+    
+    int k = 1;
+    for (; k + 4 <= m; k += 4)
+    {
+        //bins m - k - 3 ... m - k, reversed to line up with k ... k + 3
+        const float32x4_t jr = vrev64q_f32(vld1q_f32(zr + m - k - 3));
+        const float32x4_t ji = vrev64q_f32(vld1q_f32(zi + m - k - 3));
+        const float32x4_t br = vextq_f32(jr, jr, 2);
+        const float32x4_t bi = vextq_f32(ji, ji, 2);
+        const float32x4_t ar = vld1q_f32(zr + k);
+        const float32x4_t ai = vld1q_f32(zi + k);
+        const float32x4_t c = vld1q_f32(cosines + k);
+        const float32x4_t s = vld1q_f32(sines + k);
+        const float32x4_t evenReal = vmulq_n_f32(vaddq_f32(ar, br), 0.5f);
+        const float32x4_t evenImag = vmulq_n_f32(vsubq_f32(ai, bi), 0.5f);
+        const float32x4_t oddReal = vmulq_n_f32(vaddq_f32(ai, bi), 0.5f);
+        const float32x4_t oddImag = vmulq_n_f32(vsubq_f32(br, ar), 0.5f);
+        vst1q_f32(real + k, vfmaq_f32(vfmaq_f32(evenReal, c, oddReal), s, oddImag));
+        vst1q_f32(imag + k, vfmsq_f32(vfmaq_f32(evenImag, c, oddImag), s, oddReal));
+    }
+    
+    untangleScalar(zr, zi, cosines, sines, real, imag, m, k, m);
+}
+
+static void preProcessNEON(const float* real,
+                           const float* imag,
+                           const float* cosines,
+                           const float* sines,
+                           float* zr,
+                           float* zi,
+                           int m)
+{
+    const float scale = 0.5f / m;
+    
+    int k = 0;
+    for (; k + 4 <= m; k += 4)
+    {
+        //bins m - k - 3 ... m - k, reversed to line up with k ... k + 3
+        const float32x4_t jr = vrev64q_f32(vld1q_f32(real + m - k - 3));
+        const float32x4_t ji = vrev64q_f32(vld1q_f32(imag + m - k - 3));
+        const float32x4_t br = vextq_f32(jr, jr, 2);
+        const float32x4_t bi = vextq_f32(ji, ji, 2);
+        const float32x4_t ar = vld1q_f32(real + k);
+        const float32x4_t ai = vld1q_f32(imag + k);
+        const float32x4_t c = vld1q_f32(cosines + k);
+        const float32x4_t s = vld1q_f32(sines + k);
+        const float32x4_t diffReal = vsubq_f32(ar, br);
+        const float32x4_t diffImag = vaddq_f32(ai, bi);
+        const float32x4_t sumReal = vfmsq_f32(vfmsq_f32(vaddq_f32(ar, br), s, diffReal), c, diffImag);
+        const float32x4_t sumImag = vfmsq_f32(vfmaq_f32(vsubq_f32(ai, bi), c, diffReal), s, diffImag);
+        vst1q_f32(zr + k, vmulq_n_f32(sumReal, scale));
+        vst1q_f32(zi + k, vmulq_n_f32(sumImag, scale));
+    }
+    
+    entangleScalar(real, imag, cosines, sines, zr, zi, m, k, m);
+}
+
+#endif
+
+typedef void (*stageFunction)(const float* xr,
+                              const float* xi,
+                              float* yr,
+                              float* yi,
+                              const float* twiddlesReal,
+                              const float* twiddlesImag,
+                              int n,
+                              int s);
+typedef void (*postProcessFunction)(const float* zr,
+                                    const float* zi,
+                                    const float* cosines,
+                                    const float* sines,
+                                    float* real,
+                                    float* imag,
+                                    int m);
+typedef void (*preProcessFunction)(const float* real,
+                                   const float* imag,
+                                   const float* cosines,
+                                   const float* sines,
+                                   float* zr,
+                                   float* zi,
+                                   int m);
+
+static void getKernels(stageFunction* stage, postProcessFunction* postProcess, preProcessFunction* preProcess)
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            *stage = stageSSE2;
+            *postProcess = postProcessSSE2;
+            *preProcess = preProcessSSE2;
+            return;
+        case MN_SIMD_AVX2:
+            *stage = stageAVX2;
+            *postProcess = postProcessAVX2;
+            *preProcess = preProcessAVX2;
+            return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            *stage = stageNEON;
+            *postProcess = postProcessNEON;
+            *preProcess = preProcessNEON;
+            return;
+#endif
+        default:
+            *stage = stageScalar;
+            *postProcess = postProcessScalar;
+            *preProcess = preProcessScalar;
+            return;
+    }
+}
+
+/**
+ * Runs all stages, starting from the first set of buffers.
+ * @return The buffer holding the real parts of the result, followed by the
+ * imaginary parts.
+ */
+static float* runStages(mnFFT* fft, stageFunction stage)
+{
+    const int m = fft->size / 2;
+    float* xr = fft->buffers;
+    float* xi = xr + m;
+    float* yr = xi + m;
+    float* yi = yr + m;
+    
+    for (int n = m, s = 1; n > 1; n /= 2, s *= 2)
+    {
+        stage(xr, xi, yr, yi, fft->twiddles, fft->twiddles + m / 2, n, s);
+        float* swap = xr;
+        xr = yr;
+        yr = swap;
+        swap = xi;
+        xi = yi;
+        yi = swap;
+    }
+    
+    return xr;
+}
+
+/* FFT */
+
+int mnFFT_init(mnFFT* fft, int size)
+{
+    memset(fft, 0, sizeof(mnFFT));
+    if (size < 16 || (size & (size - 1)) != 0)
+    {
+        return 0;
+    }
+    
+    fft->size = size;
+    const int m = size / 2;
+    fft->twiddles = malloc(2 * (m / 2) * sizeof(float));
+    fft->postTwiddles = malloc(2 * m * sizeof(float));
+    fft->buffers = malloc(4 * m * sizeof(float));
+    if (!fft->twiddles || !fft->postTwiddles || !fft->buffers)
+    {
+        mnFFT_deinit(fft);
+        return 0;
+    }
+    
+    for (int j = 0; j < m / 2; j++)
+    {
+        const double angle = 2.0 * MN_PI * j / m;
+        fft->twiddles[j] = (float)cos(angle);
+        fft->twiddles[m / 2 + j] = (float)-sin(angle);
+    }
+    for (int k = 0; k < m; k++)
+    {
+        const double angle = 2.0 * MN_PI * k / size;
+        fft->postTwiddles[k] = (float)cos(angle);
+        fft->postTwiddles[m + k] = (float)sin(angle);
+    }
+    
+    return 1;
+}
+
+void mnFFT_deinit(mnFFT* fft)
+{
+    free(fft->twiddles);
+    free(fft->postTwiddles);
+    free(fft->buffers);
+    memset(fft, 0, sizeof(mnFFT));
+}
+
+void mnFFT_forwardReal(mnFFT* fft, const float* input, float* real, float* imag)
+{
+    const int m = fft->size / 2;
+    float* xr = fft->buffers;
+    float* xi = xr + m;
+    
+    //the even samples are the real parts and the odd ones the imaginary parts
+    for (int i = 0; i < m; i++)
+    {
+        xr[i] = input[2 * i];
+        xi[i] = input[2 * i + 1];
+    }
+    
+    stageFunction stage;
+    postProcessFunction postProcess;
+    preProcessFunction preProcess;
+    getKernels(&stage, &postProcess, &preProcess);
+    
+    const float* z = runStages(fft, stage);
+    postProcess(z, z + m, fft->postTwiddles, fft->postTwiddles + m, real, imag, m);
+}
+
+void mnFFT_inverseReal(mnFFT* fft, const float* real, const float* imag, float* output)
+{
+    const int m = fft->size / 2;
+    float* xr = fft->buffers;
+    float* xi = xr + m;
+    
+    stageFunction stage;
+    postProcessFunction postProcess;
+    preProcessFunction preProcess;
+    getKernels(&stage, &postProcess, &preProcess);
+    
+    //swapping the real and imaginary parts on the way in and out conjugates the transform
+    preProcess(real, imag, fft->postTwiddles, fft->postTwiddles + m, xi, xr, m);
+    const float* z = runStages(fft, stage);
+    for (int i = 0; i < m; i++)
+    {
+        output[2 * i] = z[m + i];
+        output[2 * i + 1] = z[i];
+    }
+}
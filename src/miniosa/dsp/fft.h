@@ -0,0 +1,93 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_FFT_H
+#define MN_FFT_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Forward FFT of real input whose size is a power of two.
+     *
+     * The N real samples are treated as N / 2 complex samples, which a
+     * radix-2 Stockham transform processes in natural order, ping-ponging
+     * between two sets of split real and imaginary buffers so no bit reversal
+     * is needed. A final pass untangles the N / 2 + 1 bins of the real
+     * transform. The inverse transform runs the same passes in reverse. The
+     * stages and the untangling passes have a plain C reference and
+     * SSE2, AVX2 and NEON versions, picked at run time according to
+     * mnSIMD_getLevel.
+     */
+    typedef struct mnFFT
+    {
+        /** The number of real input samples. */
+        int size;
+        /** exp(-2 pi i j / (size / 2)) for j < size / 4, real parts followed by imaginary parts. */
+        float* twiddles;
+        /** cos(2 pi k / size) for k < size / 2 followed by the corresponding sines. */
+        float* postTwiddles;
+        /** Two sets of size / 2 real parts followed by size / 2 imaginary parts. */
+        float* buffers;
+    } mnFFT;
+    
+    /**
+     * Initializes an FFT.
+     * @param size The number of real input samples, a power of two of at least 16.
+     * @return Non-zero on success, 0 if the size is invalid or allocation failed.
+     */
+    int mnFFT_init(mnFFT* fft, int size);
+    
+    /**
+     *
+     */
+    void mnFFT_deinit(mnFFT* fft);
+    
+    /**
+     * Transforms \c size real samples. Doesn't allocate, so it may be called
+     * from the audio thread, but not from several threads at once.
+     * @param real Receives the real parts of bins 0 ... size / 2.
+     * @param imag Receives the imaginary parts of bins 0 ... size / 2.
+     */
+    void mnFFT_forwardReal(mnFFT* fft, const float* input, float* real, float* imag);
+    
+    /**
+     * The inverse of ::mnFFT_forwardReal, including the 1 / size scaling, so
+     * a round trip gives back the input. The imaginary parts of bins 0 and
+     * size / 2 are ignored. Doesn't allocate.
+     * @param real The real parts of bins 0 ... size / 2.
+     * @param imag The imaginary parts of bins 0 ... size / 2.
+     * @param output Receives \c size real samples.
+     */
+    void mnFFT_inverseReal(mnFFT* fft, const float* real, const float* imag, float* output);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_FFT_H
@@ -0,0 +1,546 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atomic.h"
+#include "dsp_math.h"
+#include "meter.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+/*
+ * Each channel's work buffer holds TAPS - 1 frames of history followed by up
+ * to MN_METER_BLOCK_SIZE new frames. The interpolated values for frame i of
+ * a block are computed from buffer[i] ... buffer[i + TAPS - 1] and lie
+ * between buffer[i + TAPS / 2 - 1] and buffer[i + TAPS / 2], so the true peak
+ * lags the sample peak by TAPS / 2 frames, which no one can see on a meter.
+ *
+ * The kernels run over frames rather than taps, broadcasting one coefficient
+ * at a time against a vector of consecutive frames, so no horizontal sums
+ * are needed. They have a plain C reference and SSE2, AVX2 and NEON versions,
+ * picked at run time according to mnSIMD_getLevel.
+ */
+
+#define TAPS MN_METER_TRUE_PEAK_TAPS
+#define NUM_PHASES (MN_METER_OVERSAMPLING - 1)
+#define WORK_BUFFER_SIZE (TAPS - 1 + MN_METER_BLOCK_SIZE)
+#define NUM_PUBLISHED_LEVELS 4
+/** The peak, sum of squares and true peak of a buffer. */
+#define NUM_MEASUREMENTS 3
+
+/* Filter design */
+
+/**
+ * Fills in the filters for the phases between samples, each a Hann windowed
+ * sinc normalized to unity gain at DC.
+ */
+static void designFilters(float* filters)
+{
+    const double halfLength = 0.5 * TAPS;
+    
+    for (int p = 0; p < NUM_PHASES; p++)
+    {
+        float* filter = filters + p * TAPS;
+        const double f = (double)(p + 1) / MN_METER_OVERSAMPLING;
+        double sum = 0.0;
+        
+        for (int k = 0; k < TAPS; k++)
+        {
+            const double x = k - (halfLength - 1.0) - f;
+            const double window = 0.5 + 0.5 * cos(MN_PI * x / halfLength);
+            const double t = MN_PI * x;
+            const double sinc = fabs(t) < 1e-12 ? 1.0 : sin(t) / t;
+            filter[k] = (float)(sinc * window);
+            sum += filter[k];
+        }
+        
+        const float gain = (float)(1.0 / sum);
+        for (int k = 0; k < TAPS; k++)
+        {
+            filter[k] *= gain;
+        }
+    }
+}
+
+/* Kernels */
+
+/**
+ * Measures frames first ... last - 1 of a work buffer one at a time. Used
+ * by the reference kernel and for the frames left over by the vector loops.
+ */
+static void measureFramesScalar(const float* buffer,
+                                int first,
+                                int last,
+                                const float* filters,
+                                float* peak,
+                                float* sumOfSquares,
+                                float* truePeak)
+{
+    float maxSample = *peak;
+    float sum = 0.0f;
+    float maxInterpolated = *truePeak;
+    
+    for (int i = first; i < last; i++)
+    {
+        const float x = buffer[TAPS - 1 + i];
+        maxSample = fabsf(x) > maxSample ? fabsf(x) : maxSample;
+        sum += x * x;
+        
+        for (int p = 0; p < NUM_PHASES; p++)
+        {
+            const float* filter = filters + p * TAPS;
+            float y = 0.0f;
+            for (int k = 0; k < TAPS; k++)
+            {
+                y += filter[k] * buffer[i + k];
+            }
+            maxInterpolated = fabsf(y) > maxInterpolated ? fabsf(y) : maxInterpolated;
+        }
+    }
+    
+    *peak = maxSample;
+    *sumOfSquares += sum;
+    *truePeak = maxInterpolated;
+}
+
+static void measureScalar(const float* buffer,
+                          int numFrames,
+                          const float* filters,
+                          float* peak,
+                          float* sumOfSquares,
+                          float* truePeak)
+{
+    measureFramesScalar(buffer, 0, numFrames, filters, peak, sumOfSquares, truePeak);
+}
+
+#if MN_SIMD_X86
+
+static void measureSSE2(const float* buffer,
+                        int numFrames,
+                        const float* filters,
+                        float* peak,
+                        float* sumOfSquares,
+                        float* truePeak)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 maxSample = _mm_setzero_ps();
+    __m128 sum = _mm_setzero_ps();
+    __m128 maxInterpolated = _mm_setzero_ps();
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(buffer + TAPS - 1 + i);
+        maxSample = _mm_max_ps(maxSample, _mm_andnot_ps(signMask, x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+        
+        for (int p = 0; p < NUM_PHASES; p++)
+        {
+            const float* filter = filters + p * TAPS;
+            __m128 y0 = _mm_setzero_ps();
+            __m128 y1 = _mm_setzero_ps();
+            for (int k = 0; k < TAPS; k += 2)
+            {
+                y0 = _mm_add_ps(y0, _mm_mul_ps(_mm_set1_ps(filter[k]), _mm_loadu_ps(buffer + i + k)));
+                y1 = _mm_add_ps(y1, _mm_mul_ps(_mm_set1_ps(filter[k + 1]), _mm_loadu_ps(buffer + i + k + 1)));
+            }
+            maxInterpolated = _mm_max_ps(maxInterpolated, _mm_andnot_ps(signMask, _mm_add_ps(y0, y1)));
+        }
+    }
+    
+    float lanes[3][4];
+    _mm_storeu_ps(lanes[0], maxSample);
+    _mm_storeu_ps(lanes[1], sum);
+    _mm_storeu_ps(lanes[2], maxInterpolated);
+    for (int l = 0; l < 4; l++)
+    {
+        *peak = lanes[0][l] > *peak ? lanes[0][l] : *peak;
+        *sumOfSquares += lanes[1][l];
+        *truePeak = lanes[2][l] > *truePeak ? lanes[2][l] : *truePeak;
+    }
+    
+    measureFramesScalar(buffer, i, numFrames, filters, peak, sumOfSquares, truePeak);
+}
+
+MN_TARGET_AVX2
+static void measureAVX2(const float* buffer,
+                        int numFrames,
+                        const float* filters,
+                        float* peak,
+                        float* sumOfSquares,
+                        float* truePeak)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 maxSample = _mm256_setzero_ps();
+    __m256 sum = _mm256_setzero_ps();
+    __m256 maxInterpolated = _mm256_setzero_ps();
+    
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(buffer + TAPS - 1 + i);
+        maxSample = _mm256_max_ps(maxSample, _mm256_andnot_ps(signMask, x));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x, x));
+        
+        for (int p = 0; p < NUM_PHASES; p++)
+        {
+            const float* filter = filters + p * TAPS;
+            __m256 y0 = _mm256_setzero_ps();
+            __m256 y1 = _mm256_setzero_ps();
+            for (int k = 0; k < TAPS; k += 2)
+            {
+                y0 = _mm256_add_ps(y0, _mm256_mul_ps(_mm256_set1_ps(filter[k]), _mm256_loadu_ps(buffer + i + k)));
+                y1 = _mm256_add_ps(y1, _mm256_mul_ps(_mm256_set1_ps(filter[k + 1]), _mm256_loadu_ps(buffer + i + k + 1)));
+            }
+            maxInterpolated = _mm256_max_ps(maxInterpolated, _mm256_andnot_ps(signMask, _mm256_add_ps(y0, y1)));
+        }
+    }
+    
+    float lanes[3][8];
+    _mm256_storeu_ps(lanes[0], maxSample);
+    _mm256_storeu_ps(lanes[1], sum);
+    _mm256_storeu_ps(lanes[2], maxInterpolated);
+    for (int l = 0; l < 8; l++)
+    {
+        *peak = lanes[0][l] > *peak ? lanes[0][l] : *peak;
+        *sumOfSquares += lanes[1][l];
+        *truePeak = lanes[2][l] > *truePeak ? lanes[2][l] : *truePeak;
+    }
+    
+    measureFramesScalar(buffer, i, numFrames, filters, peak, sumOfSquares, truePeak);
+}
+
+#elif MN_SIMD_ARM64
+
+static void measureNEON(const float* buffer,
+                        int numFrames,
+                        const float* filters,
+                        float* peak,
+                        float* sumOfSquares,
+                        float* truePeak)
+{
+    float32x4_t maxSample = vdupq_n_f32(0.0f);
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x4_t maxInterpolated = vdupq_n_f32(0.0f);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(buffer + TAPS - 1 + i);
+        maxSample = vmaxq_f32(maxSample, vabsq_f32(x));
+        sum = vfmaq_f32(sum, x, x);
+        
+        for (int p = 0; p < NUM_PHASES; p++)
+        {
+            const float* filter = filters + p * TAPS;
+            float32x4_t y0 = vdupq_n_f32(0.0f);
+            float32x4_t y1 = vdupq_n_f32(0.0f);
+            for (int k = 0; k < TAPS; k += 2)
+            {
+                y0 = vfmaq_n_f32(y0, vld1q_f32(buffer + i + k), filter[k]);
+                y1 = vfmaq_n_f32(y1, vld1q_f32(buffer + i + k + 1), filter[k + 1]);
+            }
+            maxInterpolated = vmaxq_f32(maxInterpolated, vabsq_f32(vaddq_f32(y0, y1)));
+        }
+    }
+    
+    const float maxSampleLane = vmaxvq_f32(maxSample);
+    const float maxInterpolatedLane = vmaxvq_f32(maxInterpolated);
+    *peak = maxSampleLane > *peak ? maxSampleLane : *peak;
+    *sumOfSquares += vaddvq_f32(sum);
+    *truePeak = maxInterpolatedLane > *truePeak ? maxInterpolatedLane : *truePeak;
+    
+    measureFramesScalar(buffer, i, numFrames, filters, peak, sumOfSquares, truePeak);
+}
+
+#endif
+
+typedef void (*measureFunction)(const float* buffer,
+                                int numFrames,
+                                const float* filters,
+                                float* peak,
+                                float* sumOfSquares,
+                                float* truePeak);
+
+static measureFunction getKernel()
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            return measureSSE2;
+        case MN_SIMD_AVX2:
+            return measureAVX2;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            return measureNEON;
+#endif
+        default:
+            return measureScalar;
+    }
+}
+
+/* Meter */
+
+int mnMeter_init(mnMeter* meter, int numChannels, float sampleRate)
+{
+    memset(meter, 0, sizeof(mnMeter));
+    if (numChannels < 1 || sampleRate <= 0.0f)
+    {
+        return 0;
+    }
+    
+    meter->numChannels = numChannels;
+    meter->sampleRate = sampleRate;
+    
+    meter->filters = malloc(NUM_PHASES * TAPS * sizeof(float));
+    meter->workBuffers = calloc(numChannels * WORK_BUFFER_SIZE, sizeof(float));
+    meter->levels = calloc(numChannels, sizeof(mnMeterLevels));
+    meter->measurements = malloc(numChannels * NUM_MEASUREMENTS * sizeof(float));
+    meter->publishedLevels = calloc(numChannels * NUM_PUBLISHED_LEVELS, sizeof(int));
+    if (!meter->filters || !meter->workBuffers || !meter->levels || !meter->measurements || !meter->publishedLevels)
+    {
+        mnMeter_deinit(meter);
+        return 0;
+    }
+    
+    designFilters(meter->filters);
+    mnMeter_setBallistics(meter, 0.0f, 1.5f, 0.3f);
+    return 1;
+}
+
+void mnMeter_deinit(mnMeter* meter)
+{
+    free(meter->filters);
+    free(meter->workBuffers);
+    free(meter->levels);
+    free(meter->measurements);
+    free(meter->publishedLevels);
+    memset(meter, 0, sizeof(mnMeter));
+}
+
+void mnMeter_setBallistics(mnMeter* meter, float attackTime, float releaseTime, float integrationTime)
+{
+    meter->attackTime = attackTime > 0.0f ? attackTime : 0.0f;
+    meter->releaseTime = releaseTime > 0.0f ? releaseTime : 0.0f;
+    meter->integrationTime = integrationTime > 0.0f ? integrationTime : 0.0f;
+    //recompute the coefficients on the next buffer
+    meter->coefficientsNumFrames = 0;
+}
+
+/**
+ * The coefficient of a one-pole filter updated once every numFrames frames.
+ */
+static float getCoefficient(float time, float sampleRate, int numFrames)
+{
+    if (time <= 0.0f)
+    {
+        return 1.0f;
+    }
+    return (float)(1.0 - exp(-numFrames / ((double)time * sampleRate)));
+}
+
+/**
+ * Applies a one-pole filter with separate coefficients for rising and falling values.
+ */
+static inline float follow(float level, float target, float attackCoefficient, float releaseCoefficient)
+{
+    const float coefficient = target > level ? attackCoefficient : releaseCoefficient;
+    return level + coefficient * (target - level);
+}
+
+static inline int floatBits(float value)
+{
+    int bits;
+    memcpy(&bits, &value, sizeof(int));
+    return bits;
+}
+
+static inline float bitsToFloat(int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+/**
+ * Measures the frames in the work buffers, then moves the last TAPS - 1
+ * frames of each to the front to become the history of the next block.
+ */
+static void measureBlock(mnMeter* meter, measureFunction measure, int numFrames)
+{
+    for (int c = 0; c < meter->numChannels; c++)
+    {
+        float* buffer = meter->workBuffers + c * WORK_BUFFER_SIZE;
+        float* measurements = meter->measurements + c * NUM_MEASUREMENTS;
+        measure(buffer, numFrames, meter->filters, &measurements[0], &measurements[1], &measurements[2]);
+        memmove(buffer, buffer + numFrames, (TAPS - 1) * sizeof(float));
+    }
+}
+
+/**
+ * Applies the ballistics to the measurements of a buffer and publishes the levels.
+ */
+static void update(mnMeter* meter, int numFrames)
+{
+    if (numFrames != meter->coefficientsNumFrames)
+    {
+        meter->attackCoefficient = getCoefficient(meter->attackTime, meter->sampleRate, numFrames);
+        meter->releaseCoefficient = getCoefficient(meter->releaseTime, meter->sampleRate, numFrames);
+        meter->integrationCoefficient = getCoefficient(meter->integrationTime, meter->sampleRate, numFrames);
+        meter->coefficientsNumFrames = numFrames;
+    }
+    
+    const int isResetRequested = mnAtomicLoadAcquire(&meter->isResetRequested);
+    if (isResetRequested)
+    {
+        mnAtomicStoreRelaxed(0, &meter->isResetRequested);
+    }
+    
+    for (int c = 0; c < meter->numChannels; c++)
+    {
+        mnMeterLevels* levels = &meter->levels[c];
+        const float* measurements = meter->measurements + c * NUM_MEASUREMENTS;
+        const float peak = measurements[0];
+        //the true peak is at least the peak of the samples the interpolation passes through
+        const float truePeak = measurements[2] > peak ? measurements[2] : peak;
+        levels->peak = follow(levels->peak, peak, meter->attackCoefficient, meter->releaseCoefficient);
+        levels->truePeak = follow(levels->truePeak, truePeak, meter->attackCoefficient, meter->releaseCoefficient);
+        levels->rms += meter->integrationCoefficient * (measurements[1] / numFrames - levels->rms);
+        if (isResetRequested || truePeak > levels->maxTruePeak)
+        {
+            levels->maxTruePeak = truePeak;
+        }
+    }
+    
+    //an odd sequence number tells readers that the levels are being updated
+    const int sequence = mnAtomicLoadRelaxed(&meter->sequence);
+    mnAtomicStoreRelaxed(sequence + 1, &meter->sequence);
+    mnAtomicFenceRelease();
+    
+    for (int c = 0; c < meter->numChannels; c++)
+    {
+        const mnMeterLevels* levels = &meter->levels[c];
+        int* published = meter->publishedLevels + c * NUM_PUBLISHED_LEVELS;
+        mnAtomicStoreRelaxed(floatBits(levels->peak), &published[0]);
+        mnAtomicStoreRelaxed(floatBits(sqrtf(levels->rms)), &published[1]);
+        mnAtomicStoreRelaxed(floatBits(levels->truePeak), &published[2]);
+        mnAtomicStoreRelaxed(floatBits(levels->maxTruePeak), &published[3]);
+    }
+    
+    mnAtomicStoreRelease(sequence + 2, &meter->sequence);
+}
+
+void mnMeter_processPlanar(mnMeter* meter, const float* const* channels, int numFrames)
+{
+    if (numFrames <= 0)
+    {
+        return;
+    }
+    
+    const int numChannels = meter->numChannels;
+    const measureFunction measure = getKernel();
+    memset(meter->measurements, 0, NUM_MEASUREMENTS * numChannels * sizeof(float));
+    
+    for (int start = 0; start < numFrames; start += MN_METER_BLOCK_SIZE)
+    {
+        const int n = numFrames - start < MN_METER_BLOCK_SIZE ? numFrames - start : MN_METER_BLOCK_SIZE;
+        for (int c = 0; c < numChannels; c++)
+        {
+            memcpy(meter->workBuffers + c * WORK_BUFFER_SIZE + TAPS - 1, channels[c] + start, n * sizeof(float));
+        }
+        measureBlock(meter, measure, n);
+    }
+    
+    update(meter, numFrames);
+}
+
+void mnMeter_processInterleaved(mnMeter* meter, const float* samples, int numFrames)
+{
+    if (numFrames <= 0)
+    {
+        return;
+    }
+    
+    const int numChannels = meter->numChannels;
+    const measureFunction measure = getKernel();
+    memset(meter->measurements, 0, NUM_MEASUREMENTS * numChannels * sizeof(float));
+    
+    for (int start = 0; start < numFrames; start += MN_METER_BLOCK_SIZE)
+    {
+        const int n = numFrames - start < MN_METER_BLOCK_SIZE ? numFrames - start : MN_METER_BLOCK_SIZE;
+        const float* frames = samples + start * numChannels;
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* block = meter->workBuffers + c * WORK_BUFFER_SIZE + TAPS - 1;
+            for (int i = 0; i < n; i++)
+            {
+                block[i] = frames[i * numChannels + c];
+            }
+        }
+        measureBlock(meter, measure, n);
+    }
+    
+    update(meter, numFrames);
+}
+
+void mnMeter_getLevels(mnMeter* meter, mnMeterLevels* levels)
+{
+    while (1)
+    {
+        const int sequenceBefore = mnAtomicLoadAcquire(&meter->sequence);
+        if (sequenceBefore & 1)
+        {
+            //the audio thread is in the middle of a write
+            continue;
+        }
+        
+        for (int c = 0; c < meter->numChannels; c++)
+        {
+            int* published = meter->publishedLevels + c * NUM_PUBLISHED_LEVELS;
+            levels[c].peak = bitsToFloat(mnAtomicLoadRelaxed(&published[0]));
+            levels[c].rms = bitsToFloat(mnAtomicLoadRelaxed(&published[1]));
+            levels[c].truePeak = bitsToFloat(mnAtomicLoadRelaxed(&published[2]));
+            levels[c].maxTruePeak = bitsToFloat(mnAtomicLoadRelaxed(&published[3]));
+        }
+        
+        mnAtomicFenceAcquire();
+        if (mnAtomicLoadRelaxed(&meter->sequence) == sequenceBefore)
+        {
+            return;
+        }
+    }
+}
+
+void mnMeter_resetMaxTruePeak(mnMeter* meter)
+{
+    mnAtomicStoreRelease(1, &meter->isResetRequested);
+}
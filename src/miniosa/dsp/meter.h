@@ -0,0 +1,149 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef MN_METER_H
+#define MN_METER_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The number of frames measured per pass over the per channel work buffers. */
+    #define MN_METER_BLOCK_SIZE 256
+    
+    /** The number of taps of each true peak interpolation filter. */
+    #define MN_METER_TRUE_PEAK_TAPS 16
+    
+    /** The oversampling factor of true peak measurements. */
+    #define MN_METER_OVERSAMPLING 4
+    
+    /**
+     * The levels of one channel, as linear amplitudes.
+     */
+    typedef struct mnMeterLevels
+    {
+        /** The sample peak with attack and release ballistics. */
+        float peak;
+        /** The root mean square over the integration time. */
+        float rms;
+        /** The peak between samples, with the same ballistics as \c peak. */
+        float truePeak;
+        /** The highest true peak since the meter was created or last reset. */
+        float maxTruePeak;
+    } mnMeterLevels;
+    
+    /**
+     * Measures the peak, RMS and true peak levels of a number of channels.
+     *
+     * ::mnMeter_processPlanar or ::mnMeter_processInterleaved is called once
+     * per buffer from the audio thread. The samples of each channel are copied
+     * into a work buffer following the channel's history, in blocks of
+     * ::MN_METER_BLOCK_SIZE frames, where a vectorized kernel finds the
+     * absolute maximum, the sum of squares and the absolute maximum of the
+     * signal interpolated at ::MN_METER_OVERSAMPLING times the sample rate.
+     * The ballistics are then applied once per buffer, as one-pole filters
+     * whose coefficients depend on the buffer size.
+     *
+     * The levels are published behind a sequence counter, so that any number
+     * of threads can take consistent snapshots with ::mnMeter_getLevels while
+     * the audio thread never waits.
+     */
+    typedef struct mnMeter
+    {
+        int numChannels;
+        float sampleRate;
+        /** The time in seconds for \c peak and \c truePeak to rise by 63% of a step. 0 by default. */
+        float attackTime;
+        /** The time in seconds for \c peak and \c truePeak to fall by 63% of a step. 1.5 by default. */
+        float releaseTime;
+        /** The time constant in seconds of \c rms. 0.3 by default. */
+        float integrationTime;
+        
+        /** The interpolation filters for the fractional phases, MN_METER_TRUE_PEAK_TAPS each. */
+        float* filters;
+        /** Per channel, MN_METER_TRUE_PEAK_TAPS - 1 frames of history followed by a block. */
+        float* workBuffers;
+        /** The levels, with the mean square instead of \c rms. Only accessed by the audio thread. */
+        mnMeterLevels* levels;
+        /** Per channel, the peak, sum of squares and true peak of the current buffer. */
+        float* measurements;
+        /** The buffer size the ballistics coefficients were computed for. */
+        int coefficientsNumFrames;
+        float attackCoefficient;
+        float releaseCoefficient;
+        float integrationCoefficient;
+        /** Set to make the audio thread reset \c maxTruePeak. Only accessed through atomic operations. */
+        int isResetRequested;
+        
+        /** Odd while the levels are being published. Only accessed through atomic operations. */
+        int sequence;
+        /** The bits of the published levels. Only accessed through atomic operations. */
+        int* publishedLevels;
+    } mnMeter;
+    
+    /**
+     * Initializes a meter with default ballistics.
+     * @return Non-zero on success, 0 if the arguments are invalid or allocation failed.
+     */
+    int mnMeter_init(mnMeter* meter, int numChannels, float sampleRate);
+    
+    /**
+     *
+     */
+    void mnMeter_deinit(mnMeter* meter);
+    
+    /**
+     * Sets the ballistics. Call when the meter is not being processed.
+     */
+    void mnMeter_setBallistics(mnMeter* meter, float attackTime, float releaseTime, float integrationTime);
+    
+    /**
+     * Measures a buffer of planar samples and publishes the levels. Called from the audio thread only.
+     */
+    void mnMeter_processPlanar(mnMeter* meter, const float* const* channels, int numFrames);
+    
+    /**
+     * Measures a buffer of interleaved samples and publishes the levels. Called from the audio thread only.
+     */
+    void mnMeter_processInterleaved(mnMeter* meter, const float* samples, int numFrames);
+    
+    /**
+     * Takes a consistent snapshot of the levels. May be called from any number of threads.
+     * @param levels Receives the levels of each channel.
+     */
+    void mnMeter_getLevels(mnMeter* meter, mnMeterLevels* levels);
+    
+    /**
+     * Makes the audio thread clear \c maxTruePeak of all channels, for example
+     * when the user clicks a clip indicator. May be called from any thread.
+     */
+    void mnMeter_resetMaxTruePeak(mnMeter* meter);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_METER_H
@@ -0,0 +1,527 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "oscillator_bank.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every frame, each voice adds amplitude * sine to its lane of laneMix and
+ * rotates its phasor (cosine, sine) by the angle (rotationCosine,
+ * rotationSine). During a frequency ramp the rotation is interpolated
+ * linearly between the start and end angles, which is accurate for the small
+ * per frame angles of audible frequencies. An interpolated rotation is
+ * slightly shorter than a unit vector, so after every chunk the phasor is
+ * pulled back onto the unit circle with one Newton step towards
+ * 1 / sqrt(c^2 + s^2), which also cancels rounding drift.
+ *
+ * The group kernels have a plain C reference and SSE2, AVX2 and NEON versions,
+ * picked at run time according to mnSIMD_getLevel. Lanes of silent groups are
+ * skipped, and notes are allocated to the lowest free voice so that active
+ * voices stay packed into few groups.
+ */
+
+#define GROUP_SIZE MN_OSCILLATOR_GROUP_SIZE
+#define CHUNK_SIZE MN_OSCILLATOR_CHUNK_SIZE
+
+#define TWO_PI 6.283185307179586
+
+enum
+{
+    VOICE_FREE = 0,
+    VOICE_PLAYING,
+    VOICE_RELEASING
+};
+
+static float* allocateFloats(int size)
+{
+    float* floats = malloc(size * sizeof(float));
+    assert(floats);
+    memset(floats, 0, size * sizeof(float));
+    return floats;
+}
+
+void mnOscillatorBank_init(mnOscillatorBank* bank, int maxVoices, float sampleRate)
+{
+    assert(maxVoices > 0);
+    assert(sampleRate > 0);
+    
+    memset(bank, 0, sizeof(mnOscillatorBank));
+    bank->sampleRate = sampleRate;
+    bank->maxVoices = maxVoices;
+    bank->numSlots = (maxVoices + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+    
+    const int numSlots = bank->numSlots;
+    bank->cosines = allocateFloats(numSlots);
+    bank->sines = allocateFloats(numSlots);
+    bank->rotationCosines = allocateFloats(numSlots);
+    bank->rotationSines = allocateFloats(numSlots);
+    bank->rotationCosineSteps = allocateFloats(numSlots);
+    bank->rotationSineSteps = allocateFloats(numSlots);
+    bank->amplitudes = allocateFloats(numSlots);
+    bank->amplitudeSteps = allocateFloats(numSlots);
+    bank->frequencies = allocateFloats(numSlots);
+    bank->targetFrequencies = allocateFloats(numSlots);
+    bank->targetAmplitudes = allocateFloats(numSlots);
+    bank->voiceStates = calloc(numSlots, sizeof(int));
+    bank->voiceAges = calloc(numSlots, sizeof(unsigned int));
+    assert(bank->voiceStates && bank->voiceAges);
+    
+    for (int i = 0; i < numSlots; i++)
+    {
+        bank->cosines[i] = 1.0f;
+        bank->rotationCosines[i] = 1.0f;
+    }
+}
+
+void mnOscillatorBank_deinit(mnOscillatorBank* bank)
+{
+    free(bank->cosines);
+    free(bank->sines);
+    free(bank->rotationCosines);
+    free(bank->rotationSines);
+    free(bank->rotationCosineSteps);
+    free(bank->rotationSineSteps);
+    free(bank->amplitudes);
+    free(bank->amplitudeSteps);
+    free(bank->frequencies);
+    free(bank->targetFrequencies);
+    free(bank->targetAmplitudes);
+    free(bank->voiceStates);
+    free(bank->voiceAges);
+    memset(bank, 0, sizeof(mnOscillatorBank));
+}
+
+/* Voice allocation */
+
+static void setRotation(mnOscillatorBank* bank, int voice, float frequency)
+{
+    const double angle = TWO_PI * frequency / bank->sampleRate;
+    bank->rotationCosines[voice] = (float)cos(angle);
+    bank->rotationSines[voice] = (float)sin(angle);
+    bank->frequencies[voice] = frequency;
+    bank->targetFrequencies[voice] = frequency;
+}
+
+static int findVoiceToSteal(mnOscillatorBank* bank)
+{
+    int oldest = 0;
+    unsigned int oldestAge = 0;
+    int oldestIsReleasing = 0;
+    for (int i = 0; i < bank->maxVoices; i++)
+    {
+        //ages are relative to the note counter, so wrapping doesn't matter
+        const unsigned int age = bank->noteCounter - bank->voiceAges[i];
+        const int isReleasing = bank->voiceStates[i] == VOICE_RELEASING;
+        if ((isReleasing && !oldestIsReleasing) ||
+            (isReleasing == oldestIsReleasing && age > oldestAge))
+        {
+            oldest = i;
+            oldestAge = age;
+            oldestIsReleasing = isReleasing;
+        }
+    }
+    
+    return oldest;
+}
+
+int mnOscillatorBank_noteOn(mnOscillatorBank* bank, float frequency, float amplitude)
+{
+    int voice = -1;
+    for (int i = 0; i < bank->maxVoices; i++)
+    {
+        if (bank->voiceStates[i] == VOICE_FREE)
+        {
+            voice = i;
+            break;
+        }
+    }
+    
+    if (voice < 0)
+    {
+        voice = findVoiceToSteal(bank);
+    }
+    else
+    {
+        bank->cosines[voice] = 1.0f;
+        bank->sines[voice] = 0.0f;
+        bank->amplitudes[voice] = 0.0f;
+    }
+    
+    bank->noteCounter++;
+    bank->voiceAges[voice] = bank->noteCounter;
+    bank->voiceStates[voice] = VOICE_PLAYING;
+    bank->targetAmplitudes[voice] = amplitude;
+    setRotation(bank, voice, frequency);
+    
+    return voice;
+}
+
+void mnOscillatorBank_noteOff(mnOscillatorBank* bank, int voice)
+{
+    assert(voice >= 0 && voice < bank->maxVoices);
+    if (bank->voiceStates[voice] == VOICE_PLAYING)
+    {
+        bank->voiceStates[voice] = VOICE_RELEASING;
+        bank->targetAmplitudes[voice] = 0.0f;
+    }
+}
+
+void mnOscillatorBank_setFrequency(mnOscillatorBank* bank, int voice, float frequency)
+{
+    assert(voice >= 0 && voice < bank->maxVoices);
+    if (bank->voiceStates[voice] == VOICE_PLAYING)
+    {
+        bank->targetFrequencies[voice] = frequency;
+    }
+}
+
+void mnOscillatorBank_setAmplitude(mnOscillatorBank* bank, int voice, float amplitude)
+{
+    assert(voice >= 0 && voice < bank->maxVoices);
+    if (bank->voiceStates[voice] == VOICE_PLAYING)
+    {
+        bank->targetAmplitudes[voice] = amplitude;
+    }
+}
+
+int mnOscillatorBank_getNumActiveVoices(mnOscillatorBank* bank)
+{
+    int numActive = 0;
+    for (int i = 0; i < bank->maxVoices; i++)
+    {
+        if (bank->voiceStates[i] != VOICE_FREE)
+        {
+            numActive++;
+        }
+    }
+    
+    return numActive;
+}
+
+/* Group kernels */
+
+static void renderGroupScalar(mnOscillatorBank* bank, int first, int numFrames)
+{
+    for (int lane = 0; lane < GROUP_SIZE; lane++)
+    {
+        const int v = first + lane;
+        float c = bank->cosines[v];
+        float s = bank->sines[v];
+        float rc = bank->rotationCosines[v];
+        float rs = bank->rotationSines[v];
+        float a = bank->amplitudes[v];
+        const float rcStep = bank->rotationCosineSteps[v];
+        const float rsStep = bank->rotationSineSteps[v];
+        const float aStep = bank->amplitudeSteps[v];
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            bank->laneMix[i * GROUP_SIZE + lane] += a * s;
+            const float nextC = c * rc - s * rs;
+            s = c * rs + s * rc;
+            c = nextC;
+            rc += rcStep;
+            rs += rsStep;
+            a += aStep;
+        }
+        
+        const float g = 1.5f - 0.5f * (c * c + s * s);
+        bank->cosines[v] = c * g;
+        bank->sines[v] = s * g;
+        bank->rotationCosines[v] = rc;
+        bank->rotationSines[v] = rs;
+        bank->amplitudes[v] = a;
+    }
+}
+
+#if MN_SIMD_X86
+
+static void renderGroupSSE2(mnOscillatorBank* bank, int first, int numFrames)
+{
+    //two vectors per group, interleaved to hide the latency of the rotation
+    __m128 c[2], s[2], rc[2], rs[2], a[2], rcStep[2], rsStep[2], aStep[2];
+    for (int h = 0; h < 2; h++)
+    {
+        const int v = first + 4 * h;
+        c[h] = _mm_loadu_ps(bank->cosines + v);
+        s[h] = _mm_loadu_ps(bank->sines + v);
+        rc[h] = _mm_loadu_ps(bank->rotationCosines + v);
+        rs[h] = _mm_loadu_ps(bank->rotationSines + v);
+        a[h] = _mm_loadu_ps(bank->amplitudes + v);
+        rcStep[h] = _mm_loadu_ps(bank->rotationCosineSteps + v);
+        rsStep[h] = _mm_loadu_ps(bank->rotationSineSteps + v);
+        aStep[h] = _mm_loadu_ps(bank->amplitudeSteps + v);
+    }
+    
+    float* mix = bank->laneMix;
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int h = 0; h < 2; h++)
+        {
+            float* m = mix + i * GROUP_SIZE + 4 * h;
+            _mm_storeu_ps(m, _mm_add_ps(_mm_loadu_ps(m), _mm_mul_ps(a[h], s[h])));
+            const __m128 nextC = _mm_sub_ps(_mm_mul_ps(c[h], rc[h]), _mm_mul_ps(s[h], rs[h]));
+            s[h] = _mm_add_ps(_mm_mul_ps(c[h], rs[h]), _mm_mul_ps(s[h], rc[h]));
+            c[h] = nextC;
+            rc[h] = _mm_add_ps(rc[h], rcStep[h]);
+            rs[h] = _mm_add_ps(rs[h], rsStep[h]);
+            a[h] = _mm_add_ps(a[h], aStep[h]);
+        }
+    }
+    
+    for (int h = 0; h < 2; h++)
+    {
+        const int v = first + 4 * h;
+        const __m128 r2 = _mm_add_ps(_mm_mul_ps(c[h], c[h]), _mm_mul_ps(s[h], s[h]));
+        const __m128 g = _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(0.5f), r2));
+        _mm_storeu_ps(bank->cosines + v, _mm_mul_ps(c[h], g));
+        _mm_storeu_ps(bank->sines + v, _mm_mul_ps(s[h], g));
+        _mm_storeu_ps(bank->rotationCosines + v, rc[h]);
+        _mm_storeu_ps(bank->rotationSines + v, rs[h]);
+        _mm_storeu_ps(bank->amplitudes + v, a[h]);
+    }
+}
+
+MN_TARGET_AVX2
+static void renderGroupAVX2(mnOscillatorBank* bank, int first, int numFrames)
+{
+    __m256 c = _mm256_loadu_ps(bank->cosines + first);
+    __m256 s = _mm256_loadu_ps(bank->sines + first);
+    __m256 rc = _mm256_loadu_ps(bank->rotationCosines + first);
+    __m256 rs = _mm256_loadu_ps(bank->rotationSines + first);
+    __m256 a = _mm256_loadu_ps(bank->amplitudes + first);
+    const __m256 rcStep = _mm256_loadu_ps(bank->rotationCosineSteps + first);
+    const __m256 rsStep = _mm256_loadu_ps(bank->rotationSineSteps + first);
+    const __m256 aStep = _mm256_loadu_ps(bank->amplitudeSteps + first);
+    
+    float* mix = bank->laneMix;
+    for (int i = 0; i < numFrames; i++)
+    {
+        float* m = mix + i * GROUP_SIZE;
+        _mm256_storeu_ps(m, _mm256_add_ps(_mm256_loadu_ps(m), _mm256_mul_ps(a, s)));
+        const __m256 nextC = _mm256_sub_ps(_mm256_mul_ps(c, rc), _mm256_mul_ps(s, rs));
+        s = _mm256_add_ps(_mm256_mul_ps(c, rs), _mm256_mul_ps(s, rc));
+        c = nextC;
+        rc = _mm256_add_ps(rc, rcStep);
+        rs = _mm256_add_ps(rs, rsStep);
+        a = _mm256_add_ps(a, aStep);
+    }
+    
+    const __m256 r2 = _mm256_add_ps(_mm256_mul_ps(c, c), _mm256_mul_ps(s, s));
+    const __m256 g = _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2));
+    _mm256_storeu_ps(bank->cosines + first, _mm256_mul_ps(c, g));
+    _mm256_storeu_ps(bank->sines + first, _mm256_mul_ps(s, g));
+    _mm256_storeu_ps(bank->rotationCosines + first, rc);
+    _mm256_storeu_ps(bank->rotationSines + first, rs);
+    _mm256_storeu_ps(bank->amplitudes + first, a);
+}
+
+#elif MN_SIMD_ARM64
+
+static void renderGroupNEON(mnOscillatorBank* bank, int first, int numFrames)
+{
+    //two vectors per group, interleaved to hide the latency of the rotation
+    float32x4_t c[2], s[2], rc[2], rs[2], a[2], rcStep[2], rsStep[2], aStep[2];
+    for (int h = 0; h < 2; h++)
+    {
+        const int v = first + 4 * h;
+        c[h] = vld1q_f32(bank->cosines + v);
+        s[h] = vld1q_f32(bank->sines + v);
+        rc[h] = vld1q_f32(bank->rotationCosines + v);
+        rs[h] = vld1q_f32(bank->rotationSines + v);
+        a[h] = vld1q_f32(bank->amplitudes + v);
+        rcStep[h] = vld1q_f32(bank->rotationCosineSteps + v);
+        rsStep[h] = vld1q_f32(bank->rotationSineSteps + v);
+        aStep[h] = vld1q_f32(bank->amplitudeSteps + v);
+    }
+    
+    float* mix = bank->laneMix;
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int h = 0; h < 2; h++)
+        {
+            float* m = mix + i * GROUP_SIZE + 4 * h;
+            vst1q_f32(m, vmlaq_f32(vld1q_f32(m), a[h], s[h]));
+            const float32x4_t nextC = vmlsq_f32(vmulq_f32(c[h], rc[h]), s[h], rs[h]);
+            s[h] = vmlaq_f32(vmulq_f32(c[h], rs[h]), s[h], rc[h]);
+            c[h] = nextC;
+            rc[h] = vaddq_f32(rc[h], rcStep[h]);
+            rs[h] = vaddq_f32(rs[h], rsStep[h]);
+            a[h] = vaddq_f32(a[h], aStep[h]);
+        }
+    }
+    
+    for (int h = 0; h < 2; h++)
+    {
+        const int v = first + 4 * h;
+        const float32x4_t r2 = vmlaq_f32(vmulq_f32(c[h], c[h]), s[h], s[h]);
+        const float32x4_t g = vmlsq_f32(vdupq_n_f32(1.5f), vdupq_n_f32(0.5f), r2);
+        vst1q_f32(bank->cosines + v, vmulq_f32(c[h], g));
+        vst1q_f32(bank->sines + v, vmulq_f32(s[h], g));
+        vst1q_f32(bank->rotationCosines + v, rc[h]);
+        vst1q_f32(bank->rotationSines + v, rs[h]);
+        vst1q_f32(bank->amplitudes + v, a[h]);
+    }
+}
+
+#endif
+
+/* Rendering */
+
+typedef void (*renderGroupFunction)(mnOscillatorBank* bank, int first, int numFrames);
+
+static renderGroupFunction getRenderGroupFunction(void)
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            return renderGroupSSE2;
+        case MN_SIMD_AVX2:
+            return renderGroupAVX2;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            return renderGroupNEON;
+#endif
+        default:
+            return renderGroupScalar;
+    }
+}
+
+/**
+ * Sets up the per frame steps that take every active voice from its current
+ * amplitude and frequency to its target over numFrames frames.
+ */
+static void beginRamps(mnOscillatorBank* bank, int numFrames)
+{
+    const float frameScale = 1.0f / numFrames;
+    for (int v = 0; v < bank->maxVoices; v++)
+    {
+        if (bank->voiceStates[v] == VOICE_FREE)
+        {
+            continue;
+        }
+        
+        bank->amplitudeSteps[v] = (bank->targetAmplitudes[v] - bank->amplitudes[v]) * frameScale;
+        
+        if (bank->targetFrequencies[v] != bank->frequencies[v])
+        {
+            const double angle = TWO_PI * bank->targetFrequencies[v] / bank->sampleRate;
+            bank->rotationCosineSteps[v] = ((float)cos(angle) - bank->rotationCosines[v]) * frameScale;
+            bank->rotationSineSteps[v] = ((float)sin(angle) - bank->rotationSines[v]) * frameScale;
+        }
+    }
+}
+
+/**
+ * Replaces the accumulated ramps with their exact end values and frees
+ * voices that have faded out.
+ */
+static void endRamps(mnOscillatorBank* bank)
+{
+    for (int v = 0; v < bank->maxVoices; v++)
+    {
+        if (bank->voiceStates[v] == VOICE_FREE)
+        {
+            continue;
+        }
+        
+        bank->amplitudes[v] = bank->targetAmplitudes[v];
+        bank->amplitudeSteps[v] = 0.0f;
+        
+        if (bank->targetFrequencies[v] != bank->frequencies[v])
+        {
+            setRotation(bank, v, bank->targetFrequencies[v]);
+            bank->rotationCosineSteps[v] = 0.0f;
+            bank->rotationSineSteps[v] = 0.0f;
+        }
+        
+        if (bank->voiceStates[v] == VOICE_RELEASING)
+        {
+            bank->voiceStates[v] = VOICE_FREE;
+        }
+    }
+}
+
+static int isGroupActive(mnOscillatorBank* bank, int first)
+{
+    for (int i = first; i < first + GROUP_SIZE; i++)
+    {
+        if (bank->voiceStates[i] != VOICE_FREE)
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+void mnOscillatorBank_render(mnOscillatorBank* bank, float* output, int numFrames)
+{
+    if (numFrames <= 0)
+    {
+        return;
+    }
+    
+    const renderGroupFunction renderGroup = getRenderGroupFunction();
+    beginRamps(bank, numFrames);
+    
+    for (int start = 0; start < numFrames; start += CHUNK_SIZE)
+    {
+        const int chunkFrames = numFrames - start < CHUNK_SIZE ? numFrames - start : CHUNK_SIZE;
+        memset(bank->laneMix, 0, chunkFrames * GROUP_SIZE * sizeof(float));
+        
+        for (int first = 0; first < bank->numSlots; first += GROUP_SIZE)
+        {
+            if (isGroupActive(bank, first))
+            {
+                renderGroup(bank, first, chunkFrames);
+            }
+        }
+        
+        for (int i = 0; i < chunkFrames; i++)
+        {
+            const float* lanes = bank->laneMix + i * GROUP_SIZE;
+            float sum = 0.0f;
+            for (int lane = 0; lane < GROUP_SIZE; lane++)
+            {
+                sum += lanes[lane];
+            }
+            output[start + i] = sum;
+        }
+    }
+    
+    endRamps(bank);
+}
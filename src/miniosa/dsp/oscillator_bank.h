@@ -0,0 +1,136 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_OSCILLATOR_BANK_H
+#define MN_OSCILLATOR_BANK_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The number of voices rendered side by side in vector lanes. */
+    #define MN_OSCILLATOR_GROUP_SIZE 8
+    
+    /** The number of frames rendered between renormalizations of the oscillators. */
+    #define MN_OSCILLATOR_CHUNK_SIZE 32
+    
+    /**
+     * A bank of sine oscillators that are summed into a mono output.
+     *
+     * Each voice is a recursive quadrature oscillator, a unit phasor that is
+     * rotated by a fixed angle every frame, so rendering costs a few
+     * multiplications per voice and frame instead of a call to \c sinf.
+     * Voices are stored as structure of arrays and rendered in groups of
+     * ::MN_OSCILLATOR_GROUP_SIZE, one voice per vector lane.
+     *
+     * Frequency and amplitude changes take effect as linear ramps over the
+     * next call to ::mnOscillatorBank_render. Frequency ramps interpolate the
+     * rotation, and the phasor is renormalized every ::MN_OSCILLATOR_CHUNK_SIZE
+     * frames to keep its amplitude from drifting.
+     *
+     * A bank is not thread safe. Control functions are meant to be called
+     * from the audio thread, between calls to ::mnOscillatorBank_render.
+     */
+    typedef struct mnOscillatorBank
+    {
+        float sampleRate;
+        int maxVoices;
+        /** maxVoices rounded up to a whole number of groups. */
+        int numSlots;
+        
+        /** Oscillator state. */
+        float* cosines;
+        float* sines;
+        /** The per frame rotation and its per frame change during a ramp. */
+        float* rotationCosines;
+        float* rotationSines;
+        float* rotationCosineSteps;
+        float* rotationSineSteps;
+        float* amplitudes;
+        float* amplitudeSteps;
+        
+        /** Control state. */
+        float* frequencies;
+        float* targetFrequencies;
+        float* targetAmplitudes;
+        int* voiceStates;
+        unsigned int* voiceAges;
+        unsigned int noteCounter;
+        
+        /** Per lane output of the chunk being rendered. */
+        float laneMix[MN_OSCILLATOR_CHUNK_SIZE * MN_OSCILLATOR_GROUP_SIZE];
+    } mnOscillatorBank;
+    
+    /**
+     * Initializes an oscillator bank with all voices free.
+     */
+    void mnOscillatorBank_init(mnOscillatorBank* bank, int maxVoices, float sampleRate);
+    
+    /**
+     *
+     */
+    void mnOscillatorBank_deinit(mnOscillatorBank* bank);
+    
+    /**
+     * Starts a voice at phase zero that fades in to \c amplitude over the next
+     * render call. If all voices are in use, a released voice or else the
+     * oldest voice is taken over, keeping its phase and fading from its
+     * current amplitude.
+     * @return The index of the voice.
+     */
+    int mnOscillatorBank_noteOn(mnOscillatorBank* bank, float frequency, float amplitude);
+    
+    /**
+     * Fades a voice out over the next render call, after which it is free.
+     */
+    void mnOscillatorBank_noteOff(mnOscillatorBank* bank, int voice);
+    
+    /**
+     * Ramps the frequency of a playing voice over the next render call.
+     */
+    void mnOscillatorBank_setFrequency(mnOscillatorBank* bank, int voice, float frequency);
+    
+    /**
+     * Ramps the amplitude of a playing voice over the next render call.
+     */
+    void mnOscillatorBank_setAmplitude(mnOscillatorBank* bank, int voice, float amplitude);
+    
+    /**
+     * Returns the number of voices that are playing or fading out.
+     */
+    int mnOscillatorBank_getNumActiveVoices(mnOscillatorBank* bank);
+    
+    /**
+     * Renders the sum of all active voices, overwriting \c output.
+     */
+    void mnOscillatorBank_render(mnOscillatorBank* bank, float* output, int numFrames);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_OSCILLATOR_BANK_H
@@ -0,0 +1,467 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "dsp_math.h"
+#include "resampler.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+/*
+ * Output frame positions are measured in input frames. The output frame at
+ * position i + f, with integer i and 0 <= f < 1, is the dot product of the
+ * history frames i ... i + numTaps - 1 with the filter for phase f, which
+ * reconstructs the input at history time i + numTaps / 2 - 1 + f. The history
+ * starts out with numTaps - 1 frames of silence, so the first output frame
+ * is at input time -numTaps / 2.
+ *
+ * The filter and dot product kernels have a plain C reference and SSE2, AVX2
+ * and NEON versions, picked at run time according to mnSIMD_getLevel.
+ */
+
+#define ONE_32_32 4294967296.0
+
+typedef struct
+{
+    int numTaps;
+    int numPhases;
+    /** The Kaiser window parameter. */
+    double beta;
+    /** The -6 dB point of the filter as a fraction of the lower sample rate. */
+    double cutoff;
+} QualitySettings;
+
+static const QualitySettings qualitySettings[] =
+{
+    {0, 0, 0.0, 0.0},
+    {16, 64, 5.6, 0.84},
+    {32, 256, 8.0, 0.90},
+    {64, 512, 10.5, 0.94}
+};
+
+/* Filter design */
+
+/**
+ * The zeroth order modified Bessel function of the first kind.
+ */
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-17)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+
+/**
+ * Fills in numPhases + 1 filters, each normalized to unity gain at DC.
+ * @param cutoff The -6 dB point in cycles per input frame.
+ */
+static void designFilters(mnResampler* resampler, double cutoff, double beta)
+{
+    const int numTaps = resampler->numTaps;
+    const int numPhases = resampler->numPhases;
+    const double halfLength = 0.5 * numTaps;
+    const double windowScale = 1.0 / besselI0(beta);
+    
+    for (int p = 0; p <= numPhases; p++)
+    {
+        float* filter = resampler->coefficients + p * numTaps;
+        const double f = (double)p / numPhases;
+        double sum = 0.0;
+        
+        for (int k = 0; k < numTaps; k++)
+        {
+            const double x = k - (halfLength - 1.0) - f;
+            const double r = x / halfLength;
+            const double window = r * r < 1.0 ? besselI0(beta * sqrt(1.0 - r * r)) * windowScale : 0.0;
+            const double t = 2.0 * MN_PI * cutoff * x;
+            const double sinc = fabs(t) < 1e-12 ? 1.0 : sin(t) / t;
+            const double tap = 2.0 * cutoff * sinc * window;
+            filter[k] = (float)tap;
+            sum += tap;
+        }
+        
+        const float gain = (float)(1.0 / sum);
+        for (int k = 0; k < numTaps; k++)
+        {
+            filter[k] *= gain;
+        }
+    }
+    
+    for (int i = 0; i < numPhases * numTaps; i++)
+    {
+        resampler->coefficientSteps[i] = resampler->coefficients[i + numTaps] - resampler->coefficients[i];
+    }
+}
+
+/* Kernels */
+
+static void interpolateFilterScalar(float* filter, const float* a, const float* steps, float f, int numTaps)
+{
+    for (int k = 0; k < numTaps; k++)
+    {
+        filter[k] = a[k] + f * steps[k];
+    }
+}
+
+static float dotScalar(const float* a, const float* b, int numTaps)
+{
+    float sum = 0.0f;
+    for (int k = 0; k < numTaps; k++)
+    {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+#if MN_SIMD_X86
+
+static void interpolateFilterSSE2(float* filter, const float* a, const float* steps, float f, int numTaps)
+{
+    const __m128 fv = _mm_set1_ps(f);
+    for (int k = 0; k < numTaps; k += 4)
+    {
+        _mm_storeu_ps(filter + k, _mm_add_ps(_mm_loadu_ps(a + k), _mm_mul_ps(fv, _mm_loadu_ps(steps + k))));
+    }
+}
+
+static float dotSSE2(const float* a, const float* b, int numTaps)
+{
+    //two accumulators to hide the latency of the additions
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4)));
+    }
+    
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+MN_TARGET_AVX2
+static void interpolateFilterAVX2(float* filter, const float* a, const float* steps, float f, int numTaps)
+{
+    const __m256 fv = _mm256_set1_ps(f);
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        _mm256_storeu_ps(filter + k, _mm256_add_ps(_mm256_loadu_ps(a + k), _mm256_mul_ps(fv, _mm256_loadu_ps(steps + k))));
+    }
+}
+
+MN_TARGET_AVX2
+static float dotAVX2(const float* a, const float* b, int numTaps)
+{
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k)));
+    }
+    
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+
+#elif MN_SIMD_ARM64
+
+static void interpolateFilterNEON(float* filter, const float* a, const float* steps, float f, int numTaps)
+{
+    for (int k = 0; k < numTaps; k += 4)
+    {
+        vst1q_f32(filter + k, vfmaq_n_f32(vld1q_f32(a + k), vld1q_f32(steps + k), f));
+    }
+}
+
+static float dotNEON(const float* a, const float* b, int numTaps)
+{
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (int k = 0; k < numTaps; k += 8)
+    {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(a + k), vld1q_f32(b + k));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(a + k + 4), vld1q_f32(b + k + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+#endif
+
+typedef void (*interpolateFilterFunction)(float* filter, const float* a, const float* steps, float f, int numTaps);
+typedef float (*dotFunction)(const float* a, const float* b, int numTaps);
+
+static void getKernels(interpolateFilterFunction* interpolateFilter, dotFunction* dot)
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            *interpolateFilter = interpolateFilterSSE2;
+            *dot = dotSSE2;
+            return;
+        case MN_SIMD_AVX2:
+            *interpolateFilter = interpolateFilterAVX2;
+            *dot = dotAVX2;
+            return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            *interpolateFilter = interpolateFilterNEON;
+            *dot = dotNEON;
+            return;
+#endif
+        default:
+            *interpolateFilter = interpolateFilterScalar;
+            *dot = dotScalar;
+            return;
+    }
+}
+
+/* Resampler */
+
+int mnResampler_init(mnResampler* resampler,
+                     int numChannels,
+                     double inputSampleRate,
+                     double outputSampleRate,
+                     mnResamplerQuality quality,
+                     int maxInputFrames)
+{
+    memset(resampler, 0, sizeof(mnResampler));
+    if (numChannels < 1 ||
+        inputSampleRate <= 0.0 ||
+        outputSampleRate <= 0.0 ||
+        maxInputFrames < 1 ||
+        quality < MN_RESAMPLER_QUALITY_LOW ||
+        quality > MN_RESAMPLER_QUALITY_HIGH)
+    {
+        return 0;
+    }
+    
+    const QualitySettings* settings = &qualitySettings[quality];
+    
+    //When downsampling, the filter cuts off below the output's Nyquist
+    //frequency and gets proportionally longer.
+    const double scale = outputSampleRate < inputSampleRate ? outputSampleRate / inputSampleRate : 1.0;
+    const int numTaps = (int)ceil(settings->numTaps / scale);
+    
+    resampler->numChannels = numChannels;
+    resampler->inputSampleRate = inputSampleRate;
+    resampler->outputSampleRate = outputSampleRate;
+    resampler->numTaps = (numTaps + 7) / 8 * 8;
+    resampler->numPhases = settings->numPhases;
+    resampler->step = (unsigned long long)(inputSampleRate / outputSampleRate * ONE_32_32 + 0.5);
+    resampler->maxInputFrames = maxInputFrames;
+    resampler->historyCapacity = maxInputFrames + 2 * resampler->numTaps;
+    
+    //locked, since the audio thread sweeps through all of them
+    resampler->coefficients = mnLockedMemory_alloc((resampler->numPhases + 1) * resampler->numTaps * sizeof(float), NULL);
+    resampler->coefficientSteps = mnLockedMemory_alloc(resampler->numPhases * resampler->numTaps * sizeof(float), NULL);
+    resampler->filter = mnLockedMemory_alloc(resampler->numTaps * sizeof(float), NULL);
+    resampler->history = mnLockedMemory_alloc(numChannels * resampler->historyCapacity * sizeof(float), NULL);
+    if (!resampler->coefficients || !resampler->coefficientSteps || !resampler->filter || !resampler->history)
+    {
+        mnResampler_deinit(resampler);
+        return 0;
+    }
+    
+    designFilters(resampler, 0.5 * scale * settings->cutoff, settings->beta);
+    mnResampler_reset(resampler);
+    return 1;
+}
+
+void mnResampler_deinit(mnResampler* resampler)
+{
+    mnLockedMemory_free(resampler->coefficients);
+    mnLockedMemory_free(resampler->coefficientSteps);
+    mnLockedMemory_free(resampler->filter);
+    mnLockedMemory_free(resampler->history);
+    memset(resampler, 0, sizeof(mnResampler));
+}
+
+void mnResampler_reset(mnResampler* resampler)
+{
+    memset(resampler->history, 0, resampler->numChannels * resampler->historyCapacity * sizeof(float));
+    resampler->numHistoryFrames = resampler->numTaps - 1;
+    resampler->position = 0;
+}
+
+int mnResampler_getInputFramesNeeded(mnResampler* resampler, int numOutputFrames)
+{
+    if (numOutputFrames <= 0)
+    {
+        return 0;
+    }
+    
+    const unsigned long long last = resampler->position + (unsigned long long)(numOutputFrames - 1) * resampler->step;
+    const long long needed = (long long)(last >> 32) + resampler->numTaps - resampler->numHistoryFrames;
+    return needed > 0 ? (int)needed : 0;
+}
+
+int mnResampler_getOutputFramesAvailable(mnResampler* resampler, int numInputFrames)
+{
+    //the last history frame a filter may start at
+    const long long lastStart = (long long)resampler->numHistoryFrames + numInputFrames - resampler->numTaps;
+    if (lastStart < (long long)(resampler->position >> 32))
+    {
+        return 0;
+    }
+    
+    const unsigned long long end = (unsigned long long)(lastStart + 1) << 32;
+    return (int)((end - 1 - resampler->position) / resampler->step) + 1;
+}
+
+int mnResampler_getMaxOutputFrames(mnResampler* resampler)
+{
+    return (int)ceil(resampler->maxInputFrames * resampler->outputSampleRate / resampler->inputSampleRate) + 2;
+}
+
+double mnResampler_getLatency(mnResampler* resampler)
+{
+    return 0.5 * resampler->numTaps / resampler->inputSampleRate;
+}
+
+int mnResampler_process(mnResampler* resampler,
+                        const float* input,
+                        int numInputFrames,
+                        float* output,
+                        int maxOutputFrames)
+{
+    const int numChannels = resampler->numChannels;
+    const int numTaps = resampler->numTaps;
+    const int capacity = resampler->historyCapacity;
+    
+    if (numInputFrames > 0)
+    {
+        if (resampler->numHistoryFrames + numInputFrames > capacity)
+        {
+            //only happens if the output has been too small for a while. drop
+            //the oldest frames to make room.
+            int excess = resampler->numHistoryFrames + numInputFrames - capacity;
+            if (excess > resampler->numHistoryFrames)
+            {
+                excess = resampler->numHistoryFrames;
+            }
+            for (int c = 0; c < numChannels; c++)
+            {
+                float* history = resampler->history + c * capacity;
+                memmove(history, history + excess, (resampler->numHistoryFrames - excess) * sizeof(float));
+            }
+            resampler->numHistoryFrames -= excess;
+            const unsigned long long shift = (unsigned long long)excess << 32;
+            resampler->position = resampler->position > shift ? resampler->position - shift : 0;
+            
+            if (numInputFrames > capacity - resampler->numHistoryFrames)
+            {
+                input += (numInputFrames - (capacity - resampler->numHistoryFrames)) * numChannels;
+                numInputFrames = capacity - resampler->numHistoryFrames;
+            }
+        }
+        
+        //deinterleave into the history
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* history = resampler->history + c * capacity + resampler->numHistoryFrames;
+            for (int i = 0; i < numInputFrames; i++)
+            {
+                history[i] = input[i * numChannels + c];
+            }
+        }
+        resampler->numHistoryFrames += numInputFrames;
+    }
+    
+    interpolateFilterFunction interpolateFilter;
+    dotFunction dot;
+    getKernels(&interpolateFilter, &dot);
+    
+    const int numPhases = resampler->numPhases;
+    unsigned long long position = resampler->position;
+    int numOutputFrames = 0;
+    while (numOutputFrames < maxOutputFrames)
+    {
+        const int start = (int)(position >> 32);
+        if (start + numTaps > resampler->numHistoryFrames)
+        {
+            break;
+        }
+        
+        //the phase index and the fraction between it and the next one
+        const unsigned long long phase = (position & 0xffffffffULL) * (unsigned long long)numPhases;
+        const int p = (int)(phase >> 32);
+        const float f = (float)((double)(phase & 0xffffffffULL) * (1.0 / ONE_32_32));
+        interpolateFilter(resampler->filter,
+                          resampler->coefficients + p * numTaps,
+                          resampler->coefficientSteps + p * numTaps,
+                          f,
+                          numTaps);
+        
+        float* frame = output + numOutputFrames * numChannels;
+        for (int c = 0; c < numChannels; c++)
+        {
+            frame[c] = dot(resampler->filter, resampler->history + c * capacity + start, numTaps);
+        }
+        
+        position += resampler->step;
+        numOutputFrames++;
+    }
+    
+    //drop the history frames no future output frame needs
+    int consumed = (int)(position >> 32);
+    if (consumed > resampler->numHistoryFrames)
+    {
+        consumed = resampler->numHistoryFrames;
+    }
+    if (consumed > 0)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* history = resampler->history + c * capacity;
+            memmove(history, history + consumed, (resampler->numHistoryFrames - consumed) * sizeof(float));
+        }
+        resampler->numHistoryFrames -= consumed;
+        position -= (unsigned long long)consumed << 32;
+    }
+    resampler->position = position;
+    
+    return numOutputFrames;
+}
@@ -0,0 +1,159 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_RESAMPLER_H
+#define MN_RESAMPLER_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Resampling quality, trading filter length for CPU time.
+     */
+    typedef enum
+    {
+        /** No resampling. */
+        MN_RESAMPLER_QUALITY_NONE = 0,
+        /** 16 taps, about 60 dB of stopband attenuation. */
+        MN_RESAMPLER_QUALITY_LOW,
+        /** 32 taps, about 80 dB of stopband attenuation. */
+        MN_RESAMPLER_QUALITY_MEDIUM,
+        /** 64 taps, about 105 dB of stopband attenuation. */
+        MN_RESAMPLER_QUALITY_HIGH
+    } mnResamplerQuality;
+    
+    /**
+     * A streaming sample rate converter for interleaved float samples, with an
+     * arbitrary ratio between the input and output rates.
+     *
+     * Output frames are computed with a polyphase FIR filter, a Kaiser windowed
+     * sinc sampled at a fixed number of phases per input frame. The filter for
+     * the exact position of an output frame is interpolated linearly between the
+     * two nearest phases, once per frame for all channels, and applied to each
+     * channel with a vectorized dot product. Positions are 32.32 fixed point
+     * input frames, so the ratio is exact to about 1e-10 and rounding does
+     * not accumulate.
+     *
+     * The history of each channel is kept in a contiguous buffer, so blocks of
+     * any size can be pushed. The output lags the input by half the filter
+     * length, see ::mnResampler_getLatency.
+     */
+    typedef struct mnResampler
+    {
+        int numChannels;
+        double inputSampleRate;
+        double outputSampleRate;
+        /** Filter taps per phase, a multiple of 8. */
+        int numTaps;
+        int numPhases;
+        /** numPhases + 1 filters of numTaps coefficients. */
+        float* coefficients;
+        /** The difference between each filter and the next one. */
+        float* coefficientSteps;
+        /** The filter for the current output frame. */
+        float* filter;
+        /** The input frames per output frame, 32.32 fixed point. */
+        unsigned long long step;
+        /** The position of the next output frame relative to the first history frame, 32.32 fixed point. */
+        unsigned long long position;
+        int maxInputFrames;
+        /** The number of frames each channel's history can hold. */
+        int historyCapacity;
+        int numHistoryFrames;
+        /** numChannels buffers of historyCapacity frames. */
+        float* history;
+    } mnResampler;
+    
+    /**
+     * Initializes a resampler.
+     * @param numChannels The number of interleaved channels.
+     * @param maxInputFrames The largest number of frames passed to ::mnResampler_process.
+     * @param quality Any quality except ::MN_RESAMPLER_QUALITY_NONE.
+     * @return 1 on success, 0 if a parameter is out of range.
+     */
+    int mnResampler_init(mnResampler* resampler,
+                         int numChannels,
+                         double inputSampleRate,
+                         double outputSampleRate,
+                         mnResamplerQuality quality,
+                         int maxInputFrames);
+    
+    /**
+     *
+     */
+    void mnResampler_deinit(mnResampler* resampler);
+    
+    /**
+     * Clears the history, as if no input had been processed.
+     */
+    void mnResampler_reset(mnResampler* resampler);
+    
+    /**
+     * Returns the number of input frames to pass to ::mnResampler_process for it
+     * to produce exactly \c numOutputFrames frames.
+     */
+    int mnResampler_getInputFramesNeeded(mnResampler* resampler, int numOutputFrames);
+    
+    /**
+     * Returns the number of frames ::mnResampler_process produces from
+     * \c numInputFrames frames, given enough room for them.
+     */
+    int mnResampler_getOutputFramesAvailable(mnResampler* resampler, int numInputFrames);
+    
+    /**
+     * Returns the largest number of frames ::mnResampler_process can produce
+     * from ::mnResampler_init's \c maxInputFrames frames.
+     */
+    int mnResampler_getMaxOutputFrames(mnResampler* resampler);
+    
+    /**
+     * Returns the delay in seconds between a frame entering and leaving the
+     * resampler.
+     */
+    double mnResampler_getLatency(mnResampler* resampler);
+    
+    /**
+     * Resamples a block of frames. All input is consumed, and input that is
+     * needed for output frames that don't fit into \c output is kept for the
+     * next call.
+     * @param input \c numInputFrames interleaved frames, at most \c maxInputFrames.
+     * @param output Receives interleaved frames.
+     * @param maxOutputFrames The room in \c output.
+     * @return The number of frames written to \c output.
+     */
+    int mnResampler_process(mnResampler* resampler,
+                            const float* input,
+                            int numInputFrames,
+                            float* output,
+                            int maxOutputFrames);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_RESAMPLER_H
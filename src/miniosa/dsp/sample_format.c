@@ -0,0 +1,1097 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include "sample_format.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <immintrin.h>
+#define MN_TARGET_AVX2 __attribute__((target("avx2")))
+#elif MN_SIMD_ARM64
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every conversion has a plain C reference implementation and vectorized
+ * SSE2, AVX2 and NEON versions, picked at run time according to mnSIMD_getLevel.
+ * All implementations round to nearest and give bit identical results.
+ * Packed 24 bit samples have no cheap vector load, so they are converted in
+ * plain C only.
+ *
+ * The planar conversions fuse (de)interleaving with the format conversion.
+ * Stereo float and 16 bit samples have dedicated vector kernels. Other cases
+ * convert cache sized blocks of interleaved samples with the kernels above and
+ * scatter or gather the channels from there.
+ */
+
+#define INT16_SCALE 32767.0f
+#define INT24_SCALE 8388607.0f
+#define INT32_SCALE 2147483648.0f
+/** The largest float below 2^31. */
+#define INT32_MAX_FLOAT 2147483520.0f
+
+/** The number of samples dithered per block of generated noise. */
+#define DITHER_BLOCK_SIZE 64
+
+int mnSampleFormat_getBytesPerSample(mnSampleFormat format)
+{
+    switch (format)
+    {
+        case MN_SAMPLE_FORMAT_INT16:
+            return 2;
+        case MN_SAMPLE_FORMAT_INT24:
+            return 3;
+        case MN_SAMPLE_FORMAT_INT32:
+        case MN_SAMPLE_FORMAT_FLOAT32:
+        default:
+            return 4;
+    }
+}
+
+/* Dither */
+
+void mnDither_init(mnDither* dither, unsigned int seed)
+{
+    assert(seed != 0);
+    for (int i = 0; i < 4; i++)
+    {
+        //distinct, non-zero start states for the four generators
+        dither->state[i] = seed * (2 * i + 1) + 0x9e3779b9u * i;
+        if (dither->state[i] == 0)
+        {
+            dither->state[i] = 1;
+        }
+    }
+}
+
+static inline unsigned int xorshift(unsigned int x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/**
+ * Fills \c noise with TPDF noise in the range (-1, 1), i.e +/- 1 LSB after scaling.
+ * Four independent generators are stepped together so that the compiler can
+ * vectorize the loop. \c size is rounded up to a multiple of four.
+ */
+static void generateDither(mnDither* dither, float* noise, int size)
+{
+    const float scale = 1.0f / 16777216.0f;
+    unsigned int s[4] = {dither->state[0], dither->state[1], dither->state[2], dither->state[3]};
+    
+    for (int i = 0; i < size; i += 4)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            const unsigned int a = xorshift(s[lane]);
+            const unsigned int b = xorshift(a);
+            s[lane] = b;
+            noise[i + lane] = ((float)(a >> 8) - (float)(b >> 8)) * scale;
+        }
+    }
+    
+    for (int i = 0; i < 4; i++)
+    {
+        dither->state[i] = s[i];
+    }
+}
+
+/* Reference implementations */
+
+static inline float clamp(float value, float low, float high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+static void floatToInt16Scalar(const float* src, short* dst, int size, const float* noise)
+{
+    for (int i = 0; i < size; i++)
+    {
+        float v = src[i] * INT16_SCALE;
+        if (noise)
+        {
+            v += noise[i];
+        }
+        dst[i] = (short)lrintf(clamp(v, -32768.0f, 32767.0f));
+    }
+}
+
+static void int16ToFloatScalar(const short* src, float* dst, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = src[i] * (1.0f / 32768.0f);
+    }
+}
+
+static void floatToInt32Scalar(const float* src, int* dst, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = (int)lrintf(clamp(src[i] * INT32_SCALE, -INT32_SCALE, INT32_MAX_FLOAT));
+    }
+}
+
+static void int32ToFloatScalar(const int* src, float* dst, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = (float)src[i] * (1.0f / INT32_SCALE);
+    }
+}
+
+static void floatToFloat32Scalar(const float* src, float* dst, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        dst[i] = clamp(src[i], -1.0f, 1.0f);
+    }
+}
+
+static void floatToInt24Scalar(const float* src, unsigned char* dst, int size, const float* noise)
+{
+    for (int i = 0; i < size; i++)
+    {
+        float v = src[i] * INT24_SCALE;
+        if (noise)
+        {
+            v += noise[i];
+        }
+        const int s = (int)lrintf(clamp(v, -8388608.0f, 8388607.0f));
+        dst[3 * i] = (unsigned char)(s & 0xff);
+        dst[3 * i + 1] = (unsigned char)((s >> 8) & 0xff);
+        dst[3 * i + 2] = (unsigned char)((s >> 16) & 0xff);
+    }
+}
+
+static void int24ToFloatScalar(const unsigned char* src, float* dst, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        //assemble the sample in the upper 24 bits so the sign is kept
+        const int s = (int)(((unsigned int)src[3 * i] << 8) |
+                            ((unsigned int)src[3 * i + 1] << 16) |
+                            ((unsigned int)src[3 * i + 2] << 24));
+        dst[i] = (float)(s >> 8) * (1.0f / 8388608.0f);
+    }
+}
+
+#if MN_SIMD_X86
+
+/* SSE2 */
+
+static void floatToInt16SSE2(const float* src, short* dst, int size, const float* noise)
+{
+    const __m128 scale = _mm_set1_ps(INT16_SCALE);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(&src[i]), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(&src[i + 4]), scale);
+        if (noise)
+        {
+            a = _mm_add_ps(a, _mm_loadu_ps(&noise[i]));
+            b = _mm_add_ps(b, _mm_loadu_ps(&noise[i + 4]));
+        }
+        a = _mm_min_ps(_mm_max_ps(a, low), high);
+        b = _mm_min_ps(_mm_max_ps(b, low), high);
+        const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128((__m128i*)&dst[i], packed);
+    }
+    
+    floatToInt16Scalar(&src[i], &dst[i], size - i, noise ? &noise[i] : NULL);
+}
+
+static void int16ToFloatSSE2(const short* src, float* dst, int size)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m128i s = _mm_loadu_si128((const __m128i*)&src[i]);
+        //sign extend by placing each short in the upper half of an int and shifting down
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(&dst[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    
+    int16ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+static void floatToInt32SSE2(const float* src, int* dst, int size)
+{
+    const __m128 scale = _mm_set1_ps(INT32_SCALE);
+    const __m128 low = _mm_set1_ps(-INT32_SCALE);
+    const __m128 high = _mm_set1_ps(INT32_MAX_FLOAT);
+    
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(&src[i]), scale);
+        v = _mm_min_ps(_mm_max_ps(v, low), high);
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_cvtps_epi32(v));
+    }
+    
+    floatToInt32Scalar(&src[i], &dst[i], size - i);
+}
+
+static void int32ToFloatSSE2(const int* src, float* dst, int size)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / INT32_SCALE);
+    
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128((const __m128i*)&src[i]);
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(s), scale));
+    }
+    
+    int32ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+static void floatToFloat32SSE2(const float* src, float* dst, int size)
+{
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        _mm_storeu_ps(&dst[i], _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[i]), low), high));
+    }
+    
+    floatToFloat32Scalar(&src[i], &dst[i], size - i);
+}
+
+/* AVX2 */
+
+MN_TARGET_AVX2
+static void floatToInt16AVX2(const float* src, short* dst, int size, const float* noise)
+{
+    const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(&src[i]), scale);
+        if (noise)
+        {
+            v = _mm256_add_ps(v, _mm256_loadu_ps(&noise[i]));
+        }
+        v = _mm256_min_ps(_mm256_max_ps(v, low), high);
+        const __m256i s = _mm256_cvtps_epi32(v);
+        //256 bit packs work within 128 bit lanes, so pack the two halves explicitly
+        const __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        _mm_storeu_si128((__m128i*)&dst[i], packed);
+    }
+    
+    floatToInt16Scalar(&src[i], &dst[i], size - i, noise ? &noise[i] : NULL);
+}
+
+MN_TARGET_AVX2
+static void int16ToFloatAVX2(const short* src, float* dst, int size)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&src[i]));
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+    
+    int16ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+MN_TARGET_AVX2
+static void floatToInt32AVX2(const float* src, int* dst, int size)
+{
+    const __m256 scale = _mm256_set1_ps(INT32_SCALE);
+    const __m256 low = _mm256_set1_ps(-INT32_SCALE);
+    const __m256 high = _mm256_set1_ps(INT32_MAX_FLOAT);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(&src[i]), scale);
+        v = _mm256_min_ps(_mm256_max_ps(v, low), high);
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_cvtps_epi32(v));
+    }
+    
+    floatToInt32Scalar(&src[i], &dst[i], size - i);
+}
+
+MN_TARGET_AVX2
+static void int32ToFloatAVX2(const int* src, float* dst, int size)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / INT32_SCALE);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)&src[i]);
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+    
+    int32ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+MN_TARGET_AVX2
+static void floatToFloat32AVX2(const float* src, float* dst, int size)
+{
+    const __m256 low = _mm256_set1_ps(-1.0f);
+    const __m256 high = _mm256_set1_ps(1.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(&dst[i], _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&src[i]), low), high));
+    }
+    
+    floatToFloat32Scalar(&src[i], &dst[i], size - i);
+}
+
+#elif MN_SIMD_ARM64
+
+/* NEON */
+
+static void floatToInt16NEON(const float* src, short* dst, int size, const float* noise)
+{
+    const float32x4_t low = vdupq_n_f32(-32768.0f);
+    const float32x4_t high = vdupq_n_f32(32767.0f);
+    
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(&src[i]), INT16_SCALE);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(&src[i + 4]), INT16_SCALE);
+        if (noise)
+        {
+            a = vaddq_f32(a, vld1q_f32(&noise[i]));
+            b = vaddq_f32(b, vld1q_f32(&noise[i + 4]));
+        }
+        a = vminq_f32(vmaxq_f32(a, low), high);
+        b = vminq_f32(vmaxq_f32(b, low), high);
+        const int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+        vst1q_s16(&dst[i], packed);
+    }
+    
+    floatToInt16Scalar(&src[i], &dst[i], size - i, noise ? &noise[i] : NULL);
+}
+
+static void int16ToFloatNEON(const short* src, float* dst, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        const int16x8_t s = vld1q_s16(&src[i]);
+        const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(&dst[i], vmulq_n_f32(lo, 1.0f / 32768.0f));
+        vst1q_f32(&dst[i + 4], vmulq_n_f32(hi, 1.0f / 32768.0f));
+    }
+    
+    int16ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+static void floatToInt32NEON(const float* src, int* dst, int size)
+{
+    const float32x4_t low = vdupq_n_f32(-INT32_SCALE);
+    const float32x4_t high = vdupq_n_f32(INT32_MAX_FLOAT);
+    
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(&src[i]), INT32_SCALE);
+        v = vminq_f32(vmaxq_f32(v, low), high);
+        vst1q_s32(&dst[i], vcvtnq_s32_f32(v));
+    }
+    
+    floatToInt32Scalar(&src[i], &dst[i], size - i);
+}
+
+static void int32ToFloatNEON(const int* src, float* dst, int size)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1q_f32(&dst[i], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&src[i])), 1.0f / INT32_SCALE));
+    }
+    
+    int32ToFloatScalar(&src[i], &dst[i], size - i);
+}
+
+static void floatToFloat32NEON(const float* src, float* dst, int size)
+{
+    const float32x4_t low = vdupq_n_f32(-1.0f);
+    const float32x4_t high = vdupq_n_f32(1.0f);
+    
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1q_f32(&dst[i], vminq_f32(vmaxq_f32(vld1q_f32(&src[i]), low), high));
+    }
+    
+    floatToFloat32Scalar(&src[i], &dst[i], size - i);
+}
+
+#endif //MN_SIMD_X86, MN_SIMD_ARM64
+
+/* Dispatch */
+
+static void floatToInt16(const float* src, short* dst, int size, const float* noise)
+{
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_AVX2: floatToInt16AVX2(src, dst, size, noise); return;
+        case MN_SIMD_SSE2: floatToInt16SSE2(src, dst, size, noise); return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON: floatToInt16NEON(src, dst, size, noise); return;
+#endif
+        default: floatToInt16Scalar(src, dst, size, noise); return;
+    }
+}
+
+void mnFloatToInt16(const float* sourceBuffer, short* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    floatToInt16(sourceBuffer, targetBuffer, size, NULL);
+}
+
+void mnFloatToInt16Dithered(const float* sourceBuffer, short* targetBuffer, int size, mnDither* dither)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    float noise[DITHER_BLOCK_SIZE];
+    for (int i = 0; i < size; i += DITHER_BLOCK_SIZE)
+    {
+        const int n = size - i < DITHER_BLOCK_SIZE ? size - i : DITHER_BLOCK_SIZE;
+        generateDither(dither, noise, n);
+        floatToInt16(&sourceBuffer[i], &targetBuffer[i], n, noise);
+    }
+}
+
+void mnInt16ToFloat(const short* sourceBuffer, float* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_AVX2: int16ToFloatAVX2(sourceBuffer, targetBuffer, size); return;
+        case MN_SIMD_SSE2: int16ToFloatSSE2(sourceBuffer, targetBuffer, size); return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON: int16ToFloatNEON(sourceBuffer, targetBuffer, size); return;
+#endif
+        default: int16ToFloatScalar(sourceBuffer, targetBuffer, size); return;
+    }
+}
+
+void mnFloatToInt24(const float* sourceBuffer, unsigned char* targetBuffer, int size, mnDither* dither)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    if (!dither)
+    {
+        floatToInt24Scalar(sourceBuffer, targetBuffer, size, NULL);
+        return;
+    }
+    
+    float noise[DITHER_BLOCK_SIZE];
+    for (int i = 0; i < size; i += DITHER_BLOCK_SIZE)
+    {
+        const int n = size - i < DITHER_BLOCK_SIZE ? size - i : DITHER_BLOCK_SIZE;
+        generateDither(dither, noise, n);
+        floatToInt24Scalar(&sourceBuffer[i], &targetBuffer[3 * i], n, noise);
+    }
+}
+
+void mnInt24ToFloat(const unsigned char* sourceBuffer, float* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    int24ToFloatScalar(sourceBuffer, targetBuffer, size);
+}
+
+void mnFloatToInt32(const float* sourceBuffer, int* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_AVX2: floatToInt32AVX2(sourceBuffer, targetBuffer, size); return;
+        case MN_SIMD_SSE2: floatToInt32SSE2(sourceBuffer, targetBuffer, size); return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON: floatToInt32NEON(sourceBuffer, targetBuffer, size); return;
+#endif
+        default: floatToInt32Scalar(sourceBuffer, targetBuffer, size); return;
+    }
+}
+
+void mnInt32ToFloat(const int* sourceBuffer, float* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_AVX2: int32ToFloatAVX2(sourceBuffer, targetBuffer, size); return;
+        case MN_SIMD_SSE2: int32ToFloatSSE2(sourceBuffer, targetBuffer, size); return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON: int32ToFloatNEON(sourceBuffer, targetBuffer, size); return;
+#endif
+        default: int32ToFloatScalar(sourceBuffer, targetBuffer, size); return;
+    }
+}
+
+void mnFloatToFloat32(const float* sourceBuffer, float* targetBuffer, int size)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetBuffer != NULL);
+    
+    switch (mnSIMD_getLevel())
+    {
+#if MN_SIMD_X86
+        case MN_SIMD_AVX2: floatToFloat32AVX2(sourceBuffer, targetBuffer, size); return;
+        case MN_SIMD_SSE2: floatToFloat32SSE2(sourceBuffer, targetBuffer, size); return;
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON: floatToFloat32NEON(sourceBuffer, targetBuffer, size); return;
+#endif
+        default: floatToFloat32Scalar(sourceBuffer, targetBuffer, size); return;
+    }
+}
+
+void mnConvertFromFloat(const float* sourceBuffer,
+                        void* targetBuffer,
+                        mnSampleFormat targetFormat,
+                        int size,
+                        mnDither* dither)
+{
+    switch (targetFormat)
+    {
+        case MN_SAMPLE_FORMAT_INT16:
+            if (dither)
+            {
+                mnFloatToInt16Dithered(sourceBuffer, (short*)targetBuffer, size, dither);
+            }
+            else
+            {
+                mnFloatToInt16(sourceBuffer, (short*)targetBuffer, size);
+            }
+            break;
+        case MN_SAMPLE_FORMAT_INT24:
+            mnFloatToInt24(sourceBuffer, (unsigned char*)targetBuffer, size, dither);
+            break;
+        case MN_SAMPLE_FORMAT_INT32:
+            mnFloatToInt32(sourceBuffer, (int*)targetBuffer, size);
+            break;
+        case MN_SAMPLE_FORMAT_FLOAT32:
+        default:
+            mnFloatToFloat32(sourceBuffer, (float*)targetBuffer, size);
+            break;
+    }
+}
+
+void mnConvertToFloat(const void* sourceBuffer,
+                      mnSampleFormat sourceFormat,
+                      float* targetBuffer,
+                      int size)
+{
+    switch (sourceFormat)
+    {
+        case MN_SAMPLE_FORMAT_INT16:
+            mnInt16ToFloat((const short*)sourceBuffer, targetBuffer, size);
+            break;
+        case MN_SAMPLE_FORMAT_INT24:
+            mnInt24ToFloat((const unsigned char*)sourceBuffer, targetBuffer, size);
+            break;
+        case MN_SAMPLE_FORMAT_INT32:
+            mnInt32ToFloat((const int*)sourceBuffer, targetBuffer, size);
+            break;
+        case MN_SAMPLE_FORMAT_FLOAT32:
+        default:
+            if (sourceBuffer != targetBuffer)
+            {
+                memcpy(targetBuffer, sourceBuffer, size * sizeof(float));
+            }
+            break;
+    }
+}
+
+/* Planar conversions */
+
+/** The number of interleaved samples per block in the generic planar conversions. */
+#define PLANAR_BLOCK_SIZE 1024
+
+static void deinterleaveStereoFloatScalar(const float* src, float* left, float* right, int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        left[i] = src[2 * i];
+        right[i] = src[2 * i + 1];
+    }
+}
+
+static void interleaveStereoFloat32Scalar(const float* left, const float* right, float* dst, int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        dst[2 * i] = clamp(left[i], -1.0f, 1.0f);
+        dst[2 * i + 1] = clamp(right[i], -1.0f, 1.0f);
+    }
+}
+
+static void deinterleaveStereoInt16Scalar(const short* src, float* left, float* right, int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        left[i] = src[2 * i] * (1.0f / 32768.0f);
+        right[i] = src[2 * i + 1] * (1.0f / 32768.0f);
+    }
+}
+
+static void interleaveStereoInt16Scalar(const float* left, const float* right, short* dst, int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        dst[2 * i] = (short)lrintf(clamp(left[i] * INT16_SCALE, -32768.0f, 32767.0f));
+        dst[2 * i + 1] = (short)lrintf(clamp(right[i] * INT16_SCALE, -32768.0f, 32767.0f));
+    }
+}
+
+#if MN_SIMD_X86
+
+static void deinterleaveStereoFloatSSE2(const float* src, float* left, float* right, int numFrames)
+{
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128 a = _mm_loadu_ps(&src[2 * i]);
+        const __m128 b = _mm_loadu_ps(&src[2 * i + 4]);
+        _mm_storeu_ps(&left[i], _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(&right[i], _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    
+    deinterleaveStereoFloatScalar(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+static void interleaveStereoFloat32SSE2(const float* left, const float* right, float* dst, int numFrames)
+{
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128 l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&left[i]), low), high);
+        const __m128 r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&right[i]), low), high);
+        _mm_storeu_ps(&dst[2 * i], _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(&dst[2 * i + 4], _mm_unpackhi_ps(l, r));
+    }
+    
+    interleaveStereoFloat32Scalar(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+static void deinterleaveStereoInt16SSE2(const short* src, float* left, float* right, int numFrames)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        //each 32 bit lane holds a frame, with the left sample in the lower half
+        const __m128i s = _mm_loadu_si128((const __m128i*)&src[2 * i]);
+        const __m128i l = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+        const __m128i r = _mm_srai_epi32(s, 16);
+        _mm_storeu_ps(&left[i], _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+        _mm_storeu_ps(&right[i], _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+    }
+    
+    deinterleaveStereoInt16Scalar(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+static void interleaveStereoInt16SSE2(const float* left, const float* right, short* dst, int numFrames)
+{
+    const __m128 scale = _mm_set1_ps(INT16_SCALE);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const __m128 l = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&left[i]), scale), low), high);
+        const __m128 r = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&right[i]), scale), low), high);
+        const __m128i li = _mm_cvtps_epi32(l);
+        const __m128i ri = _mm_cvtps_epi32(r);
+        const __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(li, ri), _mm_unpackhi_epi32(li, ri));
+        _mm_storeu_si128((__m128i*)&dst[2 * i], packed);
+    }
+    
+    interleaveStereoInt16Scalar(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+MN_TARGET_AVX2
+static void deinterleaveStereoFloatAVX2(const float* src, float* left, float* right, int numFrames)
+{
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(&src[2 * i]);
+        const __m256 b = _mm256_loadu_ps(&src[2 * i + 8]);
+        //the shuffles work within 128 bit lanes, giving frames 0 1 4 5 2 3 6 7
+        const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(&left[i], _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(&right[i], _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    
+    deinterleaveStereoFloatSSE2(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+MN_TARGET_AVX2
+static void interleaveStereoFloat32AVX2(const float* left, const float* right, float* dst, int numFrames)
+{
+    const __m256 low = _mm256_set1_ps(-1.0f);
+    const __m256 high = _mm256_set1_ps(1.0f);
+    
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256 l = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&left[i]), low), high);
+        const __m256 r = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&right[i]), low), high);
+        //frames 0 1 4 5 and 2 3 6 7
+        const __m256 lo = _mm256_unpacklo_ps(l, r);
+        const __m256 hi = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(&dst[2 * i], _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&dst[2 * i + 8], _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    
+    interleaveStereoFloat32SSE2(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+MN_TARGET_AVX2
+static void deinterleaveStereoInt16AVX2(const short* src, float* left, float* right, int numFrames)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256i s = _mm256_loadu_si256((const __m256i*)&src[2 * i]);
+        const __m256i l = _mm256_srai_epi32(_mm256_slli_epi32(s, 16), 16);
+        const __m256i r = _mm256_srai_epi32(s, 16);
+        _mm256_storeu_ps(&left[i], _mm256_mul_ps(_mm256_cvtepi32_ps(l), scale));
+        _mm256_storeu_ps(&right[i], _mm256_mul_ps(_mm256_cvtepi32_ps(r), scale));
+    }
+    
+    deinterleaveStereoInt16SSE2(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+MN_TARGET_AVX2
+static void interleaveStereoInt16AVX2(const float* left, const float* right, short* dst, int numFrames)
+{
+    const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const __m256 l = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&left[i]), scale), low), high);
+        const __m256 r = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&right[i]), scale), low), high);
+        const __m256i li = _mm256_cvtps_epi32(l);
+        const __m256i ri = _mm256_cvtps_epi32(r);
+        //unpacking and packing both work within 128 bit lanes, which cancels out
+        const __m256i packed = _mm256_packs_epi32(_mm256_unpacklo_epi32(li, ri), _mm256_unpackhi_epi32(li, ri));
+        _mm256_storeu_si256((__m256i*)&dst[2 * i], packed);
+    }
+    
+    interleaveStereoInt16SSE2(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+#elif MN_SIMD_ARM64
+
+static void deinterleaveStereoFloatNEON(const float* src, float* left, float* right, int numFrames)
+{
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        const float32x4x2_t s = vld2q_f32(&src[2 * i]);
+        vst1q_f32(&left[i], s.val[0]);
+        vst1q_f32(&right[i], s.val[1]);
+    }
+    
+    deinterleaveStereoFloatScalar(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+static void interleaveStereoFloat32NEON(const float* left, const float* right, float* dst, int numFrames)
+{
+    const float32x4_t low = vdupq_n_f32(-1.0f);
+    const float32x4_t high = vdupq_n_f32(1.0f);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4)
+    {
+        float32x4x2_t d;
+        d.val[0] = vminq_f32(vmaxq_f32(vld1q_f32(&left[i]), low), high);
+        d.val[1] = vminq_f32(vmaxq_f32(vld1q_f32(&right[i]), low), high);
+        vst2q_f32(&dst[2 * i], d);
+    }
+    
+    interleaveStereoFloat32Scalar(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+static void deinterleaveStereoInt16NEON(const short* src, float* left, float* right, int numFrames)
+{
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        const int16x8x2_t s = vld2q_s16(&src[2 * i]);
+        vst1q_f32(&left[i], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[0]))), 1.0f / 32768.0f));
+        vst1q_f32(&left[i + 4], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[0]))), 1.0f / 32768.0f));
+        vst1q_f32(&right[i], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[1]))), 1.0f / 32768.0f));
+        vst1q_f32(&right[i + 4], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[1]))), 1.0f / 32768.0f));
+    }
+    
+    deinterleaveStereoInt16Scalar(&src[2 * i], &left[i], &right[i], numFrames - i);
+}
+
+static inline int16x4_t floatToInt16x4NEON(float32x4_t v)
+{
+    v = vmulq_n_f32(v, INT16_SCALE);
+    v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+    return vqmovn_s32(vcvtnq_s32_f32(v));
+}
+
+static void interleaveStereoInt16NEON(const float* left, const float* right, short* dst, int numFrames)
+{
+    int i = 0;
+    for (; i + 8 <= numFrames; i += 8)
+    {
+        int16x8x2_t d;
+        d.val[0] = vcombine_s16(floatToInt16x4NEON(vld1q_f32(&left[i])),
+                                floatToInt16x4NEON(vld1q_f32(&left[i + 4])));
+        d.val[1] = vcombine_s16(floatToInt16x4NEON(vld1q_f32(&right[i])),
+                                floatToInt16x4NEON(vld1q_f32(&right[i + 4])));
+        vst2q_s16(&dst[2 * i], d);
+    }
+    
+    interleaveStereoInt16Scalar(&left[i], &right[i], &dst[2 * i], numFrames - i);
+}
+
+#endif //MN_SIMD_X86, MN_SIMD_ARM64
+
+/**
+ * Converts stereo samples with a fused kernel, if there is one for the format.
+ * @return 1 if the samples were converted.
+ */
+static int stereoToFloatPlanar(const void* src, mnSampleFormat format, float* left, float* right, int numFrames)
+{
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    
+    if (format == MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        switch (level)
+        {
+#if MN_SIMD_X86
+            case MN_SIMD_AVX2: deinterleaveStereoFloatAVX2((const float*)src, left, right, numFrames); return 1;
+            case MN_SIMD_SSE2: deinterleaveStereoFloatSSE2((const float*)src, left, right, numFrames); return 1;
+#elif MN_SIMD_ARM64
+            case MN_SIMD_NEON: deinterleaveStereoFloatNEON((const float*)src, left, right, numFrames); return 1;
+#endif
+            default: deinterleaveStereoFloatScalar((const float*)src, left, right, numFrames); return 1;
+        }
+    }
+    else if (format == MN_SAMPLE_FORMAT_INT16)
+    {
+        switch (level)
+        {
+#if MN_SIMD_X86
+            case MN_SIMD_AVX2: deinterleaveStereoInt16AVX2((const short*)src, left, right, numFrames); return 1;
+            case MN_SIMD_SSE2: deinterleaveStereoInt16SSE2((const short*)src, left, right, numFrames); return 1;
+#elif MN_SIMD_ARM64
+            case MN_SIMD_NEON: deinterleaveStereoInt16NEON((const short*)src, left, right, numFrames); return 1;
+#endif
+            default: deinterleaveStereoInt16Scalar((const short*)src, left, right, numFrames); return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * Converts stereo samples with a fused kernel, if there is one for the format.
+ * @return 1 if the samples were converted.
+ */
+static int stereoFromFloatPlanar(const float* left, const float* right, void* dst, mnSampleFormat format, int numFrames)
+{
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    
+    if (format == MN_SAMPLE_FORMAT_FLOAT32)
+    {
+        switch (level)
+        {
+#if MN_SIMD_X86
+            case MN_SIMD_AVX2: interleaveStereoFloat32AVX2(left, right, (float*)dst, numFrames); return 1;
+            case MN_SIMD_SSE2: interleaveStereoFloat32SSE2(left, right, (float*)dst, numFrames); return 1;
+#elif MN_SIMD_ARM64
+            case MN_SIMD_NEON: interleaveStereoFloat32NEON(left, right, (float*)dst, numFrames); return 1;
+#endif
+            default: interleaveStereoFloat32Scalar(left, right, (float*)dst, numFrames); return 1;
+        }
+    }
+    else if (format == MN_SAMPLE_FORMAT_INT16)
+    {
+        switch (level)
+        {
+#if MN_SIMD_X86
+            case MN_SIMD_AVX2: interleaveStereoInt16AVX2(left, right, (short*)dst, numFrames); return 1;
+            case MN_SIMD_SSE2: interleaveStereoInt16SSE2(left, right, (short*)dst, numFrames); return 1;
+#elif MN_SIMD_ARM64
+            case MN_SIMD_NEON: interleaveStereoInt16NEON(left, right, (short*)dst, numFrames); return 1;
+#endif
+            default: interleaveStereoInt16Scalar(left, right, (short*)dst, numFrames); return 1;
+        }
+    }
+    
+    return 0;
+}
+
+void mnConvertToFloatPlanar(const void* sourceBuffer,
+                            mnSampleFormat sourceFormat,
+                            float* const* targetChannels,
+                            int numChannels,
+                            int numFrames)
+{
+    assert(sourceBuffer != NULL);
+    assert(targetChannels != NULL);
+    assert(numChannels > 0 && numChannels <= MN_MAX_PLANAR_CHANNELS);
+    
+    if (numChannels == 1)
+    {
+        mnConvertToFloat(sourceBuffer, sourceFormat, targetChannels[0], numFrames);
+        return;
+    }
+    
+    if (numChannels == 2 &&
+        stereoToFloatPlanar(sourceBuffer, sourceFormat, targetChannels[0], targetChannels[1], numFrames))
+    {
+        return;
+    }
+    
+    const unsigned char* source = (const unsigned char*)sourceBuffer;
+    const int frameSize = numChannels * mnSampleFormat_getBytesPerSample(sourceFormat);
+    const int framesPerBlock = PLANAR_BLOCK_SIZE / numChannels;
+    float block[PLANAR_BLOCK_SIZE];
+    
+    for (int f = 0; f < numFrames; f += framesPerBlock)
+    {
+        const int n = numFrames - f < framesPerBlock ? numFrames - f : framesPerBlock;
+        
+        //float samples can be scattered straight from the source
+        const float* interleaved = (const float*)&source[f * frameSize];
+        if (sourceFormat != MN_SAMPLE_FORMAT_FLOAT32)
+        {
+            mnConvertToFloat(&source[f * frameSize], sourceFormat, block, n * numChannels);
+            interleaved = block;
+        }
+        
+        for (int c = 0; c < numChannels; c++)
+        {
+            float* target = &targetChannels[c][f];
+            for (int i = 0; i < n; i++)
+            {
+                target[i] = interleaved[i * numChannels + c];
+            }
+        }
+    }
+}
+
+void mnConvertFromFloatPlanar(const float* const* sourceChannels,
+                              int numChannels,
+                              void* targetBuffer,
+                              mnSampleFormat targetFormat,
+                              int numFrames,
+                              mnDither* dither)
+{
+    assert(sourceChannels != NULL);
+    assert(targetBuffer != NULL);
+    assert(numChannels > 0 && numChannels <= MN_MAX_PLANAR_CHANNELS);
+    
+    if (numChannels == 1)
+    {
+        mnConvertFromFloat(sourceChannels[0], targetBuffer, targetFormat, numFrames, dither);
+        return;
+    }
+    
+    if (numChannels == 2 && !dither &&
+        stereoFromFloatPlanar(sourceChannels[0], sourceChannels[1], targetBuffer, targetFormat, numFrames))
+    {
+        return;
+    }
+    
+    unsigned char* target = (unsigned char*)targetBuffer;
+    const int frameSize = numChannels * mnSampleFormat_getBytesPerSample(targetFormat);
+    const int framesPerBlock = PLANAR_BLOCK_SIZE / numChannels;
+    float block[PLANAR_BLOCK_SIZE];
+    
+    for (int f = 0; f < numFrames; f += framesPerBlock)
+    {
+        const int n = numFrames - f < framesPerBlock ? numFrames - f : framesPerBlock;
+        
+        for (int c = 0; c < numChannels; c++)
+        {
+            const float* source = &sourceChannels[c][f];
+            for (int i = 0; i < n; i++)
+            {
+                block[i * numChannels + c] = source[i];
+            }
+        }
+        
+        mnConvertFromFloat(block, &target[f * frameSize], targetFormat, n * numChannels, dither);
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_SAMPLE_FORMAT_H
+#define MN_SAMPLE_FORMAT_H
+
+/*! \file */ 
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The largest number of channels supported by the planar conversions. */
+    #define MN_MAX_PLANAR_CHANNELS 256
+    
+    /**
+     * Sample formats that audio hardware reads or writes. Integer formats are
+     * signed and little endian.
+     */
+    typedef enum
+    {
+        MN_SAMPLE_FORMAT_FLOAT32 = 0,
+        MN_SAMPLE_FORMAT_INT16,
+        /** Packed, three bytes per sample. */
+        MN_SAMPLE_FORMAT_INT24,
+        MN_SAMPLE_FORMAT_INT32
+    } mnSampleFormat;
+    
+    /**
+     * Returns the size in bytes of a sample in a given format.
+     */
+    int mnSampleFormat_getBytesPerSample(mnSampleFormat format);
+    
+    /**
+     * State for triangular probability density function (TPDF) dither, which adds
+     * up to +/- 1 LSB of noise before quantization to decorrelate the
+     * quantization error from the signal.
+     */
+    typedef struct mnDither
+    {
+        unsigned int state[4];
+    } mnDither;
+    
+    /**
+     * Initializes dither state. \c seed must be non-zero.
+     */
+    void mnDither_init(mnDither* dither, unsigned int seed);
+    
+    /**
+     * Converts floats in the range [-1, 1] to signed shorts. Values outside the
+     * range are clipped.
+     * @param sourceBuffer The buffer containing the values to convert.
+     * @param targetBuffer The buffer to write converted samples to.
+     * @param size The number of samples to convert.
+     */
+    void mnFloatToInt16(const float* sourceBuffer, short* targetBuffer, int size);
+    
+    /**
+     * Like ::mnFloatToInt16, but applies TPDF dither before quantization.
+     */
+    void mnFloatToInt16Dithered(const float* sourceBuffer, short* targetBuffer, int size, mnDither* dither);
+    
+    /**
+     * Converts signed shorts to floats in the range [-1, 1].
+     */
+    void mnInt16ToFloat(const short* sourceBuffer, float* targetBuffer, int size);
+    
+    /**
+     * Converts floats in the range [-1, 1] to packed 24 bit integers. Values
+     * outside the range are clipped. \c dither is ignored if NULL.
+     */
+    void mnFloatToInt24(const float* sourceBuffer, unsigned char* targetBuffer, int size, mnDither* dither);
+    
+    /**
+     * Converts packed 24 bit integers to floats in the range [-1, 1].
+     */
+    void mnInt24ToFloat(const unsigned char* sourceBuffer, float* targetBuffer, int size);
+    
+    /**
+     * Converts floats in the range [-1, 1] to 32 bit integers. Values outside
+     * the range are clipped.
+     */
+    void mnFloatToInt32(const float* sourceBuffer, int* targetBuffer, int size);
+    
+    /**
+     * Converts 32 bit integers to floats in the range [-1, 1].
+     */
+    void mnInt32ToFloat(const int* sourceBuffer, float* targetBuffer, int size);
+    
+    /**
+     * Copies floats, clipping them to the range [-1, 1].
+     */
+    void mnFloatToFloat32(const float* sourceBuffer, float* targetBuffer, int size);
+    
+    /**
+     * Converts floats in the range [-1, 1] to any sample format.
+     * @param dither Dither state, used for 16 and 24 bit formats. Ignored if NULL.
+     */
+    void mnConvertFromFloat(const float* sourceBuffer,
+                            void* targetBuffer,
+                            mnSampleFormat targetFormat,
+                            int size,
+                            mnDither* dither);
+    
+    /**
+     * Converts samples in any format to floats in the range [-1, 1].
+     */
+    void mnConvertToFloat(const void* sourceBuffer,
+                          mnSampleFormat sourceFormat,
+                          float* targetBuffer,
+                          int size);
+    
+    /**
+     * Converts interleaved samples in any format to one buffer of floats per
+     * channel, in a single pass.
+     * @param targetChannels \c numChannels buffers of \c numFrames floats each.
+     * @param numChannels At most ::MN_MAX_PLANAR_CHANNELS.
+     */
+    void mnConvertToFloatPlanar(const void* sourceBuffer,
+                                mnSampleFormat sourceFormat,
+                                float* const* targetChannels,
+                                int numChannels,
+                                int numFrames);
+    
+    /**
+     * Converts one buffer of floats per channel to interleaved samples in any
+     * format, in a single pass. Without dither, gives the same result as
+     * interleaving the channels and calling ::mnConvertFromFloat.
+     * @param sourceChannels \c numChannels buffers of \c numFrames floats each.
+     * @param numChannels At most ::MN_MAX_PLANAR_CHANNELS.
+     * @param dither Dither state, used for 16 and 24 bit formats. Ignored if NULL.
+     */
+    void mnConvertFromFloatPlanar(const float* const* sourceChannels,
+                                  int numChannels,
+                                  void* targetBuffer,
+                                  mnSampleFormat targetFormat,
+                                  int numFrames,
+                                  mnDither* dither);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_SAMPLE_FORMAT_H
@@ -0,0 +1,159 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for posix_memalign and sysconf
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "arena.h"
+
+/* Locked memory */
+
+/**
+ * Stored at the start of every allocation from mnLockedMemory_alloc, in front
+ * of the returned block, so that it can be unlocked and freed given just the
+ * pointer.
+ */
+typedef struct LockedHeader
+{
+    size_t lockedSize;
+    int isLocked;
+} LockedHeader;
+
+/** Room for the header that keeps the returned block cache line aligned. */
+#define MN_LOCKED_HEADER_SIZE ((sizeof(LockedHeader) + MN_ARENA_ALIGNMENT - 1) / MN_ARENA_ALIGNMENT * MN_ARENA_ALIGNMENT)
+
+void* mnLockedMemory_alloc(int size, int* isLocked)
+{
+    if (isLocked)
+    {
+        *isLocked = 0;
+    }
+    
+    //whole pages only, since unlocking one block would otherwise unlock
+    //any other block sharing its first or last page
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    const size_t alignment = pageSize > (long)MN_ARENA_ALIGNMENT ? (size_t)pageSize : MN_ARENA_ALIGNMENT;
+    const size_t usedSize = MN_LOCKED_HEADER_SIZE + (size_t)(size > 0 ? size : 1);
+    const size_t totalSize = (usedSize + alignment - 1) / alignment * alignment;
+    void* allocation = NULL;
+    if (posix_memalign(&allocation, alignment, totalSize) != 0)
+    {
+        return NULL;
+    }
+    
+    //writing every page also makes sure they are mapped before locking
+    memset(allocation, 0, totalSize);
+    
+    LockedHeader* header = (LockedHeader*)allocation;
+    header->lockedSize = totalSize;
+    header->isLocked = mlock(allocation, totalSize) == 0;
+    
+    if (isLocked)
+    {
+        *isLocked = header->isLocked;
+    }
+    return (unsigned char*)allocation + MN_LOCKED_HEADER_SIZE;
+}
+
+void mnLockedMemory_free(void* memory)
+{
+    if (!memory)
+    {
+        return;
+    }
+    
+    LockedHeader* header = (LockedHeader*)((unsigned char*)memory - MN_LOCKED_HEADER_SIZE);
+    if (header->isLocked)
+    {
+        munlock(header, header->lockedSize);
+    }
+    free(header);
+}
+
+int mnLockedMemory_isLocked(const void* memory)
+{
+    if (!memory)
+    {
+        return 0;
+    }
+    
+    const LockedHeader* header = (const LockedHeader*)((const unsigned char*)memory - MN_LOCKED_HEADER_SIZE);
+    return header->isLocked;
+}
+
+/* Arena */
+
+int mnArena_init(mnArena* arena, int capacity)
+{
+    memset(arena, 0, sizeof(mnArena));
+    arena->memory = mnLockedMemory_alloc(capacity, &arena->isLocked);
+    if (!arena->memory)
+    {
+        return 0;
+    }
+    
+    arena->capacity = capacity;
+    return 1;
+}
+
+void mnArena_deinit(mnArena* arena)
+{
+    mnLockedMemory_free(arena->memory);
+    memset(arena, 0, sizeof(mnArena));
+}
+
+void* mnArena_alloc(mnArena* arena, int size)
+{
+    const int offset = (arena->used + MN_ARENA_ALIGNMENT - 1) / MN_ARENA_ALIGNMENT * MN_ARENA_ALIGNMENT;
+    if (size < 0 || offset > arena->capacity || size > arena->capacity - offset)
+    {
+        return NULL;
+    }
+    
+    arena->used = offset + size;
+    if (arena->used > arena->highWaterMark)
+    {
+        arena->highWaterMark = arena->used;
+    }
+    return arena->memory + offset;
+}
+
+int mnArena_getMark(mnArena* arena)
+{
+    return arena->used;
+}
+
+void mnArena_reset(mnArena* arena, int mark)
+{
+    if (mark >= 0 && mark < arena->used)
+    {
+        arena->used = mark;
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_ARENA_H
+#define MN_ARENA_H
+
+/*! \file */ 
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /** The alignment of blocks returned by ::mnArena_alloc. */
+    #define MN_ARENA_ALIGNMENT MN_CACHE_LINE_SIZE
+    
+    /**
+     * Allocates zeroed memory and tries to lock it into physical memory, so
+     * that touching it from the audio thread never causes a page fault. Called
+     * from a non real time thread. Every call gets whole pages of its own, so
+     * freeing one block never unlocks another, and small blocks are better
+     * carved out of an ::mnArena.
+     * @param isLocked If not NULL, receives 1 if the pages were locked and 0
+     * if locking failed, for example because of a resource limit. The memory
+     * is usable either way.
+     * @return The memory, aligned to ::MN_ARENA_ALIGNMENT, or NULL.
+     */
+    void* mnLockedMemory_alloc(int size, int* isLocked);
+    
+    /**
+     * Unlocks and frees memory obtained from ::mnLockedMemory_alloc.
+     */
+    void mnLockedMemory_free(void* memory);
+    
+    /**
+     * Returns 1 if memory obtained from ::mnLockedMemory_alloc was locked, 0
+     * if locking failed or \c memory is NULL.
+     */
+    int mnLockedMemory_isLocked(const void* memory);
+    
+    /** The largest value ::mnNextPowerOfTwo rounds up to. */
+    #define MN_MAX_POWER_OF_TWO (1 << 30)
+    
+    /**
+     * Returns the smallest power of two that is at least \c value, for sizing
+     * ring buffers whose indices wrap with a mask.
+     * @return The power of two, or 0 if \c value is less than 1 or larger
+     * than ::MN_MAX_POWER_OF_TWO.
+     */
+    static inline int mnNextPowerOfTwo(int value)
+    {
+        if (value < 1 || value > MN_MAX_POWER_OF_TWO)
+        {
+            return 0;
+        }
+        
+        int result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+    
+    /**
+     * A pre-reserved block of locked memory that hands out pieces by bumping
+     * an offset, for scratch buffers and other temporaries on the audio thread.
+     * Allocating never locks, blocks or calls into the system. Pieces are not
+     * freed one by one, instead the arena is rewound to a mark, for example the
+     * one taken at the start of a callback. Used by a single thread at a time.
+     */
+    typedef struct mnArena
+    {
+        unsigned char* memory;
+        int capacity;
+        /** The number of bytes handed out. */
+        int used;
+        /** The largest value of \c used so far. */
+        int highWaterMark;
+        /** 1 if \c memory is locked into physical memory. */
+        int isLocked;
+    } mnArena;
+    
+    /**
+     * Initializes an arena.
+     * @param capacity The number of bytes to reserve.
+     * @return 1 if the memory was reserved, 0 otherwise.
+     */
+    int mnArena_init(mnArena* arena, int capacity);
+    
+    /**
+     *
+     */
+    void mnArena_deinit(mnArena* arena);
+    
+    /**
+     * Returns \c size bytes aligned to ::MN_ARENA_ALIGNMENT, or NULL if the
+     * arena is exhausted. The contents are undefined.
+     */
+    void* mnArena_alloc(mnArena* arena, int size);
+    
+    /**
+     * Returns a mark to pass to ::mnArena_reset later.
+     */
+    int mnArena_getMark(mnArena* arena);
+    
+    /**
+     * Frees everything allocated since \c mark was taken. Pass 0 to free all.
+     */
+    void mnArena_reset(mnArena* arena, int mark);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_ARENA_H
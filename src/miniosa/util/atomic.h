@@ -27,25 +27,195 @@
 
 /*! \file */ 
 
+/**
+ * The assumed size in bytes of a cache line. Data written by different threads
+ * is kept at least this far apart to avoid false sharing.
+ */
+#ifndef MN_CACHE_LINE_SIZE
+#if defined(__APPLE__) && defined(__aarch64__)
+#define MN_CACHE_LINE_SIZE 128
+#else
+#define MN_CACHE_LINE_SIZE 64
+#endif
+#endif /* MN_CACHE_LINE_SIZE */
+
+/*
+ * The atomic operations are defined inline below, on top of std::atomic when
+ * compiled as C++ and C11 atomics otherwise, so that each load and store
+ * compiles to a plain instruction the compiler can schedule around. Define
+ * MN_ATOMIC_OSATOMIC and build atomic_darwin.c to use the out of line
+ * OSAtomic implementation instead.
+ */
+#if defined(MN_ATOMIC_OSATOMIC)
+#define MN_ATOMIC_INLINE
+#else
+#define MN_ATOMIC_INLINE static inline
+#if defined(__cplusplus)
+#include <atomic>
+#else
+#include <stdatomic.h>
+#endif /* __cplusplus */
+#endif /* MN_ATOMIC_OSATOMIC */
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif /* __cplusplus */
     
     /**
-     *
+     * Loads \c value with sequentially consistent ordering (a full barrier).
+     */
+    MN_ATOMIC_INLINE int mnAtomicLoad(int* value);
+    
+    /**
+     * Stores \c newValue in \c destination with sequentially consistent
+     * ordering (a full barrier).
+     */
+    MN_ATOMIC_INLINE void mnAtomicStore(int newValue, int* destination);
+    
+    /**
+     * Atomically adds \c amount to \c value with sequentially consistent ordering.
+     * @return The new value.
+     */
+    MN_ATOMIC_INLINE int mnAtomicAdd(int* value, int amount);
+    
+    /**
+     * Loads \c value with acquire ordering. Reads and writes following the load
+     * in program order are not moved before it. Pair with ::mnAtomicStoreRelease.
+     */
+    MN_ATOMIC_INLINE int mnAtomicLoadAcquire(int* value);
+    
+    /**
+     * Stores \c newValue in \c destination with release ordering. Reads and writes
+     * preceding the store in program order are not moved after it.
+     */
+    MN_ATOMIC_INLINE void mnAtomicStoreRelease(int newValue, int* destination);
+    
+    /**
+     * Loads \c value atomically without any ordering guarantees. Suitable for
+     * reading a variable only written by the calling thread.
+     */
+    MN_ATOMIC_INLINE int mnAtomicLoadRelaxed(int* value);
+    
+    /**
+     * Stores \c newValue in \c destination atomically without any ordering guarantees.
+     */
+    MN_ATOMIC_INLINE void mnAtomicStoreRelaxed(int newValue, int* destination);
+    
+    /**
+     * Atomically replaces the value in \c destination with \c newValue, with
+     * sequentially consistent ordering.
+     * @return The previous value.
      */
-    int mnAtomicLoad(int* value);
+    MN_ATOMIC_INLINE int mnAtomicExchange(int newValue, int* destination);
     
     /**
-     *
+     * Atomically replaces the value in \c destination with \c newValue if it equals
+     * \c oldValue, with sequentially consistent ordering.
+     * @return 1 if the value was replaced, 0 otherwise.
      */
-    void mnAtomicStore(int newValue, int* destination);
+    MN_ATOMIC_INLINE int mnAtomicCompareAndSwap(int oldValue, int newValue, int* destination);
     
     /**
-     *
+     * An acquire fence. Relaxed loads preceding the fence are not moved after
+     * reads and writes following it.
      */
-    int mnAtomicAdd(int* value, int amount);
+    MN_ATOMIC_INLINE void mnAtomicFenceAcquire();
+    
+    /**
+     * A release fence. Reads and writes preceding the fence are not moved after
+     * relaxed stores following it.
+     */
+    MN_ATOMIC_INLINE void mnAtomicFenceRelease();
+    
+#if !defined(MN_ATOMIC_OSATOMIC)
+    
+#if defined(__cplusplus)
+    
+    /*
+     * The int pointers passed in are treated as pointers to atomic ints, which
+     * have the same size and alignment as plain ints on all supported platforms.
+     */
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "atomic ints must be plain ints");
+    
+#define MN_ATOMIC(pointer) reinterpret_cast<std::atomic<int>*>(pointer)
+#define MN_MEMORY_ORDER(order) std::memory_order_##order
+#define MN_ATOMIC_OP(operation) std::atomic_##operation
+    
+#else
+    
+    _Static_assert(sizeof(_Atomic int) == sizeof(int), "atomic ints must be plain ints");
+    
+#define MN_ATOMIC(pointer) ((_Atomic int*)(pointer))
+#define MN_MEMORY_ORDER(order) memory_order_##order
+#define MN_ATOMIC_OP(operation) atomic_##operation
+    
+#endif /* __cplusplus */
+    
+    static inline int mnAtomicLoad(int* value)
+    {
+        return MN_ATOMIC_OP(load_explicit)(MN_ATOMIC(value), MN_MEMORY_ORDER(seq_cst));
+    }
+    
+    static inline void mnAtomicStore(int newValue, int* destination)
+    {
+        MN_ATOMIC_OP(store_explicit)(MN_ATOMIC(destination), newValue, MN_MEMORY_ORDER(seq_cst));
+    }
+    
+    static inline int mnAtomicAdd(int* value, int amount)
+    {
+        return MN_ATOMIC_OP(fetch_add_explicit)(MN_ATOMIC(value), amount, MN_MEMORY_ORDER(seq_cst)) + amount;
+    }
+    
+    static inline int mnAtomicLoadAcquire(int* value)
+    {
+        return MN_ATOMIC_OP(load_explicit)(MN_ATOMIC(value), MN_MEMORY_ORDER(acquire));
+    }
+    
+    static inline void mnAtomicStoreRelease(int newValue, int* destination)
+    {
+        MN_ATOMIC_OP(store_explicit)(MN_ATOMIC(destination), newValue, MN_MEMORY_ORDER(release));
+    }
+    
+    static inline int mnAtomicLoadRelaxed(int* value)
+    {
+        return MN_ATOMIC_OP(load_explicit)(MN_ATOMIC(value), MN_MEMORY_ORDER(relaxed));
+    }
+    
+    static inline void mnAtomicStoreRelaxed(int newValue, int* destination)
+    {
+        MN_ATOMIC_OP(store_explicit)(MN_ATOMIC(destination), newValue, MN_MEMORY_ORDER(relaxed));
+    }
+    
+    static inline int mnAtomicExchange(int newValue, int* destination)
+    {
+        return MN_ATOMIC_OP(exchange_explicit)(MN_ATOMIC(destination), newValue, MN_MEMORY_ORDER(seq_cst));
+    }
+    
+    static inline int mnAtomicCompareAndSwap(int oldValue, int newValue, int* destination)
+    {
+        return MN_ATOMIC_OP(compare_exchange_strong_explicit)(MN_ATOMIC(destination),
+                                                              &oldValue,
+                                                              newValue,
+                                                              MN_MEMORY_ORDER(seq_cst),
+                                                              MN_MEMORY_ORDER(seq_cst)) ? 1 : 0;
+    }
+    
+    static inline void mnAtomicFenceAcquire()
+    {
+        MN_ATOMIC_OP(thread_fence)(MN_MEMORY_ORDER(acquire));
+    }
+    
+    static inline void mnAtomicFenceRelease()
+    {
+        MN_ATOMIC_OP(thread_fence)(MN_MEMORY_ORDER(release));
+    }
+    
+#undef MN_ATOMIC
+#undef MN_MEMORY_ORDER
+#undef MN_ATOMIC_OP
+    
+#endif /* MN_ATOMIC_OSATOMIC */
     
 #ifdef __cplusplus
 } //extern "C"
@@ -22,11 +22,17 @@
  SOFTWARE.
  */
 
+/*
+ * Out of line implementation based on the deprecated OSAtomic functions, used
+ * instead of the inline operations in atomic.h when MN_ATOMIC_OSATOMIC is
+ * defined.
+ */
+#if defined(MN_ATOMIC_OSATOMIC)
+
 #include <libkern/OSAtomic.h>
 
 #include "atomic.h"
 
-
 int mnAtomicLoad(int* value)
 {
     return OSAtomicAdd32Barrier(0, value);
@@ -48,3 +54,55 @@ int mnAtomicAdd(int* value, int amount)
 {
     return OSAtomicAdd32Barrier(amount, value);
 }
+
+int mnAtomicLoadAcquire(int* value)
+{
+    const int result = *(volatile int*)value;
+    OSMemoryBarrier();
+    return result;
+}
+
+void mnAtomicStoreRelease(int newValue, int* destination)
+{
+    OSMemoryBarrier();
+    *(volatile int*)destination = newValue;
+}
+
+int mnAtomicLoadRelaxed(int* value)
+{
+    return *(volatile int*)value;
+}
+
+void mnAtomicStoreRelaxed(int newValue, int* destination)
+{
+    *(volatile int*)destination = newValue;
+}
+
+int mnAtomicExchange(int newValue, int* destination)
+{
+    while (true)
+    {
+        int oldValue = *destination;
+        if (OSAtomicCompareAndSwap32Barrier(oldValue, newValue, destination))
+        {
+            return oldValue;
+        }
+    }
+}
+
+int mnAtomicCompareAndSwap(int oldValue, int newValue, int* destination)
+{
+    return OSAtomicCompareAndSwap32Barrier(oldValue, newValue, destination) ? 1 : 0;
+}
+
+void mnAtomicFenceAcquire()
+{
+    OSMemoryBarrier();
+}
+
+void mnAtomicFenceRelease()
+{
+    OSMemoryBarrier();
+}
+
+#endif /* MN_ATOMIC_OSATOMIC */
@@ -0,0 +1,112 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#if defined(__linux__)
+//for clock_gettime and sem_timedwait
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <time.h>
+
+#include "counting_semaphore.h"
+
+#ifdef __APPLE__
+
+#include <dispatch/dispatch.h>
+
+/*
+ * This file is compiled as C, where dispatch objects are plain reference
+ * counted pointers, so the semaphore is released explicitly.
+ */
+
+void mnSemaphore_init(mnSemaphore* semaphore)
+{
+    semaphore->semaphore = dispatch_semaphore_create(0);
+}
+
+void mnSemaphore_deinit(mnSemaphore* semaphore)
+{
+    dispatch_release((dispatch_semaphore_t)semaphore->semaphore);
+    semaphore->semaphore = NULL;
+}
+
+void mnSemaphore_post(mnSemaphore* semaphore)
+{
+    dispatch_semaphore_signal((dispatch_semaphore_t)semaphore->semaphore);
+}
+
+void mnSemaphore_wait(mnSemaphore* semaphore)
+{
+    dispatch_semaphore_wait((dispatch_semaphore_t)semaphore->semaphore, DISPATCH_TIME_FOREVER);
+}
+
+int mnSemaphore_waitFor(mnSemaphore* semaphore, double seconds)
+{
+    const dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(seconds * NSEC_PER_SEC));
+    return dispatch_semaphore_wait((dispatch_semaphore_t)semaphore->semaphore, timeout) == 0;
+}
+
+#else
+
+void mnSemaphore_init(mnSemaphore* semaphore)
+{
+    sem_init(&semaphore->semaphore, 0, 0);
+}
+
+void mnSemaphore_deinit(mnSemaphore* semaphore)
+{
+    sem_destroy(&semaphore->semaphore);
+}
+
+void mnSemaphore_post(mnSemaphore* semaphore)
+{
+    sem_post(&semaphore->semaphore);
+}
+
+void mnSemaphore_wait(mnSemaphore* semaphore)
+{
+    //retry if interrupted by a signal
+    while (sem_wait(&semaphore->semaphore) != 0 && errno == EINTR)
+    {
+    }
+}
+
+int mnSemaphore_waitFor(mnSemaphore* semaphore, double seconds)
+{
+    //sem_timedwait takes an absolute time on the realtime clock
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const long long nanoseconds = deadline.tv_nsec + (long long)(1e9 * seconds);
+    deadline.tv_sec += (time_t)(nanoseconds / 1000000000);
+    deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+    
+    int result;
+    while ((result = sem_timedwait(&semaphore->semaphore, &deadline)) != 0 && errno == EINTR)
+    {
+    }
+    return result == 0;
+}
+
+#endif /* __APPLE__ */
@@ -0,0 +1,91 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_COUNTING_SEMAPHORE_H
+#define MN_COUNTING_SEMAPHORE_H
+
+/*! \file */ 
+
+#ifndef __APPLE__
+#include <semaphore.h>
+#endif /* __APPLE__ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * A counting semaphore for parking threads that have nothing to do.
+     * Posting may enter the kernel, so it is never called from the audio
+     * thread. Threads fed by the audio thread poll for work instead, and only
+     * wait on a semaphore to be told to shut down.
+     */
+    typedef struct mnSemaphore
+    {
+#ifdef __APPLE__
+        /**
+         * A dispatch_semaphore_t, owned by this struct. Stored as a plain
+         * pointer so that including this header from Objective-C code
+         * compiled with ARC doesn't put an ARC managed object inside a C
+         * struct that is copied and cleared with memcpy and memset.
+         */
+        void* semaphore;
+#else
+        sem_t semaphore;
+#endif /* __APPLE__ */
+    } mnSemaphore;
+    
+    /**
+     * Initializes a semaphore with a count of zero.
+     */
+    void mnSemaphore_init(mnSemaphore* semaphore);
+    
+    /**
+     *
+     */
+    void mnSemaphore_deinit(mnSemaphore* semaphore);
+    
+    /**
+     * Increments the count, waking a waiting thread if there is one.
+     */
+    void mnSemaphore_post(mnSemaphore* semaphore);
+    
+    /**
+     * Waits until the count is positive and decrements it.
+     */
+    void mnSemaphore_wait(mnSemaphore* semaphore);
+    
+    /**
+     * Waits at most \c seconds for the count to become positive, and
+     * decrements it if it does.
+     * @return 1 if the count was decremented, 0 if the wait timed out.
+     */
+    int mnSemaphore_waitFor(mnSemaphore* semaphore, double seconds);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_COUNTING_SEMAPHORE_H
@@ -22,78 +22,202 @@
  SOFTWARE.
  */
 
-#include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include "fifo.h"
+#include "arena.h"
 #include "atomic.h"
 
 /*Based on http://www.codeproject.com/Articles/43510/Lock-Free-Single-Producer-Single-Consumer-Circular*/
 
-void mnFIFO_init(mnFIFO* fifo, int capacity, int elementSize)
+int mnFIFO_init(mnFIFO* fifo, int capacity, int elementSize)
 {
     memset(fifo, 0, sizeof(mnFIFO));
-    fifo->capacity = capacity + 1;
+    const int numSlots = mnNextPowerOfTwo(capacity);
+    if (numSlots == 0 || elementSize < 1 || numSlots > INT_MAX / elementSize)
+    {
+        return 0;
+    }
+    
+    fifo->elements = mnLockedMemory_alloc(numSlots * elementSize, NULL);
+    if (!fifo->elements)
+    {
+        return 0;
+    }
+    fifo->capacity = capacity;
+    fifo->mask = numSlots - 1;
     fifo->elementSize = elementSize;
-    fifo->elements =  malloc(fifo->capacity * elementSize);
+    return 1;
 }
 
 void mnFIFO_deinit(mnFIFO* fifo)
 {
-    if (fifo->elements)
-    {
-         free(fifo->elements);
-    }
+    mnLockedMemory_free(fifo->elements);
     
     memset(fifo, 0, sizeof(mnFIFO));   
 }
 
-static int increment(int idx, int capacity)
+/**
+ * Returns the number of elements between \c head and \c tail. The indices are free
+ * running counters, so the subtraction is done on unsigned values to handle wrap around.
+ */
+static inline int distance(int head, int tail)
+{
+    return (int)((unsigned int)tail - (unsigned int)head);
+}
+
+static inline int advance(int idx, int amount)
+{
+    return (int)((unsigned int)idx + (unsigned int)amount);
+}
+
+static inline unsigned char* slot(mnFIFO* fifo, int idx)
 {
-    return (idx + 1) % capacity;
+    return &fifo->elements[(idx & fifo->mask) * fifo->elementSize];
 }
 
 int mnFIFO_isEmpty(mnFIFO* fifo)
 {
-    return mnAtomicLoad(&fifo->head) == mnAtomicLoad(&fifo->tail);
+    return mnAtomicLoadAcquire(&fifo->head) == mnAtomicLoadAcquire(&fifo->tail);
 }
 
 int mnFIFO_isFull(mnFIFO* fifo)
 {
-    const int nextTail = increment(mnAtomicLoad(&fifo->tail), fifo->capacity);
-    return nextTail == mnAtomicLoad(&fifo->head);
+    return mnFIFO_getNumElements(fifo) >= fifo->capacity;
 }
 
 int mnFIFO_getNumElements(mnFIFO* fifo)
 {
-    const int currentTail = mnAtomicLoad(&fifo->tail);
-    const int currentHead = mnAtomicLoad(&fifo->head);
+    const int currentTail = mnAtomicLoadAcquire(&fifo->tail);
+    const int currentHead = mnAtomicLoadAcquire(&fifo->head);
     
-    const int d = currentTail - currentHead;
-    return d < 0 ? d + fifo->capacity : d;
+    return distance(currentHead, currentTail);
 }
 
 int mnFIFO_push(mnFIFO* fifo, const void* element)
-{    
-    int currentTail = mnAtomicLoad(&fifo->tail);
-    const int nextTail = increment(currentTail, fifo->capacity);
-    if(nextTail != mnAtomicLoad(&fifo->head))
+{
+    //the tail is only written by this thread, so no ordering is needed to read it.
+    const int currentTail = mnAtomicLoadRelaxed(&fifo->tail);
+    if (distance(fifo->cachedHead, currentTail) >= fifo->capacity)
     {
-        memcpy(&(((unsigned char*)fifo->elements)[currentTail * fifo->elementSize]), element, fifo->elementSize);
-        mnAtomicStore(nextTail, &fifo->tail);
-        return 1;
+        //the FIFO looks full. refresh the cached head to see if the consumer has made room.
+        //acquiring the head makes sure the consumer is done reading the slot we're about to write.
+        fifo->cachedHead = mnAtomicLoadAcquire(&fifo->head);
+        if (distance(fifo->cachedHead, currentTail) >= fifo->capacity)
+        {
+            return 0;
+        }
     }
-    return 0;
+    
+    memcpy(slot(fifo, currentTail), element, fifo->elementSize);
+    //publish the element to the consumer
+    mnAtomicStoreRelease(advance(currentTail, 1), &fifo->tail);
+    return 1;
 }
 
 int mnFIFO_pop(mnFIFO* fifo, void* element)
 {
-    const int currentHead = mnAtomicLoad(&fifo->head);
-    if(currentHead == mnAtomicLoad(&fifo->tail))
+    const int currentHead = mnAtomicLoadRelaxed(&fifo->head);
+    if (currentHead == fifo->cachedTail)
     {
-        return 0; // empty queue
+        //the FIFO looks empty. refresh the cached tail to see if the producer has pushed anything.
+        //acquiring the tail makes the element written by the producer visible to this thread.
+        fifo->cachedTail = mnAtomicLoadAcquire(&fifo->tail);
+        if (currentHead == fifo->cachedTail)
+        {
+            return 0; // empty queue
+        }
     }
     
-    memcpy(element, &fifo->elements[currentHead * fifo->elementSize], fifo->elementSize);
-    mnAtomicStore(increment(currentHead, fifo->capacity), &fifo->head);
+    memcpy(element, slot(fifo, currentHead), fifo->elementSize);
+    mnAtomicStoreRelease(advance(currentHead, 1), &fifo->head);
     return 1;
-}
\ No newline at end of file
+}
+
+/**
+ * Splits \c count elements starting at index \c idx into at most two
+ * contiguous runs of the element storage.
+ */
+static void getSpans(mnFIFO* fifo, int idx, int count, mnFIFOSpans* spans)
+{
+    const int numSlots = fifo->mask + 1;
+    const int start = idx & fifo->mask;
+    const int firstCount = count < numSlots - start ? count : numSlots - start;
+    
+    spans->elements[0] = &fifo->elements[start * fifo->elementSize];
+    spans->numElements[0] = firstCount;
+    spans->elements[1] = fifo->elements;
+    spans->numElements[1] = count - firstCount;
+}
+
+int mnFIFO_reserveWrite(mnFIFO* fifo, int count, mnFIFOSpans* spans)
+{
+    const int currentTail = mnAtomicLoadRelaxed(&fifo->tail);
+    int numFree = fifo->capacity - distance(fifo->cachedHead, currentTail);
+    if (numFree < count)
+    {
+        fifo->cachedHead = mnAtomicLoadAcquire(&fifo->head);
+        numFree = fifo->capacity - distance(fifo->cachedHead, currentTail);
+    }
+    
+    const int numReserved = count < numFree ? count : numFree;
+    getSpans(fifo, currentTail, numReserved, spans);
+    return numReserved;
+}
+
+void mnFIFO_commitWrite(mnFIFO* fifo, int count)
+{
+    const int currentTail = mnAtomicLoadRelaxed(&fifo->tail);
+    mnAtomicStoreRelease(advance(currentTail, count), &fifo->tail);
+}
+
+int mnFIFO_peekRead(mnFIFO* fifo, int count, mnFIFOSpans* spans)
+{
+    const int currentHead = mnAtomicLoadRelaxed(&fifo->head);
+    int numAvailable = distance(currentHead, fifo->cachedTail);
+    if (numAvailable < count)
+    {
+        fifo->cachedTail = mnAtomicLoadAcquire(&fifo->tail);
+        numAvailable = distance(currentHead, fifo->cachedTail);
+    }
+    
+    const int numReadable = count < numAvailable ? count : numAvailable;
+    getSpans(fifo, currentHead, numReadable, spans);
+    return numReadable;
+}
+
+void mnFIFO_consumeRead(mnFIFO* fifo, int count)
+{
+    const int currentHead = mnAtomicLoadRelaxed(&fifo->head);
+    mnAtomicStoreRelease(advance(currentHead, count), &fifo->head);
+}
+
+int mnFIFO_pushN(mnFIFO* fifo, const void* elements, int count)
+{
+    mnFIFOSpans spans;
+    const int numPushed = mnFIFO_reserveWrite(fifo, count, &spans);
+    
+    const size_t firstSize = (size_t)spans.numElements[0] * fifo->elementSize;
+    memcpy(spans.elements[0], elements, firstSize);
+    memcpy(spans.elements[1],
+           (const unsigned char*)elements + firstSize,
+           (size_t)spans.numElements[1] * fifo->elementSize);
+    
+    mnFIFO_commitWrite(fifo, numPushed);
+    return numPushed;
+}
+
+int mnFIFO_popN(mnFIFO* fifo, void* elements, int count)
+{
+    mnFIFOSpans spans;
+    const int numPopped = mnFIFO_peekRead(fifo, count, &spans);
+    
+    const size_t firstSize = (size_t)spans.numElements[0] * fifo->elementSize;
+    memcpy(elements, spans.elements[0], firstSize);
+    memcpy((unsigned char*)elements + firstSize,
+           spans.elements[1],
+           (size_t)spans.numElements[1] * fifo->elementSize);
+    
+    mnFIFO_consumeRead(fifo, numPopped);
+    return numPopped;
+}
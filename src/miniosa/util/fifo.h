@@ -27,6 +27,8 @@
 
 /*! \file */ 
 
+#include "atomic.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -34,22 +36,59 @@ extern "C"
     
     /**
      * Single reader, single writer lock free FIFO.
+     *
+     * The element storage has a power of two number of slots, so head and tail
+     * are free running counters that are masked instead of wrapped with a modulo.
+     * The consumer fields and the producer fields are padded onto separate cache
+     * lines, and each side keeps a private copy of the other side's index that is
+     * only refreshed when the FIFO looks empty (consumer) or full (producer).
      */
     typedef struct mnFIFO
     {
+        /** The maximum number of elements the FIFO can hold. */
         int capacity;
         int elementSize;
-        void* elements;
+        /** The number of element slots minus one. The number of slots is a power of two. */
+        int mask;
+        unsigned char* elements;
+        
+        char consumerPadding[MN_CACHE_LINE_SIZE];
         /** Only manipulated through atomic operations. Only changed by the consumer thread.*/
         int head;
+        /** The consumer's copy of \c tail. Only accessed by the consumer thread. */
+        int cachedTail;
+        
+        char producerPadding[MN_CACHE_LINE_SIZE];
         /** Only accessed through atomic operations. Only changed by the producer thread.*/
         int tail;
+        /** The producer's copy of \c head. Only accessed by the producer thread. */
+        int cachedHead;
+        
+        char endPadding[MN_CACHE_LINE_SIZE];
     } mnFIFO;
     
     /**
-     *
+     * One or two contiguous runs of elements inside the FIFO's storage, as
+     * handed out by ::mnFIFO_reserveWrite and ::mnFIFO_peekRead. The second
+     * run is only used when the range wraps around the end of the storage.
+     */
+    typedef struct mnFIFOSpans
+    {
+        void* elements[2];
+        int numElements[2];
+    } mnFIFOSpans;
+    
+    /**
+     * Initializes a FIFO. The storage comes from ::mnLockedMemory_alloc, since
+     * one end of a FIFO is usually the audio thread.
+     * @param capacity The maximum number of elements. The storage is rounded up
+     * to a power of two number of slots, but at most \c capacity elements are held.
+     * @param elementSize The size in bytes of an element.
+     * @return 1 on success, 0 if the capacity is out of range or the storage
+     * could not be allocated. A FIFO that failed to initialize is empty and
+     * full, and can be safely deinitialized.
      */
-    void mnFIFO_init(mnFIFO* fifo, int capacity, int elementSize);
+    int mnFIFO_init(mnFIFO* fifo, int capacity, int elementSize);
     
     /**
      *
@@ -81,6 +120,50 @@ extern "C"
      */
     int mnFIFO_pop(mnFIFO* fifo, void* element);
     
+    /**
+     * Pushes up to \c count elements using at most two \c memcpy calls.
+     * Called from the producer thread only.
+     * @return The number of elements pushed, which is less than \c count if
+     * the FIFO fills up.
+     */
+    int mnFIFO_pushN(mnFIFO* fifo, const void* elements, int count);
+    
+    /**
+     * Pops up to \c count elements using at most two \c memcpy calls.
+     * Called from the consumer thread only.
+     * @return The number of elements popped.
+     */
+    int mnFIFO_popN(mnFIFO* fifo, void* elements, int count);
+    
+    /**
+     * Reserves space for up to \c count elements that the caller writes directly
+     * into the FIFO's storage. The elements become visible to the consumer
+     * when passed to ::mnFIFO_commitWrite. Called from the producer thread only.
+     * @param spans Receives the writable runs.
+     * @return The number of reserved elements.
+     */
+    int mnFIFO_reserveWrite(mnFIFO* fifo, int count, mnFIFOSpans* spans);
+    
+    /**
+     * Publishes \c count elements written into space obtained from
+     * ::mnFIFO_reserveWrite. Called from the producer thread only.
+     */
+    void mnFIFO_commitWrite(mnFIFO* fifo, int count);
+    
+    /**
+     * Gets up to \c count of the oldest elements without removing them, so
+     * the caller can read them in place. Called from the consumer thread only.
+     * @param spans Receives the readable runs.
+     * @return The number of readable elements.
+     */
+    int mnFIFO_peekRead(mnFIFO* fifo, int count, mnFIFOSpans* spans);
+    
+    /**
+     * Removes \c count elements previously obtained from ::mnFIFO_peekRead,
+     * handing their slots back to the producer. Called from the consumer thread only.
+     */
+    void mnFIFO_consumeRead(mnFIFO* fifo, int count);
+    
 #ifdef __cplusplus
 } //extern "C"
 #endif /* __cplusplus */
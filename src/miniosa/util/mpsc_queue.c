@@ -0,0 +1,157 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "mpsc_queue.h"
+#include "arena.h"
+
+/*Based on Dmitry Vyukov's bounded MPMC queue, with a single consumer.*/
+
+/**
+ * Returns the signed difference between two free running positions.
+ */
+static inline int difference(int a, int b)
+{
+    return (int)((unsigned int)a - (unsigned int)b);
+}
+
+static inline int advance(int position, int amount)
+{
+    return (int)((unsigned int)position + (unsigned int)amount);
+}
+
+int mnMPSCQueue_init(mnMPSCQueue* queue, int capacity, int elementSize)
+{
+    memset(queue, 0, sizeof(mnMPSCQueue));
+    const int numSlots = mnNextPowerOfTwo(capacity);
+    if (numSlots == 0 ||
+        elementSize < 1 ||
+        numSlots > INT_MAX / elementSize ||
+        numSlots > INT_MAX / (int)sizeof(int))
+    {
+        return 0;
+    }
+    
+    queue->elements = mnLockedMemory_alloc(numSlots * elementSize, NULL);
+    queue->sequences = mnLockedMemory_alloc(numSlots * sizeof(int), NULL);
+    if (!queue->elements || !queue->sequences)
+    {
+        mnMPSCQueue_deinit(queue);
+        return 0;
+    }
+    queue->capacity = numSlots;
+    queue->mask = numSlots - 1;
+    queue->elementSize = elementSize;
+    
+    //slot i is free for the producer claiming position i
+    for (int i = 0; i < queue->capacity; i++)
+    {
+        queue->sequences[i] = i;
+    }
+    return 1;
+}
+
+void mnMPSCQueue_deinit(mnMPSCQueue* queue)
+{
+    mnLockedMemory_free(queue->elements);
+    mnLockedMemory_free(queue->sequences);
+    
+    memset(queue, 0, sizeof(mnMPSCQueue));
+}
+
+int mnMPSCQueue_getNumElements(mnMPSCQueue* queue)
+{
+    const int currentHead = mnAtomicLoadAcquire(&queue->head);
+    const int currentTail = mnAtomicLoadAcquire(&queue->tail);
+    const int d = difference(currentTail, currentHead);
+    return d < 0 ? 0 : (d > queue->capacity ? queue->capacity : d);
+}
+
+int mnMPSCQueue_push(mnMPSCQueue* queue, const void* element)
+{
+    int position = mnAtomicLoadRelaxed(&queue->tail);
+    int* sequence = NULL;
+    
+    while (1)
+    {
+        sequence = &queue->sequences[position & queue->mask];
+        const int d = difference(mnAtomicLoadAcquire(sequence), position);
+        
+        if (d == 0)
+        {
+            //the slot is free. try to claim it.
+            if (mnAtomicCompareAndSwap(position, advance(position, 1), &queue->tail))
+            {
+                break;
+            }
+            position = mnAtomicLoadRelaxed(&queue->tail);
+        }
+        else if (d < 0)
+        {
+            //the slot still holds an element from the previous lap
+            return 0;
+        }
+        else
+        {
+            //another producer claimed this position first
+            position = mnAtomicLoadRelaxed(&queue->tail);
+        }
+    }
+    
+    memcpy(&queue->elements[(position & queue->mask) * queue->elementSize], element, queue->elementSize);
+    //hand the slot over to the consumer
+    mnAtomicStoreRelease(advance(position, 1), sequence);
+    return 1;
+}
+
+int mnMPSCQueue_pop(mnMPSCQueue* queue, void* element)
+{
+    const int position = mnAtomicLoadRelaxed(&queue->head);
+    int* sequence = &queue->sequences[position & queue->mask];
+    
+    if (mnAtomicLoadAcquire(sequence) != advance(position, 1))
+    {
+        return 0; // empty queue, or the next element is still being written
+    }
+    
+    memcpy(element, &queue->elements[(position & queue->mask) * queue->elementSize], queue->elementSize);
+    //hand the slot back to producers for the next lap
+    mnAtomicStoreRelease(advance(position, queue->capacity), sequence);
+    mnAtomicStoreRelease(advance(position, 1), &queue->head);
+    return 1;
+}
+
+int mnMPSCQueue_popN(mnMPSCQueue* queue, void* elements, int maxCount)
+{
+    unsigned char* target = (unsigned char*)elements;
+    int numPopped = 0;
+    while (numPopped < maxCount &&
+           mnMPSCQueue_pop(queue, &target[numPopped * queue->elementSize]))
+    {
+        numPopped++;
+    }
+    
+    return numPopped;
+}
@@ -0,0 +1,118 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_MPSC_QUEUE_H
+#define MN_MPSC_QUEUE_H
+
+/*! \file */ 
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Bounded lock free queue with multiple writers and a single reader, for
+     * sending messages from several control threads to the audio thread.
+     *
+     * Every slot has a sequence number telling whether it is free for the
+     * producer claiming position \c n (sequence \c n) or holds an element for
+     * the consumer reading position \c n (sequence <tt>n + 1</tt>). Producers
+     * claim positions with a compare-and-swap on \c tail, so pushing is lock
+     * free. Popping never loops or waits, so it is wait free.
+     *
+     * A producer that has claimed a slot but not yet finished writing it hides
+     * the elements pushed after it until it is done.
+     */
+    typedef struct mnMPSCQueue
+    {
+        /** The number of slots. A power of two. */
+        int capacity;
+        int elementSize;
+        int mask;
+        /** Per slot sequence numbers. */
+        int* sequences;
+        unsigned char* elements;
+        
+        char consumerPadding[MN_CACHE_LINE_SIZE];
+        /** Only changed by the consumer thread. */
+        int head;
+        
+        char producerPadding[MN_CACHE_LINE_SIZE];
+        /** The next position to claim. Changed by all producer threads. */
+        int tail;
+        
+        char endPadding[MN_CACHE_LINE_SIZE];
+    } mnMPSCQueue;
+    
+    /**
+     * Initializes a queue. The storage comes from ::mnLockedMemory_alloc, so
+     * producers on the audio thread don't page fault.
+     * @param capacity The minimum number of elements the queue can hold. Rounded
+     * up to a power of two.
+     * @param elementSize The size in bytes of an element.
+     * @return 1 on success, 0 if the capacity is out of range or the storage
+     * could not be allocated. A queue that failed to initialize may only be
+     * deinitialized.
+     */
+    int mnMPSCQueue_init(mnMPSCQueue* queue, int capacity, int elementSize);
+    
+    /**
+     *
+     */
+    void mnMPSCQueue_deinit(mnMPSCQueue* queue);
+    
+    /**
+     * Returns the number of elements in the queue. Only an estimate while other
+     * threads are pushing or popping.
+     */
+    int mnMPSCQueue_getNumElements(mnMPSCQueue* queue);
+    
+    /**
+     * May be called from any number of producer threads.
+     * @return 1 if the element was pushed, 0 if the queue is full.
+     */
+    int mnMPSCQueue_push(mnMPSCQueue* queue, const void* element);
+    
+    /**
+     * Called from the consumer thread only.
+     * @return 1 if an element was popped, 0 if the queue is empty.
+     */
+    int mnMPSCQueue_pop(mnMPSCQueue* queue, void* element);
+    
+    /**
+     * Pops at most \c maxCount elements into \c elements. Lets the audio thread
+     * drain a batch of messages per callback with a bounded amount of work.
+     * Called from the consumer thread only.
+     * @return The number of popped elements.
+     */
+    int mnMPSCQueue_popN(mnMPSCQueue* queue, void* elements, int maxCount);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_MPSC_QUEUE_H
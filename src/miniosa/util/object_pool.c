@@ -0,0 +1,163 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "arena.h"
+#include "object_pool.h"
+
+#define NO_OBJECT -1
+
+/** Objects are aligned for any scalar or 16 byte vector type. */
+#define OBJECT_ALIGNMENT 16
+
+static inline int indexOf(mnObjectPool* pool, void* object)
+{
+    return (int)(((unsigned char*)object - pool->objects) / pool->stride);
+}
+
+/**
+ * Pushes the chain of objects from \c first to \c last, already linked
+ * through \c next, onto the stack at \c head with a single compare-and-swap.
+ */
+static void pushChain(mnObjectPool* pool, int* head, int first, int last)
+{
+    int oldHead = mnAtomicLoadRelaxed(head);
+    while (1)
+    {
+        pool->next[last] = oldHead;
+        if (mnAtomicCompareAndSwap(oldHead, first, head))
+        {
+            return;
+        }
+        oldHead = mnAtomicLoadRelaxed(head);
+    }
+}
+
+int mnObjectPool_init(mnObjectPool* pool, int objectSize, int capacity)
+{
+    memset(pool, 0, sizeof(mnObjectPool));
+    pool->localHead = NO_OBJECT;
+    pool->freeHead = NO_OBJECT;
+    pool->retiredHead = NO_OBJECT;
+    if (objectSize < 0 || objectSize > INT_MAX - OBJECT_ALIGNMENT || capacity < 0)
+    {
+        return 0;
+    }
+    
+    const int stride = objectSize > 0 ? (objectSize + OBJECT_ALIGNMENT - 1) / OBJECT_ALIGNMENT * OBJECT_ALIGNMENT : OBJECT_ALIGNMENT;
+    
+    //objects and links share one locked block
+    if (capacity > INT_MAX / (stride + (int)sizeof(int)))
+    {
+        return 0;
+    }
+    const int objectBytes = stride * capacity;
+    pool->objects = mnLockedMemory_alloc(objectBytes + capacity * (int)sizeof(int), &pool->isLocked);
+    if (!pool->objects)
+    {
+        return 0;
+    }
+    pool->objectSize = objectSize;
+    pool->stride = stride;
+    pool->next = (int*)(pool->objects + objectBytes);
+    pool->capacity = capacity;
+    
+    for (int i = 0; i < capacity; i++)
+    {
+        pool->next[i] = i + 1 < capacity ? i + 1 : NO_OBJECT;
+    }
+    pool->localHead = capacity > 0 ? 0 : NO_OBJECT;
+    
+    return 1;
+}
+
+void mnObjectPool_deinit(mnObjectPool* pool)
+{
+    mnLockedMemory_free(pool->objects);
+    memset(pool, 0, sizeof(mnObjectPool));
+}
+
+void* mnObjectPool_alloc(mnObjectPool* pool)
+{
+    int head = pool->localHead;
+    if (head == NO_OBJECT)
+    {
+        //take over everything freed since the last time
+        if (mnAtomicLoadRelaxed(&pool->freeHead) == NO_OBJECT)
+        {
+            return NULL;
+        }
+        head = mnAtomicExchange(NO_OBJECT, &pool->freeHead);
+        if (head == NO_OBJECT)
+        {
+            return NULL;
+        }
+    }
+    
+    pool->localHead = pool->next[head];
+    return pool->objects + head * pool->stride;
+}
+
+void mnObjectPool_free(mnObjectPool* pool, void* object)
+{
+    const int index = indexOf(pool, object);
+    pushChain(pool, &pool->freeHead, index, index);
+}
+
+void mnObjectPool_retire(mnObjectPool* pool, void* object)
+{
+    const int index = indexOf(pool, object);
+    pushChain(pool, &pool->retiredHead, index, index);
+}
+
+int mnObjectPool_reclaim(mnObjectPool* pool, mnObjectReclaimCallback callback, void* callbackContext)
+{
+    //take the whole retired stack at once
+    const int first = mnAtomicExchange(NO_OBJECT, &pool->retiredHead);
+    if (first == NO_OBJECT)
+    {
+        return 0;
+    }
+    
+    int numReclaimed = 1;
+    int last = first;
+    while (1)
+    {
+        if (callback)
+        {
+            callback(pool->objects + last * pool->stride, callbackContext);
+        }
+        if (pool->next[last] == NO_OBJECT)
+        {
+            break;
+        }
+        last = pool->next[last];
+        numReclaimed++;
+    }
+    
+    //the retired objects are still linked, so they go back in one push
+    pushChain(pool, &pool->freeHead, first, last);
+    return numReclaimed;
+}
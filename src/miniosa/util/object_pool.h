@@ -0,0 +1,131 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_OBJECT_POOL_H
+#define MN_OBJECT_POOL_H
+
+/*! \file */ 
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Called by ::mnObjectPool_reclaim for every retired object before it is
+     * returned to the pool.
+     */
+    typedef void (*mnObjectReclaimCallback)(void* object, void* callbackContext);
+    
+    /**
+     * A fixed number of fixed size objects in locked memory, for voices, events
+     * and similar things the audio thread needs to create on the fly.
+     *
+     * Allocation is done by a single thread, normally the audio thread, which
+     * pops objects from a private list of object indices without any atomic
+     * operations. Freeing may be done from any thread and pushes onto a shared
+     * lock free stack. When the private list runs empty, the allocating thread
+     * takes over the whole shared stack with a single atomic exchange. Since
+     * the shared stack is only ever emptied as a whole, it is free from the ABA
+     * problem.
+     *
+     * Objects that need cleanup the audio thread shouldn't do, like releasing
+     * resources they refer to, can instead be retired. Retired objects are
+     * collected on a second lock free stack that a control thread takes over as
+     * a whole with ::mnObjectPool_reclaim, and are returned to the pool from
+     * there.
+     */
+    typedef struct mnObjectPool
+    {
+        int capacity;
+        int objectSize;
+        /** The distance in bytes between objects. */
+        int stride;
+        unsigned char* objects;
+        /** The index of the next object on the stack each object is on, or -1. */
+        int* next;
+        /** 1 if the objects are locked into physical memory. */
+        int isLocked;
+        
+        char localPadding[MN_CACHE_LINE_SIZE];
+        /** The first object in the private free list, or -1. Only accessed by the allocating thread. */
+        int localHead;
+        
+        char freePadding[MN_CACHE_LINE_SIZE];
+        /** The top of the shared free stack, or -1. Only accessed through atomic operations. */
+        int freeHead;
+        
+        char retiredPadding[MN_CACHE_LINE_SIZE];
+        /** The top of the retired stack, or -1. Only accessed through atomic operations. */
+        int retiredHead;
+        
+        char endPadding[MN_CACHE_LINE_SIZE];
+    } mnObjectPool;
+    
+    /**
+     * Initializes a pool. All objects are free and zeroed.
+     * @param objectSize The size in bytes of an object.
+     * @param capacity The number of objects.
+     * @return 1 if the memory was reserved, 0 if it couldn't be or the
+     * sizes are negative or too large.
+     */
+    int mnObjectPool_init(mnObjectPool* pool, int objectSize, int capacity);
+    
+    /**
+     * Must not be called while objects are in use.
+     */
+    void mnObjectPool_deinit(mnObjectPool* pool);
+    
+    /**
+     * Returns a free object, or NULL if there is none. The contents are
+     * whatever the previous user left. Called from a single allocating thread only.
+     */
+    void* mnObjectPool_alloc(mnObjectPool* pool);
+    
+    /**
+     * Returns an object to the pool right away. May be called from any thread.
+     */
+    void mnObjectPool_free(mnObjectPool* pool, void* object);
+    
+    /**
+     * Hands an object over to the thread calling ::mnObjectPool_reclaim.
+     * May be called from any thread.
+     */
+    void mnObjectPool_retire(mnObjectPool* pool, void* object);
+    
+    /**
+     * Returns all retired objects to the pool. Called from a single
+     * reclaiming thread only.
+     * @param callback If not NULL, invoked for every object first.
+     * @return The number of reclaimed objects.
+     */
+    int mnObjectPool_reclaim(mnObjectPool* pool, mnObjectReclaimCallback callback, void* callbackContext);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_OBJECT_POOL_H
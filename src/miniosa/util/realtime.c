@@ -0,0 +1,201 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#if defined(__linux__)
+//for pthread_setaffinity_np
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "realtime.h"
+#include "simd.h"
+
+#if MN_SIMD_X86
+#include <xmmintrin.h>
+#endif
+
+/* Denormals */
+
+#if MN_SIMD_X86
+/** The flush to zero and denormals are zero bits of MXCSR. */
+#define FLUSH_TO_ZERO_BITS 0x8040
+#elif MN_SIMD_ARM64 || defined(__arm__)
+/** The flush to zero bit of FPCR and FPSCR, which also covers denormal inputs. */
+#define FLUSH_TO_ZERO_BITS (1 << 24)
+#endif
+
+static mnFloatState getFloatState(void)
+{
+#if MN_SIMD_X86
+    return _mm_getcsr();
+#elif MN_SIMD_ARM64
+    unsigned long long state;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(state));
+    return state;
+#elif defined(__arm__)
+    unsigned int state;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(state));
+    return state;
+#else
+    return 0;
+#endif
+}
+
+static void setFloatState(mnFloatState state)
+{
+#if MN_SIMD_X86
+    _mm_setcsr((unsigned int)state);
+#elif MN_SIMD_ARM64
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(state));
+#elif defined(__arm__)
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"((unsigned int)state));
+#else
+    (void)state;
+#endif
+}
+
+mnFloatState mnFloatState_enterFlushToZero(void)
+{
+    const mnFloatState state = getFloatState();
+#ifdef FLUSH_TO_ZERO_BITS
+    if ((state & FLUSH_TO_ZERO_BITS) != FLUSH_TO_ZERO_BITS)
+    {
+        setFloatState(state | FLUSH_TO_ZERO_BITS);
+    }
+#endif
+    return state;
+}
+
+void mnFloatState_restore(mnFloatState state)
+{
+    //writing the register stalls the pipeline, so skip it when nothing changed
+    if (getFloatState() != state)
+    {
+        setFloatState(state);
+    }
+}
+
+int mnFloatState_isFlushingToZero(void)
+{
+#ifdef FLUSH_TO_ZERO_BITS
+    return (getFloatState() & FLUSH_TO_ZERO_BITS) == FLUSH_TO_ZERO_BITS;
+#else
+    return 0;
+#endif
+}
+
+/* Threads */
+
+void mnThreadOptions_setDefaults(mnThreadOptions* options)
+{
+    options->priority = 0;
+    options->core = -1;
+}
+
+static int clampPriority(int priority)
+{
+    const int minPriority = sched_get_priority_min(SCHED_FIFO);
+    const int maxPriority = sched_get_priority_max(SCHED_FIFO);
+    return priority < minPriority ? minPriority : (priority > maxPriority ? maxPriority : priority);
+}
+
+static int pinThread(pthread_t thread, int core)
+{
+#if defined(__linux__)
+    const long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (core >= numCores)
+    {
+        return 0;
+    }
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    return pthread_setaffinity_np(thread, sizeof(cores), &cores) == 0;
+#else
+    //iOS and macOS have no API for pinning threads to cores
+    (void)thread;
+    (void)core;
+    return 0;
+#endif
+}
+
+int mnThread_create(pthread_t* thread,
+                    const mnThreadOptions* options,
+                    void* (*entryPoint)(void*),
+                    void* argument)
+{
+    int result = -1;
+    if (options && options->priority > 0)
+    {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        struct sched_param parameters;
+        memset(&parameters, 0, sizeof(parameters));
+        parameters.sched_priority = clampPriority(options->priority);
+        pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+        pthread_attr_setschedparam(&attributes, &parameters);
+        result = pthread_create(thread, &attributes, entryPoint, argument);
+        pthread_attr_destroy(&attributes);
+    }
+    
+    if (result != 0)
+    {
+        //normal scheduling, if real time scheduling wasn't asked for or was refused
+        result = pthread_create(thread, NULL, entryPoint, argument);
+    }
+    if (result != 0)
+    {
+        return 0;
+    }
+    
+    if (options && options->core >= 0)
+    {
+        pinThread(*thread, options->core);
+    }
+    return 1;
+}
+
+int mnThread_setOptions(pthread_t thread, const mnThreadOptions* options)
+{
+    struct sched_param parameters;
+    memset(&parameters, 0, sizeof(parameters));
+    //the middle of the range is the default priority on Linux and Darwin alike
+    int policy = SCHED_OTHER;
+    parameters.sched_priority = (sched_get_priority_min(SCHED_OTHER) + sched_get_priority_max(SCHED_OTHER)) / 2;
+    if (options->priority > 0)
+    {
+        policy = SCHED_FIFO;
+        parameters.sched_priority = clampPriority(options->priority);
+    }
+    int isApplied = pthread_setschedparam(thread, policy, &parameters) == 0;
+    
+    if (options->core >= 0)
+    {
+        isApplied = pinThread(thread, options->core) && isApplied;
+    }
+    return isApplied;
+}
@@ -0,0 +1,111 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+#ifndef MN_REALTIME_H
+#define MN_REALTIME_H
+
+/*! \file */ 
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * The floating point control register of a thread: MXCSR on x86, FPCR on
+     * ARM64 and FPSCR on 32 bit ARM.
+     */
+    typedef unsigned long long mnFloatState;
+    
+    /**
+     * Makes the calling thread flush denormal results to zero and treat
+     * denormal inputs as zero, FTZ and DAZ on x86 and FZ on ARM.
+     *
+     * Filters and envelopes that decay towards zero, such as one pole
+     * smoothers, end up in the denormal range once their input goes silent.
+     * x86 CPUs take microcode assists on every operation on a denormal, which
+     * can make a quiet buffer many times slower than a loud one. Flushing
+     * only affects values far below anything audible. Cheap enough to call
+     * on every callback.
+     * @return The previous state, to pass to ::mnFloatState_restore.
+     */
+    mnFloatState mnFloatState_enterFlushToZero(void);
+    
+    /**
+     * Restores the state saved by ::mnFloatState_enterFlushToZero.
+     */
+    void mnFloatState_restore(mnFloatState state);
+    
+    /**
+     * Returns 1 if the calling thread flushes denormals to zero.
+     */
+    int mnFloatState_isFlushingToZero(void);
+    
+    /**
+     * Scheduling options for threads created by the library.
+     */
+    typedef struct mnThreadOptions
+    {
+        /**
+         * A \c SCHED_FIFO priority, clamped to the range the system supports,
+         * or 0 for normal scheduling. If the process isn't allowed to use real
+         * time scheduling, the thread falls back to normal scheduling.
+         */
+        int priority;
+        /**
+         * The core to run the thread on, or -1 to let the scheduler pick.
+         * Ignored on iOS and macOS, which have no API for pinning threads.
+         */
+        int core;
+    } mnThreadOptions;
+    
+    /**
+     * Fills in the default options: normal scheduling on any core.
+     */
+    void mnThreadOptions_setDefaults(mnThreadOptions* options);
+    
+    /**
+     * Creates a thread with the given priority and core, falling back to
+     * normal scheduling if real time priority is refused.
+     * @param options The scheduling options, or NULL for the defaults.
+     * @return 1 if the thread was created.
+     */
+    int mnThread_create(pthread_t* thread,
+                        const mnThreadOptions* options,
+                        void* (*entryPoint)(void*),
+                        void* argument);
+    
+    /**
+     * Changes the priority and core of a running thread. A \c core of -1
+     * leaves the thread's affinity as it is.
+     * @return 1 if every option could be applied.
+     */
+    int mnThread_setOptions(pthread_t thread, const mnThreadOptions* options);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_REALTIME_H
@@ -0,0 +1,85 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include "simd.h"
+#include "atomic.h"
+
+/** -1 until a level has been set. Read with relaxed atomics from any thread. */
+static int currentLevel = -1;
+
+static int isSupported(mnSIMDLevel level)
+{
+    switch (level)
+    {
+        case MN_SIMD_NONE:
+            return 1;
+#if MN_SIMD_X86
+        case MN_SIMD_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case MN_SIMD_AVX2:
+            return __builtin_cpu_supports("avx2");
+#elif MN_SIMD_ARM64
+        case MN_SIMD_NEON:
+            //NEON is part of the baseline ARMv8 instruction set
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+mnSIMDLevel mnSIMD_getBestLevel(void)
+{
+    if (isSupported(MN_SIMD_AVX2))
+    {
+        return MN_SIMD_AVX2;
+    }
+    if (isSupported(MN_SIMD_SSE2))
+    {
+        return MN_SIMD_SSE2;
+    }
+    if (isSupported(MN_SIMD_NEON))
+    {
+        return MN_SIMD_NEON;
+    }
+    return MN_SIMD_NONE;
+}
+
+mnSIMDLevel mnSIMD_getLevel(void)
+{
+    int level = mnAtomicLoadRelaxed(&currentLevel);
+    if (level < 0)
+    {
+        //detecting the level doesn't involve any system calls, so this is
+        //safe to do on the audio thread.
+        level = mnSIMD_getBestLevel();
+        mnAtomicStoreRelaxed(level, &currentLevel);
+    }
+    return (mnSIMDLevel)level;
+}
+
+void mnSIMD_setLevel(mnSIMDLevel level)
+{
+    mnAtomicStoreRelaxed(isSupported(level) ? level : mnSIMD_getBestLevel(), &currentLevel);
+}
@@ -0,0 +1,75 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_SIMD_H
+#define MN_SIMD_H
+
+/*! \file */ 
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define MN_SIMD_X86 1
+#elif defined(__aarch64__) || defined(__arm64__)
+#define MN_SIMD_ARM64 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Instruction set extensions used by vectorized kernels.
+     */
+    typedef enum
+    {
+        /** Plain C, used as the reference implementation. */
+        MN_SIMD_NONE = 0,
+        MN_SIMD_SSE2,
+        MN_SIMD_AVX2,
+        MN_SIMD_NEON
+    } mnSIMDLevel;
+    
+    /**
+     * Returns the best instruction set supported by the CPU running the program.
+     */
+    mnSIMDLevel mnSIMD_getBestLevel(void);
+    
+    /**
+     * Returns the instruction set vectorized kernels currently use. Defaults to
+     * the best supported one.
+     */
+    mnSIMDLevel mnSIMD_getLevel(void);
+    
+    /**
+     * Overrides the instruction set used by vectorized kernels, for example to
+     * compare against the plain C reference. Levels the CPU doesn't support are
+     * replaced with the best supported one.
+     */
+    void mnSIMD_setLevel(mnSIMDLevel level);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_SIMD_H
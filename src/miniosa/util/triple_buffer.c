@@ -0,0 +1,105 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include "arena.h"
+#include "triple_buffer.h"
+
+/** Set in \c middle when the middle slot holds a value the reader hasn't seen. */
+#define NEW_VALUE_FLAG 4
+#define INDEX_MASK 3
+
+int mnTripleBuffer_init(mnTripleBuffer* buffer, int elementSize, const void* initialValue)
+{
+    memset(buffer, 0, sizeof(mnTripleBuffer));
+    if (elementSize < 0 || elementSize > INT_MAX / 3 - MN_CACHE_LINE_SIZE)
+    {
+        return 0;
+    }
+    
+    //whole cache lines per slot, so the writer's and the reader's slots never share a line
+    const int numLines = (elementSize + MN_CACHE_LINE_SIZE - 1) / MN_CACHE_LINE_SIZE;
+    buffer->stride = (numLines > 0 ? numLines : 1) * MN_CACHE_LINE_SIZE;
+    buffer->slots = mnLockedMemory_alloc(3 * buffer->stride, NULL);
+    if (!buffer->slots)
+    {
+        memset(buffer, 0, sizeof(mnTripleBuffer));
+        return 0;
+    }
+    buffer->elementSize = elementSize;
+    
+    for (int i = 0; i < 3 && initialValue; i++)
+    {
+        memcpy(buffer->slots + i * buffer->stride, initialValue, elementSize);
+    }
+    
+    buffer->frontIndex = 0;
+    buffer->middle = 1;
+    buffer->backIndex = 2;
+    return 1;
+}
+
+void mnTripleBuffer_deinit(mnTripleBuffer* buffer)
+{
+    mnLockedMemory_free(buffer->slots);
+    memset(buffer, 0, sizeof(mnTripleBuffer));
+}
+
+void* mnTripleBuffer_getWriteBuffer(mnTripleBuffer* buffer)
+{
+    return buffer->slots + buffer->backIndex * buffer->stride;
+}
+
+void mnTripleBuffer_publish(mnTripleBuffer* buffer)
+{
+    //the exchange releases the written value and hands the writer the
+    //previous middle slot, which the reader no longer uses
+    const int previous = mnAtomicExchange(buffer->backIndex | NEW_VALUE_FLAG, &buffer->middle);
+    buffer->backIndex = previous & INDEX_MASK;
+}
+
+void mnTripleBuffer_write(mnTripleBuffer* buffer, const void* value)
+{
+    memcpy(mnTripleBuffer_getWriteBuffer(buffer), value, buffer->elementSize);
+    mnTripleBuffer_publish(buffer);
+}
+
+const void* mnTripleBuffer_read(mnTripleBuffer* buffer, int* isNew)
+{
+    const int hasNewValue = (mnAtomicLoadRelaxed(&buffer->middle) & NEW_VALUE_FLAG) != 0;
+    if (hasNewValue)
+    {
+        //the exchange acquires the published value
+        const int previous = mnAtomicExchange(buffer->frontIndex, &buffer->middle);
+        buffer->frontIndex = previous & INDEX_MASK;
+    }
+    
+    if (isNew)
+    {
+        *isNew = hasNewValue;
+    }
+    
+    return buffer->slots + buffer->frontIndex * buffer->stride;
+}
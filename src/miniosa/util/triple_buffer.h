@@ -0,0 +1,122 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_TRIPLE_BUFFER_H
+#define MN_TRIPLE_BUFFER_H
+
+/*! \file */ 
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Lock free single writer, single reader exchange of the latest value of a
+     * struct, for example a full set of synth parameters going to the audio
+     * thread or a set of meter levels coming back from it.
+     *
+     * There are three slots. The writer fills its back slot and publishes it by
+     * swapping it with the middle slot, and the reader swaps its front slot with
+     * the middle slot when that holds something it hasn't seen. Both swaps are a
+     * single atomic exchange, so publishing and reading are O(1) and wait free
+     * whatever the size of the struct. The reader uses the front slot in place,
+     * and reads without a new value swap nothing, so unchanged data is never
+     * copied. Values published between two reads replace each other, only the
+     * latest one is seen.
+     */
+    typedef struct mnTripleBuffer
+    {
+        int elementSize;
+        /** The distance in bytes between slots, a whole number of cache lines, at least one. */
+        int stride;
+        unsigned char* slots;
+        
+        char writerPadding[MN_CACHE_LINE_SIZE];
+        /** The slot being written. Only accessed by the writer. */
+        int backIndex;
+        
+        char sharedPadding[MN_CACHE_LINE_SIZE];
+        /**
+         * The index of the middle slot, with a flag telling if it holds a value
+         * the reader hasn't seen. Only accessed through atomic operations.
+         */
+        int middle;
+        
+        char readerPadding[MN_CACHE_LINE_SIZE];
+        /** The slot being read. Only accessed by the reader. */
+        int frontIndex;
+        
+        char endPadding[MN_CACHE_LINE_SIZE];
+    } mnTripleBuffer;
+    
+    /**
+     * Initializes a triple buffer. The slots come from ::mnLockedMemory_alloc,
+     * aligned to and padded out to whole cache lines.
+     * @param elementSize The size in bytes of the exchanged struct.
+     * @param initialValue The value seen by the reader until the first
+     * publication. Zeros if NULL.
+     * @return 1 on success, 0 if the slots could not be allocated.
+     */
+    int mnTripleBuffer_init(mnTripleBuffer* buffer, int elementSize, const void* initialValue);
+    
+    /**
+     *
+     */
+    void mnTripleBuffer_deinit(mnTripleBuffer* buffer);
+    
+    /**
+     * Returns the slot to write the next value into. Its contents are an older
+     * value, so every field must be written before publishing. Called from
+     * the writer thread only.
+     */
+    void* mnTripleBuffer_getWriteBuffer(mnTripleBuffer* buffer);
+    
+    /**
+     * Makes the value in the write buffer the latest value. Called from the
+     * writer thread only.
+     */
+    void mnTripleBuffer_publish(mnTripleBuffer* buffer);
+    
+    /**
+     * Copies \c value into the write buffer and publishes it. Called from the
+     * writer thread only.
+     */
+    void mnTripleBuffer_write(mnTripleBuffer* buffer, const void* value);
+    
+    /**
+     * Returns the latest published value, which stays valid and unchanged
+     * until the next call. Called from the reader thread only.
+     * @param isNew If not NULL, receives 1 if a value was published since the
+     * previous call and 0 otherwise.
+     */
+    const void* mnTripleBuffer_read(mnTripleBuffer* buffer, int* isNew);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_TRIPLE_BUFFER_H
@@ -0,0 +1,127 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "work_deque.h"
+
+/*
+ * Based on "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * by Le, Pop, Cohen and Zappa Nardelli. The seq_cst fences of the paper are
+ * replaced with sequentially consistent loads and stores of top and bottom,
+ * which give the same store-load ordering between take and steal.
+ * Counter differences are computed on unsigned ints, so wrapping is harmless.
+ */
+
+static inline int distance(int from, int to)
+{
+    return (int)((unsigned int)to - (unsigned int)from);
+}
+
+static inline int advance(int index, int amount)
+{
+    return (int)((unsigned int)index + (unsigned int)amount);
+}
+
+int mnWorkDeque_init(mnWorkDeque* deque, int capacity)
+{
+    memset(deque, 0, sizeof(mnWorkDeque));
+    const int numSlots = mnNextPowerOfTwo(capacity);
+    if (numSlots == 0)
+    {
+        return 0;
+    }
+    
+    deque->items = calloc(numSlots, sizeof(int));
+    if (!deque->items)
+    {
+        return 0;
+    }
+    deque->capacity = numSlots;
+    deque->mask = numSlots - 1;
+    return 1;
+}
+
+void mnWorkDeque_deinit(mnWorkDeque* deque)
+{
+    free(deque->items);
+    memset(deque, 0, sizeof(mnWorkDeque));
+}
+
+int mnWorkDeque_push(mnWorkDeque* deque, int item)
+{
+    const int bottom = mnAtomicLoadRelaxed(&deque->bottom);
+    const int top = mnAtomicLoadAcquire(&deque->top);
+    if (distance(top, bottom) >= deque->capacity)
+    {
+        return 0;
+    }
+    
+    mnAtomicStoreRelaxed(item, &deque->items[bottom & deque->mask]);
+    //publishes the item to thieves
+    mnAtomicStoreRelease(advance(bottom, 1), &deque->bottom);
+    return 1;
+}
+
+int mnWorkDeque_take(mnWorkDeque* deque, int* item)
+{
+    //reserve the bottom item before looking at top, so that a thief
+    //either sees the reservation or is seen by the owner
+    const int bottom = advance(mnAtomicLoadRelaxed(&deque->bottom), -1);
+    mnAtomicStore(bottom, &deque->bottom);
+    const int top = mnAtomicLoad(&deque->top);
+    
+    const int size = distance(top, bottom);
+    if (size < 0)
+    {
+        //empty
+        mnAtomicStoreRelaxed(top, &deque->bottom);
+        return 0;
+    }
+    
+    *item = mnAtomicLoadRelaxed(&deque->items[bottom & deque->mask]);
+    if (size > 0)
+    {
+        return 1;
+    }
+    
+    //the last item, which a thief may be stealing too
+    const int won = mnAtomicCompareAndSwap(top, advance(top, 1), &deque->top);
+    mnAtomicStoreRelaxed(advance(top, 1), &deque->bottom);
+    return won;
+}
+
+int mnWorkDeque_steal(mnWorkDeque* deque, int* item)
+{
+    const int top = mnAtomicLoad(&deque->top);
+    const int bottom = mnAtomicLoad(&deque->bottom);
+    if (distance(top, bottom) <= 0)
+    {
+        return 0;
+    }
+    
+    *item = mnAtomicLoadRelaxed(&deque->items[top & deque->mask]);
+    return mnAtomicCompareAndSwap(top, advance(top, 1), &deque->top);
+}
@@ -0,0 +1,106 @@
+/*
+ The MIT License (MIT)
+ 
+ Copyright (c) 2015 Per Gantelius
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#ifndef MN_WORK_DEQUE_H
+#define MN_WORK_DEQUE_H
+
+/*! \file */ 
+
+#include "atomic.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+    
+    /**
+     * Bounded lock free work stealing deque of ints (Chase-Lev). The owner
+     * thread pushes and takes items at the bottom, last in first out, which
+     * keeps recently produced work in its cache. Other threads steal from
+     * the top, oldest first.
+     *
+     * \c top and \c bottom are free running counters compared with wrapping
+     * arithmetic, so the deque never has to be reset between batches of work.
+     * Only the owner takes, so taking is wait free. Stealing is lock free:
+     * a thief fails when it races with another thief or the owner for the
+     * last item.
+     */
+    typedef struct mnWorkDeque
+    {
+        /** The number of slots. A power of two. */
+        int capacity;
+        int mask;
+        /** Only accessed through atomic operations. */
+        int* items;
+        
+        char ownerPadding[MN_CACHE_LINE_SIZE];
+        /** One past the newest item. Only changed by the owner thread. */
+        int bottom;
+        
+        char thiefPadding[MN_CACHE_LINE_SIZE];
+        /** The oldest item. Advanced by thieves and by the owner taking the last item. */
+        int top;
+        
+        char endPadding[MN_CACHE_LINE_SIZE];
+    } mnWorkDeque;
+    
+    /**
+     * Initializes a deque.
+     * @param capacity The minimum number of items the deque can hold. Rounded
+     * up to a power of two.
+     * @return 1 on success, 0 if the capacity is out of range or the items
+     * could not be allocated. A deque that failed to initialize may only be
+     * deinitialized.
+     */
+    int mnWorkDeque_init(mnWorkDeque* deque, int capacity);
+    
+    /**
+     *
+     */
+    void mnWorkDeque_deinit(mnWorkDeque* deque);
+    
+    /**
+     * Adds an item at the bottom. Called from the owner thread only.
+     * @return 1 if the item was pushed, 0 if the deque is full.
+     */
+    int mnWorkDeque_push(mnWorkDeque* deque, int item);
+    
+    /**
+     * Removes the newest item. Called from the owner thread only.
+     * @return 1 if an item was taken, 0 if the deque is empty.
+     */
+    int mnWorkDeque_take(mnWorkDeque* deque, int* item);
+    
+    /**
+     * Removes the oldest item. May be called from any thread.
+     * @return 1 if an item was stolen, 0 if the deque is empty or another
+     * thread got the item first.
+     */
+    int mnWorkDeque_steal(mnWorkDeque* deque, int* item);
+    
+#ifdef __cplusplus
+} //extern "C"
+#endif /* __cplusplus */
+
+#endif //MN_WORK_DEQUE_H
@@ -0,0 +1,311 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_analyzer.h"
+
+#include "analyzer.h"
+#include "atomic.h"
+#include "backend_offline.h"
+#include "engine.h"
+
+#define TWO_PI 6.283185307179586
+
+static const float sampleRate = 48000;
+
+static int isNear(float value, float expected, float tolerance)
+{
+    return fabsf(value - expected) <= tolerance;
+}
+
+static void initOptions(mnAnalyzerOptions* options)
+{
+    mnAnalyzerOptions_setDefaults(options);
+    options->sampleRate = sampleRate;
+}
+
+/**
+ * Gives the worker thread up to five seconds to analyze \c numSnapshots windows.
+ */
+static int waitForSnapshots(mnAnalyzer* analyzer, int numSnapshots)
+{
+    struct timespec duration = {0, 1000000};
+    for (int i = 0; i < 5000 && mnAnalyzer_getNumSnapshots(analyzer) < numSnapshots; i++)
+    {
+        thrd_sleep(&duration, NULL);
+    }
+    return mnAnalyzer_getNumSnapshots(analyzer) == numSnapshots;
+}
+
+/**
+ * Writes harmonics of a fundamental, each with its own amplitude, in buffers
+ * of 256 frames and returns the snapshot of the last window.
+ */
+static mnAnalyzerSnapshot analyzeHarmonics(mnAnalyzer* analyzer,
+                                           float fundamental,
+                                           const float* amplitudes,
+                                           int numHarmonics,
+                                           int useNoise)
+{
+    mnAnalyzerOptions options;
+    initOptions(&options);
+    mnAnalyzer_start(analyzer, &options);
+    
+    const int numFrames = 8192;
+    float buffer[256];
+    for (int start = 0; start < numFrames; start += 256)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float x = useNoise ? 0.5f * ((float)rand() / (float)RAND_MAX) - 0.25f : 0.0f;
+            for (int h = 0; h < numHarmonics; h++)
+            {
+                x += amplitudes[h] * (float)sin(TWO_PI * fundamental * (h + 1) * (start + i) / sampleRate);
+            }
+            buffer[i] = x;
+        }
+        mnAnalyzer_writeInterleaved(analyzer, buffer, 256);
+    }
+    
+    fail_unless(waitForSnapshots(analyzer, numFrames / options.hopSize), "every hop should be analyzed");
+    return *mnAnalyzer_getSnapshot(analyzer, NULL);
+}
+
+static void testKnownSignals()
+{
+    start_test("Analyzer - spectrum and pitch of known signals");
+    
+    mnAnalyzer analyzer;
+    mnAnalyzerOptions options;
+    initOptions(&options);
+    options.fftSize = 1000;
+    fail_unless(!mnAnalyzer_start(&analyzer, &options), "FFT sizes that aren't powers of two should be rejected");
+    initOptions(&options);
+    options.bufferSizeInFrames = (1 << 30) + 1;
+    fail_unless(!mnAnalyzer_start(&analyzer, &options), "a ring too large for a FIFO should be rejected");
+    
+    //a sine centered on bin 20
+    const float sineAmplitude = 0.5f;
+    mnAnalyzerSnapshot snapshot = analyzeHarmonics(&analyzer, 20 * sampleRate / 2048, &sineAmplitude, 1, 0);
+    fail_unless(snapshot.numBins == 1025 && isNear(snapshot.binWidth, sampleRate / 2048, 1e-4f), "bin layout mismatch");
+    fail_unless(snapshot.position == 8192, "the last window should end with the last frame");
+    int loudest = 0;
+    for (int k = 1; k < snapshot.numBins; k++)
+    {
+        loudest = snapshot.magnitudes[k] > snapshot.magnitudes[loudest] ? k : loudest;
+    }
+    fail_unless(loudest == 20, "the sine should peak in its bin");
+    fail_unless(isNear(snapshot.magnitudes[20], sineAmplitude, 1e-3f), "the magnitude should be the amplitude");
+    fail_unless(snapshot.magnitudes[40] < 1e-4f, "a Hann window leaks nothing into distant bins");
+    fail_unless(isNear(snapshot.level, sineAmplitude / sqrtf(2.0f), 1e-3f), "level mismatch");
+    fail_unless(isNear(snapshot.pitch, 20 * sampleRate / 2048, 0.5f), "the pitch of a sine is its frequency");
+    fail_unless(snapshot.pitchConfidence > 0.95f, "a sine is periodic");
+    mnAnalyzer_stop(&analyzer);
+    
+    //a weak fundamental under strong overtones, between bins
+    const float overtones[] = {0.05f, 0.4f, 0.3f, 0.2f};
+    snapshot = analyzeHarmonics(&analyzer, 147.0f, overtones, 4, 0);
+    fail_unless(isNear(snapshot.pitch, 147.0f, 0.5f), "the pitch should be the fundamental, not an overtone");
+    fail_unless(snapshot.pitchConfidence > 0.95f, "harmonic signals are periodic");
+    mnAnalyzer_stop(&analyzer);
+    
+    snapshot = analyzeHarmonics(&analyzer, 0.0f, NULL, 0, 0);
+    fail_unless(snapshot.pitch == 0.0f && snapshot.level == 0.0f, "silence has no pitch");
+    mnAnalyzer_stop(&analyzer);
+    
+    snapshot = analyzeHarmonics(&analyzer, 0.0f, NULL, 0, 1);
+    fail_unless(snapshot.pitchConfidence < 0.5f, "noise isn't periodic");
+    mnAnalyzer_stop(&analyzer);
+}
+
+static void testDroppedFrames()
+{
+    start_test("Analyzer - a full ring drops and counts frames");
+    
+    mnAnalyzer analyzer;
+    mnAnalyzerOptions options;
+    initOptions(&options);
+    options.numChannels = 2;
+    options.bufferSizeInFrames = 4096;
+    fail_unless(mnAnalyzer_start(&analyzer, &options), "start failed");
+    
+    //more than the ring holds in a single write
+    const int numFrames = 10000;
+    float* input = calloc(2 * numFrames, sizeof(float));
+    const int numQueued = mnAnalyzer_writeInterleaved(&analyzer, input, numFrames);
+    fail_unless(numQueued == 4096, "the ring should take as many frames as it holds");
+    fail_unless(mnAnalyzer_getNumDroppedFrames(&analyzer) == numFrames - numQueued, "dropped frame count mismatch");
+    
+    fail_unless(waitForSnapshots(&analyzer, numQueued / options.hopSize), "every hop should be analyzed");
+    int isNew = 0;
+    const mnAnalyzerSnapshot* snapshot = mnAnalyzer_getSnapshot(&analyzer, &isNew);
+    fail_unless(isNew && snapshot->position == numQueued, "positions count the frames queued");
+    mnAnalyzer_getSnapshot(&analyzer, &isNew);
+    fail_unless(!isNew, "nothing new should be analyzed");
+    
+    mnAnalyzer_stop(&analyzer);
+    free(input);
+}
+
+typedef struct
+{
+    mnAnalyzer analyzer;
+    int numHops;
+    /** Only accessed through atomic operations. */
+    int isDone;
+} ConcurrencyContext;
+
+/**
+ * The constant value of every frame of a hop, so that each window's level
+ * and DC bin follow from its position.
+ */
+static float getHopValue(int hop)
+{
+    return 0.1f * (hop % 7 + 1);
+}
+
+static int entryPointWriter(void* data)
+{
+    ConcurrencyContext* context = (ConcurrencyContext*)data;
+    mnAnalyzer* analyzer = &context->analyzer;
+    const int hopSize = analyzer->options.hopSize;
+    float buffer[128];
+    for (int hop = 0; hop < context->numHops; hop++)
+    {
+        for (int start = 0; start < hopSize; start += 128)
+        {
+            for (int i = 0; i < 128; i++)
+            {
+                buffer[i] = getHopValue(hop);
+            }
+            //stay clear of overflows, which would shift the hops
+            while (mnFIFO_getNumElements(&analyzer->ring) > analyzer->options.bufferSizeInFrames - 128)
+            {
+                thrd_yield();
+            }
+            mnAnalyzer_writeInterleaved(analyzer, buffer, 128);
+        }
+    }
+    mnAtomicStoreRelease(1, &context->isDone);
+    return 0;
+}
+
+static void testConcurrentSnapshots()
+{
+    start_test("Analyzer - consistent snapshots while analyzing");
+    
+    ConcurrencyContext context;
+    memset(&context, 0, sizeof(context));
+    context.numHops = 4000;
+    mnAnalyzerOptions options;
+    initOptions(&options);
+    options.bufferSizeInFrames = 8192;
+    mnAnalyzer_start(&context.analyzer, &options);
+    
+    const int size = options.fftSize;
+    const int hopSize = options.hopSize;
+    float* window = malloc(size * sizeof(float));
+    for (int i = 0; i < size; i++)
+    {
+        window[i] = (float)(0.5 - 0.5 * cos(TWO_PI * i / size));
+    }
+    
+    thrd_t writer;
+    thrd_create(&writer, entryPointWriter, &context);
+    
+    int numInconsistent = 0;
+    int numSeen = 0;
+    long long lastPosition = 0;
+    while (!mnAtomicLoadAcquire(&context.isDone) ||
+           mnAnalyzer_getNumSnapshots(&context.analyzer) < context.numHops)
+    {
+        int isNew = 0;
+        const mnAnalyzerSnapshot* snapshot = mnAnalyzer_getSnapshot(&context.analyzer, &isNew);
+        if (!isNew)
+        {
+            thrd_yield();
+            continue;
+        }
+        
+        //the window holds the last size / hopSize hops, with zeros before the first one
+        double sumOfSquares = 0.0;
+        double dc = 0.0;
+        const int lastHop = (int)(snapshot->position / hopSize) - 1;
+        for (int i = 0; i < size; i++)
+        {
+            const int hop = lastHop - (size - 1 - i) / hopSize;
+            const float x = hop >= 0 ? getHopValue(hop) : 0.0f;
+            sumOfSquares += x * x;
+            dc += x * window[i];
+        }
+        if (snapshot->position <= lastPosition ||
+            snapshot->position % hopSize != 0 ||
+            !isNear(snapshot->level, (float)sqrt(sumOfSquares / size), 1e-4f) ||
+            !isNear(snapshot->magnitudes[0], (float)(4.0 * dc / size), 1e-4f))
+        {
+            numInconsistent++;
+        }
+        lastPosition = snapshot->position;
+        numSeen++;
+    }
+    
+    int joinRes;
+    thrd_join(writer, &joinRes);
+    fail_unless(numInconsistent == 0, "torn snapshots");
+    fail_unless(numSeen > 0, "no snapshots seen");
+    fail_unless(mnAnalyzer_getNumDroppedFrames(&context.analyzer) == 0, "no frames should be dropped");
+    
+    mnAnalyzer_stop(&context.analyzer);
+    free(window);
+}
+
+static void ignoreInputCallback(int numChannels, int numFrames, const float* samples, void* context)
+{
+}
+
+static void testEngine()
+{
+    start_test("Analyzer - engine input");
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.sampleRate = sampleRate;
+    options.numberOfInputChannels = 1;
+    options.numberOfOutputChannels = 0;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    
+    mnAnalyzer analyzer;
+    mnAnalyzerOptions analyzerOptions;
+    initOptions(&analyzerOptions);
+    fail_unless(mnAnalyzer_start(&analyzer, &analyzerOptions), "start failed");
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), ignoreInputCallback, NULL, NULL, &options);
+    mnEngine_setAnalyzer(&engine, &analyzer);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    const int numFrames = 24000;
+    short* input = malloc(numFrames * sizeof(short));
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = (short)(16384 * sin(TWO_PI * 330.0 * i / sampleRate));
+    }
+    fail_unless(mnOfflineBackend_render(&engine, input, NULL, numFrames) == numFrames, "frame count mismatch");
+    
+    fail_unless(waitForSnapshots(&analyzer, numFrames / analyzerOptions.hopSize), "every hop should be analyzed");
+    const mnAnalyzerSnapshot* snapshot = mnAnalyzer_getSnapshot(&analyzer, NULL);
+    fail_unless(isNear(snapshot->pitch, 330.0f, 0.5f), "the input's pitch should be found");
+    
+    mnEngine_deinit(&engine);
+    mnAnalyzer_stop(&analyzer);
+    free(input);
+}
+
+void testAnalyzer()
+{
+    testKnownSignals();
+    testDroppedFrames();
+    testConcurrentSnapshots();
+    testEngine();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_ANALYZER_H
+#define DR_TEST_ANALYZER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testAnalyzer();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_ANALYZER_H
+
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include "testmacros.h"
+#include "test_arena.h"
+
+#include "arena.h"
+
+static void testLockedMemory()
+{
+    start_test("Locked memory - aligned and zeroed");
+    
+    int isLocked = -1;
+    unsigned char* memory = mnLockedMemory_alloc(1000, &isLocked);
+    fail_unless(memory != NULL, "allocation should succeed");
+    fail_unless(isLocked == 0 || isLocked == 1, "the lock state should be reported");
+    fail_unless((uintptr_t)memory % MN_ARENA_ALIGNMENT == 0, "memory should be aligned");
+    
+    int allZero = 1;
+    for (int i = 0; i < 1000; i++)
+    {
+        allZero = allZero && memory[i] == 0;
+    }
+    fail_unless(allZero, "memory should be zeroed");
+    
+    mnLockedMemory_free(memory);
+    mnLockedMemory_free(NULL);
+    
+    //pages are at least 4 kB everywhere, so small blocks on separate pages
+    //are at least that far apart
+    unsigned char* first = mnLockedMemory_alloc(16, NULL);
+    unsigned char* second = mnLockedMemory_alloc(16, NULL);
+    const uintptr_t distance = first > second ? (uintptr_t)(first - second) : (uintptr_t)(second - first);
+    fail_unless(distance >= 4096, "small blocks should not share a page");
+    mnLockedMemory_free(first);
+    mnLockedMemory_free(second);
+}
+
+static void testAllocAndReset()
+{
+    start_test("Arena - bump allocation and reset to a mark");
+    
+    mnArena arena;
+    fail_unless(mnArena_init(&arena, 4096), "init should succeed");
+    
+    unsigned char* a = mnArena_alloc(&arena, 10);
+    unsigned char* b = mnArena_alloc(&arena, 100);
+    fail_unless(a != NULL && b != NULL, "small allocations should succeed");
+    fail_unless((uintptr_t)a % MN_ARENA_ALIGNMENT == 0 && (uintptr_t)b % MN_ARENA_ALIGNMENT == 0,
+                "allocations should be aligned");
+    fail_unless(b >= a + 10, "allocations should not overlap");
+    
+    const int mark = mnArena_getMark(&arena);
+    unsigned char* c = mnArena_alloc(&arena, 1000);
+    mnArena_reset(&arena, mark);
+    unsigned char* d = mnArena_alloc(&arena, 1000);
+    fail_unless(c == d, "resetting to a mark should free what was allocated after it");
+    
+    fail_unless(mnArena_alloc(&arena, 4096) == NULL, "allocating more than what is left should fail");
+    fail_unless(mnArena_alloc(&arena, -1) == NULL, "negative sizes should fail");
+    
+    mnArena_reset(&arena, 0);
+    fail_unless(mnArena_alloc(&arena, 4096) == a, "the whole capacity should be available after a full reset");
+    fail_unless(arena.highWaterMark == 4096, "the high water mark should be tracked");
+    
+    mnArena_deinit(&arena);
+}
+
+void testArena()
+{
+    testLockedMemory();
+    testAllocAndReset();
+}
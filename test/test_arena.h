@@ -0,0 +1,17 @@
+#ifndef DR_TEST_ARENA_H
+#define DR_TEST_ARENA_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testArena();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_ARENA_H
+
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include "tinycthread.h"
 #include "atomic.h"
 #include "test_atomic.h"
 #include "testmacros.h"
@@ -13,7 +14,7 @@ static void testStore()
     {
         int valRef = rand() % 100000;
         int val = 0;
-        drAtomicStore(valRef, &val);
+        mnAtomicStore(valRef, &val);
         if (val != valRef)
         {
             fail_unless(val == valRef, "atomically stored value should equal reference value");
@@ -30,7 +31,7 @@ static void testLoad()
     for (int i = -r; i < r; i++)
     {
         int valRef = rand() % 100000;
-        int val = drAtomicLoad(&valRef);
+        int val = mnAtomicLoad(&valRef);
         if (val != valRef)
         {
             fail_unless(val == valRef, "atomically loaded value should equal reference value");
@@ -48,7 +49,7 @@ static void testAdd()
     {
         const int valRef = rand() % 100000;
         int val = valRef;
-        drAtomicAdd(&val, i);
+        mnAtomicAdd(&val, i);
         if ((val - i) != valRef)
         {
             fail_unless((val - i) == valRef, "atomically incremented value should equal reference value");
@@ -56,9 +57,149 @@ static void testAdd()
     }
 }
 
+static void testOrderedStore()
+{
+    start_test("Atomic release/relaxed store");
+    
+    const int r = 1000;
+    srand(1234);
+    for (int i = -r; i < r; i++)
+    {
+        int valRef = rand() % 100000;
+        int val = 0;
+        mnAtomicStoreRelease(valRef, &val);
+        if (val != valRef)
+        {
+            fail_unless(val == valRef, "value stored with release ordering should equal reference value");
+        }
+        
+        mnAtomicStoreRelaxed(valRef + 1, &val);
+        if (val != valRef + 1)
+        {
+            fail_unless(val == valRef + 1, "value stored with relaxed ordering should equal reference value");
+        }
+    }
+}
+
+static void testOrderedLoad()
+{
+    start_test("Atomic acquire/relaxed load");
+    
+    const int r = 1000;
+    srand(1234);
+    for (int i = -r; i < r; i++)
+    {
+        int valRef = rand() % 100000;
+        int val = mnAtomicLoadAcquire(&valRef);
+        if (val != valRef)
+        {
+            fail_unless(val == valRef, "value loaded with acquire ordering should equal reference value");
+        }
+        
+        val = mnAtomicLoadRelaxed(&valRef);
+        if (val != valRef)
+        {
+            fail_unless(val == valRef, "value loaded with relaxed ordering should equal reference value");
+        }
+    }
+}
+
+static void testCompareAndSwap()
+{
+    start_test("Atomic compare and swap");
+    
+    int val = 10;
+    int success = mnAtomicCompareAndSwap(11, 20, &val);
+    fail_unless(success == 0 && val == 10, "compare and swap with a mismatching old value should fail");
+    
+    success = mnAtomicCompareAndSwap(10, 20, &val);
+    fail_unless(success == 1 && val == 20, "compare and swap with a matching old value should succeed");
+}
+
+static void testExchange()
+{
+    start_test("Atomic exchange");
+    
+    int val = 10;
+    const int old = mnAtomicExchange(20, &val);
+    fail_unless(old == 10 && val == 20, "exchange should return the old value and store the new one");
+}
+
+static const int messageCount = 100000;
+
+typedef struct
+{
+    int payload;
+    int flag;
+    int errors;
+} Mailbox;
+
+static int entryPointPublisher(void* data)
+{
+    Mailbox* m = (Mailbox*)data;
+    
+    for (int i = 1; i <= messageCount; i++)
+    {
+        //wait for the previous message to be consumed
+        while (mnAtomicLoadAcquire(&m->flag) != 0)
+        {
+            thrd_yield();
+        }
+        m->payload = i;
+        mnAtomicStoreRelease(1, &m->flag);
+    }
+    
+    return 0;
+}
+
+static int entryPointSubscriber(void* data)
+{
+    Mailbox* m = (Mailbox*)data;
+    
+    for (int i = 1; i <= messageCount; i++)
+    {
+        while (mnAtomicLoadAcquire(&m->flag) != 1)
+        {
+            thrd_yield();
+        }
+        if (m->payload != i)
+        {
+            m->errors++;
+        }
+        mnAtomicStoreRelease(0, &m->flag);
+    }
+    
+    return 0;
+}
+
+static void testAcquireReleaseHandoff()
+{
+    start_test("Atomic acquire/release - message passing between threads");
+    
+    Mailbox m;
+    m.payload = 0;
+    m.flag = 0;
+    m.errors = 0;
+    
+    thrd_t t1, t2;
+    thrd_create(&t1, entryPointSubscriber, &m);
+    thrd_create(&t2, entryPointPublisher, &m);
+    
+    int joinRes1, joinRes2;
+    thrd_join(t1, &joinRes1);
+    thrd_join(t2, &joinRes2);
+    
+    fail_unless(m.errors == 0, "payload written before a release store should be visible after an acquire load");
+}
+
 void testAtomic()
 {
     testStore();
     testLoad();
     testAdd();
+    testOrderedStore();
+    testOrderedLoad();
+    testCompareAndSwap();
+    testExchange();
+    testAcquireReleaseHandoff();
 }
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_convolver.h"
+
+#include "atomic.h"
+#include "backend_offline.h"
+#include "convolver.h"
+#include "engine.h"
+#include "simd.h"
+
+/** Callback sizes that don't line up with the blocks. */
+static const int oddBufferSizes[] = {1, 17, 64, 30, 63, 5, 40, 2, 200};
+#define NUM_ODD_BUFFER_SIZES ((int)(sizeof(oddBufferSizes) / sizeof(oddBufferSizes[0])))
+
+static float randomSample()
+{
+    return 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+}
+
+/**
+ * Returns a noise burst that decays by 60 dB over \c length taps.
+ */
+static float* createResponse(int length)
+{
+    float* response = malloc(length * sizeof(float));
+    for (int i = 0; i < length; i++)
+    {
+        response[i] = randomSample() * powf(0.001f, (float)i / length);
+    }
+    return response;
+}
+
+static void convolveDirectly(const float* input, int numFrames, const float* response, int length, double* output)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        double sum = 0.0;
+        for (int k = 0; k < length && k <= i; k++)
+        {
+            sum += (double)response[k] * input[i - k];
+        }
+        output[i] = sum;
+    }
+}
+
+/**
+ * Returns the largest difference from the expected output, relative to the
+ * largest expected sample.
+ */
+static double getRelativeError(const float* output, const double* expected, int numFrames)
+{
+    double maxError = 0.0;
+    double maxExpected = 0.0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const double error = fabs(output[i] - expected[i]);
+        maxError = error > maxError ? error : maxError;
+        maxExpected = fabs(expected[i]) > maxExpected ? fabs(expected[i]) : maxExpected;
+    }
+    return maxError / maxExpected;
+}
+
+/**
+ * Gives the tail thread up to five seconds to process the input that the
+ * tail of the next \c numFrames frames comes from.
+ */
+static int waitForTail(mnConvolver* convolver, int numFrames)
+{
+    if (!convolver->hasTail)
+    {
+        return 1;
+    }
+    
+    const int tailBlockSize = convolver->options.tailBlockSize;
+    const int first = convolver->tailBlock;
+    const int last = convolver->tailBlock + (convolver->tailPosition + numFrames - 1) / tailBlockSize;
+    struct timespec duration = {0, 100000};
+    for (int block = first; block <= last; block++)
+    {
+        for (int i = 0; i < 50000 && mnAtomicLoadAcquire(&convolver->numTailBlocksRead) < block - 1; i++)
+        {
+            thrd_sleep(&duration, NULL);
+        }
+        if (mnAtomicLoadAcquire(&convolver->numTailBlocksRead) < block - 1)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Convolves \c numFrames frames of noise per channel in callbacks of odd sizes
+ * and returns the largest relative error over the channels.
+ */
+static double measureError(const mnConvolverOptions* options, int length, int numFrames, int isPlanar)
+{
+    const int numChannels = options->numChannels;
+    float* responses[2];
+    float* inputs[2];
+    float* outputs[2];
+    double* expected = malloc(numFrames * sizeof(double));
+    float* interleaved = malloc(numChannels * numFrames * sizeof(float));
+    for (int c = 0; c < numChannels; c++)
+    {
+        responses[c] = createResponse(length);
+        inputs[c] = malloc(numFrames * sizeof(float));
+        outputs[c] = malloc(numFrames * sizeof(float));
+        for (int i = 0; i < numFrames; i++)
+        {
+            inputs[c][i] = randomSample();
+            interleaved[i * numChannels + c] = inputs[c][i];
+        }
+        memcpy(outputs[c], inputs[c], numFrames * sizeof(float));
+    }
+    
+    mnConvolver convolver;
+    fail_unless(mnConvolver_init(&convolver, options, (const float* const*)responses, length), "init failed");
+    
+    int isTailOnTime = 1;
+    for (int start = 0, call = 0; start < numFrames; call++)
+    {
+        const int size = oddBufferSizes[call % NUM_ODD_BUFFER_SIZES];
+        const int count = numFrames - start < size ? numFrames - start : size;
+        isTailOnTime &= waitForTail(&convolver, count);
+        if (isPlanar)
+        {
+            float* channels[2] = {outputs[0] + start, numChannels > 1 ? outputs[1] + start : NULL};
+            mnConvolver_processPlanar(&convolver, channels, count);
+        }
+        else
+        {
+            mnConvolver_processInterleaved(&convolver, interleaved + start * numChannels, count);
+        }
+        start += count;
+    }
+    fail_unless(isTailOnTime, "the tail thread should keep up");
+    fail_unless(mnConvolver_getNumLateFrames(&convolver) == 0, "no frames should be late when paced");
+    mnConvolver_deinit(&convolver);
+    
+    double maxError = 0.0;
+    for (int c = 0; c < numChannels; c++)
+    {
+        if (!isPlanar)
+        {
+            for (int i = 0; i < numFrames; i++)
+            {
+                outputs[c][i] = interleaved[i * numChannels + c];
+            }
+        }
+        convolveDirectly(inputs[c], numFrames, responses[c], length, expected);
+        const double error = getRelativeError(outputs[c], expected, numFrames);
+        maxError = error > maxError ? error : maxError;
+        free(responses[c]);
+        free(inputs[c]);
+        free(outputs[c]);
+    }
+    free(expected);
+    free(interleaved);
+    return maxError;
+}
+
+static void testDirectConvolution()
+{
+    start_test("Convolver - all kernels match direct convolution");
+    
+    mnConvolverOptions options;
+    mnConvolverOptions_setDefaults(&options);
+    mnConvolver convolver;
+    const float* response = NULL;
+    options.blockSize = 48;
+    fail_unless(!mnConvolver_init(&convolver, &options, &response, 1), "block sizes that aren't powers of two should be rejected");
+    options.blockSize = 64;
+    options.tailBlockSize = 64;
+    fail_unless(!mnConvolver_init(&convolver, &options, &response, 1), "tail blocks should be larger than blocks");
+    options.tailBlockSize = 256;
+    options.sampleRate = 0.0f;
+    fail_unless(!mnConvolver_init(&convolver, &options, &response, 1), "a sample rate of zero should be rejected");
+    options.sampleRate = 44100.0f;
+    
+    options.numChannels = 2;
+    options.tailBlockSize = 0;
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    const mnSIMDLevel levels[] = {MN_SIMD_NONE, MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    const int lengths[] = {10, 64, 65, 1000};
+    double maxError = 0.0;
+    for (int l = 0; l < 4; l++)
+    {
+        mnSIMD_setLevel(levels[l]);
+        for (int i = 0; i < 4; i++)
+        {
+            const double error = measureError(&options, lengths[i], 4000, i % 2);
+            maxError = error > maxError ? error : maxError;
+        }
+    }
+    mnSIMD_setLevel(level);
+    
+    fail_unless(maxError < 1e-5, "the output differs from direct convolution");
+}
+
+static void testTail()
+{
+    start_test("Convolver - the tail thread's output lines up");
+    
+    mnConvolverOptions options;
+    mnConvolverOptions_setDefaults(&options);
+    options.numChannels = 2;
+    options.blockSize = 32;
+    options.tailBlockSize = 256;
+    
+    fail_unless(measureError(&options, 3000, 8000, 1) < 1e-5, "the planar output differs from direct convolution");
+    fail_unless(measureError(&options, 513, 8000, 0) < 1e-5, "the interleaved output differs from direct convolution");
+}
+
+static void testLateTail()
+{
+    start_test("Convolver - recovers after the tail thread falls behind");
+    
+    mnConvolverOptions options;
+    mnConvolverOptions_setDefaults(&options);
+    options.blockSize = 32;
+    options.tailBlockSize = 128;
+    const int length = 4000;
+    float* response = createResponse(length);
+    float* buffer = malloc(length * sizeof(float));
+    
+    mnConvolver convolver;
+    fail_unless(mnConvolver_init(&convolver, &options, (const float* const*)&response, length), "init failed");
+    
+    //run ahead of the tail thread as fast as possible
+    for (int i = 0; i < 200; i++)
+    {
+        for (int j = 0; j < 64; j++)
+        {
+            buffer[j] = randomSample();
+        }
+        mnConvolver_processPlanar(&convolver, &buffer, 64);
+    }
+    
+    //once the noise has rung out, silence in gives silence out, and an
+    //impulse gives the response
+    int isTailOnTime = 1;
+    float maxError = 0.0f;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int start = 0; start < length; start += 50)
+        {
+            const int count = length - start < 50 ? length - start : 50;
+            memset(buffer, 0, count * sizeof(float));
+            buffer[0] = pass == 1 && start == 0 ? 1.0f : 0.0f;
+            isTailOnTime &= waitForTail(&convolver, count);
+            mnConvolver_processPlanar(&convolver, &buffer, count);
+            for (int i = 0; pass == 1 && i < count; i++)
+            {
+                const float error = fabsf(buffer[i] - response[start + i]);
+                maxError = error > maxError ? error : maxError;
+            }
+        }
+    }
+    fail_unless(isTailOnTime, "the tail thread should catch up");
+    fail_unless(maxError < 1e-5f, "the impulse response should come out intact");
+    
+    mnConvolver_deinit(&convolver);
+    free(response);
+    free(buffer);
+}
+
+static void renderNoise(int numChannels, int numFrames, float* samples, void* context)
+{
+    const float* noise = *(const float**)context;
+    memcpy(samples, noise, numChannels * numFrames * sizeof(float));
+    *(const float**)context = noise + numChannels * numFrames;
+}
+
+static void testEngine()
+{
+    start_test("Convolver - engine output");
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfInputChannels = 0;
+    options.numberOfOutputChannels = 2;
+    options.bufferSizeInFrames = 100;
+    options.sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    
+    //the left channel is delayed by 100 frames, the right one is echoed
+    float left[200] = {0};
+    float right[200] = {0};
+    left[100] = 1.0f;
+    right[0] = 1.0f;
+    right[199] = 0.5f;
+    const float* responses[2] = {left, right};
+    mnConvolverOptions convolverOptions;
+    mnConvolverOptions_setDefaults(&convolverOptions);
+    convolverOptions.numChannels = 2;
+    convolverOptions.blockSize = 64;
+    mnConvolver convolver;
+    fail_unless(mnConvolver_init(&convolver, &convolverOptions, responses, 200), "init failed");
+    
+    const int numFrames = 5000;
+    float* noise = malloc(2 * numFrames * sizeof(float));
+    float* output = malloc(2 * numFrames * sizeof(float));
+    for (int i = 0; i < 2 * numFrames; i++)
+    {
+        noise[i] = randomSample();
+    }
+    
+    const float* next = noise;
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, renderNoise, &next, &options);
+    mnEngine_setConvolver(&engine, &convolver);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == numFrames, "frame count mismatch");
+    mnEngine_deinit(&engine);
+    
+    float maxError = 0.0f;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float expectedLeft = i >= 100 ? noise[2 * (i - 100)] : 0.0f;
+        const float expectedRight = noise[2 * i + 1] + (i >= 199 ? 0.5f * noise[2 * (i - 199) + 1] : 0.0f);
+        maxError = fmaxf(maxError, fabsf(output[2 * i] - expectedLeft));
+        maxError = fmaxf(maxError, fabsf(output[2 * i + 1] - expectedRight));
+    }
+    fail_unless(maxError < 1e-5f, "the output should be convolved");
+    
+    mnConvolver_deinit(&convolver);
+    free(noise);
+    free(output);
+}
+
+void testConvolver()
+{
+    testDirectConvolution();
+    testTail();
+    testLateTail();
+    testEngine();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_CONVOLVER_H
+#define DR_TEST_CONVOLVER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testConvolver();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_CONVOLVER_H
+
@@ -0,0 +1,679 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_engine.h"
+
+#include "engine.h"
+#include "backend_null.h"
+#include "backend_offline.h"
+
+typedef struct
+{
+    int numOutputCalls;
+    int numInputCalls;
+    int numOutputFrames;
+    int maxFramesPerCall;
+    int badChannelCount;
+    float lastInputSample;
+} CallbackState;
+
+static void inputCallback(int numChannels, int numFrames, const float* samples, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    state->numInputCalls++;
+    if (numChannels != 1)
+    {
+        state->badChannelCount = 1;
+    }
+    state->lastInputSample = samples[numFrames * numChannels - 1];
+}
+
+/**
+ * Writes a ramp that continues across buffers, so the rendered output
+ * reveals dropped or repeated frames.
+ */
+static void outputCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    state->numOutputCalls++;
+    if (numChannels != 2)
+    {
+        state->badChannelCount = 1;
+    }
+    if (numFrames > state->maxFramesPerCall)
+    {
+        state->maxFramesPerCall = numFrames;
+    }
+    
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float value = 0.001f * (float)((state->numOutputFrames + i) % 1000);
+        samples[i * numChannels] = value;
+        samples[i * numChannels + 1] = -value;
+    }
+    state->numOutputFrames += numFrames;
+}
+
+static void initOptions(mnOptions* options, mnSampleFormat format)
+{
+    mnOptions_setDefaults(options);
+    options->numberOfInputChannels = 1;
+    options->numberOfOutputChannels = 2;
+    options->bufferSizeInFrames = 64;
+    options->sampleFormat = format;
+}
+
+static void testOfflineFloat()
+{
+    start_test("Engine - offline rendering, float stream");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_FLOAT32);
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), inputCallback, outputCallback, &state, &options);
+    
+    const int numFrames = 1000;
+    float* output = malloc(numFrames * 2 * sizeof(float));
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == 0,
+                "rendering before starting should fail");
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == numFrames,
+                "frame count mismatch");
+    
+    fail_unless(state.numOutputFrames == numFrames, "callback frame count mismatch");
+    fail_unless(state.numOutputCalls == (numFrames + 63) / 64, "callback count mismatch");
+    fail_unless(state.numInputCalls == state.numOutputCalls, "input callback count mismatch");
+    fail_unless(state.maxFramesPerCall == 64, "buffers exceed the buffer size");
+    fail_unless(!state.badChannelCount, "channel count mismatch");
+    fail_unless(engine.outputScratchBuffer == NULL && engine.inputScratchBuffer == NULL,
+                "float streams should not need scratch buffers");
+    
+    int mismatches = 0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float expected = 0.001f * (float)(i % 1000);
+        if (output[2 * i] != expected || output[2 * i + 1] != -expected)
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "rendered output mismatch");
+    
+    mnEngine_suspend(&engine);
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == 0,
+                "rendering while suspended should fail");
+    fail_unless(mnEngine_resume(&engine), "resume failed");
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, 10) == 10, "render after resume failed");
+    
+    mnEngine_deinit(&engine);
+    free(output);
+}
+
+static void testOfflineInt16()
+{
+    start_test("Engine - offline rendering, 16 bit stream");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_INT16);
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), inputCallback, outputCallback, &state, &options);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    const int numFrames = 100;
+    short input[100];
+    short output[200];
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = -16384;
+    }
+    fail_unless(mnOfflineBackend_render(&engine, input, output, numFrames) == numFrames,
+                "frame count mismatch");
+    
+    fail_unless(state.lastInputSample == -0.5f, "input conversion mismatch");
+    int mismatches = 0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float expected = 0.001f * (float)i;
+        const float left = output[2 * i] / 32767.0f;
+        const float right = output[2 * i + 1] / 32767.0f;
+        if (left - expected > 1e-4f || expected - left > 1e-4f ||
+            right + expected > 1e-4f || -expected - right > 1e-4f)
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "output conversion mismatch");
+    
+    mnEngine_stop(&engine);
+    fail_unless(engine.outputScratchBuffer == NULL && engine.inputScratchBuffer == NULL,
+                "scratch buffers should be released when stopping");
+    mnEngine_deinit(&engine);
+}
+
+static void planarInputCallback(int numChannels, int numFrames, const float* const* channels, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    state->numInputCalls++;
+    //channel c of the test input holds the value 0.25 * c
+    for (int c = 0; c < numChannels; c++)
+    {
+        for (int i = 0; i < numFrames; i++)
+        {
+            if (channels[c][i] != 0.25f * c)
+            {
+                state->badChannelCount = 1;
+            }
+        }
+    }
+}
+
+static void planarOutputCallback(int numChannels, int numFrames, float* const* channels, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    state->numOutputCalls++;
+    for (int c = 0; c < numChannels; c++)
+    {
+        for (int i = 0; i < numFrames; i++)
+        {
+            channels[c][i] = -0.25f * c;
+        }
+    }
+}
+
+static void testOfflinePlanar()
+{
+    start_test("Engine - offline rendering, planar callbacks");
+    
+    const mnSampleFormat formats[] = {MN_SAMPLE_FORMAT_FLOAT32, MN_SAMPLE_FORMAT_INT32};
+    for (int f = 0; f < 2; f++)
+    {
+        CallbackState state;
+        memset(&state, 0, sizeof(state));
+        mnOptions options;
+        initOptions(&options, formats[f]);
+        options.numberOfInputChannels = 4;
+        options.numberOfOutputChannels = 3;
+        
+        mnEngine engine;
+        mnEngine_initPlanar(&engine,
+                            mnOfflineBackend_get(),
+                            planarInputCallback,
+                            planarOutputCallback,
+                            &state,
+                            &options);
+        fail_unless(mnEngine_start(&engine), "start failed");
+        
+        const int numFrames = 100;
+        float inputFloats[4 * 100];
+        int input[4 * 100];
+        int output[3 * 100];
+        for (int i = 0; i < numFrames; i++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                inputFloats[4 * i + c] = 0.25f * c;
+            }
+        }
+        mnConvertFromFloat(inputFloats, input, formats[f], 4 * numFrames, NULL);
+        mnOfflineBackend_render(&engine, input, output, numFrames);
+        
+        fail_unless(state.numInputCalls == 2 && state.numOutputCalls == 2, "callback count mismatch");
+        fail_unless(!state.badChannelCount, "deinterleaved input mismatch");
+        
+        float outputFloats[3 * 100];
+        mnConvertToFloat(output, formats[f], outputFloats, 3 * numFrames);
+        int mismatches = 0;
+        for (int i = 0; i < numFrames; i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                if (outputFloats[3 * i + c] != -0.25f * c)
+                {
+                    mismatches++;
+                }
+            }
+        }
+        fail_unless(mismatches == 0, "interleaved output mismatch");
+        
+        mnEngine_deinit(&engine);
+    }
+}
+
+typedef struct
+{
+    int numCalls;
+    int frameCountMismatch;
+    int copiedInput;
+    const float* streamInput;
+    int numFramesProcessed;
+} DuplexState;
+
+/**
+ * Passes the mono input through to both output channels, the left one inverted.
+ */
+static void duplexCallback(const float* inputSamples,
+                           float* outputSamples,
+                           int numInputChannels,
+                           int numOutputChannels,
+                           int numFrames,
+                           void* context)
+{
+    DuplexState* state = (DuplexState*)context;
+    state->numCalls++;
+    if (numFrames > 64 || numInputChannels != 1 || numOutputChannels != 2)
+    {
+        state->frameCountMismatch = 1;
+    }
+    if (state->streamInput && inputSamples != state->streamInput + state->numFramesProcessed)
+    {
+        state->copiedInput = 1;
+    }
+    
+    for (int i = 0; i < numFrames; i++)
+    {
+        outputSamples[2 * i] = -inputSamples[i];
+        outputSamples[2 * i + 1] = inputSamples[i];
+    }
+    state->numFramesProcessed += numFrames;
+}
+
+static void testOfflineDuplex()
+{
+    start_test("Engine - offline rendering, duplex callback");
+    
+    const mnSampleFormat formats[] = {MN_SAMPLE_FORMAT_FLOAT32, MN_SAMPLE_FORMAT_INT16};
+    for (int f = 0; f < 2; f++)
+    {
+        const int numFrames = 960;
+        float inputFloats[960];
+        short inputShorts[960];
+        for (int i = 0; i < numFrames; i++)
+        {
+            inputFloats[i] = 0.001f * (float)(i % 500);
+        }
+        mnConvertFromFloat(inputFloats, inputShorts, MN_SAMPLE_FORMAT_INT16, numFrames, NULL);
+        
+        DuplexState state;
+        memset(&state, 0, sizeof(state));
+        mnOptions options;
+        initOptions(&options, formats[f]);
+        
+        mnEngine engine;
+        mnEngine_initDuplex(&engine, mnOfflineBackend_get(), duplexCallback, &state, &options);
+        fail_unless(mnEngine_start(&engine), "start failed");
+        
+        float output[2 * 960];
+        short outputShorts[2 * 960];
+        if (formats[f] == MN_SAMPLE_FORMAT_FLOAT32)
+        {
+            //float input should reach the callback without being copied
+            state.streamInput = inputFloats;
+            mnOfflineBackend_render(&engine, inputFloats, output, numFrames);
+        }
+        else
+        {
+            mnOfflineBackend_render(&engine, inputShorts, outputShorts, numFrames);
+            mnConvertToFloat(outputShorts, MN_SAMPLE_FORMAT_INT16, output, 2 * numFrames);
+        }
+        
+        fail_unless(state.numCalls == (numFrames + 63) / 64, "there should be one call per buffer");
+        fail_unless(!state.frameCountMismatch, "buffer sizes or channel counts mismatch");
+        fail_unless(!state.copiedInput, "float input should be passed in place");
+        
+        int mismatches = 0;
+        for (int i = 0; i < numFrames; i++)
+        {
+            const float error = output[2 * i + 1] - inputFloats[i];
+            if (error > 1e-4f || error < -1e-4f || output[2 * i] != -output[2 * i + 1])
+            {
+                mismatches++;
+            }
+        }
+        fail_unless(mismatches == 0, "input should pass through to the output of the same buffer");
+        
+        const double latency = mnEngine_getRoundTripLatency(&engine);
+        const double expected = 2.0 * 64 / options.sampleRate;
+        fail_unless(latency > expected - 1e-9 && latency < expected + 1e-9,
+                    "without device latencies, the round trip should be two buffers");
+        
+        mnEngine_deinit(&engine);
+    }
+}
+
+static void testNullBackend()
+{
+    start_test("Engine - null backend runs in real time");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_FLOAT32);
+    options.numberOfInputChannels = 0;
+    options.sampleRate = 32000;
+    
+    //64 frames at 32 kHz is 2 ms per buffer, so about 50 buffers in 100 ms
+    mnEngine engine;
+    mnEngine_init(&engine, mnNullBackend_get(), NULL, outputCallback, &state, &options);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    struct timespec duration = {0, 100000000};
+    thrd_sleep(&duration, NULL);
+    mnEngine_stop(&engine);
+    
+    //generous bounds, since the test machine may be busy
+    fail_unless(state.numOutputCalls > 10, "too few callbacks");
+    fail_unless(state.numOutputCalls < 100, "too many callbacks, the thread is not paced");
+    
+    const int numCallsAfterStop = state.numOutputCalls;
+    thrd_sleep(&duration, NULL);
+    fail_unless(state.numOutputCalls == numCallsAfterStop, "callbacks invoked after stopping");
+    
+    mnEngine_deinit(&engine);
+}
+
+static void testRenderAheadOffline()
+{
+    start_test("Engine - render-ahead ring, 16 bit stream");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_INT16);
+    options.numberOfInputChannels = 0;
+    options.renderAheadFrames = 512;
+    options.maxRenderAheadFrames = 1024;
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+    fail_unless(mnEngine_getRenderAheadFill(&engine) == 0, "nothing should be rendered before starting");
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(engine.isRenderingAhead, "the engine should render ahead");
+    fail_unless(mnEngine_getRenderAheadFill(&engine) == 512, "the ring should be filled when starting");
+    
+    //within the frames rendered before starting, so the output doesn't
+    //depend on how fast the render thread catches up
+    const int numFrames = 448;
+    short output[2 * 448];
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == numFrames,
+                "frame count mismatch");
+    
+    int mismatches = 0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float expected = 0.001f * (float)i;
+        const float left = output[2 * i] / 32767.0f;
+        if (left - expected > 1e-4f || expected - left > 1e-4f)
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "output should come from the ring in order");
+    
+    //the render thread tops the ring up to a new target
+    mnEngine_setRenderAheadFrames(&engine, 100000);
+    struct timespec duration = {0, 1000000};
+    for (int i = 0; i < 1000 && mnEngine_getRenderAheadFill(&engine) < 1024; i++)
+    {
+        thrd_sleep(&duration, NULL);
+    }
+    fail_unless(mnEngine_getRenderAheadFill(&engine) == 1024, "the target should be clamped to the maximum");
+    
+    mnEngine_stop(&engine);
+    mnTimingSnapshot snapshot;
+    mnEngine_getTimingStats(&engine, &snapshot);
+    fail_unless(snapshot.numUnderruns == 0, "no frames should be missing");
+    fail_unless(state.numOutputFrames == 448 + 1024, "callback frame count mismatch");
+    mnEngine_deinit(&engine);
+}
+
+static void testRenderAheadTooLarge()
+{
+    start_test("Engine - render-ahead ring too large to allocate");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_FLOAT32);
+    options.numberOfInputChannels = 0;
+    options.numberOfOutputChannels = 8;
+    options.renderAheadFrames = 512;
+    options.maxRenderAheadFrames = 1 << 28;
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+    fail_unless(!mnEngine_start(&engine), "start should fail");
+    fail_unless(!engine.isOpen && !engine.isRenderingAhead, "a failed start should leave the engine closed");
+    fail_unless(state.numOutputCalls == 0, "nothing should be rendered");
+    mnEngine_deinit(&engine);
+}
+
+/**
+ * Renders the ramp, but takes several buffers' worth of time now and then.
+ */
+static void spikyOutputCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    if (state->numOutputCalls % 25 == 24)
+    {
+        struct timespec duration = {0, 10000000};
+        thrd_sleep(&duration, NULL);
+    }
+    outputCallback(numChannels, numFrames, samples, context);
+}
+
+static void testRenderAheadSpikes()
+{
+    start_test("Engine - render-ahead absorbs slow buffers");
+    
+    CallbackState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_FLOAT32);
+    options.numberOfInputChannels = 0;
+    options.sampleRate = 32000;
+    //64 frame buffers last 2 ms, so 10 ms spikes need 5 buffers of slack
+    options.renderAheadFrames = 1024;
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnNullBackend_get(), NULL, spikyOutputCallback, &state, &options);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    struct timespec duration = {0, 300000000};
+    thrd_sleep(&duration, NULL);
+    mnEngine_stop(&engine);
+    
+    mnTimingSnapshot snapshot;
+    mnEngine_getTimingStats(&engine, &snapshot);
+    fail_unless(state.numOutputCalls > 50, "too few callbacks");
+    fail_unless(snapshot.numUnderruns == 0, "the ring should cover the slow buffers");
+    fail_unless(snapshot.maxDurationMicroseconds < 5000, "the device callback should only copy frames");
+    
+    mnEngine_deinit(&engine);
+}
+
+/**
+ * Device buffer sizes that don't divide the block size, to be used in turn.
+ */
+static const int oddBufferSizes[] = {1, 17, 64, 30, 63, 5, 40, 2};
+
+static void testFixedBufferSize()
+{
+    start_test("Engine - fixed size blocks from odd sized buffers");
+    
+    const mnSampleFormat formats[] = {MN_SAMPLE_FORMAT_FLOAT32, MN_SAMPLE_FORMAT_INT16};
+    for (int f = 0; f < 2; f++)
+    {
+        CallbackState state;
+        memset(&state, 0, sizeof(state));
+        mnOptions options;
+        initOptions(&options, formats[f]);
+        options.fixedBufferSize = 1;
+        
+        mnEngine engine;
+        mnEngine_init(&engine, mnOfflineBackend_get(), inputCallback, outputCallback, &state, &options);
+        fail_unless(mnEngine_start(&engine), "start failed");
+        fail_unless(engine.isBufferSizeFixed, "the buffer size should be fixed");
+        
+        const int numFrames = 1000;
+        float inputFloats[1000];
+        short inputShorts[1000];
+        for (int i = 0; i < numFrames; i++)
+        {
+            inputFloats[i] = 0.0005f * (float)i;
+        }
+        mnConvertFromFloat(inputFloats, inputShorts, MN_SAMPLE_FORMAT_INT16, numFrames, NULL);
+        float output[2 * 1000];
+        short outputShorts[2 * 1000];
+        
+        int numRendered = 0;
+        for (int i = 0; numRendered < numFrames; i++)
+        {
+            int n = oddBufferSizes[i % 8];
+            if (n > numFrames - numRendered)
+            {
+                n = numFrames - numRendered;
+            }
+            if (formats[f] == MN_SAMPLE_FORMAT_FLOAT32)
+            {
+                mnOfflineBackend_render(&engine, inputFloats + numRendered, output + 2 * numRendered, n);
+            }
+            else
+            {
+                mnOfflineBackend_render(&engine, inputShorts + numRendered, outputShorts + 2 * numRendered, n);
+            }
+            numRendered += n;
+        }
+        if (formats[f] == MN_SAMPLE_FORMAT_INT16)
+        {
+            mnConvertToFloat(outputShorts, MN_SAMPLE_FORMAT_INT16, output, 2 * numFrames);
+        }
+        
+        fail_unless(state.maxFramesPerCall == 64 && state.numOutputFrames == 64 * state.numOutputCalls,
+                    "every output call should get a whole block");
+        fail_unless(state.numOutputFrames == 1024, "only the blocks needed should be rendered");
+        int mismatches = 0;
+        for (int i = 0; i < numFrames; i++)
+        {
+            const float error = output[2 * i] - 0.001f * (float)i;
+            if (error > 1e-4f || error < -1e-4f)
+            {
+                mismatches++;
+            }
+        }
+        fail_unless(mismatches == 0, "the output should continue across buffers without delay");
+        
+        fail_unless(state.numInputCalls == numFrames / 64, "every input call should get a whole block");
+        const float error = state.lastInputSample - inputFloats[64 * state.numInputCalls - 1];
+        fail_unless(error < 1e-4f && error > -1e-4f, "input blocks should hold the frames in order");
+        const int latency = mnEngine_getBlockLatency(&engine);
+        fail_unless(latency > 0 && latency < 64, "the latency should be the input frames left waiting");
+        
+        mnEngine_deinit(&engine);
+    }
+}
+
+typedef struct
+{
+    int numCalls;
+    int frameCountMismatch;
+} BlockDuplexState;
+
+static void blockDuplexCallback(const float* inputSamples,
+                                float* outputSamples,
+                                int numInputChannels,
+                                int numOutputChannels,
+                                int numFrames,
+                                void* context)
+{
+    BlockDuplexState* state = (BlockDuplexState*)context;
+    state->numCalls++;
+    if (numFrames != 64)
+    {
+        state->frameCountMismatch = 1;
+    }
+    for (int i = 0; i < numFrames; i++)
+    {
+        outputSamples[2 * i] = inputSamples[i];
+        outputSamples[2 * i + 1] = inputSamples[i];
+    }
+}
+
+static void testFixedBufferSizeDuplex()
+{
+    start_test("Engine - fixed size duplex blocks, reported latency");
+    
+    BlockDuplexState state;
+    memset(&state, 0, sizeof(state));
+    mnOptions options;
+    initOptions(&options, MN_SAMPLE_FORMAT_FLOAT32);
+    options.fixedBufferSize = 1;
+    
+    mnEngine engine;
+    mnEngine_initDuplex(&engine, mnOfflineBackend_get(), blockDuplexCallback, &state, &options);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(mnEngine_getBlockLatency(&engine) == 0, "buffers of the block size need no delay");
+    
+    const int numFrames = 2000;
+    float input[2000];
+    float output[2 * 2000];
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = 0.0004f * (float)(i + 1);
+    }
+    
+    //whole blocks first, then odd sizes that make the output wait for input
+    int numRendered = 0;
+    mnOfflineBackend_render(&engine, input, output, 256);
+    numRendered = 256;
+    for (int i = 0; numRendered < numFrames; i++)
+    {
+        int n = oddBufferSizes[i % 8];
+        if (n > numFrames - numRendered)
+        {
+            n = numFrames - numRendered;
+        }
+        mnOfflineBackend_render(&engine, input + numRendered, output + 2 * numRendered, n);
+        numRendered += n;
+    }
+    
+    fail_unless(!state.frameCountMismatch, "every call should get a whole block");
+    fail_unless(state.numCalls == numFrames / 64, "every complete block of input should be processed");
+    
+    const int latency = mnEngine_getBlockLatency(&engine);
+    fail_unless(latency > 0 && latency < 64, "the latency should stay below a block");
+    int mismatches = 0;
+    for (int i = numFrames / 2; i < numFrames; i++)
+    {
+        if (output[2 * i] != input[i - latency])
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "the output should lag the input by the reported latency");
+    
+    const double roundTrip = mnEngine_getRoundTripLatency(&engine);
+    const double expected = (2.0 * engine.lastFramesPerBuffer + latency) / options.sampleRate;
+    fail_unless(roundTrip > expected - 1e-9 && roundTrip < expected + 1e-9,
+                "the round trip should include the block latency");
+    
+    mnEngine_deinit(&engine);
+}
+
+void testEngine()
+{
+    testOfflineFloat();
+    testOfflineInt16();
+    testOfflinePlanar();
+    testOfflineDuplex();
+    testNullBackend();
+    testRenderAheadOffline();
+    testRenderAheadTooLarge();
+    testRenderAheadSpikes();
+    testFixedBufferSize();
+    testFixedBufferSizeDuplex();
+}
@@ -0,0 +1,16 @@
+#ifndef DR_TEST_ENGINE_H
+#define DR_TEST_ENGINE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testEngine();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_ENGINE_H
@@ -0,0 +1,222 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testmacros.h"
+#include "test_event_scheduler.h"
+
+#include "event_scheduler.h"
+#include "engine.h"
+#include "backend_offline.h"
+
+static mnScheduledEvent makeEvent(double sampleTime, int type)
+{
+    mnScheduledEvent event;
+    memset(&event, 0, sizeof(event));
+    event.sampleTime = sampleTime;
+    event.type = type;
+    return event;
+}
+
+static void testOrdering()
+{
+    start_test("Event scheduler - events are handed out in time order");
+    
+    mnEventScheduler scheduler;
+    fail_unless(mnEventScheduler_init(&scheduler, 8), "init should succeed");
+    fail_unless(mnEventScheduler_getNextSampleTime(&scheduler) < 0.0, "the sample time should be unknown at first");
+    
+    const double times[5] = {300.0, 10.0, 200.5, 10.0, 1000.0};
+    for (int i = 0; i < 5; i++)
+    {
+        const mnScheduledEvent event = makeEvent(times[i], i);
+        mnEventScheduler_post(&scheduler, &event);
+    }
+    
+    mnEventScheduler_beginBuffer(&scheduler, 0.0, 512);
+    fail_unless(mnEventScheduler_getNextSampleTime(&scheduler) == 512.0,
+                "the next sample time should follow the buffer");
+    fail_unless(mnEventScheduler_getNextOffset(&scheduler, 0.0, 512) == 10, "the first event is at frame 10");
+    
+    mnScheduledEvent event;
+    fail_unless(!mnEventScheduler_popDue(&scheduler, 9.0, &event), "no event should be due before frame 10");
+    fail_unless(mnEventScheduler_popDue(&scheduler, 10.0, &event) && event.type == 1,
+                "events with equal times should keep their posting order");
+    fail_unless(mnEventScheduler_popDue(&scheduler, 10.0, &event) && event.type == 3,
+                "events with equal times should keep their posting order");
+    fail_unless(mnEventScheduler_getNextOffset(&scheduler, 0.0, 512) == 201,
+                "fractional times should be rounded up to the next frame");
+    fail_unless(mnEventScheduler_popDue(&scheduler, 201.0, &event) && event.type == 2, "events should be sorted");
+    fail_unless(mnEventScheduler_popDue(&scheduler, 511.0, &event) && event.type == 0, "events should be sorted");
+    fail_unless(mnEventScheduler_getNextOffset(&scheduler, 0.0, 512) == 512,
+                "events after the buffer should not split it");
+    
+    mnEventScheduler_deinit(&scheduler);
+}
+
+static void testCapacity()
+{
+    start_test("Event scheduler - full scheduler");
+    
+    mnEventScheduler scheduler;
+    fail_unless(!mnEventScheduler_init(&scheduler, 0), "a capacity of zero should be rejected");
+    fail_unless(!mnEventScheduler_init(&scheduler, INT_MAX), "an overflowing capacity should be rejected");
+    fail_unless(mnEventScheduler_init(&scheduler, 4), "init should succeed");
+    
+    int numPosted = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        const mnScheduledEvent event = makeEvent(100.0 - i, i);
+        numPosted += mnEventScheduler_post(&scheduler, &event);
+    }
+    fail_unless(numPosted == 4, "posting should fail when the scheduler is full");
+    
+    //fill the pending list, then post more events that have to wait in the FIFO
+    mnEventScheduler_beginBuffer(&scheduler, 0.0, 64);
+    for (int i = 0; i < 2; i++)
+    {
+        const mnScheduledEvent event = makeEvent(0.0, 10 + i);
+        numPosted += mnEventScheduler_post(&scheduler, &event);
+    }
+    mnEventScheduler_beginBuffer(&scheduler, 64.0, 64);
+    
+    mnScheduledEvent event;
+    int numPopped = 0;
+    while (mnEventScheduler_popDue(&scheduler, 1000.0, &event))
+    {
+        numPopped++;
+    }
+    mnEventScheduler_beginBuffer(&scheduler, 128.0, 64);
+    while (mnEventScheduler_popDue(&scheduler, 1000.0, &event))
+    {
+        numPopped++;
+    }
+    fail_unless(numPosted == 6 && numPopped == 6, "events should wait in the FIFO while the pending list is full");
+    
+    mnEventScheduler_deinit(&scheduler);
+}
+
+typedef struct
+{
+    float level;
+    int numOutputCalls;
+    int numEvents;
+} SchedulingState;
+
+static void applyEvent(const mnScheduledEvent* event, void* context)
+{
+    SchedulingState* state = (SchedulingState*)context;
+    state->level = event->value;
+    state->numEvents++;
+}
+
+static void renderLevel(int numChannels, int numFrames, float* samples, void* context)
+{
+    SchedulingState* state = (SchedulingState*)context;
+    state->numOutputCalls++;
+    for (int i = 0; i < numFrames * numChannels; i++)
+    {
+        samples[i] = state->level;
+    }
+}
+
+static void renderLevelPlanar(int numChannels, int numFrames, float* const* channels, void* context)
+{
+    SchedulingState* state = (SchedulingState*)context;
+    state->numOutputCalls++;
+    for (int c = 0; c < numChannels; c++)
+    {
+        for (int i = 0; i < numFrames; i++)
+        {
+            channels[c][i] = state->level;
+        }
+    }
+}
+
+/**
+ * Renders two 64 frame buffers with events changing the output level and
+ * checks that each change lands on its exact frame.
+ */
+static int renderEvents(int isPlanar, mnSampleFormat format)
+{
+    SchedulingState state;
+    memset(&state, 0, sizeof(state));
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfOutputChannels = 2;
+    options.bufferSizeInFrames = 64;
+    options.sampleFormat = format;
+    
+    mnEngine engine;
+    if (isPlanar)
+    {
+        mnEngine_initPlanar(&engine, mnOfflineBackend_get(), NULL, renderLevelPlanar, &state, &options);
+    }
+    else
+    {
+        mnEngine_init(&engine, mnOfflineBackend_get(), NULL, renderLevel, &state, &options);
+    }
+    const mnScheduledEvent rejected = makeEvent(0.0, 0);
+    fail_unless(!mnEngine_setEventCallback(&engine, applyEvent, -1), "a negative capacity should be rejected");
+    fail_unless(!mnEngine_postEvent(&engine, &rejected), "events should be disabled after a failed set");
+    fail_unless(mnEngine_setEventCallback(&engine, applyEvent, 16), "setting the event callback should succeed");
+    mnEngine_start(&engine);
+    
+    const double times[4] = {10.0, 10.0, 40.5, 100.0};
+    const float levels[4] = {0.1f, 0.2f, 0.3f, 0.4f};
+    for (int i = 0; i < 4; i++)
+    {
+        mnScheduledEvent event = makeEvent(times[i], 0);
+        event.value = levels[i];
+        mnEngine_postEvent(&engine, &event);
+    }
+    
+    float output[128 * 2];
+    float expected[128 * 2];
+    for (int i = 0; i < 128; i++)
+    {
+        const float level = i < 10 ? 0.0f : i < 41 ? 0.2f : i < 100 ? 0.3f : 0.4f;
+        expected[2 * i] = level;
+        expected[2 * i + 1] = level;
+    }
+    
+    int isCorrect = 1;
+    if (format == MN_SAMPLE_FORMAT_INT16)
+    {
+        short samples[128 * 2];
+        short expectedSamples[128 * 2];
+        mnOfflineBackend_render(&engine, NULL, samples, 128);
+        mnFloatToInt16(expected, expectedSamples, 128 * 2);
+        isCorrect &= memcmp(samples, expectedSamples, sizeof(samples)) == 0;
+    }
+    else
+    {
+        mnOfflineBackend_render(&engine, NULL, output, 128);
+        isCorrect &= memcmp(output, expected, sizeof(output)) == 0;
+    }
+    
+    //three sub-blocks in the first buffer, two in the second
+    isCorrect &= state.numOutputCalls == 5;
+    isCorrect &= state.numEvents == 4;
+    isCorrect &= mnEngine_getNextSampleTime(&engine) == 128.0;
+    
+    mnEngine_deinit(&engine);
+    return isCorrect;
+}
+
+static void testEngineEvents()
+{
+    start_test("Event scheduler - engine applies events at their exact frame");
+    
+    fail_unless(renderEvents(0, MN_SAMPLE_FORMAT_FLOAT32), "interleaved float stream");
+    fail_unless(renderEvents(0, MN_SAMPLE_FORMAT_INT16), "interleaved 16 bit stream");
+    fail_unless(renderEvents(1, MN_SAMPLE_FORMAT_FLOAT32), "planar float stream");
+    fail_unless(renderEvents(1, MN_SAMPLE_FORMAT_INT16), "planar 16 bit stream");
+}
+
+void testEventScheduler()
+{
+    testOrdering();
+    testCapacity();
+    testEngineEvents();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_EVENT_SCHEDULER_H
+#define DR_TEST_EVENT_SCHEDULER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testEventScheduler();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_EVENT_SCHEDULER_H
+
@@ -0,0 +1,131 @@
+#include <math.h>
+#include <stdlib.h>
+#include "testmacros.h"
+#include "test_fft.h"
+
+#include "fft.h"
+#include "simd.h"
+
+#define TWO_PI 6.283185307179586
+
+/**
+ * Computes bins 0 ... size / 2 of the DFT of real input the slow way, in double precision.
+ */
+static void directDFT(const float* input, int size, double* real, double* imag)
+{
+    for (int k = 0; k <= size / 2; k++)
+    {
+        double sumReal = 0.0;
+        double sumImag = 0.0;
+        for (int i = 0; i < size; i++)
+        {
+            //reduce the index first, so the angle stays accurate
+            const double angle = TWO_PI * (double)(((long long)k * i) % size) / size;
+            sumReal += input[i] * cos(angle);
+            sumImag -= input[i] * sin(angle);
+        }
+        real[k] = sumReal;
+        imag[k] = sumImag;
+    }
+}
+
+static void testAgainstDFT()
+{
+    start_test("FFT - all kernels and sizes match a direct DFT");
+    
+    mnFFT fft;
+    fail_unless(!mnFFT_init(&fft, 8), "sizes below 16 should be rejected");
+    fail_unless(!mnFFT_init(&fft, 48), "sizes that aren't powers of two should be rejected");
+    
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    const mnSIMDLevel levels[] = {MN_SIMD_NONE, MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    double maxError = 0.0;
+    
+    for (int size = 16; size <= 4096; size *= 2)
+    {
+        float* input = malloc(size * sizeof(float));
+        for (int i = 0; i < size; i++)
+        {
+            input[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+        }
+        double* expectedReal = malloc((size / 2 + 1) * sizeof(double));
+        double* expectedImag = malloc((size / 2 + 1) * sizeof(double));
+        directDFT(input, size, expectedReal, expectedImag);
+        
+        float* real = malloc((size / 2 + 1) * sizeof(float));
+        float* imag = malloc((size / 2 + 1) * sizeof(float));
+        fail_unless(mnFFT_init(&fft, size), "init failed");
+        for (int l = 0; l < 4; l++)
+        {
+            mnSIMD_setLevel(levels[l]);
+            mnFFT_forwardReal(&fft, input, real, imag);
+            
+            //the bins of white noise grow with the square root of the size
+            for (int k = 0; k <= size / 2; k++)
+            {
+                const double error = hypot(real[k] - expectedReal[k], imag[k] - expectedImag[k]) / sqrt(size);
+                maxError = error > maxError ? error : maxError;
+            }
+        }
+        mnFFT_deinit(&fft);
+        
+        free(input);
+        free(expectedReal);
+        free(expectedImag);
+        free(real);
+        free(imag);
+    }
+    
+    mnSIMD_setLevel(level);
+    fail_unless(maxError < 1e-5, "the transform differs from the DFT");
+}
+
+static void testRoundTrip()
+{
+    start_test("FFT - the inverse transform gives back the input");
+    
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    const mnSIMDLevel levels[] = {MN_SIMD_NONE, MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    double maxError = 0.0;
+    
+    for (int size = 16; size <= 4096; size *= 2)
+    {
+        float* input = malloc(size * sizeof(float));
+        float* output = malloc(size * sizeof(float));
+        float* real = malloc((size / 2 + 1) * sizeof(float));
+        float* imag = malloc((size / 2 + 1) * sizeof(float));
+        for (int i = 0; i < size; i++)
+        {
+            input[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+        }
+        
+        mnFFT fft;
+        fail_unless(mnFFT_init(&fft, size), "init failed");
+        for (int l = 0; l < 4; l++)
+        {
+            mnSIMD_setLevel(levels[l]);
+            mnFFT_forwardReal(&fft, input, real, imag);
+            mnFFT_inverseReal(&fft, real, imag, output);
+            for (int i = 0; i < size; i++)
+            {
+                const double error = fabs(output[i] - input[i]);
+                maxError = error > maxError ? error : maxError;
+            }
+        }
+        mnFFT_deinit(&fft);
+        
+        free(input);
+        free(output);
+        free(real);
+        free(imag);
+    }
+    
+    mnSIMD_setLevel(level);
+    fail_unless(maxError < 1e-5, "the round trip changed the signal");
+}
+
+void testFFT()
+{
+    testAgainstDFT();
+    testRoundTrip();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_FFT_H
+#define DR_TEST_FFT_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testFFT();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_FFT_H
+
@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_file_player.h"
+
+#include "backend_offline.h"
+#include "engine.h"
+#include "file_player.h"
+
+static void getTestPath(char* path, int size, const char* name)
+{
+    const char* directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/%s", directory ? directory : "/tmp", name);
+}
+
+static void put16LE(unsigned char* p, int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void put32LE(unsigned char* p, int value)
+{
+    put16LE(p, value & 0xffff);
+    put16LE(p + 2, (value >> 16) & 0xffff);
+}
+
+/**
+ * Writes a WAV file with an extra chunk before the format chunk. Sample i of
+ * 16 bit files is i % 32768, float files hold i / numSamples.
+ */
+static void writeTestFile(const char* path, int numChannels, int isFloat, int numFrames)
+{
+    const int bytesPerSample = isFloat ? 4 : 2;
+    const int numSamples = numFrames * numChannels;
+    unsigned char header[58];
+    memcpy(header, "RIFF", 4);
+    put32LE(header + 4, 50 + numSamples * bytesPerSample);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "LIST", 4);
+    put32LE(header + 16, 2);
+    put16LE(header + 20, 0);
+    memcpy(header + 22, "fmt ", 4);
+    put32LE(header + 26, 16);
+    put16LE(header + 30, isFloat ? 3 : 1);
+    put16LE(header + 32, numChannels);
+    put32LE(header + 34, 48000);
+    put32LE(header + 38, 48000 * numChannels * bytesPerSample);
+    put16LE(header + 42, numChannels * bytesPerSample);
+    put16LE(header + 44, 8 * bytesPerSample);
+    memcpy(header + 46, "data", 4);
+    put32LE(header + 50, numSamples * bytesPerSample);
+    
+    FILE* file = fopen(path, "wb");
+    fwrite(header, 1, 54, file);
+    for (int i = 0; i < numSamples; i++)
+    {
+        if (isFloat)
+        {
+            const float sample = (float)i / numSamples;
+            fwrite(&sample, sizeof(float), 1, file);
+        }
+        else
+        {
+            const short sample = (short)(i % 32768);
+            fwrite(&sample, sizeof(short), 1, file);
+        }
+    }
+    fclose(file);
+}
+
+static void sleepMilliseconds(int milliseconds)
+{
+    struct timespec t = {0, milliseconds * 1000000L};
+    thrd_sleep(&t, NULL);
+}
+
+static void testStreaming()
+{
+    start_test("File player - streaming files longer than the rings");
+    
+    char path16[256];
+    char pathFloat[256];
+    getTestPath(path16, sizeof(path16), "mn_test_player16.wav");
+    getTestPath(pathFloat, sizeof(pathFloat), "mn_test_player_float.wav");
+    const int numFrames = 100000;
+    writeTestFile(path16, 2, 0, numFrames);
+    writeTestFile(pathFloat, 1, 1, numFrames);
+    
+    mnFilePlayer player;
+    fail_unless(!mnFilePlayer_init(&player, 0, NULL), "a player without streams should be rejected");
+    fail_unless(mnFilePlayer_init(&player, 4, NULL), "init should succeed");
+    fail_unless(mnFilePlayer_open(&player, "/nonexistent.wav", 1024, 0) == -1, "opening a missing file should fail");
+    const int stereo = mnFilePlayer_open(&player, path16, 16384, 0);
+    const int mono = mnFilePlayer_open(&player, pathFloat, 16384, 0);
+    fail_unless(stereo >= 0 && mono >= 0, "opening failed");
+    fail_unless(player.streams[stereo].numChannels == 2 && player.streams[stereo].numFrames == numFrames,
+                "bad file format");
+    
+    //pull at about five times real time at 48 kHz
+    float stereoBlock[2 * 256];
+    float monoBlock[256];
+    int stereoMismatches = 0;
+    int monoMismatches = 0;
+    int numStereoFrames = 0;
+    int numMonoFrames = 0;
+    for (int block = 0; block < numFrames / 256 + 2; block++)
+    {
+        const int numStereo = mnFilePlayer_read(&player, stereo, stereoBlock, 256);
+        for (int i = 0; i < 2 * numStereo; i++)
+        {
+            stereoMismatches += stereoBlock[i] != (float)((2 * numStereoFrames + i) % 32768) / 32768.0f;
+        }
+        numStereoFrames += numStereo;
+        
+        const int numMono = mnFilePlayer_read(&player, mono, monoBlock, 256);
+        for (int i = 0; i < numMono; i++)
+        {
+            monoMismatches += monoBlock[i] != (float)(numMonoFrames + i) / numFrames;
+        }
+        numMonoFrames += numMono;
+        
+        sleepMilliseconds(1);
+    }
+    
+    fail_unless(numStereoFrames == numFrames && numMonoFrames == numFrames, "frame count mismatch");
+    fail_unless(stereoMismatches == 0 && monoMismatches == 0, "decoded samples mismatch");
+    fail_unless(mnFilePlayer_getNumUnderruns(&player, stereo) == 0 && mnFilePlayer_getNumUnderruns(&player, mono) == 0,
+                "reading past the end of a file should not count as an underrun");
+    fail_unless(stereoBlock[2 * 255] == 0.0f, "frames past the end should be silent");
+    
+    mnFilePlayer_deinit(&player);
+    remove(path16);
+    remove(pathFloat);
+}
+
+static void testSeek()
+{
+    start_test("File player - sample accurate seeking with pre-roll");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_player_seek.wav");
+    const int numFrames = 200000;
+    writeTestFile(path, 1, 1, numFrames);
+    
+    mnFilePlayer player;
+    fail_unless(mnFilePlayer_init(&player, 1, NULL), "init should succeed");
+    const int stream = mnFilePlayer_open(&player, path, 8192, 4096);
+    
+    float block[512];
+    mnFilePlayer_read(&player, stream, block, 512);
+    
+    const long long targets[] = {150000, 1234, numFrames - 100, 77777};
+    int mismatches = 0;
+    for (int t = 0; t < 4; t++)
+    {
+        mnFilePlayer_seek(&player, stream, targets[t]);
+        while (mnFilePlayer_isSeeking(&player, stream))
+        {
+            sleepMilliseconds(1);
+        }
+        
+        //the pre-roll covers the time it takes to refill the ring
+        const int numRead = mnFilePlayer_read(&player, stream, block, 512);
+        const int expected = numFrames - targets[t] < 512 ? (int)(numFrames - targets[t]) : 512;
+        fail_unless(numRead == expected, "the pre-roll should be played right after a seek");
+        for (int i = 0; i < numRead; i++)
+        {
+            mismatches += block[i] != (float)(targets[t] + i) / numFrames;
+        }
+    }
+    fail_unless(mismatches == 0, "playback should continue exactly at the seek target");
+    
+    //playback continues from the ring after the pre-roll
+    long long position = 77777 + 512;
+    for (int i = 0; i < 40; i++)
+    {
+        const int numRead = mnFilePlayer_read(&player, stream, block, 512);
+        for (int j = 0; j < numRead; j++)
+        {
+            mismatches += block[j] != (float)(position + j) / numFrames;
+        }
+        position += numRead;
+        sleepMilliseconds(1);
+    }
+    fail_unless(mismatches == 0 && position == 77777 + 41 * 512, "frames after the pre-roll mismatch");
+    fail_unless(mnFilePlayer_getNumUnderruns(&player, stream) == 0, "there should be no underruns");
+    
+    mnFilePlayer_deinit(&player);
+    remove(path);
+}
+
+typedef struct
+{
+    mnFilePlayer* player;
+    int stream;
+} EngineState;
+
+static void outputCallback(int numChannels, int numFrames, float* samples, void* callbackContext)
+{
+    EngineState* state = (EngineState*)callbackContext;
+    mnFilePlayer_read(state->player, state->stream, samples, numFrames);
+}
+
+static void testUnderrun()
+{
+    start_test("File player - underruns are counted in the engine's stats");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_player_underrun.wav");
+    writeTestFile(path, 1, 1, 100000);
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfOutputChannels = 1;
+    options.bufferSizeInFrames = 512;
+    
+    mnEngine engine;
+    EngineState state;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+    
+    mnFilePlayer player;
+    fail_unless(mnFilePlayer_init(&player, 1, &engine), "init should succeed");
+    state.player = &player;
+    state.stream = mnFilePlayer_open(&player, path, 256, 0);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    //rendering faster than the prefetch thread polls drains the small ring
+    float output[2048];
+    mnOfflineBackend_render(&engine, NULL, output, 2048);
+    
+    mnTimingSnapshot snapshot;
+    mnEngine_getTimingStats(&engine, &snapshot);
+    fail_unless(mnFilePlayer_getNumUnderruns(&player, state.stream) > 0, "the stream should underrun");
+    fail_unless(snapshot.numUnderruns == mnFilePlayer_getNumUnderruns(&player, state.stream),
+                "the engine should count the underruns");
+    
+    mnEngine_deinit(&engine);
+    mnFilePlayer_deinit(&player);
+    remove(path);
+}
+
+static void testUnderrunFromRenderThread()
+{
+    start_test("File player - underruns counted from the render thread");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_player_render_ahead.wav");
+    writeTestFile(path, 1, 1, 100000);
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfOutputChannels = 1;
+    options.bufferSizeInFrames = 512;
+    options.renderAheadFrames = 2048;
+    
+    //the output callback runs on the render thread while the device thread records timing
+    mnEngine engine;
+    EngineState state;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+    
+    mnFilePlayer player;
+    fail_unless(mnFilePlayer_init(&player, 1, &engine), "init should succeed");
+    state.player = &player;
+    state.stream = mnFilePlayer_open(&player, path, 256, 0);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    float output[2048];
+    for (int i = 0; i < 32; i++)
+    {
+        mnOfflineBackend_render(&engine, NULL, output, 2048);
+    }
+    
+    mnTimingSnapshot snapshot;
+    mnEngine_getTimingStats(&engine, &snapshot);
+    fail_unless(mnFilePlayer_getNumUnderruns(&player, state.stream) > 0, "the stream should underrun");
+    fail_unless(snapshot.numUnderruns > 0, "the engine should count the underruns");
+    
+    mnEngine_deinit(&engine);
+    mnFilePlayer_deinit(&player);
+    remove(path);
+}
+
+void testFilePlayer()
+{
+    testStreaming();
+    testSeek();
+    testUnderrun();
+    testUnderrunFromRenderThread();
+}
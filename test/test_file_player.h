@@ -0,0 +1,17 @@
+#ifndef DR_TEST_FILE_PLAYER_H
+#define DR_TEST_FILE_PLAYER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testFilePlayer();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_FILE_PLAYER_H
+
@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include "testmacros.h"
+#include "test_graph.h"
+
+#include "atomic.h"
+#include "graph.h"
+
+#define NUM_NODES 24
+
+static const int bufferCount = 200;
+
+typedef struct
+{
+    /** Only accessed through atomic operations. */
+    int clock;
+    int numFrames;
+    int badNumFrames;
+    /** The clock value when each node last ran. Only accessed through atomic operations. */
+    int finishTimes[NUM_NODES];
+    int runCounts[NUM_NODES];
+} Recorder;
+
+typedef struct
+{
+    Recorder* recorder;
+    int index;
+} NodeContext;
+
+static void recordNode(int numFrames, void* context)
+{
+    NodeContext* node = (NodeContext*)context;
+    Recorder* recorder = node->recorder;
+    
+    //a little work, so that workers get a chance to steal
+    volatile float sum = 0.0f;
+    for (int i = 0; i < 2000; i++)
+    {
+        sum += 0.5f;
+    }
+    
+    if (numFrames != recorder->numFrames)
+    {
+        mnAtomicStore(1, &recorder->badNumFrames);
+    }
+    mnAtomicAdd(&recorder->runCounts[node->index], 1);
+    mnAtomicStore(mnAtomicAdd(&recorder->clock, 1), &recorder->finishTimes[node->index]);
+}
+
+/**
+ * Builds layers of nodes where each node depends on two nodes of the
+ * previous layer, processes a number of buffers and checks that every node
+ * ran once per buffer, after its dependencies.
+ */
+static int processLayers(int numWorkers)
+{
+    static Recorder recorder;
+    static NodeContext contexts[NUM_NODES];
+    memset(&recorder, 0, sizeof(recorder));
+    
+    mnGraph graph;
+    fail_unless(mnGraph_init(&graph, NUM_NODES, numWorkers, 44100.0f, NULL), "init failed");
+    //don't fall back to serial processing on a loaded test machine
+    graph.deadlineFraction = 1000.0f;
+    
+    const int layerSize = 6;
+    for (int i = 0; i < NUM_NODES; i++)
+    {
+        contexts[i].recorder = &recorder;
+        contexts[i].index = i;
+        mnGraph_addNode(&graph, recordNode, &contexts[i]);
+        if (i >= layerSize)
+        {
+            const int layerStart = i - i % layerSize - layerSize;
+            mnGraph_addDependency(&graph, i, layerStart + i % layerSize);
+            mnGraph_addDependency(&graph, i, layerStart + (i + 1) % layerSize);
+        }
+    }
+    
+    int isCorrect = mnGraph_compile(&graph);
+    for (int b = 0; b < bufferCount && isCorrect; b++)
+    {
+        recorder.numFrames = 64 + b % 3;
+        mnGraph_process(&graph, recorder.numFrames);
+        
+        for (int i = 0; i < NUM_NODES; i++)
+        {
+            isCorrect &= recorder.runCounts[i] == b + 1;
+            for (int e = 0; e < graph.nodes[i].numDependents; e++)
+            {
+                const int dependent = graph.dependents[graph.nodes[i].firstDependent + e];
+                isCorrect &= recorder.finishTimes[i] < recorder.finishTimes[dependent];
+            }
+        }
+    }
+    isCorrect &= !recorder.badNumFrames;
+    
+    mnGraph_deinit(&graph);
+    return isCorrect;
+}
+
+static void testDependencies()
+{
+    start_test("Graph - nodes run once per buffer, after their dependencies");
+    
+    fail_unless(processLayers(0), "serial processing");
+    fail_unless(processLayers(1), "one worker");
+    fail_unless(processLayers(3), "three workers");
+}
+
+static void emptyNode(int numFrames, void* context)
+{
+}
+
+static void testCycle()
+{
+    start_test("Graph - cycles are rejected");
+    
+    mnGraph graph;
+    mnGraph_init(&graph, 4, 0, 44100.0f, NULL);
+    const int a = mnGraph_addNode(&graph, emptyNode, NULL);
+    const int b = mnGraph_addNode(&graph, emptyNode, NULL);
+    const int c = mnGraph_addNode(&graph, emptyNode, NULL);
+    mnGraph_addDependency(&graph, b, a);
+    mnGraph_addDependency(&graph, c, b);
+    fail_unless(mnGraph_compile(&graph), "a chain should compile");
+    
+    mnGraph_addDependency(&graph, a, c);
+    fail_unless(!mnGraph_compile(&graph), "a cycle should not compile");
+    fail_unless(!mnGraph_addDependency(&graph, a, a), "a node should not depend on itself");
+    
+    mnGraph_deinit(&graph);
+}
+
+static void testSerialFallback()
+{
+    start_test("Graph - serial fallback after a missed deadline");
+    
+    mnGraph graph;
+    mnGraph_init(&graph, 4, 2, 44100.0f, NULL);
+    //every parallel buffer misses the deadline
+    graph.deadlineFraction = 0.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        mnGraph_addNode(&graph, emptyNode, NULL);
+    }
+    mnGraph_compile(&graph);
+    
+    mnGraph_process(&graph, 64);
+    fail_unless(mnGraph_getNumSerialFallbacks(&graph) == 1, "a missed deadline should trigger a fallback");
+    
+    for (int i = 0; i < MN_GRAPH_SERIAL_BUFFERS; i++)
+    {
+        mnGraph_process(&graph, 64);
+    }
+    fail_unless(mnGraph_getNumSerialFallbacks(&graph) == 1, "serial buffers should not count as fallbacks");
+    
+    mnGraph_process(&graph, 64);
+    fail_unless(mnGraph_getNumSerialFallbacks(&graph) == 2, "parallel processing should be retried");
+    
+    mnGraph_deinit(&graph);
+}
+
+static void testInvalidArguments()
+{
+    start_test("Graph - invalid arguments are rejected");
+    
+    mnGraph graph;
+    fail_unless(!mnGraph_init(&graph, 0, 2, 44100.0f, NULL), "a graph without nodes should be rejected");
+    fail_unless(!mnGraph_init(&graph, 4, -1, 44100.0f, NULL), "a negative number of workers should be rejected");
+    fail_unless(!mnGraph_init(&graph, 4, 2, 0.0f, NULL), "a zero sample rate should be rejected");
+    fail_unless(graph.nodes == NULL && graph.workers == NULL, "a failed init should leave nothing to release");
+    
+    mnThreadOptions options;
+    mnThreadOptions_setDefaults(&options);
+    fail_unless(mnGraph_init(&graph, 4, 2, 44100.0f, &options), "init with normal scheduling failed");
+    mnGraph_deinit(&graph);
+}
+
+void testGraph()
+{
+    testDependencies();
+    testCycle();
+    testSerialFallback();
+    testInvalidArguments();
+}
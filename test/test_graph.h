@@ -0,0 +1,17 @@
+#ifndef DR_TEST_GRAPH_H
+#define DR_TEST_GRAPH_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testGraph();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_GRAPH_H
+
@@ -1,20 +1,21 @@
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "tinycthread.h"
 #include "testmacros.h"
 #include "test_lock_free_fifo.h"
 
-#include "lock_free_fifo.h"
+#include "fifo.h"
 
 static const int loopCount = 10000;
 
 static int entryPointProducer(void* data)
 {
-    drLockFreeFIFO* f = (drLockFreeFIFO*)data;
+    mnFIFO* f = (mnFIFO*)data;
     
     for (int i = 0; i < loopCount; i++)
     {
-        int success = drLockFreeFIFO_push(f, &i);
+        int success = mnFIFO_push(f, &i);
         //printf("pushed %d (success %d)\n", i, success);
     }
     
@@ -24,12 +25,12 @@ static int entryPointProducer(void* data)
 static int entryPointConsumer(void* data)
 {
     
-    drLockFreeFIFO* f = (drLockFreeFIFO*)data;
+    mnFIFO* f = (mnFIFO*)data;
     
     for (int i = 0; i < loopCount; i++)
     {
         int val = 0;
-        int success = drLockFreeFIFO_pop(f, &val);
+        int success = mnFIFO_pop(f, &val);
         //printf("popped %d (success %d)\n", val, success);
         
     }
@@ -46,8 +47,8 @@ static void testTwoThreads()
     const int es = sizeof(int);
     const int c = 100;
     
-    drLockFreeFIFO f;
-    drLockFreeFIFO_init(&f, c, es);
+    mnFIFO f;
+    mnFIFO_init(&f, c, es);
     
     thrd_t t1, t2;
     thrd_create(&t1, entryPointConsumer, &f);
@@ -66,30 +67,30 @@ static void testSize()
     const int c = 100;
     
     const int nCases = 5;
-    int nPush[nCases] = {10, 20, 30, 5, 90};
-    int nPop[nCases] = {5, 1, 60, 10, 90};
+    int nPush[] = {10, 20, 30, 5, 90};
+    int nPop[] = {5, 1, 60, 10, 90};
     
     for (int i = 0; i < nCases; i++)
     {
-        drLockFreeFIFO f;
-        drLockFreeFIFO_init(&f, c, es);
+        mnFIFO f;
+        mnFIFO_init(&f, c, es);
         
         for (int j = 0; j < nPush[i]; j++)
         {
-            int success = drLockFreeFIFO_push(&f, &j);
+            int success = mnFIFO_push(&f, &j);
         }
         
         for (int j = 0; j < nPop[i]; j++)
         {
             int val = 0;
-            int success = drLockFreeFIFO_pop(&f, &val);
+            int success = mnFIFO_pop(&f, &val);
         }
         
         const int expectedSize = fmaxf(0.0f, nPush[i] - nPop[i]);
-        const int size = drLockFreeFIFO_getNumElements(&f);
+        const int size = mnFIFO_getNumElements(&f);
         fail_unless(expectedSize == size, "FIFO size should be the same after pushing and popping the same number of items");
         
-        drLockFreeFIFO_deinit(&f);
+        mnFIFO_deinit(&f);
     }
     
     
@@ -102,25 +103,25 @@ void testPushUntilFull()
     const int es = sizeof(int);
     const int c = 100;
     
-    drLockFreeFIFO f;
-    drLockFreeFIFO_init(&f, c, es);
+    mnFIFO f;
+    mnFIFO_init(&f, c, es);
     
     for (int i = 0; i < c; i++)
     {
-        int success = drLockFreeFIFO_push(&f, &i);
+        int success = mnFIFO_push(&f, &i);
         if (!success)
         {
             fail_unless(success == 1, "push to FIFO with free slots should succeed");
         }
     }
     
-    int success = drLockFreeFIFO_push(&f, &c);
+    int success = mnFIFO_push(&f, &c);
     fail_unless(success == 0, "push to full FIFO should fail");
     
-    const int full = drLockFreeFIFO_isFull(&f);
+    const int full = mnFIFO_isFull(&f);
     fail_unless(full == 1, "full FIFO should report that it's full");
     
-    const int empty = drLockFreeFIFO_isEmpty(&f);
+    const int empty = mnFIFO_isEmpty(&f);
     fail_unless(empty == 0, "full FIFO should not report that it's empty");
 }
 
@@ -131,31 +132,31 @@ static void testPushUntilFullAndPopUntilEmpty()
     const int es = sizeof(int);
     const int c = 100;
     
-    drLockFreeFIFO f;
-    drLockFreeFIFO_init(&f, c, es);
+    mnFIFO f;
+    mnFIFO_init(&f, c, es);
     
     for (int i = 0; i < c; i++)
     {
-        int success = drLockFreeFIFO_push(&f, &i);
+        int success = mnFIFO_push(&f, &i);
         if (!success)
         {
             fail_unless(success == 1, "push to FIFO with free slots should succeed");
         }
     }
     
-    int success = drLockFreeFIFO_push(&f, &c);
+    int success = mnFIFO_push(&f, &c);
     fail_unless(success == 0, "push to full FIFO should fail");
     
-    int full = drLockFreeFIFO_isFull(&f);
+    int full = mnFIFO_isFull(&f);
     fail_unless(full == 1, "full FIFO should report that it's full");
     
-    int empty = drLockFreeFIFO_isEmpty(&f);
+    int empty = mnFIFO_isEmpty(&f);
     fail_unless(empty == 0, "full FIFO should not report that it's empty");
     
     for (int i = 0; i < c; i++)
     {
         int val = 0;
-        int success = drLockFreeFIFO_pop(&f, &val);
+        int success = mnFIFO_pop(&f, &val);
         if (success != 1)
         {
             fail_unless(success == 1, "popping from FIFO with one or more elements should succeed");
@@ -166,18 +167,269 @@ static void testPushUntilFullAndPopUntilEmpty()
         }
     }
     
-    full = drLockFreeFIFO_isFull(&f);
+    full = mnFIFO_isFull(&f);
     fail_unless(full == 0, "empty FIFO should not report that it's full");
     
-    empty = drLockFreeFIFO_isEmpty(&f);
+    empty = mnFIFO_isEmpty(&f);
     fail_unless(empty == 1, "empty FIFO should report that it's empty");
 }
 
+typedef struct
+{
+    mnFIFO* fifo;
+    int errors;
+} OrderCheck;
+
+static int entryPointOrderedProducer(void* data)
+{
+    OrderCheck* check = (OrderCheck*)data;
+    
+    for (int i = 0; i < loopCount; i++)
+    {
+        while (!mnFIFO_push(check->fifo, &i))
+        {
+            thrd_yield();
+        }
+    }
+    
+    return 0;
+}
+
+static int entryPointOrderedConsumer(void* data)
+{
+    OrderCheck* check = (OrderCheck*)data;
+    
+    for (int i = 0; i < loopCount; i++)
+    {
+        int val = -1;
+        while (!mnFIFO_pop(check->fifo, &val))
+        {
+            thrd_yield();
+        }
+        if (val != i)
+        {
+            check->errors++;
+        }
+    }
+    
+    return 0;
+}
+
+static void testTwoThreadsOrdering()
+{
+    start_test("Lock free FIFO - elements arrive in order across threads");
+    
+    mnFIFO f;
+    mnFIFO_init(&f, 100, sizeof(int));
+    
+    OrderCheck check;
+    check.fifo = &f;
+    check.errors = 0;
+    
+    thrd_t t1, t2;
+    thrd_create(&t1, entryPointOrderedConsumer, &check);
+    thrd_create(&t2, entryPointOrderedProducer, &check);
+    
+    int joinRes1, joinRes2;
+    thrd_join(t1, &joinRes1);
+    thrd_join(t2, &joinRes2);
+    
+    fail_unless(check.errors == 0, "elements should be popped in the order they were pushed");
+    fail_unless(mnFIFO_isEmpty(&f) == 1, "FIFO should be empty after popping all pushed elements");
+    
+    mnFIFO_deinit(&f);
+}
+
+static void testIndexWrapAround()
+{
+    start_test("Lock free FIFO - index wrap around");
+    
+    const int c = 6;
+    
+    mnFIFO f;
+    mnFIFO_init(&f, c, sizeof(int));
+    
+    //start just below the largest index so the free running counters overflow
+    const int start = 0x7ffffffd;
+    f.head = f.tail = f.cachedHead = f.cachedTail = start;
+    
+    int expected = 0;
+    int next = 0;
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < c; i++)
+        {
+            int success = mnFIFO_push(&f, &next);
+            if (!success)
+            {
+                fail_unless(success == 1, "push to FIFO with free slots should succeed");
+            }
+            next++;
+        }
+        
+        fail_unless(mnFIFO_isFull(&f) == 1, "FIFO holding capacity elements should report that it's full");
+        fail_unless(mnFIFO_getNumElements(&f) == c, "FIFO size should be correct when indices wrap around");
+        
+        for (int i = 0; i < c; i++)
+        {
+            int val = -1;
+            mnFIFO_pop(&f, &val);
+            if (val != expected)
+            {
+                fail_unless(val == expected, "popped element should have the expected value");
+            }
+            expected++;
+        }
+        
+        fail_unless(mnFIFO_isEmpty(&f) == 1, "FIFO should be empty after popping all elements");
+    }
+    
+    mnFIFO_deinit(&f);
+}
+
+static void testPushNPopN()
+{
+    start_test("Lock free FIFO - bulk push and pop");
+    
+    const int c = 100;
+    
+    mnFIFO f;
+    mnFIFO_init(&f, c, sizeof(float));
+    
+    float source[70];
+    float target[70];
+    float next = 0.0f;
+    float expected = 0.0f;
+    
+    //move blocks of different sizes so that ranges wrap around the end of the storage
+    for (int round = 0; round < 20; round++)
+    {
+        const int n = 30 + (round * 7) % 41;
+        for (int i = 0; i < n; i++)
+        {
+            source[i] = next;
+            next += 1.0f;
+        }
+        
+        const int numPushed = mnFIFO_pushN(&f, source, n);
+        fail_unless(numPushed == n, "bulk push to FIFO with enough free slots should push all elements");
+        fail_unless(mnFIFO_getNumElements(&f) == n, "FIFO size should equal the number of pushed elements");
+        
+        const int numPopped = mnFIFO_popN(&f, target, n);
+        fail_unless(numPopped == n, "bulk pop should pop all available elements");
+        
+        for (int i = 0; i < n; i++)
+        {
+            if (target[i] != expected)
+            {
+                fail_unless(target[i] == expected, "bulk popped element should have the expected value");
+            }
+            expected += 1.0f;
+        }
+    }
+    
+    //partial operations
+    float big[150];
+    memset(big, 0, sizeof(big));
+    fail_unless(mnFIFO_pushN(&f, big, 150) == c, "bulk push should stop when the FIFO is full");
+    fail_unless(mnFIFO_isFull(&f) == 1, "FIFO should be full after a partial bulk push");
+    fail_unless(mnFIFO_popN(&f, big, 150) == c, "bulk pop should stop when the FIFO is empty");
+    fail_unless(mnFIFO_popN(&f, big, 1) == 0, "bulk pop from an empty FIFO should pop nothing");
+    
+    mnFIFO_deinit(&f);
+}
+
+static void testReserveCommitPeekConsume()
+{
+    start_test("Lock free FIFO - zero copy spans");
+    
+    const int c = 16;
+    
+    mnFIFO f;
+    mnFIFO_init(&f, c, sizeof(int));
+    
+    //move the indices close to the end of the storage
+    int dummy = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        mnFIFO_push(&f, &dummy);
+        mnFIFO_pop(&f, &dummy);
+    }
+    
+    mnFIFOSpans spans;
+    const int numReserved = mnFIFO_reserveWrite(&f, 12, &spans);
+    fail_unless(numReserved == 12, "reserving space in an empty FIFO should succeed");
+    fail_unless(spans.numElements[0] == 6 && spans.numElements[1] == 6,
+                "a reserved range crossing the end of the storage should be split in two spans");
+    fail_unless(mnFIFO_isEmpty(&f) == 1, "reserved elements should not be visible before they are committed");
+    
+    int value = 0;
+    for (int s = 0; s < 2; s++)
+    {
+        int* elements = (int*)spans.elements[s];
+        for (int i = 0; i < spans.numElements[s]; i++)
+        {
+            elements[i] = value++;
+        }
+    }
+    mnFIFO_commitWrite(&f, numReserved);
+    fail_unless(mnFIFO_getNumElements(&f) == 12, "committed elements should be visible");
+    
+    fail_unless(mnFIFO_reserveWrite(&f, 12, &spans) == c - 12, "reserving should be limited by the free space");
+    
+    const int numReadable = mnFIFO_peekRead(&f, 100, &spans);
+    fail_unless(numReadable == 12, "peeking should return all committed elements");
+    
+    int expected = 0;
+    for (int s = 0; s < 2; s++)
+    {
+        const int* elements = (const int*)spans.elements[s];
+        for (int i = 0; i < spans.numElements[s]; i++)
+        {
+            if (elements[i] != expected)
+            {
+                fail_unless(elements[i] == expected, "peeked element should have the expected value");
+            }
+            expected++;
+        }
+    }
+    fail_unless(mnFIFO_getNumElements(&f) == 12, "peeking should not remove elements");
+    
+    mnFIFO_consumeRead(&f, 5);
+    fail_unless(mnFIFO_getNumElements(&f) == 7, "consumed elements should be removed");
+    fail_unless(mnFIFO_pop(&f, &value) == 1 && value == 5, "popping after a partial consume should return the next element");
+    
+    mnFIFO_deinit(&f);
+}
+
+static void testOutOfRangeCapacity()
+{
+    start_test("Lock free FIFO - out of range capacity");
+    
+    mnFIFO f;
+    fail_unless(!mnFIFO_init(&f, 0, sizeof(int)), "a zero capacity should be rejected");
+    fail_unless(!mnFIFO_init(&f, (1 << 30) + 1, 1), "a capacity above 2^30 should be rejected");
+    fail_unless(!mnFIFO_init(&f, 1 << 30, sizeof(int)), "a storage size above INT_MAX should be rejected");
+    fail_unless(!mnFIFO_init(&f, 16, 0), "a zero element size should be rejected");
+    
+    int value = 0;
+    fail_unless(mnFIFO_push(&f, &value) == 0, "pushing to a rejected FIFO should fail");
+    fail_unless(mnFIFO_pop(&f, &value) == 0, "popping from a rejected FIFO should fail");
+    mnFIFO_deinit(&f);
+    
+    fail_unless(mnFIFO_init(&f, 1 << 10, sizeof(int)), "a valid capacity should be accepted");
+    mnFIFO_deinit(&f);
+}
+
 void testLockFreeFIFO()
 {
     testTwoThreads();
     testSize();
     testPushUntilFull();
     testPushUntilFullAndPopUntilEmpty();
-    
+    testTwoThreadsOrdering();
+    testIndexWrapAround();
+    testPushNPopN();
+    testReserveCommitPeekConsume();
+    testOutOfRangeCapacity();
 }
\ No newline at end of file
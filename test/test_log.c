@@ -0,0 +1,275 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_log.h"
+
+#include "backend_offline.h"
+#include "engine.h"
+#include "log.h"
+
+static void getTestPath(char* path, int size, const char* name)
+{
+    const char* directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/%s", directory ? directory : "/tmp", name);
+}
+
+static char* readFile(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    const int size = (int)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = malloc(size + 1);
+    contents[fread(contents, 1, size, file)] = '\0';
+    fclose(file);
+    return contents;
+}
+
+/**
+ * Starts a log that appends to a fresh file in the temp directory.
+ */
+static int startLog(mnLog* log, char* path, int pathSize, const char* name, int capacity)
+{
+    getTestPath(path, pathSize, name);
+    remove(path);
+    
+    mnLogOptions options;
+    mnLogOptions_setDefaults(&options);
+    options.path = path;
+    options.capacity = capacity;
+    options.flushIntervalMilliseconds = 1;
+    return mnLog_start(log, &options);
+}
+
+/**
+ * Stops the log and returns what it wrote.
+ */
+static char* stopLog(mnLog* log, const char* path)
+{
+    mnLog_stop(log);
+    char* contents = readFile(path);
+    remove(path);
+    return contents;
+}
+
+static void testFormatting()
+{
+    start_test("Log - formatting");
+    
+    char path[256];
+    mnLog log;
+    fail_unless(startLog(&log, path, sizeof(path), "mn_test_log_format", 64), "start failed");
+    
+    unsigned long long big = 18446744073709551615ULL;
+    mnLog_write(&log, 480.0, "plain text");
+    mnLog_write(&log, 960.0, "%d %i %u %ld %lld %llu", -1, 42, 3000000000u, -5L, -6000000000LL, big);
+    mnLog_write(&log, 1440.0, "%x %X %#o %hd %hhu %zu", 255, 255u, 8, (short)-2, (unsigned char)200, (size_t)7);
+    mnLog_write(&log, 1920.0, "[%-4d] [%*d] [%.*f] [%08.3f]", 3, 6, 7, 2, 3.14159, -2.5);
+    mnLog_write(&log, 2400.0, "%s=%c %g %e %.1f%%", "gain", 'x', 0.5, 1e-3, 99.96);
+    mnLog_write(&log, 2880.0, "%n is not supported", NULL);
+    mnLog_write(&log, 3360.0, "%d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7);
+    
+    char* contents = stopLog(&log, path);
+    fail_unless(contents != NULL, "the log file should exist");
+    const char* expected =
+        "[480] plain text\n"
+        "[960] -1 42 3000000000 -5 -6000000000 18446744073709551615\n"
+        "[1440] ff FF 010 -2 200 7\n"
+        "[1920] [3   ] [     7] [3.14] [-002.500]\n"
+        "[2400] gain=x 0.5 1.000000e-03 100.0%\n"
+        "[2880] (unsupported format) %n is not supported\n"
+        "[3360] (unsupported format) %d %d %d %d %d %d %d\n";
+    fail_unless(strcmp(contents, expected) == 0, "formatted log mismatch");
+    free(contents);
+}
+
+static void testMalformedFormats()
+{
+    start_test("Log - malformed formats");
+    
+    char path[256];
+    mnLog log;
+    fail_unless(startLog(&log, path, sizeof(path), "mn_test_log_malformed", 64), "start failed");
+    
+    //each * expands to up to 11 characters in the rebuilt conversion, so
+    //only one width and one precision may be taken from the arguments
+    mnLog_write(&log, 0, "x %*****d", INT_MIN, INT_MIN, INT_MIN, INT_MIN, INT_MIN, 5);
+    mnLog_write(&log, 1, "x %.*.*d", 1, 2, 3);
+    mnLog_write(&log, 2, "[%*.*d] [%-*.*f]", 4, 3, 5, -8, 2, 0.5);
+    //a width snprintf can't honor writes nothing
+    mnLog_write(&log, 3, "[%*d] [%*.*d]", INT_MIN, 1, INT_MIN, INT_MIN, 2);
+    
+    char* contents = stopLog(&log, path);
+    fail_unless(contents != NULL, "the log file should exist");
+    const char* expected =
+        "[0] (unsupported format) x %*****d\n"
+        "[1] (unsupported format) x %.*.*d\n"
+        "[2] [ 005] [0.50    ]\n"
+        "[3] [] []\n";
+    fail_unless(strcmp(contents, expected) == 0, "malformed formats should be rejected");
+    free(contents);
+}
+
+static void testDrops()
+{
+    start_test("Log - dropped records");
+    
+    char path[256];
+    mnLog log;
+    fail_unless(startLog(&log, path, sizeof(path), "mn_test_log_drops", 4), "start failed");
+    
+    //much faster than the log thread wakes up, so most of these are dropped
+    int numWritten = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        numWritten += mnLog_write(&log, i, "record %d", i);
+    }
+    const int numDropped = mnLog_getNumDroppedRecords(&log);
+    fail_unless(numWritten >= 4, "a full queue should have been written");
+    fail_unless(numWritten + numDropped == 1000, "every record should be written or dropped");
+    
+    char* contents = stopLog(&log, path);
+    int numLines = 0;
+    int numReportedDrops = 0;
+    for (const char* line = contents; *line; line = strchr(line, '\n') + 1)
+    {
+        int n;
+        if (sscanf(line, "[log] %d records dropped", &n) == 1)
+        {
+            numReportedDrops += n;
+        }
+        else
+        {
+            numLines++;
+        }
+    }
+    fail_unless(numLines == numWritten, "written record count mismatch");
+    fail_unless(numReportedDrops == numDropped, "the drops should be reported");
+    free(contents);
+}
+
+#define NUM_WRITERS 4
+#define NUM_RECORDS_PER_WRITER 2000
+
+typedef struct
+{
+    mnLog* log;
+    int index;
+} Writer;
+
+static int writerEntryPoint(void* data)
+{
+    Writer* writer = (Writer*)data;
+    for (int i = 0; i < NUM_RECORDS_PER_WRITER; i++)
+    {
+        while (!mnLog_write(writer->log, i, "writer %d record %d", writer->index, i))
+        {
+            thrd_yield();
+        }
+    }
+    return 0;
+}
+
+static void testConcurrentWriters()
+{
+    start_test("Log - concurrent writers");
+    
+    char path[256];
+    mnLog log;
+    fail_unless(startLog(&log, path, sizeof(path), "mn_test_log_writers", 256), "start failed");
+    
+    Writer writers[NUM_WRITERS];
+    thrd_t threads[NUM_WRITERS];
+    for (int w = 0; w < NUM_WRITERS; w++)
+    {
+        writers[w].log = &log;
+        writers[w].index = w;
+        thrd_create(&threads[w], writerEntryPoint, &writers[w]);
+    }
+    for (int w = 0; w < NUM_WRITERS; w++)
+    {
+        int result;
+        thrd_join(threads[w], &result);
+    }
+    
+    //the records of each writer come out in order
+    char* contents = stopLog(&log, path);
+    int nextRecords[NUM_WRITERS] = {0};
+    int numOutOfOrder = 0;
+    for (const char* line = contents; *line; line = strchr(line, '\n') + 1)
+    {
+        int w;
+        int i;
+        if (sscanf(line, "[%*d] writer %d record %d", &w, &i) != 2 || w < 0 || w >= NUM_WRITERS)
+        {
+            //dropped record reports show up here
+            continue;
+        }
+        if (i != nextRecords[w]++)
+        {
+            numOutOfOrder++;
+        }
+    }
+    fail_unless(numOutOfOrder == 0, "records out of order");
+    for (int w = 0; w < NUM_WRITERS; w++)
+    {
+        fail_unless(nextRecords[w] == NUM_RECORDS_PER_WRITER, "record count mismatch");
+    }
+    free(contents);
+}
+
+static void silentCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    memset(samples, 0, numChannels * numFrames * sizeof(float));
+}
+
+static void testEngineLog()
+{
+    start_test("Log - engine diagnostics");
+    
+    char path[256];
+    mnLog log;
+    fail_unless(startLog(&log, path, sizeof(path), "mn_test_log_engine", 64), "start failed");
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfInputChannels = 0;
+    options.bufferSizeInFrames = 480;
+    options.sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, silentCallback, NULL, &options);
+    mnEngine_setLog(&engine, &log);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    //the device skips a buffer between 1480 and 2440
+    float* output = malloc(480 * options.numberOfOutputChannels * sizeof(float));
+    const double sampleTimes[] = {1000, 1480, 2440, 2920};
+    for (int i = 0; i < 4; i++)
+    {
+        mnEngine_processOutput(&engine, output, 480, sampleTimes[i]);
+    }
+    mnEngine_deinit(&engine);
+    free(output);
+    
+    char* contents = stopLog(&log, path);
+    fail_unless(strcmp(contents, "[2440] missed deadline, buffer of 480 frames\n") == 0,
+                "the missed deadline should be logged");
+    free(contents);
+}
+
+void testLog()
+{
+    testFormatting();
+    testMalformedFormats();
+    testDrops();
+    testConcurrentWriters();
+    testEngineLog();
+}
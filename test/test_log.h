@@ -0,0 +1,17 @@
+#ifndef DR_TEST_LOG_H
+#define DR_TEST_LOG_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testLog();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_LOG_H
+
@@ -0,0 +1,389 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_meter.h"
+
+#include "atomic.h"
+#include "backend_offline.h"
+#include "engine.h"
+#include "meter.h"
+#include "simd.h"
+
+#define TWO_PI 6.283185307179586
+
+static const float sampleRate = 48000;
+
+static int isNear(float value, float expected, float tolerance)
+{
+    return fabsf(value - expected) <= tolerance;
+}
+
+/**
+ * Fills planar channels with sines, each with its own amplitude and phase.
+ */
+static float** makeSines(int numChannels, int numFrames, double frequency, double phase)
+{
+    float** channels = malloc(numChannels * sizeof(float*));
+    for (int c = 0; c < numChannels; c++)
+    {
+        channels[c] = malloc(numFrames * sizeof(float));
+        const double amplitude = 0.9 / (c + 1);
+        for (int i = 0; i < numFrames; i++)
+        {
+            channels[c][i] = (float)(amplitude * sin(TWO_PI * frequency * i / sampleRate + phase + c));
+        }
+    }
+    return channels;
+}
+
+static void freeChannels(float** channels, int numChannels)
+{
+    for (int c = 0; c < numChannels; c++)
+    {
+        free(channels[c]);
+    }
+    free(channels);
+}
+
+static void testLevels()
+{
+    start_test("Meter - peak, RMS and true peak of known signals");
+    
+    mnMeter meter;
+    fail_unless(!mnMeter_init(&meter, 0, sampleRate), "init should fail without channels");
+    fail_unless(mnMeter_init(&meter, 1, sampleRate), "init failed");
+    //no smoothing, so the levels are those of the last buffer
+    mnMeter_setBallistics(&meter, 0.0f, 0.0f, 0.0f);
+    
+    mnMeterLevels levels;
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(levels.peak == 0.0f && levels.rms == 0.0f && levels.maxTruePeak == 0.0f,
+                "levels should start at zero");
+    
+    //a 1 kHz sine with a whole number of periods per buffer
+    const int numFrames = 480;
+    float** sine = makeSines(1, numFrames, 1000.0, 0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        mnMeter_processPlanar(&meter, (const float* const*)sine, numFrames);
+    }
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(isNear(levels.peak, 0.9f, 1e-4f), "sine peak mismatch");
+    fail_unless(isNear(levels.rms, 0.9f / sqrtf(2.0f), 1e-4f), "sine RMS mismatch");
+    fail_unless(isNear(levels.truePeak, 0.9f, 0.01f), "sine true peak mismatch");
+    
+    //a quarter sample rate sine whose samples all miss the crests by 45 degrees
+    float** quarter = makeSines(1, numFrames, sampleRate / 4.0, TWO_PI / 8.0);
+    mnMeter_processPlanar(&meter, (const float* const*)quarter, numFrames);
+    mnMeter_processPlanar(&meter, (const float* const*)quarter, numFrames);
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(isNear(levels.peak, 0.9f * sqrtf(0.5f), 1e-4f), "the samples should be 3 dB below the crests");
+    fail_unless(isNear(levels.truePeak, 0.9f, 0.03f), "the true peak should find the crests between samples");
+    
+    freeChannels(sine, 1);
+    freeChannels(quarter, 1);
+    mnMeter_deinit(&meter);
+}
+
+static void testBallistics()
+{
+    start_test("Meter - release, integration and max true peak");
+    
+    mnMeter meter;
+    mnMeter_init(&meter, 1, sampleRate);
+    mnMeter_setBallistics(&meter, 0.0f, 0.5f, 0.1f);
+    
+    const int numFrames = 480;
+    float* ones = malloc(numFrames * sizeof(float));
+    float* zeros = calloc(numFrames, sizeof(float));
+    for (int i = 0; i < numFrames; i++)
+    {
+        ones[i] = 0.5f;
+    }
+    
+    mnMeterLevels levels;
+    mnMeter_processPlanar(&meter, (const float* const*)&ones, numFrames);
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(isNear(levels.peak, 0.5f, 1e-6f), "the peak should attack instantly");
+    const float expectedRms = 0.5f * sqrtf(1.0f - expf(-numFrames / (0.1f * sampleRate)));
+    fail_unless(isNear(levels.rms, expectedRms, 1e-4f), "the mean square should integrate");
+    
+    //the release doesn't depend on how the silence is split into buffers
+    mnMeter_processPlanar(&meter, (const float* const*)&zeros, numFrames);
+    mnMeter_processPlanar(&meter, (const float* const*)&zeros, numFrames / 4);
+    mnMeter_processPlanar(&meter, (const float* const*)&zeros, numFrames / 4);
+    mnMeter_processPlanar(&meter, (const float* const*)&zeros, numFrames / 2);
+    mnMeter_getLevels(&meter, &levels);
+    const float expectedPeak = 0.5f * expf(-2.0f * numFrames / (0.5f * sampleRate));
+    fail_unless(isNear(levels.peak, expectedPeak, 1e-4f), "release mismatch");
+    //the interpolation overshoots the step a little
+    fail_unless(levels.maxTruePeak >= 0.5f && levels.maxTruePeak < 0.6f, "the max true peak should hold");
+    
+    mnMeter_resetMaxTruePeak(&meter);
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(levels.maxTruePeak > 0.0f, "the reset should wait for the next buffer");
+    mnMeter_processPlanar(&meter, (const float* const*)&zeros, numFrames);
+    mnMeter_getLevels(&meter, &levels);
+    fail_unless(levels.maxTruePeak == 0.0f, "the max true peak should be reset");
+    
+    free(ones);
+    free(zeros);
+    mnMeter_deinit(&meter);
+}
+
+static void testLayouts()
+{
+    start_test("Meter - interleaved and planar input agree");
+    
+    const int numChannels = 3;
+    const int numFrames = 1003;
+    float** planar = makeSines(numChannels, numFrames, 7000.0, 0.3);
+    float* interleaved = malloc(numChannels * numFrames * sizeof(float));
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            interleaved[i * numChannels + c] = planar[c][i];
+        }
+    }
+    
+    mnMeter a;
+    mnMeter b;
+    mnMeter_init(&a, numChannels, sampleRate);
+    mnMeter_init(&b, numChannels, sampleRate);
+    mnMeter_processPlanar(&a, (const float* const*)planar, numFrames);
+    mnMeter_processInterleaved(&b, interleaved, numFrames);
+    
+    mnMeterLevels levelsA[3];
+    mnMeterLevels levelsB[3];
+    mnMeter_getLevels(&a, levelsA);
+    mnMeter_getLevels(&b, levelsB);
+    fail_unless(memcmp(levelsA, levelsB, sizeof(levelsA)) == 0, "levels mismatch");
+    fail_unless(levelsA[0].peak > levelsA[1].peak && levelsA[1].peak > levelsA[2].peak,
+                "channels should be measured separately");
+    
+    freeChannels(planar, numChannels);
+    free(interleaved);
+    mnMeter_deinit(&a);
+    mnMeter_deinit(&b);
+}
+
+static void testSIMD()
+{
+    start_test("Meter - vectorized kernels match the reference");
+    
+    const int numChannels = 2;
+    const int numFrames = 1003;
+    float** noise = malloc(numChannels * sizeof(float*));
+    for (int c = 0; c < numChannels; c++)
+    {
+        noise[c] = malloc(numFrames * sizeof(float));
+        for (int i = 0; i < numFrames; i++)
+        {
+            noise[c][i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
+        }
+    }
+    
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    mnMeterLevels reference[2];
+    mnMeterLevels vectorized[2];
+    mnMeter meter;
+    
+    mnSIMD_setLevel(MN_SIMD_NONE);
+    mnMeter_init(&meter, numChannels, sampleRate);
+    mnMeter_processPlanar(&meter, (const float* const*)noise, numFrames);
+    mnMeter_getLevels(&meter, reference);
+    mnMeter_deinit(&meter);
+    
+    float maxError = 0.0f;
+    const mnSIMDLevel levels[] = {MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    for (int l = 0; l < 3; l++)
+    {
+        mnSIMD_setLevel(levels[l]);
+        mnMeter_init(&meter, numChannels, sampleRate);
+        mnMeter_processPlanar(&meter, (const float* const*)noise, numFrames);
+        mnMeter_getLevels(&meter, vectorized);
+        mnMeter_deinit(&meter);
+        for (int c = 0; c < numChannels; c++)
+        {
+            const float errors[] =
+            {
+                fabsf(vectorized[c].peak - reference[c].peak),
+                fabsf(vectorized[c].rms - reference[c].rms),
+                fabsf(vectorized[c].truePeak - reference[c].truePeak),
+                fabsf(vectorized[c].maxTruePeak - reference[c].maxTruePeak)
+            };
+            for (int e = 0; e < 4; e++)
+            {
+                maxError = errors[e] > maxError ? errors[e] : maxError;
+            }
+        }
+    }
+    mnSIMD_setLevel(level);
+    fail_unless(maxError < 1e-5f, "vectorized levels differ");
+    
+    freeChannels(noise, numChannels);
+}
+
+typedef struct
+{
+    mnMeter meter;
+    int numBuffers;
+    /** Only accessed through atomic operations. */
+    int isDone;
+    /** Only accessed through atomic operations. */
+    int numInconsistent;
+} ConcurrencyContext;
+
+#define NUM_CONCURRENT_CHANNELS 8
+#define NUM_READERS 3
+
+static int entryPointWriter(void* data)
+{
+    ConcurrencyContext* context = (ConcurrencyContext*)data;
+    float buffer[64 * NUM_CONCURRENT_CHANNELS];
+    for (int b = 0; b < context->numBuffers; b++)
+    {
+        //every channel gets the same level, which changes with every buffer
+        const float level = (b % 100) / 100.0f;
+        for (int i = 0; i < 64 * NUM_CONCURRENT_CHANNELS; i++)
+        {
+            buffer[i] = level;
+        }
+        mnMeter_processInterleaved(&context->meter, buffer, 64);
+        if (b % 16 == 0)
+        {
+            thrd_yield();
+        }
+    }
+    mnAtomicStoreRelease(1, &context->isDone);
+    return 0;
+}
+
+static int entryPointReader(void* data)
+{
+    ConcurrencyContext* context = (ConcurrencyContext*)data;
+    mnMeterLevels levels[NUM_CONCURRENT_CHANNELS];
+    while (!mnAtomicLoadAcquire(&context->isDone))
+    {
+        mnMeter_getLevels(&context->meter, levels);
+        for (int c = 1; c < NUM_CONCURRENT_CHANNELS; c++)
+        {
+            if (memcmp(&levels[c], &levels[0], sizeof(mnMeterLevels)) != 0)
+            {
+                mnAtomicAdd(&context->numInconsistent, 1);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static void testConcurrentReaders()
+{
+    start_test("Meter - consistent levels for several readers while processing");
+    
+    ConcurrencyContext context;
+    memset(&context, 0, sizeof(context));
+    mnMeter_init(&context.meter, NUM_CONCURRENT_CHANNELS, sampleRate);
+    mnMeter_setBallistics(&context.meter, 0.0f, 0.0f, 0.0f);
+    context.numBuffers = 50000;
+    
+    thrd_t readers[NUM_READERS];
+    for (int i = 0; i < NUM_READERS; i++)
+    {
+        thrd_create(&readers[i], entryPointReader, &context);
+    }
+    thrd_t writer;
+    thrd_create(&writer, entryPointWriter, &context);
+    
+    int joinRes;
+    thrd_join(writer, &joinRes);
+    for (int i = 0; i < NUM_READERS; i++)
+    {
+        thrd_join(readers[i], &joinRes);
+    }
+    
+    fail_unless(mnAtomicLoad(&context.numInconsistent) == 0, "torn levels");
+    
+    mnMeterLevels levels[NUM_CONCURRENT_CHANNELS];
+    mnMeter_getLevels(&context.meter, levels);
+    const float last = ((context.numBuffers - 1) % 100) / 100.0f;
+    fail_unless(isNear(levels[NUM_CONCURRENT_CHANNELS - 1].peak, last, 1e-6f), "the last buffer should be published");
+    
+    mnMeter_deinit(&context.meter);
+}
+
+static void constantOutputCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            samples[i * numChannels + c] = c == 0 ? 0.25f : -0.75f;
+        }
+    }
+}
+
+static void ignoreInputCallback(int numChannels, int numFrames, const float* samples, void* context)
+{
+}
+
+static void testEngine()
+{
+    start_test("Meter - engine meters input and output");
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.sampleRate = sampleRate;
+    options.numberOfInputChannels = 1;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    
+    mnMeter inputMeter;
+    mnMeter outputMeter;
+    mnMeter_init(&inputMeter, options.numberOfInputChannels, sampleRate);
+    mnMeter_init(&outputMeter, options.numberOfOutputChannels, sampleRate);
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), ignoreInputCallback, constantOutputCallback, NULL, &options);
+    mnEngine_setMeters(&engine, &inputMeter, &outputMeter);
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    const int numFrames = 4800;
+    short* input = malloc(numFrames * sizeof(short));
+    short* output = malloc(numFrames * 2 * sizeof(short));
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = i % 2 ? 16384 : -16384;
+    }
+    fail_unless(mnOfflineBackend_render(&engine, input, output, numFrames) == numFrames, "frame count mismatch");
+    
+    mnMeterLevels inputLevels[1];
+    mnMeterLevels outputLevels[2];
+    mnMeter_getLevels(&inputMeter, inputLevels);
+    mnMeter_getLevels(&outputMeter, outputLevels);
+    fail_unless(isNear(inputLevels[0].peak, 0.5f, 1e-3f), "input peak mismatch");
+    fail_unless(isNear(outputLevels[0].peak, 0.25f, 1e-3f), "left output peak mismatch");
+    fail_unless(isNear(outputLevels[1].peak, 0.75f, 1e-3f), "right output peak mismatch");
+    //a tenth of a second into the default 0.3 second integration time
+    const float expectedRms = 0.75f * sqrtf(1.0f - expf(-numFrames / (0.3f * sampleRate)));
+    fail_unless(isNear(outputLevels[1].rms, expectedRms, 1e-3f), "right output RMS mismatch");
+    
+    mnEngine_deinit(&engine);
+    mnMeter_deinit(&inputMeter);
+    mnMeter_deinit(&outputMeter);
+    free(input);
+    free(output);
+}
+
+void testMeter()
+{
+    testLevels();
+    testBallistics();
+    testLayouts();
+    testSIMD();
+    testConcurrentReaders();
+    testEngine();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_METER_H
+#define DR_TEST_METER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testMeter();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_METER_H
+
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_mpsc_queue.h"
+
+#include "mpsc_queue.h"
+
+#define NUM_PRODUCERS 4
+
+static const int loopCount = 10000;
+
+typedef struct
+{
+    int producer;
+    int value;
+} Message;
+
+typedef struct
+{
+    mnMPSCQueue* queue;
+    int producer;
+} ProducerContext;
+
+static int entryPointProducer(void* data)
+{
+    ProducerContext* context = (ProducerContext*)data;
+    
+    for (int i = 0; i < loopCount; i++)
+    {
+        Message m;
+        m.producer = context->producer;
+        m.value = i;
+        while (!mnMPSCQueue_push(context->queue, &m))
+        {
+            thrd_yield();
+        }
+    }
+    
+    return 0;
+}
+
+static void testMultipleProducers()
+{
+    start_test("MPSC queue - multiple producer threads");
+    
+    mnMPSCQueue q;
+    mnMPSCQueue_init(&q, 64, sizeof(Message));
+    
+    thrd_t threads[NUM_PRODUCERS];
+    ProducerContext contexts[NUM_PRODUCERS];
+    for (int p = 0; p < NUM_PRODUCERS; p++)
+    {
+        contexts[p].queue = &q;
+        contexts[p].producer = p;
+        thrd_create(&threads[p], entryPointProducer, &contexts[p]);
+    }
+    
+    //drain in batches, checking that each producer's messages arrive in order
+    int nextValue[NUM_PRODUCERS] = {0};
+    int numReceived = 0;
+    int errors = 0;
+    Message batch[16];
+    while (numReceived < NUM_PRODUCERS * loopCount)
+    {
+        const int n = mnMPSCQueue_popN(&q, batch, 16);
+        if (n == 0)
+        {
+            thrd_yield();
+        }
+        
+        for (int i = 0; i < n; i++)
+        {
+            if (batch[i].value != nextValue[batch[i].producer])
+            {
+                errors++;
+            }
+            nextValue[batch[i].producer] = batch[i].value + 1;
+        }
+        numReceived += n;
+    }
+    
+    for (int p = 0; p < NUM_PRODUCERS; p++)
+    {
+        int joinRes;
+        thrd_join(threads[p], &joinRes);
+    }
+    
+    fail_unless(errors == 0, "messages from one producer should be popped in the order they were pushed");
+    fail_unless(mnMPSCQueue_getNumElements(&q) == 0, "queue should be empty after popping all pushed messages");
+    
+    mnMPSCQueue_deinit(&q);
+}
+
+static void testPushUntilFullAndPopUntilEmpty()
+{
+    start_test("MPSC queue - push until full and pop until empty");
+    
+    mnMPSCQueue q;
+    mnMPSCQueue_init(&q, 100, sizeof(int));
+    
+    const int c = q.capacity;
+    fail_unless(c == 128, "capacity should be rounded up to a power of two");
+    
+    //go a few laps to exercise slot reuse
+    for (int lap = 0; lap < 3; lap++)
+    {
+        for (int i = 0; i < c; i++)
+        {
+            int success = mnMPSCQueue_push(&q, &i);
+            if (!success)
+            {
+                fail_unless(success == 1, "push to queue with free slots should succeed");
+            }
+        }
+        
+        int success = mnMPSCQueue_push(&q, &c);
+        fail_unless(success == 0, "push to full queue should fail");
+        fail_unless(mnMPSCQueue_getNumElements(&q) == c, "full queue should hold capacity elements");
+        
+        for (int i = 0; i < c; i++)
+        {
+            int val = -1;
+            success = mnMPSCQueue_pop(&q, &val);
+            if (success != 1 || val != i)
+            {
+                fail_unless(success == 1 && val == i, "popped element should have the expected value");
+            }
+        }
+        
+        int val = 0;
+        fail_unless(mnMPSCQueue_pop(&q, &val) == 0, "pop from empty queue should fail");
+    }
+    
+    mnMPSCQueue_deinit(&q);
+}
+
+static void testBoundedBatchPop()
+{
+    start_test("MPSC queue - bounded batch pop");
+    
+    mnMPSCQueue q;
+    mnMPSCQueue_init(&q, 32, sizeof(int));
+    
+    for (int i = 0; i < 20; i++)
+    {
+        mnMPSCQueue_push(&q, &i);
+    }
+    
+    int batch[8];
+    fail_unless(mnMPSCQueue_popN(&q, batch, 8) == 8, "batch pop should stop at the requested count");
+    fail_unless(batch[0] == 0 && batch[7] == 7, "batch popped elements should have the expected values");
+    fail_unless(mnMPSCQueue_popN(&q, batch, 8) == 8, "batch pop should stop at the requested count");
+    fail_unless(mnMPSCQueue_popN(&q, batch, 8) == 4, "batch pop should stop when the queue is empty");
+    fail_unless(batch[3] == 19, "batch popped elements should have the expected values");
+    
+    mnMPSCQueue_deinit(&q);
+}
+
+static void testOutOfRangeCapacity()
+{
+    start_test("MPSC queue - out of range capacity");
+    
+    mnMPSCQueue q;
+    fail_unless(!mnMPSCQueue_init(&q, -1, sizeof(int)), "a negative capacity should be rejected");
+    fail_unless(!mnMPSCQueue_init(&q, (1 << 30) + 1, 1), "a capacity above 2^30 should be rejected");
+    fail_unless(!mnMPSCQueue_init(&q, 1 << 30, 1), "sequence storage above INT_MAX should be rejected");
+    mnMPSCQueue_deinit(&q);
+}
+
+void testMPSCQueue()
+{
+    testPushUntilFullAndPopUntilEmpty();
+    testBoundedBatchPop();
+    testMultipleProducers();
+    testOutOfRangeCapacity();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_MPSC_QUEUE_H
+#define DR_TEST_MPSC_QUEUE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testMPSCQueue();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_MPSC_QUEUE_H
+
@@ -0,0 +1,200 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_object_pool.h"
+
+#include "atomic.h"
+#include "object_pool.h"
+
+#define NUM_OBJECTS 64
+
+static const int roundCount = 20000;
+
+typedef struct
+{
+    int owner;
+    int serial;
+    float data[5];
+} Voice;
+
+static void testAllocAndFree()
+{
+    start_test("Object pool - alloc until empty, free and reuse");
+    
+    mnObjectPool pool;
+    fail_unless(mnObjectPool_init(&pool, sizeof(Voice), NUM_OBJECTS), "init should succeed");
+    
+    Voice* voices[NUM_OBJECTS];
+    int distinct = 1;
+    for (int i = 0; i < NUM_OBJECTS; i++)
+    {
+        voices[i] = mnObjectPool_alloc(&pool);
+        fail_unless(voices[i] != NULL, "the pool should hold capacity objects");
+        fail_unless((uintptr_t)voices[i] % 16 == 0, "objects should be aligned");
+        for (int j = 0; j < i; j++)
+        {
+            distinct = distinct && voices[i] != voices[j];
+        }
+        voices[i]->serial = i;
+    }
+    fail_unless(distinct, "allocated objects should be distinct");
+    fail_unless(mnObjectPool_alloc(&pool) == NULL, "an empty pool should return NULL");
+    
+    mnObjectPool_free(&pool, voices[7]);
+    fail_unless(mnObjectPool_alloc(&pool) == voices[7], "a freed object should be reused");
+    
+    mnObjectPool_deinit(&pool);
+}
+
+static void testInvalidSizes()
+{
+    start_test("Object pool - rejects negative and overflowing sizes");
+    
+    mnObjectPool pool;
+    fail_unless(!mnObjectPool_init(&pool, sizeof(Voice), -1), "a negative capacity should be rejected");
+    fail_unless(mnObjectPool_alloc(&pool) == NULL, "a rejected pool should be empty");
+    mnObjectPool_deinit(&pool);
+    fail_unless(!mnObjectPool_init(&pool, -1, NUM_OBJECTS), "a negative object size should be rejected");
+    fail_unless(!mnObjectPool_init(&pool, 1 << 20, 1 << 12), "an overflowing size should be rejected");
+    fail_unless(!mnObjectPool_init(&pool, INT_MAX, 1), "an overflowing stride should be rejected");
+}
+
+static void countReclaimed(void* object, void* callbackContext)
+{
+    Voice* voice = (Voice*)object;
+    int* sum = (int*)callbackContext;
+    *sum += voice->serial;
+}
+
+static void testRetireAndReclaim()
+{
+    start_test("Object pool - retired objects are reclaimed as a batch");
+    
+    mnObjectPool pool;
+    mnObjectPool_init(&pool, sizeof(Voice), 4);
+    
+    Voice* voices[4];
+    for (int i = 0; i < 4; i++)
+    {
+        voices[i] = mnObjectPool_alloc(&pool);
+        voices[i]->serial = i + 1;
+    }
+    mnObjectPool_retire(&pool, voices[1]);
+    mnObjectPool_retire(&pool, voices[3]);
+    fail_unless(mnObjectPool_alloc(&pool) == NULL, "retired objects should not be reused before reclaiming");
+    
+    int sum = 0;
+    fail_unless(mnObjectPool_reclaim(&pool, countReclaimed, &sum) == 2, "both retired objects should be reclaimed");
+    fail_unless(sum == 2 + 4, "the callback should see every retired object");
+    fail_unless(mnObjectPool_reclaim(&pool, NULL, NULL) == 0, "nothing should be left to reclaim");
+    
+    Voice* a = mnObjectPool_alloc(&pool);
+    Voice* b = mnObjectPool_alloc(&pool);
+    fail_unless(a != NULL && b != NULL && mnObjectPool_alloc(&pool) == NULL,
+                "reclaimed objects should be allocatable again");
+    fail_unless((a == voices[1] && b == voices[3]) || (a == voices[3] && b == voices[1]),
+                "the reclaimed objects should be the retired ones");
+    
+    mnObjectPool_deinit(&pool);
+}
+
+typedef struct
+{
+    mnObjectPool pool;
+    int done;
+    int reclaimed;
+    int corrupted;
+} SharedState;
+
+static void checkReclaimed(void* object, void* callbackContext)
+{
+    SharedState* state = (SharedState*)callbackContext;
+    Voice* voice = (Voice*)object;
+    if (voice->owner != 1 || voice->data[4] != (float)voice->serial)
+    {
+        state->corrupted = 1;
+    }
+    voice->owner = 0;
+}
+
+static int entryPointReclaimer(void* arg)
+{
+    SharedState* state = (SharedState*)arg;
+    while (!mnAtomicLoad(&state->done))
+    {
+        state->reclaimed += mnObjectPool_reclaim(&state->pool, checkReclaimed, state);
+        thrd_yield();
+    }
+    state->reclaimed += mnObjectPool_reclaim(&state->pool, checkReclaimed, state);
+    return 0;
+}
+
+static void testConcurrentReclaim()
+{
+    start_test("Object pool - allocate on one thread, reclaim on another");
+    
+    SharedState state;
+    memset(&state, 0, sizeof(SharedState));
+    mnObjectPool_init(&state.pool, sizeof(Voice), NUM_OBJECTS);
+    
+    thrd_t reclaimer;
+    thrd_create(&reclaimer, entryPointReclaimer, &state);
+    
+    int numRetired = 0;
+    int numDoubleAllocated = 0;
+    for (int round = 0; round < roundCount; round++)
+    {
+        Voice* voice = mnObjectPool_alloc(&state.pool);
+        if (!voice)
+        {
+            thrd_yield();
+            continue;
+        }
+        
+        if (voice->owner != 0)
+        {
+            numDoubleAllocated++;
+        }
+        voice->owner = 1;
+        voice->serial = round;
+        voice->data[4] = (float)round;
+        
+        //alternate between freeing directly and handing over for reclamation
+        if (round % 3 == 0)
+        {
+            voice->owner = 0;
+            mnObjectPool_free(&state.pool, voice);
+        }
+        else
+        {
+            mnObjectPool_retire(&state.pool, voice);
+            numRetired++;
+        }
+    }
+    
+    mnAtomicStore(1, &state.done);
+    thrd_join(reclaimer, NULL);
+    
+    fail_unless(numDoubleAllocated == 0, "an object should never be handed out twice");
+    fail_unless(!state.corrupted, "retired objects should arrive intact");
+    fail_unless(state.reclaimed == numRetired, "every retired object should be reclaimed");
+    
+    int numFree = 0;
+    while (mnObjectPool_alloc(&state.pool))
+    {
+        numFree++;
+    }
+    fail_unless(numFree == NUM_OBJECTS, "all objects should be back in the pool");
+    
+    mnObjectPool_deinit(&state.pool);
+}
+
+void testObjectPool()
+{
+    testAllocAndFree();
+    testInvalidSizes();
+    testRetireAndReclaim();
+    testConcurrentReclaim();
+}
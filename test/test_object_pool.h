@@ -0,0 +1,17 @@
+#ifndef DR_TEST_OBJECT_POOL_H
+#define DR_TEST_OBJECT_POOL_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testObjectPool();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_OBJECT_POOL_H
+
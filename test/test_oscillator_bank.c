@@ -0,0 +1,195 @@
+#include <math.h>
+#include <stdlib.h>
+#include "testmacros.h"
+#include "test_oscillator_bank.h"
+
+#include "dsp_math.h"
+#include "oscillator_bank.h"
+#include "simd.h"
+
+#define SAMPLE_RATE 44100.0f
+#define BLOCK_SIZE 512
+
+static void testSineAccuracy()
+{
+    start_test("Oscillator bank - matches sin over many blocks");
+    
+    mnOscillatorBank bank;
+    mnOscillatorBank_init(&bank, 1, SAMPLE_RATE);
+    const float frequency = 1000.0f;
+    mnOscillatorBank_noteOn(&bank, frequency, 1.0f);
+    
+    //the first block fades in, compare the following 4 seconds
+    float output[BLOCK_SIZE];
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    
+    double maxError = 0.0;
+    for (int block = 1; block < 345; block++)
+    {
+        mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+        for (int i = 0; i < BLOCK_SIZE; i++)
+        {
+            const double n = (double)(block * BLOCK_SIZE + i);
+            const double expected = sin(2.0 * MN_PI * frequency * n / SAMPLE_RATE);
+            const double error = fabs(output[i] - expected);
+            maxError = error > maxError ? error : maxError;
+        }
+    }
+    
+    fail_unless(maxError < 1e-3, "oscillator should stay in phase with sin");
+    
+    mnOscillatorBank_deinit(&bank);
+}
+
+static void testRamps()
+{
+    start_test("Oscillator bank - amplitude and frequency ramps");
+    
+    mnOscillatorBank bank;
+    mnOscillatorBank_init(&bank, 4, SAMPLE_RATE);
+    const int voice = mnOscillatorBank_noteOn(&bank, 1000.0f, 1.0f);
+    
+    float output[BLOCK_SIZE];
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    int isWithinEnvelope = 1;
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        isWithinEnvelope &= fabsf(output[i]) <= (float)i / BLOCK_SIZE + 1e-4f;
+    }
+    fail_unless(isWithinEnvelope, "a new note should fade in linearly over the first block");
+    
+    //glide from 1 to 2 kHz, which crosses zero about as often as 1.5 kHz
+    mnOscillatorBank_setFrequency(&bank, voice, 2000.0f);
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    int numCrossings = 0;
+    for (int i = 1; i < BLOCK_SIZE; i++)
+    {
+        numCrossings += (output[i - 1] < 0.0f) != (output[i] < 0.0f);
+    }
+    const int expectedCrossings = (int)(2.0f * 1500.0f * BLOCK_SIZE / SAMPLE_RATE + 0.5f);
+    fail_unless(abs(numCrossings - expectedCrossings) <= 1, "frequency should ramp linearly over a block");
+    
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    float peak = 0.0f;
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        peak = fabsf(output[i]) > peak ? fabsf(output[i]) : peak;
+    }
+    fail_unless(fabsf(peak - 1.0f) < 1e-3f, "amplitude should be unchanged after a frequency ramp");
+    
+    mnOscillatorBank_noteOff(&bank, voice);
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    fail_unless(fabsf(output[BLOCK_SIZE - 1]) < 1e-2f, "a released note should fade out over a block");
+    fail_unless(mnOscillatorBank_getNumActiveVoices(&bank) == 0, "a faded out voice should be free");
+    
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    int isSilent = 1;
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        isSilent &= output[i] == 0.0f;
+    }
+    fail_unless(isSilent, "a bank without active voices should render silence");
+    
+    mnOscillatorBank_deinit(&bank);
+}
+
+static void testVoiceAllocation()
+{
+    start_test("Oscillator bank - voice allocation");
+    
+    mnOscillatorBank bank;
+    mnOscillatorBank_init(&bank, 4, SAMPLE_RATE);
+    
+    int isInOrder = 1;
+    for (int i = 0; i < 4; i++)
+    {
+        isInOrder &= mnOscillatorBank_noteOn(&bank, 100.0f * (i + 1), 0.1f) == i;
+    }
+    fail_unless(isInOrder, "notes should get the lowest free voice");
+    fail_unless(mnOscillatorBank_getNumActiveVoices(&bank) == 4, "all voices should be active");
+    
+    fail_unless(mnOscillatorBank_noteOn(&bank, 500.0f, 0.1f) == 0, "the oldest voice should be stolen");
+    
+    mnOscillatorBank_noteOff(&bank, 2);
+    fail_unless(mnOscillatorBank_noteOn(&bank, 600.0f, 0.1f) == 2,
+                "a released voice should be stolen before a playing one");
+    
+    float output[BLOCK_SIZE];
+    mnOscillatorBank_noteOff(&bank, 1);
+    mnOscillatorBank_render(&bank, output, BLOCK_SIZE);
+    fail_unless(mnOscillatorBank_getNumActiveVoices(&bank) == 3, "a released voice should be freed by rendering");
+    fail_unless(mnOscillatorBank_noteOn(&bank, 700.0f, 0.1f) == 1, "a freed voice should be reused");
+    
+    mnOscillatorBank_deinit(&bank);
+}
+
+/**
+ * Plays a changing set of notes and returns the rendered output.
+ */
+static void renderNotes(float* output, int numBlocks)
+{
+    mnOscillatorBank bank;
+    mnOscillatorBank_init(&bank, 37, SAMPLE_RATE);
+    srand(1234);
+    
+    for (int block = 0; block < numBlocks; block++)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            const float frequency = 50.0f + 5000.0f * (float)rand() / (float)RAND_MAX;
+            const int voice = mnOscillatorBank_noteOn(&bank, frequency, 0.02f);
+            mnOscillatorBank_setFrequency(&bank, (voice + 5) % 37, 2.0f * frequency);
+            mnOscillatorBank_noteOff(&bank, rand() % 37);
+        }
+        
+        //odd block sizes exercise partial chunks
+        mnOscillatorBank_render(&bank, output + block * BLOCK_SIZE, BLOCK_SIZE - 13 * (block % 2));
+    }
+    
+    mnOscillatorBank_deinit(&bank);
+}
+
+static void testSIMDMatchesReference()
+{
+    start_test("Oscillator bank - vectorized rendering matches reference");
+    
+    const int numBlocks = 20;
+    float* reference = calloc(numBlocks * BLOCK_SIZE, sizeof(float));
+    float* rendered = calloc(numBlocks * BLOCK_SIZE, sizeof(float));
+    
+    mnSIMD_setLevel(MN_SIMD_NONE);
+    renderNotes(reference, numBlocks);
+    
+    //the vector kernels may fuse multiplies and adds, so allow rounding differences
+    float maxError = 0.0f;
+    const mnSIMDLevel levels[] = {MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    for (int l = 0; l < 3; l++)
+    {
+        mnSIMD_setLevel(levels[l]);
+        if (mnSIMD_getLevel() != levels[l])
+        {
+            continue;
+        }
+        
+        renderNotes(rendered, numBlocks);
+        for (int i = 0; i < numBlocks * BLOCK_SIZE; i++)
+        {
+            const float error = fabsf(rendered[i] - reference[i]);
+            maxError = error > maxError ? error : maxError;
+        }
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    fail_unless(maxError < 1e-4f, "vectorized oscillators should match the reference implementation");
+    
+    free(reference);
+    free(rendered);
+}
+
+void testOscillatorBank()
+{
+    testSineAccuracy();
+    testRamps();
+    testVoiceAllocation();
+    testSIMDMatchesReference();
+}
@@ -0,0 +1,16 @@
+#ifndef DR_TEST_OSCILLATOR_BANK_H
+#define DR_TEST_OSCILLATOR_BANK_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testOscillatorBank();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_OSCILLATOR_BANK_H
@@ -0,0 +1,205 @@
+#if defined(__linux__)
+//for sched_getcpu
+#define _GNU_SOURCE
+#endif
+
+#include <float.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "testmacros.h"
+#include "test_realtime.h"
+
+#include "backend_offline.h"
+#include "engine.h"
+#include "realtime.h"
+
+/**
+ * Returns half the smallest normal float, which is a denormal unless
+ * denormals are flushed to zero.
+ */
+static float halveSmallestNormal()
+{
+    volatile float smallest = FLT_MIN;
+    volatile float half = smallest * 0.5f;
+    return half;
+}
+
+static void testFloatState()
+{
+    start_test("Realtime - flushing denormals");
+    
+    const int wasFlushing = mnFloatState_isFlushingToZero();
+    fail_unless(!wasFlushing, "threads should start out keeping denormals");
+    fail_unless(halveSmallestNormal() > 0.0f, "denormal results should be kept");
+    
+    const mnFloatState state = mnFloatState_enterFlushToZero();
+    fail_unless(mnFloatState_isFlushingToZero(), "denormals should be flushed");
+    fail_unless(halveSmallestNormal() == 0.0f, "denormal results should be flushed to zero");
+    
+    //entering again is harmless and restoring the inner state keeps flushing
+    const mnFloatState innerState = mnFloatState_enterFlushToZero();
+    mnFloatState_restore(innerState);
+    fail_unless(mnFloatState_isFlushingToZero(), "restoring a nested state should keep flushing");
+    
+    mnFloatState_restore(state);
+    fail_unless(!mnFloatState_isFlushingToZero(), "the original state should be restored");
+    fail_unless(halveSmallestNormal() > 0.0f, "denormal results should be kept again");
+}
+
+typedef struct
+{
+    int core;
+    int policy;
+    int priority;
+} ThreadInfo;
+
+static void* recordThreadInfo(void* data)
+{
+    ThreadInfo* info = (ThreadInfo*)data;
+#if defined(__linux__)
+    info->core = sched_getcpu();
+#else
+    info->core = -1;
+#endif
+    struct sched_param parameters;
+    pthread_getschedparam(pthread_self(), &info->policy, &parameters);
+    info->priority = parameters.sched_priority;
+    return NULL;
+}
+
+static void testThreads()
+{
+    start_test("Realtime - thread priority and affinity");
+    
+    mnThreadOptions options;
+    mnThreadOptions_setDefaults(&options);
+    fail_unless(options.priority == 0 && options.core == -1, "default options mismatch");
+    
+    ThreadInfo info;
+    pthread_t thread;
+    fail_unless(mnThread_create(&thread, NULL, recordThreadInfo, &info), "default thread creation failed");
+    pthread_join(thread, NULL);
+    fail_unless(info.policy != SCHED_FIFO, "default threads should have normal scheduling");
+    
+    //real time priority may be refused, in which case the thread still runs
+    options.priority = 50;
+    fail_unless(mnThread_create(&thread, &options, recordThreadInfo, &info), "real time thread creation failed");
+    pthread_join(thread, NULL);
+    fail_unless(info.policy != SCHED_FIFO || info.priority == 50, "real time priority mismatch");
+    
+    //out of range priorities are clamped
+    options.priority = 1000;
+    fail_unless(mnThread_create(&thread, &options, recordThreadInfo, &info), "clamped thread creation failed");
+    pthread_join(thread, NULL);
+    fail_unless(info.policy != SCHED_FIFO || info.priority == sched_get_priority_max(SCHED_FIFO),
+                "the priority should be clamped");
+    
+#if defined(__linux__)
+    const int lastCore = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    options.priority = 0;
+    options.core = lastCore;
+    fail_unless(mnThread_create(&thread, &options, recordThreadInfo, &info), "pinned thread creation failed");
+    pthread_join(thread, NULL);
+    //pinning happens right after creation, so the thread may start elsewhere
+    
+    options.core = lastCore + 1;
+    fail_unless(!mnThread_setOptions(pthread_self(), &options), "pinning to a missing core should fail");
+    
+    //pin the calling thread and check where it runs, then let it go anywhere again
+    cpu_set_t oldCores;
+    pthread_getaffinity_np(pthread_self(), sizeof(oldCores), &oldCores);
+    options.core = lastCore;
+    fail_unless(mnThread_setOptions(pthread_self(), &options), "pinning failed");
+    fail_unless(sched_getcpu() == lastCore, "the thread should run on the pinned core");
+    pthread_setaffinity_np(pthread_self(), sizeof(oldCores), &oldCores);
+#endif
+}
+
+typedef struct
+{
+    int numCallbacks;
+    int numFlushingCallbacks;
+} CallbackState;
+
+static void outputCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    CallbackState* state = (CallbackState*)context;
+    state->numCallbacks++;
+    state->numFlushingCallbacks += mnFloatState_isFlushingToZero() && halveSmallestNormal() == 0.0f;
+    memset(samples, 0, numChannels * numFrames * sizeof(float));
+}
+
+static void testEngineFloatState()
+{
+    start_test("Realtime - engine callbacks flush denormals");
+    
+    for (int flushDenormals = 0; flushDenormals <= 1; flushDenormals++)
+    {
+        mnOptions options;
+        mnOptions_setDefaults(&options);
+        fail_unless(options.flushDenormals, "denormals should be flushed by default");
+        options.flushDenormals = flushDenormals;
+        options.bufferSizeInFrames = 64;
+        
+        CallbackState state = {0, 0};
+        mnEngine engine;
+        mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+        mnEngine_start(&engine);
+        mnOfflineBackend_render(&engine, NULL, NULL, 64 * 4);
+        mnEngine_deinit(&engine);
+        
+        fail_unless(state.numCallbacks == 4, "callback count mismatch");
+        fail_unless(state.numFlushingCallbacks == (flushDenormals ? 4 : 0), "callback float state mismatch");
+        fail_unless(!mnFloatState_isFlushingToZero(), "the backend's float state should be restored");
+    }
+}
+
+static void applyEvent(const mnScheduledEvent* event, void* context)
+{
+}
+
+static int canLockMemory()
+{
+    struct rlimit limit;
+    getrlimit(RLIMIT_MEMLOCK, &limit);
+    return geteuid() == 0 || limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= 64 * 1024 * 1024;
+}
+
+static void testEngineMemory()
+{
+    start_test("Realtime - engine buffers are locked");
+    
+    //resampled input and output, fixed blocks and events use every kind of buffer
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfInputChannels = 1;
+    options.bufferSizeInFrames = 100;
+    options.fixedBufferSize = 1;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    
+    CallbackState state = {0, 0};
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, outputCallback, &state, &options);
+    fail_unless(mnEngine_setEventCallback(&engine, applyEvent, 64), "setting the event callback should succeed");
+    engine.deviceSampleRate = 48000;
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(engine.isResampling && engine.isBufferSizeFixed, "the engine should resample fixed blocks");
+    
+    if (canLockMemory())
+    {
+        fail_unless(mnEngine_isMemoryLocked(&engine), "the engine's buffers should be locked");
+    }
+    fail_unless(mnOfflineBackend_render(&engine, NULL, NULL, 1000) == 1000, "render failed");
+    mnEngine_deinit(&engine);
+}
+
+void testRealtime()
+{
+    testFloatState();
+    testThreads();
+    testEngineFloatState();
+    testEngineMemory();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_REALTIME_H
+#define DR_TEST_REALTIME_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testRealtime();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_REALTIME_H
+
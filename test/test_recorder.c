@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_recorder.h"
+
+#include "backend_offline.h"
+#include "engine.h"
+#include "recorder.h"
+
+static void getTestPath(char* path, int size, const char* name)
+{
+    const char* directory = getenv("TMPDIR");
+    snprintf(path, size, "%s/%s", directory ? directory : "/tmp", name);
+}
+
+static unsigned char* readFile(const char* path, int* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        *size = 0;
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = (int)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* contents = malloc(*size + 1);
+    *size = (int)fread(contents, 1, *size, file);
+    fclose(file);
+    return contents;
+}
+
+static int get32LE(const unsigned char* p)
+{
+    return (int)(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24));
+}
+
+static int get32BE(const unsigned char* p)
+{
+    return (int)(((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+/** A sample that is exact in 16 bits. */
+static float getTestSample(int i)
+{
+    return (float)((i * 7) % 60000 - 30000) / 32768.0f;
+}
+
+typedef struct
+{
+    mnRecorder* recorder;
+    int numFrames;
+    int numChannels;
+    int numQueued;
+} SourceState;
+
+/**
+ * Pushes blocks of samples at roughly the pace of a 48 kHz device.
+ */
+static int sourceThreadEntryPoint(void* data)
+{
+    SourceState* state = (SourceState*)data;
+    const int blockSize = 256;
+    float block[256 * 2];
+    
+    for (int start = 0; start < state->numFrames; start += blockSize)
+    {
+        for (int i = 0; i < blockSize * state->numChannels; i++)
+        {
+            block[i] = getTestSample(start * state->numChannels + i);
+        }
+        state->numQueued += mnRecorder_write(state->recorder, block, MN_SAMPLE_FORMAT_FLOAT32, blockSize);
+        
+        struct timespec t = {0, 5000000};
+        thrd_sleep(&t, NULL);
+    }
+    
+    return 0;
+}
+
+static void testWAV()
+{
+    start_test("Recorder - 16 bit WAV from a real time source");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_recorder");
+    
+    mnRecorderOptions options;
+    mnRecorderOptions_setDefaults(&options);
+    options.path = path;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    options.useDither = 0;
+    options.numChannels = 2;
+    options.sampleRate = 48000;
+    options.bufferSizeInFrames = 16384;
+    
+    mnRecorder recorder;
+    fail_unless(mnRecorder_start(&recorder, &options), "start failed");
+    
+    SourceState state = {&recorder, 256 * 100, 2, 0};
+    thrd_t source;
+    thrd_create(&source, sourceThreadEntryPoint, &state);
+    thrd_join(source, NULL);
+    mnRecorder_stop(&recorder);
+    
+    fail_unless(state.numQueued == state.numFrames, "frames were dropped");
+    fail_unless(mnRecorder_getNumDroppedFrames(&recorder) == 0 && mnRecorder_getNumOverflows(&recorder) == 0,
+                "no overflows should be counted");
+    fail_unless(mnRecorder_getNumWriteErrors(&recorder) == 0, "writing failed");
+    fail_unless(mnRecorder_getNumFiles(&recorder) == 1, "a single file should be written");
+    
+    char filePath[300];
+    snprintf(filePath, sizeof(filePath), "%s.wav", path);
+    int size = 0;
+    unsigned char* contents = readFile(filePath, &size);
+    const int numDataBytes = state.numFrames * 2 * 2;
+    fail_unless(size == 44 + numDataBytes, "file size mismatch");
+    fail_unless(memcmp(contents, "RIFF", 4) == 0 && get32LE(contents + 4) == 36 + numDataBytes, "bad RIFF header");
+    fail_unless(memcmp(contents + 8, "WAVEfmt ", 8) == 0 && get32LE(contents + 24) == 48000, "bad format chunk");
+    fail_unless(contents[20] == 1 && contents[22] == 2 && contents[34] == 16, "bad sample format");
+    fail_unless(memcmp(contents + 36, "data", 4) == 0 && get32LE(contents + 40) == numDataBytes, "bad data chunk");
+    
+    int mismatches = 0;
+    const short* samples = (const short*)(contents + 44);
+    for (int i = 0; i < state.numFrames * 2; i++)
+    {
+        const int expected = (int)(getTestSample(i) * 32767.0f);
+        if (abs(samples[i] - expected) > 1)
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "recorded samples mismatch");
+    
+    free(contents);
+    remove(filePath);
+}
+
+static void testRotation()
+{
+    start_test("Recorder - CAF files rotated after a number of frames");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_rotation");
+    
+    mnRecorderOptions options;
+    mnRecorderOptions_setDefaults(&options);
+    options.path = path;
+    options.fileType = MN_AUDIO_FILE_CAF;
+    options.sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    options.bufferSizeInFrames = 4096;
+    options.maxFramesPerFile = 1000;
+    
+    mnRecorder recorder;
+    fail_unless(mnRecorder_start(&recorder, &options), "start failed");
+    
+    float block[100];
+    for (int start = 0; start < 2500; start += 100)
+    {
+        for (int i = 0; i < 100; i++)
+        {
+            block[i] = getTestSample(start + i);
+        }
+        mnRecorder_write(&recorder, block, MN_SAMPLE_FORMAT_FLOAT32, 100);
+    }
+    mnRecorder_stop(&recorder);
+    fail_unless(mnRecorder_getNumFiles(&recorder) == 3, "there should be three files");
+    
+    const int expectedFrames[] = {1000, 1000, 500};
+    int mismatches = 0;
+    for (int f = 0; f < 3; f++)
+    {
+        char filePath[300];
+        snprintf(filePath, sizeof(filePath), "%s-%03d.caf", path, f);
+        int size = 0;
+        unsigned char* contents = readFile(filePath, &size);
+        fail_unless(size == 68 + 4 * expectedFrames[f], "file size mismatch");
+        fail_unless(contents && memcmp(contents, "caff", 4) == 0 && memcmp(contents + 8, "desc", 4) == 0,
+                    "bad CAF header");
+        if (!contents || size != 68 + 4 * expectedFrames[f])
+        {
+            free(contents);
+            continue;
+        }
+        fail_unless(memcmp(contents + 28, "lpcm", 4) == 0 && get32BE(contents + 32) == 3, "bad sample format");
+        fail_unless(memcmp(contents + 52, "data", 4) == 0 && get32BE(contents + 60) == 4 + 4 * expectedFrames[f],
+                    "bad data chunk size");
+        
+        const float* samples = (const float*)(contents + 68);
+        for (int i = 0; i < expectedFrames[f]; i++)
+        {
+            if (samples[i] != getTestSample(1000 * f + i))
+            {
+                mismatches++;
+            }
+        }
+        free(contents);
+        remove(filePath);
+    }
+    fail_unless(mismatches == 0, "recorded samples mismatch");
+}
+
+static void testOverflow()
+{
+    start_test("Recorder - a full ring drops and counts frames");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_overflow");
+    
+    mnRecorderOptions options;
+    mnRecorderOptions_setDefaults(&options);
+    options.path = path;
+    options.bufferSizeInFrames = 64;
+    
+    mnRecorder recorder;
+    fail_unless(mnRecorder_start(&recorder, &options), "start failed");
+    
+    float block[1000];
+    memset(block, 0, sizeof(block));
+    const int numQueued = mnRecorder_write(&recorder, block, MN_SAMPLE_FORMAT_FLOAT32, 1000);
+    fail_unless(numQueued == 64, "the ring should take as many frames as it holds");
+    fail_unless(mnRecorder_getNumDroppedFrames(&recorder) == 1000 - 64, "dropped frame count mismatch");
+    fail_unless(mnRecorder_getNumOverflows(&recorder) == 1, "overflow count mismatch");
+    mnRecorder_stop(&recorder);
+    
+    char filePath[300];
+    snprintf(filePath, sizeof(filePath), "%s.wav", path);
+    int size = 0;
+    unsigned char* contents = readFile(filePath, &size);
+    fail_unless(size == 44 + 64 * 3, "only the queued frames should be written");
+    free(contents);
+    remove(filePath);
+    
+    options.path = "/nonexistent/directory/take";
+    fail_unless(!mnRecorder_start(&recorder, &options), "starting should fail if the file can't be created");
+    
+    options.path = path;
+    options.numChannels = 8;
+    options.bufferSizeInFrames = 1 << 28;
+    fail_unless(!mnRecorder_start(&recorder, &options), "starting should fail if the number of samples overflows");
+    options.bufferSizeInFrames = 1 << 26;
+    fail_unless(!mnRecorder_start(&recorder, &options), "starting should fail if the ring storage is too large");
+    options.numChannels = 0;
+    options.bufferSizeInFrames = 64;
+    fail_unless(!mnRecorder_start(&recorder, &options), "starting should fail without channels");
+}
+
+static void testEngine()
+{
+    start_test("Recorder - engine input");
+    
+    char path[256];
+    getTestPath(path, sizeof(path), "mn_test_engine_recorder");
+    
+    mnRecorderOptions recorderOptions;
+    mnRecorderOptions_setDefaults(&recorderOptions);
+    recorderOptions.path = path;
+    recorderOptions.sampleFormat = MN_SAMPLE_FORMAT_FLOAT32;
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.numberOfInputChannels = 1;
+    options.numberOfOutputChannels = 0;
+    options.bufferSizeInFrames = 64;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    
+    mnRecorder recorder;
+    fail_unless(mnRecorder_start(&recorder, &recorderOptions), "start failed");
+    
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, NULL, NULL, &options);
+    mnEngine_setRecorder(&engine, &recorder);
+    fail_unless(mnEngine_start(&engine), "engine start failed");
+    
+    const int numFrames = 1000;
+    short input[1000];
+    for (int i = 0; i < numFrames; i++)
+    {
+        input[i] = (short)(i * 30 - 15000);
+    }
+    mnOfflineBackend_render(&engine, input, NULL, numFrames);
+    mnEngine_deinit(&engine);
+    mnRecorder_stop(&recorder);
+    
+    char filePath[300];
+    snprintf(filePath, sizeof(filePath), "%s.wav", path);
+    int size = 0;
+    unsigned char* contents = readFile(filePath, &size);
+    fail_unless(size == 44 + 4 * numFrames, "file size mismatch");
+    fail_unless(contents && contents[20] == 3, "float files should have the IEEE float format tag");
+    
+    int mismatches = 0;
+    const float* samples = (const float*)(contents + 44);
+    for (int i = 0; contents && size == 44 + 4 * numFrames && i < numFrames; i++)
+    {
+        if (samples[i] != input[i] / 32768.0f)
+        {
+            mismatches++;
+        }
+    }
+    fail_unless(mismatches == 0, "recorded input mismatch");
+    free(contents);
+    remove(filePath);
+}
+
+void testRecorder()
+{
+    testWAV();
+    testRotation();
+    testOverflow();
+    testEngine();
+}
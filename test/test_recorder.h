@@ -0,0 +1,17 @@
+#ifndef DR_TEST_RECORDER_H
+#define DR_TEST_RECORDER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testRecorder();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_RECORDER_H
+
@@ -0,0 +1,327 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testmacros.h"
+#include "test_resampler.h"
+
+#include "backend_offline.h"
+#include "engine.h"
+#include "resampler.h"
+#include "simd.h"
+
+#define TWO_PI 6.283185307179586
+
+static float* makeSine(int numFrames, int numChannels, double frequency, double sampleRate)
+{
+    float* samples = malloc(numFrames * numChannels * sizeof(float));
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int c = 0; c < numChannels; c++)
+        {
+            samples[i * numChannels + c] = (float)(0.5 * sin(TWO_PI * frequency * i / sampleRate + c));
+        }
+    }
+    return samples;
+}
+
+/**
+ * Returns the power of what is left of \c samples after subtracting the best
+ * fitting sine at \c frequency, relative to the power of that sine, in dB.
+ */
+static double measureTHDN(const float* samples, int numFrames, int stride, double frequency, double sampleRate)
+{
+    double ss = 0.0, cc = 0.0, sc = 0.0, xs = 0.0, xc = 0.0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const double s = sin(TWO_PI * frequency * i / sampleRate);
+        const double c = cos(TWO_PI * frequency * i / sampleRate);
+        const double x = samples[i * stride];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += x * s;
+        xc += x * c;
+    }
+    
+    const double det = ss * cc - sc * sc;
+    const double a = (xs * cc - xc * sc) / det;
+    const double b = (xc * ss - xs * sc) / det;
+    
+    double signal = 0.0, residual = 0.0;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const double fit = a * sin(TWO_PI * frequency * i / sampleRate) + b * cos(TWO_PI * frequency * i / sampleRate);
+        const double e = samples[i * stride] - fit;
+        signal += fit * fit;
+        residual += e * e;
+    }
+    
+    return 10.0 * log10(residual / signal);
+}
+
+static void testStreaming()
+{
+    start_test("Resampler - block sizes don't change the output");
+    
+    const double rates[][2] = {{44100.0, 48000.0}, {48000.0, 44100.0}, {44100.0, 22050.0}};
+    const int numFrames = 5000;
+    for (int r = 0; r < 3; r++)
+    {
+        float* input = makeSine(numFrames, 2, 997.0, rates[r][0]);
+        const int maxOutput = 2 * numFrames;
+        float* whole = malloc(maxOutput * 2 * sizeof(float));
+        float* pieces = malloc(maxOutput * 2 * sizeof(float));
+        
+        mnResampler resampler;
+        fail_unless(mnResampler_init(&resampler, 2, rates[r][0], rates[r][1], MN_RESAMPLER_QUALITY_MEDIUM, numFrames),
+                    "init failed");
+        const int expected = mnResampler_getOutputFramesAvailable(&resampler, numFrames);
+        const int numWhole = mnResampler_process(&resampler, input, numFrames, whole, maxOutput);
+        fail_unless(numWhole == expected, "the number of available frames should be predicted");
+        
+        mnResampler_reset(&resampler);
+        int numPieces = 0;
+        int numConsumed = 0;
+        unsigned int seed = 1;
+        while (numConsumed < numFrames)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int n = 1 + (int)((seed >> 16) % 300);
+            if (n > numFrames - numConsumed)
+            {
+                n = numFrames - numConsumed;
+            }
+            numPieces += mnResampler_process(&resampler,
+                                             input + numConsumed * 2,
+                                             n,
+                                             pieces + numPieces * 2,
+                                             maxOutput - numPieces);
+            numConsumed += n;
+        }
+        
+        fail_unless(numPieces == numWhole, "frame count mismatch");
+        fail_unless(memcmp(whole, pieces, numWhole * 2 * sizeof(float)) == 0, "sample mismatch");
+        
+        const double expectedRatio = rates[r][1] / rates[r][0];
+        const double ratio = (double)numWhole / numFrames;
+        fail_unless(fabs(ratio - expectedRatio) < 0.01, "the output should be at the output rate");
+        
+        mnResampler_deinit(&resampler);
+        free(input);
+        free(whole);
+        free(pieces);
+    }
+}
+
+static void testPull()
+{
+    start_test("Resampler - producing an exact number of frames");
+    
+    mnResampler resampler;
+    mnResampler_init(&resampler, 1, 44100.0, 48000.0, MN_RESAMPLER_QUALITY_HIGH, 1024);
+    float input[1024] = {0};
+    float output[1024];
+    
+    int exact = 1;
+    int totalIn = 0;
+    int totalOut = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        const int numOutput = 1 + (i * 37) % 600;
+        const int numInput = mnResampler_getInputFramesNeeded(&resampler, numOutput);
+        exact = exact && numInput <= 1024 && mnResampler_process(&resampler, input, numInput, output, numOutput) == numOutput;
+        totalIn += numInput;
+        totalOut += numOutput;
+    }
+    fail_unless(exact, "the input frames needed should produce exactly the requested frames");
+    fail_unless(fabs((double)totalIn / totalOut - 44100.0 / 48000.0) < 1e-3, "the average ratio should be exact");
+    fail_unless(mnResampler_getMaxOutputFrames(&resampler) >= 1024 * 48000 / 44100, "the max output should be an upper bound");
+    
+    mnResampler_deinit(&resampler);
+}
+
+static void testQuality()
+{
+    start_test("Resampler - distortion and noise of a resampled sine");
+    
+    //44.1 kHz content on a 48 kHz device, and the other way around
+    const double rates[][2] = {{44100.0, 48000.0}, {48000.0, 44100.0}};
+    const double limits[] = {0.0, -60.0, -80.0, -110.0};
+    const int numFrames = 16384;
+    for (int r = 0; r < 2; r++)
+    {
+        float* input = makeSine(numFrames, 1, 1000.0, rates[r][0]);
+        float* output = malloc(2 * numFrames * sizeof(float));
+        
+        for (int q = MN_RESAMPLER_QUALITY_LOW; q <= MN_RESAMPLER_QUALITY_HIGH; q++)
+        {
+            mnResampler resampler;
+            mnResampler_init(&resampler, 1, rates[r][0], rates[r][1], (mnResamplerQuality)q, numFrames);
+            const int n = mnResampler_process(&resampler, input, numFrames, output, 2 * numFrames);
+            
+            //skip the start, where the filter is filled up
+            const double thdn = measureTHDN(output + 200, n - 200, 1, 1000.0, rates[r][1]);
+            fail_unless(thdn < limits[q], "THD+N above the limit of the quality");
+            mnResampler_deinit(&resampler);
+        }
+        
+        free(input);
+        free(output);
+    }
+}
+
+static void testSIMD()
+{
+    start_test("Resampler - vectorized kernels match the reference");
+    
+    const int numFrames = 2000;
+    float* input = makeSine(numFrames, 2, 3000.0, 48000.0);
+    float* reference = malloc(2 * numFrames * 2 * sizeof(float));
+    float* vectorized = malloc(2 * numFrames * 2 * sizeof(float));
+    
+    const mnSIMDLevel level = mnSIMD_getLevel();
+    mnResampler resampler;
+    mnResampler_init(&resampler, 2, 48000.0, 44100.0, MN_RESAMPLER_QUALITY_HIGH, numFrames);
+    
+    mnSIMD_setLevel(MN_SIMD_NONE);
+    const int n = mnResampler_process(&resampler, input, numFrames, reference, 2 * numFrames);
+    
+    float maxError = 0.0f;
+    const mnSIMDLevel levels[] = {MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    for (int l = 0; l < 3; l++)
+    {
+        mnSIMD_setLevel(levels[l]);
+        mnResampler_reset(&resampler);
+        fail_unless(mnResampler_process(&resampler, input, numFrames, vectorized, 2 * numFrames) == n,
+                    "frame count mismatch");
+        for (int i = 0; i < 2 * n; i++)
+        {
+            const float e = fabsf(vectorized[i] - reference[i]);
+            maxError = e > maxError ? e : maxError;
+        }
+    }
+    mnSIMD_setLevel(level);
+    fail_unless(maxError < 1e-5f, "vectorized output differs");
+    
+    mnResampler_deinit(&resampler);
+    free(input);
+    free(reference);
+    free(vectorized);
+}
+
+typedef struct
+{
+    int numFrames;
+    int maxFramesPerCall;
+    int badInput;
+} EngineState;
+
+static void sineOutputCallback(int numChannels, int numFrames, float* samples, void* callbackContext)
+{
+    EngineState* state = (EngineState*)callbackContext;
+    for (int i = 0; i < numFrames; i++)
+    {
+        const float value = (float)(0.5 * sin(TWO_PI * 1000.0 * (state->numFrames + i) / 44100.0));
+        for (int c = 0; c < numChannels; c++)
+        {
+            samples[i * numChannels + c] = value;
+        }
+    }
+    state->numFrames += numFrames;
+    state->maxFramesPerCall = numFrames > state->maxFramesPerCall ? numFrames : state->maxFramesPerCall;
+}
+
+static void loopbackCallback(const float* inputSamples,
+                             float* outputSamples,
+                             int numInputChannels,
+                             int numOutputChannels,
+                             int numFrames,
+                             void* callbackContext)
+{
+    EngineState* state = (EngineState*)callbackContext;
+    if (!inputSamples)
+    {
+        state->badInput = 1;
+        return;
+    }
+    for (int i = 0; i < numFrames; i++)
+    {
+        for (int c = 0; c < numOutputChannels; c++)
+        {
+            outputSamples[i * numOutputChannels + c] = inputSamples[i * numInputChannels];
+        }
+    }
+    state->numFrames += numFrames;
+}
+
+static void testEngine()
+{
+    start_test("Resampler - engine callbacks run at the requested rate");
+    
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.sampleRate = 44100;
+    options.bufferSizeInFrames = 256;
+    
+    EngineState state;
+    memset(&state, 0, sizeof(state));
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, sineOutputCallback, &state, &options);
+    engine.deviceSampleRate = 48000;
+    fail_unless(mnEngine_start(&engine), "start failed");
+    fail_unless(engine.isResampling, "the engine should resample");
+    
+    const int numFrames = 48000;
+    float* output = malloc(numFrames * 2 * sizeof(float));
+    fail_unless(mnOfflineBackend_render(&engine, NULL, output, numFrames) == numFrames, "frame count mismatch");
+    
+    //the callback renders ahead by the resampler's delay
+    fail_unless(state.numFrames >= 44100 && state.numFrames < 44100 + 64, "callback frame count mismatch");
+    fail_unless(state.maxFramesPerCall <= engine.maxFramesPerCallback, "callback exceeds the maximum frame count");
+    fail_unless(measureTHDN(output + 2 * 4800, numFrames - 4800, 2, 1000.0, 48000.0) < -70.0,
+                "a resampled 1 kHz sine should stay a clean 1 kHz sine");
+    mnEngine_deinit(&engine);
+    
+    //an int16 duplex loopback, resampled on the way in and on the way out
+    options.numberOfInputChannels = 1;
+    options.sampleFormat = MN_SAMPLE_FORMAT_INT16;
+    memset(&state, 0, sizeof(state));
+    mnEngine_initDuplex(&engine, mnOfflineBackend_get(), loopbackCallback, &state, &options);
+    engine.deviceSampleRate = 48000;
+    fail_unless(mnEngine_start(&engine), "start failed");
+    
+    float* input = makeSine(numFrames, 1, 1000.0, 48000.0);
+    short* inputShorts = malloc(numFrames * sizeof(short));
+    short* outputShorts = malloc(numFrames * 2 * sizeof(short));
+    mnConvertFromFloat(input, inputShorts, MN_SAMPLE_FORMAT_INT16, numFrames, NULL);
+    fail_unless(mnOfflineBackend_render(&engine, inputShorts, outputShorts, numFrames) == numFrames,
+                "frame count mismatch");
+    mnConvertToFloat(outputShorts, MN_SAMPLE_FORMAT_INT16, output, numFrames * 2);
+    
+    fail_unless(!state.badInput, "the duplex callback should get input");
+    fail_unless(state.numFrames >= 44100 && state.numFrames < 44100 + 64, "callback frame count mismatch");
+    fail_unless(measureTHDN(output + 2 * 4800, numFrames - 4800, 2, 1000.0, 48000.0) < -70.0,
+                "the loopback should reproduce the input sine");
+    
+    const double latency = mnEngine_getRoundTripLatency(&engine);
+    const double expected = 2.0 * (numFrames % 256) / 48000.0 +
+                            mnResampler_getLatency(&engine.inputResampler) +
+                            mnResampler_getLatency(&engine.outputResampler);
+    fail_unless(latency > expected - 1e-9 && latency < expected + 1e-9,
+                "the latency should include the resampler delays");
+    
+    mnEngine_deinit(&engine);
+    free(input);
+    free(inputShorts);
+    free(outputShorts);
+    free(output);
+}
+
+void testResampler()
+{
+    testStreaming();
+    testPull();
+    testQuality();
+    testSIMD();
+    testEngine();
+}
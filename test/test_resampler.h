@@ -0,0 +1,17 @@
+#ifndef DR_TEST_RESAMPLER_H
+#define DR_TEST_RESAMPLER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testResampler();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_RESAMPLER_H
+
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+#include "testmacros.h"
+#include "test_sample_format.h"
+
+#include "sample_format.h"
+#include "simd.h"
+
+//not a multiple of any vector width, so the scalar tails are exercised
+#define NUM_SAMPLES 1027
+
+static void fillRandom(float* buffer, int size)
+{
+    srand(1234);
+    for (int i = 0; i < size; i++)
+    {
+        //include out of range values to test clipping
+        buffer[i] = 3.0f * ((float)rand() / (float)RAND_MAX) - 1.5f;
+    }
+    buffer[0] = 1.0f;
+    buffer[1] = -1.0f;
+    buffer[2] = 1.0001f;
+    buffer[3] = -1.0001f;
+    buffer[4] = 0.0f;
+}
+
+/**
+ * Runs all conversions with the given instruction set and checks that the
+ * results are identical to those of the plain C reference.
+ */
+static void testLevelMatchesReference(mnSIMDLevel level)
+{
+    static float source[NUM_SAMPLES];
+    fillRandom(source, NUM_SAMPLES);
+    
+    const mnSampleFormat formats[] =
+    {
+        MN_SAMPLE_FORMAT_FLOAT32,
+        MN_SAMPLE_FORMAT_INT16,
+        MN_SAMPLE_FORMAT_INT24,
+        MN_SAMPLE_FORMAT_INT32
+    };
+    
+    for (int f = 0; f < 4; f++)
+    {
+        for (int useDither = 0; useDither < 2; useDither++)
+        {
+            static unsigned char reference[4 * NUM_SAMPLES];
+            static unsigned char converted[4 * NUM_SAMPLES];
+            static float referenceFloats[NUM_SAMPLES];
+            static float convertedFloats[NUM_SAMPLES];
+            const int numBytes = NUM_SAMPLES * mnSampleFormat_getBytesPerSample(formats[f]);
+            
+            mnDither dither;
+            
+            mnSIMD_setLevel(MN_SIMD_NONE);
+            mnDither_init(&dither, 42);
+            mnConvertFromFloat(source, reference, formats[f], NUM_SAMPLES, useDither ? &dither : NULL);
+            mnConvertToFloat(reference, formats[f], referenceFloats, NUM_SAMPLES);
+            
+            mnSIMD_setLevel(level);
+            mnDither_init(&dither, 42);
+            mnConvertFromFloat(source, converted, formats[f], NUM_SAMPLES, useDither ? &dither : NULL);
+            mnConvertToFloat(converted, formats[f], convertedFloats, NUM_SAMPLES);
+            
+            fail_unless(memcmp(reference, converted, numBytes) == 0,
+                        "vectorized conversion from float should match the reference implementation");
+            fail_unless(memcmp(referenceFloats, convertedFloats, NUM_SAMPLES * sizeof(float)) == 0,
+                        "vectorized conversion to float should match the reference implementation");
+        }
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+}
+
+static void testSIMDMatchesReference()
+{
+    start_test("Sample format - vectorized conversions match reference");
+    
+    const mnSIMDLevel levels[] = {MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    for (int i = 0; i < 3; i++)
+    {
+        mnSIMD_setLevel(levels[i]);
+        if (mnSIMD_getLevel() == levels[i])
+        {
+            testLevelMatchesReference(levels[i]);
+        }
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+}
+
+static void testClipping()
+{
+    start_test("Sample format - clipping");
+    
+    const float source[8] = {1.0f, -1.0f, 1.0001f, -1.0001f, 2.0f, -2.0f, 100.0f, -100.0f};
+    
+    short int16[8];
+    mnFloatToInt16(source, int16, 8);
+    fail_unless(int16[0] == 32767 && int16[1] == -32767, "full scale floats should map to full scale shorts");
+    fail_unless(int16[2] == 32767 && int16[4] == 32767 && int16[6] == 32767,
+                "floats above 1 should saturate to the largest short");
+    fail_unless(int16[3] == -32768 && int16[5] == -32768 && int16[7] == -32768,
+                "floats below -1 should saturate to the smallest short");
+    
+    int int32[8];
+    mnFloatToInt32(source, int32, 8);
+    fail_unless(int32[2] > 2147483000 && int32[4] > 2147483000 && int32[6] > 2147483000,
+                "floats above 1 should saturate to a large positive int");
+    fail_unless(int32[3] == -2147483647 - 1 && int32[7] == -2147483647 - 1,
+                "floats below -1 should saturate to the smallest int");
+    
+    unsigned char int24[3 * 8];
+    float roundTrip[8];
+    mnFloatToInt24(source, int24, 8, NULL);
+    mnInt24ToFloat(int24, roundTrip, 8);
+    fail_unless(roundTrip[6] > 0.9999f && roundTrip[6] <= 1.0f, "floats above 1 should saturate in 24 bits");
+    fail_unless(roundTrip[7] == -1.0f, "floats below -1 should saturate in 24 bits");
+    
+    float float32[8];
+    mnFloatToFloat32(source, float32, 8);
+    fail_unless(float32[6] == 1.0f && float32[7] == -1.0f, "float output should be clipped to [-1, 1]");
+}
+
+static void testDither()
+{
+    start_test("Sample format - TPDF dither");
+    
+    static float source[NUM_SAMPLES];
+    static short plain[NUM_SAMPLES];
+    static short dithered[NUM_SAMPLES];
+    for (int i = 0; i < NUM_SAMPLES; i++)
+    {
+        source[i] = 0.25f * (float)i / NUM_SAMPLES;
+    }
+    
+    mnDither dither;
+    mnDither_init(&dither, 1);
+    mnFloatToInt16(source, plain, NUM_SAMPLES);
+    mnFloatToInt16Dithered(source, dithered, NUM_SAMPLES, &dither);
+    
+    int numDifferent = 0;
+    int maxDifference = 0;
+    int sumDifference = 0;
+    for (int i = 0; i < NUM_SAMPLES; i++)
+    {
+        const int d = dithered[i] - plain[i];
+        numDifferent += d != 0;
+        maxDifference = abs(d) > maxDifference ? abs(d) : maxDifference;
+        sumDifference += d;
+    }
+    
+    fail_unless(numDifferent > NUM_SAMPLES / 10, "dither should change a fair share of the samples");
+    fail_unless(maxDifference <= 1, "dither should not change samples by more than 1 LSB");
+    fail_unless(abs(sumDifference) < NUM_SAMPLES / 10, "dither should not add a DC offset");
+}
+
+static void testFormatConversion()
+{
+    start_test("Sample format - integer to float");
+    
+    const short int16[4] = {-32768, -16384, 0, 16384};
+    float f[4];
+    mnInt16ToFloat(int16, f, 4);
+    fail_unless(f[0] == -1.0f && f[1] == -0.5f && f[2] == 0.0f && f[3] == 0.5f,
+                "shorts should be converted to the expected floats");
+    
+    //-2^23, 2^22 and -1 as packed little endian 24 bit samples
+    const unsigned char int24[9] = {0x00, 0x00, 0x80, 0x00, 0x00, 0x40, 0xff, 0xff, 0xff};
+    mnInt24ToFloat(int24, f, 3);
+    fail_unless(f[0] == -1.0f && f[1] == 0.5f && f[2] == -1.0f / 8388608.0f,
+                "24 bit samples should be converted to the expected floats");
+    
+    const int int32[2] = {-2147483647 - 1, 1073741824};
+    mnInt32ToFloat(int32, f, 2);
+    fail_unless(f[0] == -1.0f && f[1] == 0.5f, "32 bit samples should be converted to the expected floats");
+}
+
+/**
+ * Checks that the planar conversions give the same samples as interleaved
+ * conversions, for every format, instruction set and a few channel counts.
+ */
+static void testPlanarMatchesInterleaved()
+{
+    start_test("Sample format - planar conversions match interleaved conversions");
+    
+    //odd, so the vector kernels' tails are exercised
+    const int numFrames = 341;
+    const int channelCounts[] = {1, 2, 3, 8};
+    const mnSIMDLevel levels[] = {MN_SIMD_NONE, MN_SIMD_SSE2, MN_SIMD_AVX2, MN_SIMD_NEON};
+    
+    static float interleaved[8 * 341];
+    static float planar[8][341];
+    static float roundTrip[8][341];
+    static unsigned char expected[4 * 8 * 341];
+    static unsigned char converted[4 * 8 * 341];
+    static float expectedFloats[8 * 341];
+    fillRandom(interleaved, 8 * numFrames);
+    
+    float* planarPtrs[8];
+    float* roundTripPtrs[8];
+    for (int c = 0; c < 8; c++)
+    {
+        planarPtrs[c] = planar[c];
+        roundTripPtrs[c] = roundTrip[c];
+    }
+    
+    int numMismatches = 0;
+    for (int l = 0; l < 4; l++)
+    {
+        mnSIMD_setLevel(levels[l]);
+        if (mnSIMD_getLevel() != levels[l])
+        {
+            continue;
+        }
+        
+        for (int n = 0; n < 4; n++)
+        {
+            const int numChannels = channelCounts[n];
+            for (int c = 0; c < numChannels; c++)
+            {
+                for (int i = 0; i < numFrames; i++)
+                {
+                    planar[c][i] = interleaved[i * numChannels + c];
+                }
+            }
+            
+            for (int f = MN_SAMPLE_FORMAT_FLOAT32; f <= MN_SAMPLE_FORMAT_INT32; f++)
+            {
+                const int numBytes = numFrames * numChannels * mnSampleFormat_getBytesPerSample(f);
+                mnConvertFromFloat(interleaved, expected, f, numFrames * numChannels, NULL);
+                mnConvertFromFloatPlanar((const float* const*)planarPtrs, numChannels, converted, f, numFrames, NULL);
+                if (memcmp(expected, converted, numBytes) != 0)
+                {
+                    numMismatches++;
+                }
+                
+                mnConvertToFloat(expected, f, expectedFloats, numFrames * numChannels);
+                mnConvertToFloatPlanar(expected, f, roundTripPtrs, numChannels, numFrames);
+                for (int c = 0; c < numChannels; c++)
+                {
+                    for (int i = 0; i < numFrames; i++)
+                    {
+                        if (roundTrip[c][i] != expectedFloats[i * numChannels + c])
+                        {
+                            numMismatches++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    mnSIMD_setLevel(mnSIMD_getBestLevel());
+    fail_unless(numMismatches == 0, "planar conversion mismatch");
+}
+
+void testSampleFormat()
+{
+    testFormatConversion();
+    testClipping();
+    testDither();
+    testSIMDMatchesReference();
+    testPlanarMatchesInterleaved();
+}
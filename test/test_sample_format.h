@@ -0,0 +1,17 @@
+#ifndef DR_TEST_SAMPLE_FORMAT_H
+#define DR_TEST_SAMPLE_FORMAT_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testSampleFormat();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_SAMPLE_FORMAT_H
+
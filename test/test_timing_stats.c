@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_timing_stats.h"
+
+#include "timing_stats.h"
+#include "engine.h"
+#include "backend_null.h"
+#include "backend_offline.h"
+
+static const float sampleRate = 48000;
+static const int numFrames = 480;
+//the duration of a buffer in seconds
+static const double period = 0.01;
+
+static int histogramSum(const mnTimingSnapshot* snapshot)
+{
+    int sum = 0;
+    for (int i = 0; i < MN_TIMING_NUM_LOAD_BINS; i++)
+    {
+        sum += snapshot->loadHistogram[i];
+    }
+    return sum;
+}
+
+static void testHistogram()
+{
+    start_test("Timing stats - load histogram and percentiles");
+    
+    mnTimingStats stats;
+    mnTimingStats_init(&stats);
+    
+    mnTimingSnapshot snapshot;
+    mnTimingStats_getSnapshot(&stats, &snapshot);
+    fail_unless(mnTimingSnapshot_getLoadPercentile(&snapshot, 99) == 0.0f, "empty stats should have zero load");
+    
+    for (int i = 0; i < 98; i++)
+    {
+        mnTimingStats_record(&stats, 0.25 * period, numFrames, sampleRate, -1.0);
+    }
+    mnTimingStats_record(&stats, 0.5 * period, numFrames, sampleRate, -1.0);
+    mnTimingStats_record(&stats, 1.5 * period, numFrames, sampleRate, -1.0);
+    
+    mnTimingStats_getSnapshot(&stats, &snapshot);
+    fail_unless(snapshot.numCallbacks == 100, "callback count mismatch");
+    fail_unless(histogramSum(&snapshot) == 100, "histogram sum mismatch");
+    fail_unless(snapshot.numMissedDeadlines == 0, "no deadlines should be missed without sample times");
+    fail_unless(snapshot.maxDurationMicroseconds == 15000, "max duration mismatch");
+    
+    const float binWidth = 1.0f / MN_TIMING_LOAD_BINS_PER_PERIOD;
+    fail_unless(mnTimingSnapshot_getLoadPercentile(&snapshot, 50) == 0.25f + binWidth, "p50 mismatch");
+    fail_unless(mnTimingSnapshot_getLoadPercentile(&snapshot, 99) == 0.5f + binWidth, "p99 mismatch");
+    fail_unless(mnTimingSnapshot_getLoadPercentile(&snapshot, 100) == 1.5f + binWidth, "p100 mismatch");
+    
+    //loads beyond the last bin are clamped
+    mnTimingStats_record(&stats, 100.0 * period, numFrames, sampleRate, -1.0);
+    mnTimingStats_getSnapshot(&stats, &snapshot);
+    fail_unless(snapshot.loadHistogram[MN_TIMING_NUM_LOAD_BINS - 1] == 1, "overload bin mismatch");
+}
+
+static void testMissedDeadlines()
+{
+    start_test("Timing stats - missed deadlines from sample time gaps");
+    
+    mnTimingStats stats;
+    mnTimingStats_init(&stats);
+    
+    const double sampleTimes[] = {1000, 1480, 1960, 2920, 3400, 4360};
+    for (int i = 0; i < 6; i++)
+    {
+        mnTimingStats_record(&stats, 0.001, numFrames, sampleRate, sampleTimes[i]);
+    }
+    
+    mnTimingSnapshot older;
+    mnTimingStats_getSnapshot(&stats, &older);
+    fail_unless(older.numMissedDeadlines == 2, "missed deadline count mismatch");
+    
+    //after a restart, the sample time may start over
+    mnTimingStats_restart(&stats);
+    mnTimingStats_record(&stats, 0.001, numFrames, sampleRate, 0.0);
+    mnTimingStats_record(&stats, 0.001, numFrames, sampleRate, 480.0);
+    
+    mnTimingSnapshot newer;
+    mnTimingStats_getSnapshot(&stats, &newer);
+    fail_unless(newer.numMissedDeadlines == 2, "a restart should not count as a missed deadline");
+    
+    mnTimingSnapshot interval;
+    mnTimingSnapshot_getInterval(&newer, &older, &interval);
+    fail_unless(interval.numCallbacks == 2, "interval callback count mismatch");
+    fail_unless(interval.numMissedDeadlines == 0, "interval missed deadline count mismatch");
+    fail_unless(histogramSum(&interval) == 2, "interval histogram sum mismatch");
+}
+
+typedef struct
+{
+    mnTimingStats stats;
+    int numRecords;
+} WriterContext;
+
+static int entryPointWriter(void* data)
+{
+    WriterContext* context = (WriterContext*)data;
+    for (int i = 0; i < context->numRecords; i++)
+    {
+        mnTimingStats_record(&context->stats, (i % 100) * 0.0002, numFrames, sampleRate, -1.0);
+        if (i % 64 == 0)
+        {
+            thrd_yield();
+        }
+    }
+    return 0;
+}
+
+static void testConcurrentSnapshots()
+{
+    start_test("Timing stats - consistent snapshots while recording");
+    
+    WriterContext context;
+    mnTimingStats_init(&context.stats);
+    context.numRecords = 200000;
+    
+    thrd_t writer;
+    thrd_create(&writer, entryPointWriter, &context);
+    
+    int numInconsistent = 0;
+    mnTimingSnapshot snapshot;
+    do
+    {
+        mnTimingStats_getSnapshot(&context.stats, &snapshot);
+        if (histogramSum(&snapshot) != snapshot.numCallbacks)
+        {
+            numInconsistent++;
+        }
+        thrd_yield();
+    }
+    while (snapshot.numCallbacks < context.numRecords);
+    
+    int joinRes;
+    thrd_join(writer, &joinRes);
+    
+    fail_unless(numInconsistent == 0, "torn snapshot");
+}
+
+static void slowOutputCallback(int numChannels, int numFrames, float* samples, void* context)
+{
+    int* numCalls = (int*)context;
+    (*numCalls)++;
+    if (*numCalls == 5)
+    {
+        //stall for several buffer periods
+        struct timespec duration = {0, 30000000};
+        thrd_sleep(&duration, NULL);
+    }
+}
+
+static void testEngineStats()
+{
+    start_test("Timing stats - engine integration");
+    
+    int numCalls = 0;
+    mnOptions options;
+    mnOptions_setDefaults(&options);
+    options.sampleRate = 32000;
+    options.bufferSizeInFrames = 64;
+    
+    //offline rendering never misses a deadline
+    mnEngine engine;
+    mnEngine_init(&engine, mnOfflineBackend_get(), NULL, slowOutputCallback, &numCalls, &options);
+    mnEngine_start(&engine);
+    mnOfflineBackend_render(&engine, NULL, NULL, 64 * 10);
+    
+    mnTimingSnapshot snapshot;
+    mnEngine_getTimingStats(&engine, &snapshot);
+    fail_unless(snapshot.numCallbacks == 10, "offline callback count mismatch");
+    fail_unless(snapshot.numMissedDeadlines == 0, "offline rendering missed a deadline");
+    fail_unless(snapshot.maxDurationMicroseconds >= 30000, "the stall was not measured");
+    fail_unless(snapshot.loadHistogram[MN_TIMING_NUM_LOAD_BINS - 1] == 1, "the stall should overload the buffer");
+    mnEngine_deinit(&engine);
+    
+    //the null device skips ahead after the stall
+    numCalls = 0;
+    mnEngine_init(&engine, mnNullBackend_get(), NULL, slowOutputCallback, &numCalls, &options);
+    mnEngine_start(&engine);
+    struct timespec duration = {0, 100000000};
+    thrd_sleep(&duration, NULL);
+    mnEngine_getTimingStats(&engine, &snapshot);
+    mnEngine_deinit(&engine);
+    
+    fail_unless(snapshot.numCallbacks > 5, "too few callbacks");
+    fail_unless(snapshot.numMissedDeadlines >= 1, "the stall was not detected as a missed deadline");
+}
+
+void testTimingStats()
+{
+    testHistogram();
+    testMissedDeadlines();
+    testConcurrentSnapshots();
+    testEngineStats();
+}
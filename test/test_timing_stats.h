@@ -0,0 +1,16 @@
+#ifndef DR_TEST_TIMING_STATS_H
+#define DR_TEST_TIMING_STATS_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testTimingStats();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_TIMING_STATS_H
@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_triple_buffer.h"
+
+#include "arena.h"
+#include "atomic.h"
+#include "triple_buffer.h"
+
+#define NUM_PARAMETERS 300
+
+static const int publishCount = 20000;
+
+typedef struct
+{
+    int version;
+    float parameters[NUM_PARAMETERS];
+} Patch;
+
+static void fillPatch(Patch* patch, int version)
+{
+    patch->version = version;
+    for (int i = 0; i < NUM_PARAMETERS; i++)
+    {
+        patch->parameters[i] = (float)version;
+    }
+}
+
+static void testLatestValue()
+{
+    start_test("Triple buffer - reader sees the latest value");
+    
+    Patch initial;
+    fillPatch(&initial, -1);
+    mnTripleBuffer buffer;
+    mnTripleBuffer_init(&buffer, sizeof(Patch), &initial);
+    
+    int isNew = 1;
+    const Patch* patch = mnTripleBuffer_read(&buffer, &isNew);
+    fail_unless(!isNew && patch->version == -1, "the initial value should be read before anything is published");
+    
+    for (int i = 0; i < 5; i++)
+    {
+        Patch* target = mnTripleBuffer_getWriteBuffer(&buffer);
+        fillPatch(target, i);
+        mnTripleBuffer_publish(&buffer);
+    }
+    
+    patch = mnTripleBuffer_read(&buffer, &isNew);
+    fail_unless(isNew && patch->version == 4, "only the latest of several publications should be read");
+    
+    const Patch* again = mnTripleBuffer_read(&buffer, &isNew);
+    fail_unless(!isNew && again == patch, "reading an unchanged value should not swap slots");
+    
+    Patch next;
+    fillPatch(&next, 5);
+    mnTripleBuffer_write(&buffer, &next);
+    fail_unless(patch->version == 4, "publishing should not touch the slot being read");
+    patch = mnTripleBuffer_read(&buffer, &isNew);
+    fail_unless(isNew && patch->version == 5, "a written value should be read");
+    
+    mnTripleBuffer_deinit(&buffer);
+}
+
+typedef struct
+{
+    mnTripleBuffer* buffer;
+    /** Only accessed through atomic operations. */
+    int isDone;
+} WriterContext;
+
+static int entryPointWriter(void* data)
+{
+    WriterContext* context = (WriterContext*)data;
+    for (int v = 0; v < publishCount; v++)
+    {
+        fillPatch(mnTripleBuffer_getWriteBuffer(context->buffer), v);
+        mnTripleBuffer_publish(context->buffer);
+        if (v % 16 == 0)
+        {
+            thrd_yield();
+        }
+    }
+    mnAtomicStore(1, &context->isDone);
+    
+    return 0;
+}
+
+static void testConcurrentReadWrite()
+{
+    start_test("Triple buffer - concurrent reads see whole values in order");
+    
+    mnTripleBuffer buffer;
+    mnTripleBuffer_init(&buffer, sizeof(Patch), NULL);
+    
+    WriterContext context;
+    context.buffer = &buffer;
+    context.isDone = 0;
+    thrd_t writer;
+    thrd_create(&writer, entryPointWriter, &context);
+    
+    int numTorn = 0;
+    int numOutOfOrder = 0;
+    int lastVersion = 0;
+    int isDone = 0;
+    while (!isDone)
+    {
+        //checked before reading, so the final value is read after the writer is done
+        isDone = mnAtomicLoad(&context.isDone);
+        
+        const Patch* patch = mnTripleBuffer_read(&buffer, NULL);
+        for (int i = 0; i < NUM_PARAMETERS; i++)
+        {
+            numTorn += patch->parameters[i] != (float)patch->version;
+        }
+        numOutOfOrder += patch->version < lastVersion;
+        lastVersion = patch->version;
+        thrd_yield();
+    }
+    
+    int joinRes;
+    thrd_join(writer, &joinRes);
+    
+    fail_unless(numTorn == 0, "a value should never be read while it is written");
+    fail_unless(numOutOfOrder == 0, "values should be read in publication order");
+    fail_unless(lastVersion == publishCount - 1, "the last published value should be read");
+    
+    mnTripleBuffer_deinit(&buffer);
+}
+
+static void testSlotLayout()
+{
+    start_test("Triple buffer - slots are cache line aligned and padded");
+    
+    const int sizes[] = {0, 1, MN_CACHE_LINE_SIZE, MN_CACHE_LINE_SIZE + 1, (int)sizeof(Patch)};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+        mnTripleBuffer buffer;
+        fail_unless(mnTripleBuffer_init(&buffer, sizes[i], NULL), "init failed");
+        fail_unless(buffer.stride >= sizes[i] && buffer.stride >= MN_CACHE_LINE_SIZE, "slots should not overlap");
+        fail_unless(buffer.stride % MN_CACHE_LINE_SIZE == 0, "slots should be whole cache lines");
+        for (int slot = 0; slot < 3; slot++)
+        {
+            const size_t address = (size_t)(buffer.slots + slot * buffer.stride);
+            fail_unless(address % MN_CACHE_LINE_SIZE == 0, "slots should start on a cache line");
+        }
+        mnTripleBuffer_deinit(&buffer);
+    }
+    
+    mnTripleBuffer buffer;
+    fail_unless(!mnTripleBuffer_init(&buffer, -1, NULL), "a negative size should be rejected");
+}
+
+void testTripleBuffer()
+{
+    testLatestValue();
+    testConcurrentReadWrite();
+    testSlotLayout();
+}
@@ -0,0 +1,17 @@
+#ifndef DR_TEST_TRIPLE_BUFFER_H
+#define DR_TEST_TRIPLE_BUFFER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testTripleBuffer();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_TRIPLE_BUFFER_H
+
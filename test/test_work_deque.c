@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include "tinycthread.h"
+#include "testmacros.h"
+#include "test_work_deque.h"
+
+#include "atomic.h"
+#include "work_deque.h"
+
+#define NUM_THIEVES 3
+
+static const int numItems = 100000;
+
+static void testSingleThread()
+{
+    start_test("Work deque - take is LIFO, steal is FIFO");
+    
+    mnWorkDeque deque;
+    mnWorkDeque_init(&deque, 6);
+    fail_unless(deque.capacity == 8, "capacity should be rounded up to a power of two");
+    
+    //go a few laps to exercise slot reuse
+    for (int lap = 0; lap < 3; lap++)
+    {
+        int pushed = 0;
+        for (int i = 0; i < 9; i++)
+        {
+            pushed += mnWorkDeque_push(&deque, i);
+        }
+        fail_unless(pushed == 8, "push to a full deque should fail");
+        
+        int item = -1;
+        fail_unless(mnWorkDeque_take(&deque, &item) && item == 7, "take should return the newest item");
+        fail_unless(mnWorkDeque_steal(&deque, &item) && item == 0, "steal should return the oldest item");
+        fail_unless(mnWorkDeque_take(&deque, &item) && item == 6, "take should return the newest item");
+        
+        int numLeft = 0;
+        while (mnWorkDeque_take(&deque, &item))
+        {
+            numLeft++;
+        }
+        fail_unless(numLeft == 5, "take should return every remaining item");
+        fail_unless(!mnWorkDeque_steal(&deque, &item), "steal from an empty deque should fail");
+    }
+    
+    mnWorkDeque_deinit(&deque);
+}
+
+typedef struct
+{
+    mnWorkDeque* deque;
+    int* timesSeen;
+    /** Only accessed through atomic operations. */
+    int* numConsumed;
+} ThiefContext;
+
+static int entryPointThief(void* data)
+{
+    ThiefContext* context = (ThiefContext*)data;
+    while (mnAtomicLoad(context->numConsumed) < numItems)
+    {
+        int item;
+        if (mnWorkDeque_steal(context->deque, &item))
+        {
+            mnAtomicAdd(&context->timesSeen[item], 1);
+            mnAtomicAdd(context->numConsumed, 1);
+        }
+        else
+        {
+            thrd_yield();
+        }
+    }
+    
+    return 0;
+}
+
+static void testConcurrentStealing()
+{
+    start_test("Work deque - every item is taken or stolen exactly once");
+    
+    mnWorkDeque deque;
+    mnWorkDeque_init(&deque, 64);
+    int* timesSeen = calloc(numItems, sizeof(int));
+    int numConsumed = 0;
+    
+    thrd_t threads[NUM_THIEVES];
+    ThiefContext context;
+    context.deque = &deque;
+    context.timesSeen = timesSeen;
+    context.numConsumed = &numConsumed;
+    for (int t = 0; t < NUM_THIEVES; t++)
+    {
+        thrd_create(&threads[t], entryPointThief, &context);
+    }
+    
+    //the owner pushes in bursts and takes some items back, racing the thieves for the last one
+    int next = 0;
+    while (mnAtomicLoad(&numConsumed) < numItems)
+    {
+        for (int i = 0; i < 5 && next < numItems; i++)
+        {
+            if (mnWorkDeque_push(&deque, next))
+            {
+                next++;
+            }
+        }
+        
+        int item;
+        if (mnWorkDeque_take(&deque, &item))
+        {
+            mnAtomicAdd(&timesSeen[item], 1);
+            mnAtomicAdd(&numConsumed, 1);
+        }
+        else if (next == numItems)
+        {
+            thrd_yield();
+        }
+    }
+    
+    for (int t = 0; t < NUM_THIEVES; t++)
+    {
+        int joinRes;
+        thrd_join(threads[t], &joinRes);
+    }
+    
+    int errors = 0;
+    for (int i = 0; i < numItems; i++)
+    {
+        errors += timesSeen[i] != 1;
+    }
+    fail_unless(errors == 0, "every item should be consumed exactly once");
+    
+    free(timesSeen);
+    mnWorkDeque_deinit(&deque);
+}
+
+static void testOutOfRangeCapacity()
+{
+    start_test("Work deque - out of range capacity");
+    
+    mnWorkDeque deque;
+    fail_unless(!mnWorkDeque_init(&deque, 0), "a zero capacity should be rejected");
+    fail_unless(!mnWorkDeque_init(&deque, (1 << 30) + 1), "a capacity above 2^30 should be rejected");
+    mnWorkDeque_deinit(&deque);
+}
+
+void testWorkDeque()
+{
+    testSingleThread();
+    testConcurrentStealing();
+    testOutOfRangeCapacity();
+}
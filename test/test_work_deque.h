@@ -0,0 +1,17 @@
+#ifndef DR_TEST_WORK_DEQUE_H
+#define DR_TEST_WORK_DEQUE_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    
+    void testWorkDeque();
+    
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //DR_TEST_WORK_DEQUE_H
+